@@ -0,0 +1,161 @@
+/*************************************************************************************************/
+/*  Standalone sub-allocator managing regions within a larger memory block (e.g. a GPU buffer)   */
+/*************************************************************************************************/
+
+#ifndef DVZ_ALLOC_HEADER
+#define DVZ_ALLOC_HEADER
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_ALLOC_DEFAULT_BLOCKS 64
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzAlloc DvzAlloc;
+typedef struct DvzAllocBlock DvzAllocBlock;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+struct DvzAllocBlock
+{
+    uint64_t offset;
+    uint64_t size;
+    bool is_free;
+};
+
+
+
+struct DvzAlloc
+{
+    uint64_t alignment;
+    uint64_t total_size;
+
+    // The blocks are sorted by offset and cover the whole [0, total_size) range. Adjacent free
+    // blocks are always merged.
+    uint32_t count, capacity;
+    DvzAllocBlock* blocks;
+};
+
+
+
+/*************************************************************************************************/
+/*  Sub-allocator                                                                                */
+/*************************************************************************************************/
+
+/**
+ * Create a sub-allocator.
+ *
+ * @param size the total size of the memory block to manage
+ * @param alignment the alignment of the allocated offsets and sizes (must be a power of two)
+ * @returns the sub-allocator
+ */
+DVZ_EXPORT DvzAlloc dvz_alloc(uint64_t size, uint64_t alignment);
+
+/**
+ * Allocate a new region.
+ *
+ * The smallest free block that fits the requested size is used (best fit). If there is no such
+ * block, the managed memory block is enlarged to the next power of two, and the caller is
+ * responsible for resizing the underlying memory accordingly.
+ *
+ * @param alloc the sub-allocator
+ * @param req_size the requested size, in bytes
+ * @param[out] resized if not NULL, set to the new total size if it had to be enlarged, 0 otherwise
+ * @returns the offset of the allocated region
+ */
+DVZ_EXPORT uint64_t dvz_alloc_new(DvzAlloc* alloc, uint64_t req_size, uint64_t* resized);
+
+/**
+ * Return the total size the managed memory block would have after allocating a new region.
+ *
+ * @param alloc the sub-allocator
+ * @param req_size the requested size, in bytes
+ * @returns the current total size if the region fits, or the enlarged total size otherwise
+ */
+DVZ_EXPORT uint64_t dvz_alloc_new_size(DvzAlloc* alloc, uint64_t req_size);
+
+/**
+ * Try to resize an allocated region in place.
+ *
+ * This only succeeds when shrinking the region, or when the block following it is free and large
+ * enough.
+ *
+ * @param alloc the sub-allocator
+ * @param offset the offset of the allocated region
+ * @param new_size the new size, in bytes
+ * @returns whether the region could be resized in place
+ */
+DVZ_EXPORT bool dvz_alloc_resize(DvzAlloc* alloc, uint64_t offset, uint64_t new_size);
+
+/**
+ * Free an allocated region.
+ *
+ * @param alloc the sub-allocator
+ * @param offset the offset of the allocated region
+ */
+DVZ_EXPORT void dvz_alloc_free(DvzAlloc* alloc, uint64_t offset);
+
+/**
+ * Return the size of an allocated region, or 0 if there is no region at that offset.
+ *
+ * @param alloc the sub-allocator
+ * @param offset the offset of the allocated region
+ * @returns the aligned size of the region
+ */
+DVZ_EXPORT uint64_t dvz_alloc_get(DvzAlloc* alloc, uint64_t offset);
+
+/**
+ * Return the total number of allocated bytes.
+ *
+ * @param alloc the sub-allocator
+ * @returns the allocated size
+ */
+DVZ_EXPORT uint64_t dvz_alloc_size(DvzAlloc* alloc);
+
+/**
+ * Return the end of the last allocated region.
+ *
+ * @param alloc the sub-allocator
+ * @returns the offset just after the last allocated region
+ */
+DVZ_EXPORT uint64_t dvz_alloc_end(DvzAlloc* alloc);
+
+/**
+ * Free all regions.
+ *
+ * @param alloc the sub-allocator
+ */
+DVZ_EXPORT void dvz_alloc_clear(DvzAlloc* alloc);
+
+/**
+ * Destroy a sub-allocator.
+ *
+ * @param alloc the sub-allocator
+ */
+DVZ_EXPORT void dvz_alloc_destroy(DvzAlloc* alloc);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
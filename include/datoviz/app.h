@@ -18,6 +18,7 @@
 #include <vulkan/vulkan.h>
 
 #include "common.h"
+#include "workers.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -139,6 +140,7 @@ struct DvzApp
 
     // Threads.
     DvzThread timer_thread;
+    DvzWorkers* workers; // thread pool used to bake the visuals in parallel
 };
 
 
@@ -695,26 +695,79 @@ static inline void* dvz_array_item(DvzArray* array, uint32_t idx)
 
 
 
-// Cast a vector.
-static inline void _cast(DvzDataType target_dtype, void* dst, DvzDataType source_dtype, void* src)
+// Strided column copy loops. The item size is a compile-time constant in the specialized
+// loops, so that the compiler inlines the copies and vectorizes the double to float casts.
+#define _COLUMN_COPY(size)                                                                        \
+    for (uint32_t i = 0; i < count; i++)                                                          \
+        memcpy(dst + i * dst_stride, src + i * src_stride, (size))
+
+#define _COLUMN_CAST(n)                                                                           \
+    for (uint32_t i = 0; i < count; i++)                                                          \
+        for (uint32_t k = 0; k < (n); k++)                                                        \
+            ((float*)(dst + i * dst_stride))[k] =                                                 \
+                (float)((const double*)(src + i * src_stride))[k]
+
+// Copy, or cast from double to float if `components` is not zero, a strided column of items.
+static inline void _column_write(
+    char* dst, VkDeviceSize dst_stride, const char* src, VkDeviceSize src_stride, //
+    uint32_t count, VkDeviceSize col_size, uint32_t components)
 {
-    if (source_dtype == DVZ_DTYPE_DOUBLE && target_dtype == DVZ_DTYPE_FLOAT)
-    {
-        ((vec3*)dst)[0][0] = ((dvec3*)src)[0][0];
-    }
-    else if (source_dtype == DVZ_DTYPE_DVEC2 && target_dtype == DVZ_DTYPE_VEC2)
+    switch (components)
     {
-        ((vec3*)dst)[0][0] = ((dvec3*)src)[0][0];
-        ((vec3*)dst)[0][1] = ((dvec3*)src)[0][1];
+    case 1:
+        _COLUMN_CAST(1);
+        return;
+    case 2:
+        _COLUMN_CAST(2);
+        return;
+    case 3:
+        _COLUMN_CAST(3);
+        return;
+    default:
+        break;
     }
-    else if (source_dtype == DVZ_DTYPE_DVEC3 && target_dtype == DVZ_DTYPE_VEC3)
+
+    switch (col_size)
     {
-        ((vec3*)dst)[0][0] = ((dvec3*)src)[0][0];
-        ((vec3*)dst)[0][1] = ((dvec3*)src)[0][1];
-        ((vec3*)dst)[0][2] = ((dvec3*)src)[0][2];
+    case 4:
+        _COLUMN_COPY(4);
+        return;
+    case 8:
+        _COLUMN_COPY(8);
+        return;
+    case 12:
+        _COLUMN_COPY(12);
+        return;
+    case 16:
+        _COLUMN_COPY(16);
+        return;
+    case 24:
+        _COLUMN_COPY(24);
+        return;
+    default:
+        _COLUMN_COPY(col_size);
+        return;
     }
-    else
-        log_error("unknown casting dtypes %d %d", source_dtype, target_dtype);
+}
+
+#undef _COLUMN_COPY
+#undef _COLUMN_CAST
+
+
+
+// Number of components of a supported cast, 0 if there is no cast, -1 if it is not supported.
+static inline int _cast_components(DvzDataType source_dtype, DvzDataType target_dtype)
+{
+    if (source_dtype == target_dtype || source_dtype == DVZ_DTYPE_NONE ||
+        target_dtype == DVZ_DTYPE_NONE)
+        return 0;
+    if (source_dtype == DVZ_DTYPE_DOUBLE && target_dtype == DVZ_DTYPE_FLOAT)
+        return 1;
+    if (source_dtype == DVZ_DTYPE_DVEC2 && target_dtype == DVZ_DTYPE_VEC2)
+        return 2;
+    if (source_dtype == DVZ_DTYPE_DVEC3 && target_dtype == DVZ_DTYPE_VEC3)
+        return 3;
+    return -1;
 }
 
 
@@ -752,63 +805,108 @@ static void dvz_array_column(
     ASSERT(item_count > 0);
     ASSERT(first_item + item_count <= array->item_count);
 
-    VkDeviceSize src_offset = 0;
     VkDeviceSize src_stride = col_size;
-
-    VkDeviceSize dst_offset = offset;
     VkDeviceSize dst_stride = array->item_size;
+    ASSERT(src_stride > 0);
+    ASSERT(dst_stride > 0);
 
-    void* dst = array->data;
-    const void* src = data;
+    log_trace(
+        "copy src stride %d, dst offset %d stride %d, item size %d count %d", //
+        src_stride, offset, dst_stride, col_size, item_count);
 
+    int components = _cast_components(source_dtype, target_dtype);
+    if (components < 0)
+    {
+        log_error("unknown casting dtypes %d %d", source_dtype, target_dtype);
+        return;
+    }
+
+    char* dst = (char*)array->data + first_item * dst_stride + offset;
+    const char* src = (const char*)data;
+
+    // Destination item i takes the source item i / reps. In SINGLE copy mode, only the first item
+    // of each group of reps items is written.
+    reps = MAX(1, reps);
+    bool single = copy_type == DVZ_ARRAY_COPY_SINGLE && reps > 1;
+
+    // Destination items taking the source items before the last one, in groups of reps items:
+    // one strided copy per position within the groups.
+    uint32_t n = (uint32_t)MIN((uint64_t)item_count, (uint64_t)(data_item_count - 1) * reps);
+    for (uint32_t m = 0; m < (single ? 1 : reps) && m < n; m++)
+        _column_write(
+            dst + m * dst_stride, reps * dst_stride, src, src_stride, //
+            (n - m + reps - 1) / reps, col_size, (uint32_t)components);
+
+    // The last source item is repeated until the end.
+    uint32_t step = single ? reps : 1;
+    if (n < item_count)
+        _column_write(
+            dst + n * dst_stride, step * dst_stride, src + (data_item_count - 1) * src_stride, 0,
+            (item_count - n + step - 1) / step, col_size, (uint32_t)components);
+}
+
+
+
+// Number of components of the cast between two arrays, 0 for a plain copy, -1 if unsupported.
+static inline int _array_cast_components(DvzArray* src, DvzArray* dst)
+{
     ASSERT(src != NULL);
     ASSERT(dst != NULL);
-    ASSERT(src_stride > 0);
-    ASSERT(dst_stride > 0);
-    ASSERT(item_count > 0);
+    int components = _cast_components(src->dtype, dst->dtype);
+    if (components == 0 && src->item_size != dst->item_size)
+        return -1;
+    return components;
+}
 
-    log_trace(
-        "copy src offset %d stride %d, dst offset %d stride %d, item size %d count %d", //
-        src_offset, src_stride, dst_offset, dst_stride, col_size, item_count);
 
-    int64_t src_byte = (int64_t)src + (int64_t)src_offset;
-    int64_t dst_byte = (int64_t)dst + (int64_t)(first_item * dst_stride) + (int64_t)dst_offset;
 
-    uint32_t j = 0; // j: src index
-    uint32_t m = 0;
-    bool skip = false;
-    for (uint32_t i = 0; i < item_count; i++) // i: dst index
-    {
-        if (reps > 1)
-            m = i % reps;
-        // Determine whether the current item copy should be skipped.
-        skip = copy_type == DVZ_ARRAY_COPY_SINGLE && reps > 1 && m > 0;
+// Cast or copy a range of items between two arrays, which must have been checked with
+// _array_cast_components(), the destination array being large enough.
+static inline void _array_cast_items(
+    DvzArray* src, DvzArray* dst, uint32_t first_item, uint32_t item_count, int components)
+{
+    ASSERT(src != NULL);
+    ASSERT(dst != NULL);
+    ASSERT(components >= 0);
+    ASSERT(first_item + item_count <= src->item_count);
+    ASSERT(first_item + item_count <= dst->item_count);
+    _column_write(
+        (char*)dst->data + first_item * dst->item_size, dst->item_size,
+        (const char*)src->data + first_item * src->item_size, src->item_size, //
+        item_count, dst->item_size, (uint32_t)components);
+}
 
-        // NOTE: this function is not optimized and might benefit from being refactored.
 
-        // Copy the current item, unless we are in SINGLE copy mode
-        if (!skip)
-        {
-            if (source_dtype == target_dtype ||   //
-                source_dtype == DVZ_DTYPE_NONE || //
-                target_dtype == DVZ_DTYPE_NONE)   //
-                memcpy((void*)dst_byte, (void*)src_byte, col_size);
-            else
-            {
-                _cast(target_dtype, (void*)dst_byte, source_dtype, (void*)src_byte);
-            }
-        }
 
-        // Advance the source pointer, unless we are in SINGLE copy mode
-        skip = reps > 1 && m < reps - 1;
-        if (j < data_item_count - 1 && !skip)
-        {
-            src_byte += (int64_t)src_stride;
-            j++;
-        }
+/**
+ * Cast an array of double-precision values or vectors to single precision.
+ *
+ * The destination array is resized to the number of items of the source array. Arrays with the
+ * same dtype are copied.
+ *
+ * @param src the source array, with a `DVZ_DTYPE_DOUBLE`, `DVZ_DTYPE_DVEC2` or `DVZ_DTYPE_DVEC3`
+ *      dtype
+ * @param dst the destination array, with the corresponding float dtype
+ * @returns whether the cast is supported, the destination array is left unchanged otherwise
+ */
+static bool dvz_array_cast(DvzArray* src, DvzArray* dst)
+{
+    ASSERT(src != NULL);
+    ASSERT(dst != NULL);
 
-        dst_byte += (int64_t)dst_stride;
+    int components = _array_cast_components(src, dst);
+    if (components < 0)
+    {
+        log_error("unsupported array cast from dtype %d to %d", src->dtype, dst->dtype);
+        return false;
     }
+    if (src->item_count == 0)
+        return true;
+    ASSERT(src->data != NULL);
+
+    dvz_array_resize(dst, src->item_count);
+    _array_cast_items(src, dst, 0, src->item_count, components);
+    return true;
 }
 
 
@@ -24,6 +24,9 @@ extern "C" {
 #define DVZ_MAX_EVENT_CALLBACKS 32
 // Maximum acceptable duration for the pending events in the event queue, in seconds
 #define DVZ_MAX_EVENT_DURATION .5
+#define DVZ_EVENT_QUEUE_CAPACITY 1024
+// Maximum duration of the wait for window events in on-demand rendering mode, in seconds
+#define DVZ_ON_DEMAND_MAX_WAIT .5
 #define DVZ_DEFAULT_BACKGROUND                                                                    \
     (VkClearColorValue)                                                                           \
     {                                                                                             \
@@ -49,7 +52,14 @@ extern "C" {
 #define DVZ_FENCES_FLIGHT             1
 #define DVZ_DEFAULT_COMMANDS_TRANSFER 0
 #define DVZ_DEFAULT_COMMANDS_RENDER   1
-#define DVZ_MAX_FRAMES_IN_FLIGHT      2
+#define DVZ_MAX_FRAMES_IN_FLIGHT      3
+#define DVZ_DEFAULT_FRAMES_IN_FLIGHT  2
+// Safety margin before the deadline of the next presentation in low-latency mode, in seconds
+#define DVZ_LOW_LATENCY_MARGIN .002
+// Weight of the new measurements in the smoothed frame pacing timings
+#define DVZ_PACING_SMOOTHING .1
+// Longer delays between two frames (for example in on-demand rendering mode) are not measured
+#define DVZ_PACING_MAX_PERIOD .1
 
 
 
@@ -65,6 +75,9 @@ typedef enum
     DVZ_CANVAS_FLAGS_FPS = 0x0003, // NOTE: 1 bit for ImGUI, 1 bit for FPS
     DVZ_CANVAS_FLAGS_PICK = 0x0004,
     DVZ_CANVAS_FLAGS_OFFSCREEN = 0x0008,
+    DVZ_CANVAS_FLAGS_COALESCE = 0x0010,
+    DVZ_CANVAS_FLAGS_ON_DEMAND = 0x0020,
+    DVZ_CANVAS_FLAGS_RENDER_THREAD = 0x0040,
 
     DVZ_CANVAS_FLAGS_DPI_SCALE_050 = 0x1000,
     DVZ_CANVAS_FLAGS_DPI_SCALE_100 = 0x2000,
@@ -156,6 +169,16 @@ typedef enum
 
 
 
+// Canvas render thread status.
+typedef enum
+{
+    DVZ_RENDER_THREAD_RUNNING,  // rendering the frames requested by dvz_app_run()
+    DVZ_RENDER_THREAD_RECREATE, // waiting for the main thread to recreate the swapchain
+    DVZ_RENDER_THREAD_STOP,
+} DvzRenderThreadStatus;
+
+
+
 // Screencast status.
 typedef enum
 {
@@ -203,6 +226,7 @@ typedef enum
     DVZ_EVENT_PRE_SEND,           // called before sending the commands buffers
     DVZ_EVENT_POST_SEND,          // called after sending the commands buffers
     DVZ_EVENT_DESTROY,            // called before destruction
+    DVZ_EVENT_COUNT,
 } DvzEventType;
 
 
@@ -212,6 +236,7 @@ typedef enum
 {
     DVZ_EVENT_MODE_SYNC,
     DVZ_EVENT_MODE_ASYNC,
+    DVZ_EVENT_MODE_COUNT,
 } DvzEventMode;
 
 
@@ -269,9 +294,11 @@ typedef union DvzEventUnion DvzEventUnion;
 
 typedef void (*DvzEventCallback)(DvzCanvas*, DvzEvent);
 typedef struct DvzEventCallbackRegister DvzEventCallbackRegister;
+typedef struct DvzEventCallbackTable DvzEventCallbackTable;
 
 typedef struct DvzScreencast DvzScreencast;
 typedef struct DvzPendingRefill DvzPendingRefill;
+typedef struct DvzFramePacing DvzFramePacing;
 
 // Forward declarations.
 typedef struct DvzGui DvzGui;
@@ -448,6 +475,7 @@ struct DvzScreencastEvent
 struct DvzRefillEvent
 {
     uint32_t img_idx;
+    uint32_t epoch; // changes at every complete refill request, see dvz_canvas_to_refill()
     uint32_t cmd_count;
     DvzCommands* cmds[32];
     DvzViewport viewport;
@@ -519,6 +547,15 @@ struct DvzEventCallbackRegister
 
 
 
+struct DvzEventCallbackTable
+{
+    // Indices of the registered callbacks in the canvas callbacks array, sorted by param.
+    atomic(uint32_t, count);
+    uint32_t indices[DVZ_MAX_EVENT_CALLBACKS];
+};
+
+
+
 /*************************************************************************************************/
 /*  Misc structs                                                                                 */
 /*************************************************************************************************/
@@ -547,6 +584,29 @@ struct DvzPendingRefill
 {
     bool completed[DVZ_MAX_SWAPCHAIN_IMAGES];
     atomic(DvzRefillStatus, status);
+    atomic(uint32_t, epoch); // number of complete refill requests
+
+    // Context buffer epoch at the start of the current refill, and at the end of the last
+    // complete refill: the recreated buffers of older epochs are not bound anymore.
+    uint64_t buffer_epoch;
+    atomic(uint64_t, buffer_epoch_done);
+};
+
+
+
+struct DvzFramePacing
+{
+    bool low_latency;
+
+    // Smoothed timings, in seconds.
+    double frame_period; // delay between two successive swapchain image acquisitions
+    double cpu_time;     // frame logic and submission
+    double gpu_time;     // from submission to the render finished fence
+
+    double frame_start;  // time of the last swapchain image acquisition
+    double submit_time;  // time of the last submission
+    uint32_t submit_frame;
+    bool submit_pending; // whether the GPU time of the last submission is still to be measured
 };
 
 
@@ -573,6 +633,10 @@ struct DvzCanvas
     atomic(DvzObjectStatus, cur_status);
     atomic(bool, to_close);
 
+    // On-demand rendering: a frame is only rendered when something has changed.
+    atomic(bool, on_demand);
+    atomic(bool, to_redraw);
+
     DvzWindow* window;
 
     // Swapchain.
@@ -592,6 +656,7 @@ struct DvzCanvas
     double fps, efps;
     double max_delay; // used to compute the effective frames per second (eFPS)
     double max_delay_roll[10];
+    DvzFramePacing pacing;
 
     // Renderpasses.
     DvzRenderpass renderpass;         // default renderpass
@@ -617,12 +682,22 @@ struct DvzCanvas
     // Event callbacks, running in the background thread, may be slow, for end-users.
     uint32_t callbacks_count;
     DvzEventCallbackRegister callbacks[DVZ_MAX_EVENT_CALLBACKS];
+    // Callbacks indexed by event type and mode, the tables are protected by a reader-writer lock.
+    DvzEventCallbackTable callback_tables[DVZ_EVENT_COUNT][DVZ_EVENT_MODE_COUNT];
+    pthread_rwlock_t callbacks_lock;
+    // Recursive lock held by async callbacks, and by the sync callbacks that access the same data.
+    pthread_mutex_t event_lock;
+
+    // Coalescing of high-rate MOUSE_MOVE and MOUSE_WHEEL events, dispatched once per frame.
+    atomic(bool, coalesce_events);
+    pthread_mutex_t coalesce_lock;
+    DvzEvent coalesced_move;
+    DvzEvent coalesced_wheel;
 
     // Event queue.
     DvzFifo event_queue;
     // DvzEvent events[DVZ_MAX_FIFO_CAPACITY];
     DvzThread event_thread;
-    bool enable_lock;
     atomic(DvzEventType, event_processing);
 
     bool captured; // if true, mouse and keyboard should not be processed
@@ -636,6 +711,18 @@ struct DvzCanvas
     DvzScreencast* screencast;
     DvzPendingRefill refills;
 
+    // Render thread, see dvz_canvas_render_thread().
+    atomic(bool, is_threaded);
+    DvzThread render_thread;
+    pthread_mutex_t render_lock;
+    pthread_cond_t render_cond;
+    atomic(DvzRenderThreadStatus, render_status);
+    uint64_t render_frames; // number of frames left to render, protected by the render lock
+    DvzFifo input_queue;    // input events forwarded by the main thread to the render thread
+    // Latest mouse position that did not fit in the full input queue, see _backend_input().
+    atomic(bool, input_move_pending);
+    atomic(uint64_t, input_move_pos);
+
     DvzViewport viewport;
     DvzScene* scene;
 };
@@ -816,9 +903,16 @@ DVZ_EXPORT void dvz_canvas_dpi_scaling(DvzCanvas* canvas, float scaling);
  *
  * The event object has a field with the user-specified pointer `user_data`.
  *
+ * The callbacks of a given type are called by increasing `param`, and in registration order for
+ * equal params.
+ *
+ * Async callbacks are called while holding the event lock (see `dvz_event_lock()`). Sync
+ * callbacks are called without it: those accessing data that is also modified by async callbacks
+ * should take it explicitly.
+ *
  * @param canvas the canvas
  * @param type the event type
- * @param param time interval for TIMER events, in seconds
+ * @param param time interval for TIMER events in seconds, priority for other events
  * @param mode whether the callback is sync or async
  * @param callback the callback function
  * @param user_data a pointer to arbitrary user data
@@ -828,6 +922,46 @@ DVZ_EXPORT void dvz_event_callback(
     DvzCanvas* canvas, DvzEventType type, double param, DvzEventMode mode, //
     DvzEventCallback callback, void* user_data);
 
+/**
+ * Enable or disable the coalescing of mouse move and wheel events.
+ *
+ * When enabled, the MOUSE_MOVE and MOUSE_WHEEL events raised during a frame are merged into a
+ * single event of each type, with the latest position and the accumulated wheel delta, and the
+ * callbacks are called once, just before the FRAME callbacks. Consecutive events of these types
+ * pending in the async event queue are merged as well. The mouse state is still updated for
+ * every event. This option can also be set with the `DVZ_CANVAS_FLAGS_COALESCE` flag.
+ *
+ * @param canvas the canvas
+ * @param enable whether to coalesce mouse move and wheel events
+ */
+DVZ_EXPORT void dvz_event_coalesce(DvzCanvas* canvas, bool enable);
+
+/**
+ * Acquire the event lock of a canvas.
+ *
+ * This recursive lock is held during the async callbacks. Sync callbacks, or any other thread,
+ * should hold it while accessing data that async callbacks may modify concurrently.
+ *
+ * @param canvas the canvas
+ */
+DVZ_EXPORT void dvz_event_lock(DvzCanvas* canvas);
+
+/**
+ * Try to acquire the event lock of a canvas without blocking.
+ *
+ * @param canvas the canvas
+ * @returns whether the lock has been acquired, in which case it must be released with
+ *      `dvz_event_unlock()`
+ */
+DVZ_EXPORT bool dvz_event_trylock(DvzCanvas* canvas);
+
+/**
+ * Release the event lock of a canvas.
+ *
+ * @param canvas the canvas
+ */
+DVZ_EXPORT void dvz_event_unlock(DvzCanvas* canvas);
+
 
 
 /*************************************************************************************************/
@@ -837,10 +971,22 @@ DVZ_EXPORT void dvz_event_callback(
 /**
  * Trigger a canvas refill at the next frame.
  *
+ * The REFILL callbacks must re-record everything, cached command buffers become invalid.
+ *
  * @param canvas the canvas
  */
 DVZ_EXPORT void dvz_canvas_to_refill(DvzCanvas* canvas);
 
+/**
+ * Trigger a partial canvas refill at the next frame.
+ *
+ * The REFILL callbacks may only re-record the secondary command buffers they know have changed,
+ * the event's refill epoch does not change.
+ *
+ * @param canvas the canvas
+ */
+DVZ_EXPORT void dvz_canvas_to_refill_partial(DvzCanvas* canvas);
+
 /**
  * Close the canvas at the next frame.
  *
@@ -848,6 +994,91 @@ DVZ_EXPORT void dvz_canvas_to_refill(DvzCanvas* canvas);
  */
 DVZ_EXPORT void dvz_canvas_to_close(DvzCanvas* canvas);
 
+/**
+ * Only render frames when something has changed.
+ *
+ * In this mode, a frame is rendered after user input, window resize, scene updates, command
+ * buffer refills, GPU transfers, TIMER events, and calls to `dvz_canvas_redraw()`. Otherwise, the
+ * event loop waits for window events instead of presenting new swapchain images. This option can
+ * also be set with the `DVZ_CANVAS_FLAGS_ON_DEMAND` flag.
+ *
+ * !!! note
+ *     FRAME callbacks are only called when a frame is rendered. Animations must request the next
+ *     frame with `dvz_canvas_redraw()`.
+ *
+ * @param canvas the canvas
+ * @param enable whether to render frames on demand
+ */
+DVZ_EXPORT void dvz_canvas_on_demand(DvzCanvas* canvas, bool enable);
+
+/**
+ * Render a new frame, in on-demand rendering mode.
+ *
+ * This function can be called from any thread.
+ *
+ * @param canvas the canvas
+ */
+DVZ_EXPORT void dvz_canvas_redraw(DvzCanvas* canvas);
+
+/**
+ * Change the swapchain present mode.
+ *
+ * `VK_PRESENT_MODE_FIFO_KHR` waits for the vertical blank, `VK_PRESENT_MODE_MAILBOX_KHR`
+ * replaces the queued image with the most recent one, and `VK_PRESENT_MODE_IMMEDIATE_KHR`
+ * presents the images without waiting (with possible tearing). The FIFO mode is used if the
+ * requested mode is not supported. The swapchain is recreated, this function must be called from
+ * the main thread.
+ *
+ * @param canvas the canvas
+ * @param present_mode the present mode
+ */
+DVZ_EXPORT void dvz_canvas_present_mode(DvzCanvas* canvas, VkPresentModeKHR present_mode);
+
+/**
+ * Set the maximum number of frames that are being rendered by the GPU while the next one is
+ * prepared.
+ *
+ * More frames in flight improve the throughput, less frames in flight reduce the input latency.
+ * This function must be called from the main thread.
+ *
+ * @param canvas the canvas
+ * @param count the number of frames in flight, between 1 and `DVZ_MAX_FRAMES_IN_FLIGHT`
+ */
+DVZ_EXPORT void dvz_canvas_frames_in_flight(DvzCanvas* canvas, uint32_t count);
+
+/**
+ * Reduce the latency between user input and presentation.
+ *
+ * In this mode, the canvas waits for the previous frame to be rendered, then delays the sampling
+ * of the input and the frame logic (event callbacks, command buffer refills) until just before
+ * the next presentation deadline. The delay is estimated from the measured frame period, CPU time,
+ * and GPU time.
+ *
+ * @param canvas the canvas
+ * @param enable whether to enable the low-latency mode
+ */
+DVZ_EXPORT void dvz_canvas_low_latency(DvzCanvas* canvas, bool enable);
+
+/**
+ * Run the frame loop of a canvas in its own thread.
+ *
+ * During `dvz_app_run()`, the render thread acquires the swapchain images, calls the frame
+ * callbacks, and submits and presents the frames of the canvas, independently of the other
+ * canvases. The main thread still polls the window events, which are forwarded to the render
+ * thread, recreates the swapchain after a resize, and processes the GPU transfers. A slow canvas
+ * therefore does not slow down the other canvases. This option can also be set with the
+ * `DVZ_CANVAS_FLAGS_RENDER_THREAD` flag.
+ *
+ * !!! note
+ *     Canvases with a GUI are not supported, and the frame pacing options must be set before
+ *     enabling the render thread. This function must be called from the main thread, outside of
+ *     `dvz_app_run()`.
+ *
+ * @param canvas the canvas
+ * @param enable whether to render the canvas in its own thread
+ */
+DVZ_EXPORT void dvz_canvas_render_thread(DvzCanvas* canvas, bool enable);
+
 
 
 /*************************************************************************************************/
@@ -100,7 +100,7 @@ END_INCL_NO_WARN
 #define APPLICATION_NAME    "Datoviz canvas"
 #define APPLICATION_VERSION VK_MAKE_VERSION(1, 0, 0)
 
-#define DVZ_MAX_FRAMES_IN_FLIGHT    2
+#define DVZ_MAX_FRAMES_IN_FLIGHT    3
 #define DVZ_CONTAINER_DEFAULT_COUNT 64
 
 
@@ -5,6 +5,7 @@
 #ifndef DVZ_CONTEXT_HEADER
 #define DVZ_CONTEXT_HEADER
 
+#include "alloc.h"
 #include "colormaps.h"
 #include "common.h"
 #include "fifo.h"
@@ -30,6 +31,17 @@ extern "C" {
 #define DVZ_BUFFER_TYPE_STORAGE_SIZE (16 * 1024 * 1024)
 #define DVZ_BUFFER_TYPE_UNIFORM_SIZE (4 * 1024 * 1024)
 
+// Minimum alignment of the buffer regions allocated with dvz_ctx_buffers().
+#define DVZ_BUFFER_ALIGNMENT 16
+
+// Minimum size of a host-visible device-local heap for the vertex and storage buffers to be
+// allocated there, and written directly without staging when no frame is in flight, i.e. outside
+// of the event loop, or with idle canvases rendering on demand.
+#define DVZ_DIRECT_WRITE_MIN_HEAP_SIZE (256 * 1024 * 1024)
+
+// Maximum number of recreated buffers waiting to be destroyed.
+#define DVZ_MAX_DEFERRED_BUFFERS 16
+
 #define DVZ_ZERO_OFFSET                                                                           \
     (uvec3) { 0, 0, 0 }
 
@@ -67,6 +79,8 @@ typedef enum
 
 typedef struct DvzFontAtlas DvzFontAtlas;
 typedef struct DvzColorTexture DvzColorTexture;
+typedef struct DvzDeferredBuffer DvzDeferredBuffer;
+typedef struct DvzMemoryStats DvzMemoryStats;
 
 
 
@@ -95,14 +109,43 @@ struct DvzColorTexture
 
 
 
+struct DvzMemoryStats
+{
+    // Default buffers, per buffer type.
+    VkDeviceSize buffer_allocated[DVZ_BUFFER_TYPE_COUNT]; // size of the GPU buffer
+    VkDeviceSize buffer_used[DVZ_BUFFER_TYPE_COUNT];      // used by the buffer regions
+    VkDeviceSize buffer_deferred; // old buffers waiting to be destroyed after a resize
+
+    // Textures, including the font atlas and the colormap texture.
+    uint32_t texture_count;
+    VkDeviceSize texture_allocated;
+
+    VkDeviceSize total;  // total amount of GPU memory allocated by the context
+    VkDeviceSize budget; // soft budget, 0 if there is none
+
+    // Device-local heaps, see dvz_gpu_memory_budget().
+    bool has_heap_budget; // whether VK_EXT_memory_budget is available
+    VkDeviceSize heap_budget, heap_usage;
+};
+
+
+
+struct DvzDeferredBuffer
+{
+    DvzBuffer buffer;   // old Vulkan objects of a recreated buffer
+    uint32_t batch_idx; // transfer batch with the copy of the old data to the new buffer
+    uint64_t epoch;     // buffer epoch that the canvases must have refilled their commands past
+};
+
+
+
 struct DvzContext
 {
     DvzObject obj;
     DvzGpu* gpu;
 
-    // DvzCommands transfer_cmd;
-
     DvzContainer buffers;
+    DvzAlloc allocators[DVZ_BUFFER_TYPE_COUNT]; // sub-allocators of the buffer regions
     DvzContainer images;
     DvzContainer samplers;
     DvzContainer textures;
@@ -110,6 +153,30 @@ struct DvzContext
 
     // Data transfers.
     DvzFifo transfers;
+    DvzTransferBatch transfer_batch;
+
+    // Passes of dvz_process_transfers() started and completed. A pass processes all the transfers
+    // enqueued before it started.
+    atomic(uint64_t, transfer_passes_started);
+    atomic(uint64_t, transfer_passes_done);
+
+    // Caller-owned data to release after the pending transfers, see dvz_upload_release().
+    uint32_t release_count, release_capacity;
+    DvzTransferRelease* releases;
+
+    // Completed asynchronous downloads, whose callbacks are called without the GPU lock.
+    uint32_t downloads_done_count, downloads_done_capacity;
+    DvzTransferDownload* downloads_done;
+
+    // Recreated buffers, destroyed once the GPU does not use them anymore. The buffer epoch is
+    // incremented at each recreation, and the canvases record the epoch of their last complete
+    // refill.
+    atomic(uint64_t, buffer_epoch);
+    uint32_t deferred_count;
+    DvzDeferredBuffer deferred[DVZ_MAX_DEFERRED_BUFFERS];
+
+    // Soft budget for the GPU memory allocated by the context, 0 if there is none.
+    VkDeviceSize memory_budget;
 
     // Font atlas.
     DvzFontAtlas font_atlas;
@@ -164,6 +231,39 @@ DVZ_EXPORT void dvz_context_colormap(DvzContext* context);
 
 
 
+/*************************************************************************************************/
+/*  Memory                                                                                       */
+/*************************************************************************************************/
+
+/**
+ * Report the GPU memory allocated and used by a context.
+ *
+ * @param context the context
+ * @returns the memory statistics
+ */
+DVZ_EXPORT DvzMemoryStats dvz_context_memory_stats(DvzContext* context);
+
+/**
+ * Set a soft budget for the GPU memory allocated by a context.
+ *
+ * The buffer and texture allocations that would exceed the budget fail with an error instead of
+ * allocating more GPU memory.
+ *
+ * @param context the context
+ * @param budget the maximum amount of GPU memory, in bytes, or 0 to disable the budget
+ */
+DVZ_EXPORT void dvz_context_memory_budget(DvzContext* context, VkDeviceSize budget);
+
+/**
+ * Return the amount of GPU memory allocated for a texture.
+ *
+ * @param texture the texture
+ * @returns the size in bytes
+ */
+DVZ_EXPORT VkDeviceSize dvz_texture_memory(DvzTexture* texture);
+
+
+
 /*************************************************************************************************/
 /*  Buffer allocation                                                                            */
 /*************************************************************************************************/
@@ -171,6 +271,10 @@ DVZ_EXPORT void dvz_context_colormap(DvzContext* context);
 /**
  * Allocate one of several buffer regions on the GPU.
  *
+ * If the buffer needs to be enlarged beyond the memory budget of the context, the allocation
+ * fails and empty buffer regions are returned (with a NULL buffer). The buffer allocation
+ * functions may be called from any thread, they hold the GPU lock (see `dvz_gpu_lock()`).
+ *
  * @param context the context
  * @param buffer_type the type of buffer to allocate the regions on
  * @param buffer_count the number of buffer regions to allocate
@@ -182,6 +286,9 @@ DVZ_EXPORT DvzBufferRegions dvz_ctx_buffers(
 /**
  * Resize a set of buffer regions.
  *
+ * The regions are resized in place when possible, otherwise they are moved to a new location in
+ * the buffer. In the latter case, the existing data is not copied.
+ *
  * @param context the context
  * @param br the buffer regions to resize
  * @param new_size the new size of each buffer region, in bytes
@@ -189,6 +296,16 @@ DVZ_EXPORT DvzBufferRegions dvz_ctx_buffers(
 DVZ_EXPORT void
 dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceSize new_size);
 
+/**
+ * Free a set of buffer regions allocated with `dvz_ctx_buffers()`.
+ *
+ * The freed space may be reused by subsequent allocations.
+ *
+ * @param context the context
+ * @param br the buffer regions to free
+ */
+DVZ_EXPORT void dvz_ctx_buffers_free(DvzContext* context, DvzBufferRegions* br);
+
 
 
 /*************************************************************************************************/
@@ -212,6 +329,8 @@ DVZ_EXPORT DvzCompute* dvz_ctx_compute(DvzContext* context, const char* shader_p
 /**
  * Create a new GPU texture.
  *
+ * Return NULL if the texture would exceed the memory budget of the context.
+ *
  * @param context the context
  * @param dims the number of dimensions of the texture (1, 2, or 3)
  * @param size the width, height, and depth
@@ -226,10 +345,13 @@ dvz_ctx_texture(DvzContext* context, uint32_t dims, uvec3 size, VkFormat format)
  * !!! warning
  *     This function will delete the texture data.
  *
+ * The texture is left unchanged if the new image would exceed the memory budget of the context.
+ *
  * @param texture the texture
  * @param size the new size (width, height, depth)
+ * @returns whether the texture was resized
  */
-DVZ_EXPORT void dvz_texture_resize(DvzTexture* texture, uvec3 size);
+DVZ_EXPORT bool dvz_texture_resize(DvzTexture* texture, uvec3 size);
 
 /**
  * Set the texture filter.
@@ -253,10 +375,9 @@ DVZ_EXPORT void dvz_texture_address_mode(
 /**
  * Upload data to a GPU texture.
  *
- * !!! note
- *     This function should not be used to update a texture that is being used for rendering in the
- *     main event loop, otherwise full GPU synchronization needs to be done. Look at the Transfers
- *     API instead.
+ * The upload goes through the transfer batches, like `dvz_upload_texture()`, and the function
+ * blocks until the transfer has been executed. In the event loop, prefer the Transfers API which
+ * does not block.
  *
  * @param texture the texture
  * @param offset offset within the texture
@@ -270,10 +391,9 @@ DVZ_EXPORT void dvz_texture_upload(
 /**
  * Download a texture from the GPU to the CPU.
  *
- * !!! note
- *     This function should not be used to download from a texture that is being used for rendering
- *     in the main event loop, otherwise full GPU synchronization needs to be done. Look at the
- *     Transfers API instead.
+ * The download goes through the transfer batches, like `dvz_download_texture()`, and the
+ * function blocks until the data is available. In the event loop, prefer the asynchronous
+ * downloads of the Transfers API.
  *
  * @param texture the texture
  * @param offset offset within the texture
@@ -33,6 +33,7 @@ typedef struct DvzDeqItem DvzDeqItem;
 typedef struct DvzDeqCallbackRegister DvzDeqCallbackRegister;
 
 typedef void (*DvzDeqCallback)(DvzDeq* deq, void* item, void* user_data);
+typedef bool (*DvzFifoPredicate)(const void* item, void* user_data);
 
 
 
@@ -47,11 +48,26 @@ struct DvzFifo
     void** items;
     void* user_data;
 
+    // Typed FIFO queues store items by value in a preallocated ring instead of pointers. They
+    // have a fixed capacity, unless they are growable like the pointer queues.
+    uint32_t item_size;
+    uint8_t* values;
+    bool is_growable;
+
     pthread_mutex_t lock;
     pthread_cond_t cond;
 
     atomic(bool, is_processing);
     atomic(bool, is_empty);
+
+    // Lock-free multi-producer/single-consumer queues: the producers reserve a slot with an
+    // atomic counter, and each slot has a sequence number telling whether it is free or ready to
+    // be dequeued. The lock is only used by the consumer, and by the producers to wake it up.
+    bool is_mpsc;
+    atomic(uint64_t, enqueue_pos);
+    atomic(uint64_t, dequeue_pos);
+    atomic(uint64_t, *seqs);
+    atomic(bool, is_waiting);
 };
 
 
@@ -98,6 +114,38 @@ struct DvzDeq
  */
 DVZ_EXPORT DvzFifo dvz_fifo(int32_t capacity);
 
+/**
+ * Create a typed FIFO queue storing items by value.
+ *
+ * The items are copied into a ring buffer allocated once at creation, so that enqueueing never
+ * allocates memory. The capacity is fixed: when the queue is full, `dvz_fifo_push()` returns false
+ * and the producer should apply backpressure, for example by processing the pending items itself.
+ * Use `dvz_fifo_push()`, `dvz_fifo_push_first()` and `dvz_fifo_pop()` with typed FIFO queues.
+ *
+ * @param capacity the maximum size, the queue holds at most `capacity - 1` items
+ * @param item_size the size of each item, in bytes
+ * @returns a FIFO queue
+ */
+DVZ_EXPORT DvzFifo dvz_fifo_typed(int32_t capacity, uint32_t item_size);
+
+/**
+ * Create a lock-free multi-producer/single-consumer FIFO queue.
+ *
+ * Any number of threads can enqueue items concurrently without taking the queue lock. A single
+ * thread at a time should dequeue items. The consumer only blocks on the condition variable when
+ * the queue is empty, and producers only signal it when the consumer is waiting.
+ *
+ * The capacity is rounded up to a power of two and is fixed: when the queue is full, enqueuing
+ * fails immediately instead of waiting for the consumer, and the producer decides whether to
+ * drop, coalesce or retry the item. `dvz_fifo_enqueue_first()` and `dvz_fifo_push_first()` are
+ * not supported.
+ *
+ * @param capacity the maximum size
+ * @param item_size the size of each item in bytes, or 0 to store pointers
+ * @returns a FIFO queue
+ */
+DVZ_EXPORT DvzFifo dvz_fifo_mpsc(int32_t capacity, uint32_t item_size);
+
 /**
  * Enqueue an object in a queue.
  *
@@ -123,9 +171,68 @@ DVZ_EXPORT void dvz_fifo_enqueue_first(DvzFifo* fifo, void* item);
  */
 DVZ_EXPORT void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait);
 
+/**
+ * Copy an item at the end of a typed queue.
+ *
+ * Lock-free queues never wait for the consumer, they also return false when they are full.
+ *
+ * @param fifo the typed FIFO queue
+ * @param item the pointer to the item to copy, with `item_size` bytes
+ * @returns whether the item was enqueued, false if the queue is full
+ */
+DVZ_EXPORT bool dvz_fifo_push(DvzFifo* fifo, const void* item);
+
+/**
+ * Copy an item at the beginning of a typed queue.
+ *
+ * @param fifo the typed FIFO queue
+ * @param item the pointer to the item to copy, with `item_size` bytes
+ * @returns whether the item was enqueued, false if the queue is full
+ */
+DVZ_EXPORT bool dvz_fifo_push_first(DvzFifo* fifo, const void* item);
+
+/**
+ * Dequeue an item from a typed queue.
+ *
+ * @param fifo the typed FIFO queue
+ * @param out the pointer to the memory where to copy the dequeued item, with `item_size` bytes
+ * @param wait whether to return immediately, or wait until the queue is non-empty
+ * @returns whether an item was dequeued
+ */
+DVZ_EXPORT bool dvz_fifo_pop(DvzFifo* fifo, void* out, bool wait);
+
+/**
+ * Dequeue the first item of a typed queue only if it satisfies a predicate.
+ *
+ * The predicate is evaluated while holding the queue lock, so that the item cannot be dequeued or
+ * discarded by another thread in the meantime.
+ *
+ * @param fifo the typed FIFO queue
+ * @param out the pointer to the memory where to copy the dequeued item, with `item_size` bytes
+ * @param predicate the function called with a pointer to the first item
+ * @param user_data a pointer passed to the predicate
+ * @returns whether an item was dequeued
+ */
+DVZ_EXPORT bool dvz_fifo_pop_if(
+    DvzFifo* fifo, void* out, DvzFifoPredicate predicate, void* user_data);
+
+/**
+ * Return a pointer to a pending item in a typed queue, without dequeuing it.
+ *
+ * The caller should hold the queue lock, as the item may be dequeued by another thread.
+ *
+ * @param fifo the typed FIFO queue
+ * @param idx the index of the item, from 0 (first item to be dequeued) to the queue size
+ * @returns a pointer to the item, or NULL if a lock-free queue has not finished writing it yet
+ */
+DVZ_EXPORT void* dvz_fifo_peek(DvzFifo* fifo, int32_t idx);
+
 /**
  * Get the number of items in a queue.
  *
+ * This function does not take the lock with lock-free queues, the returned value may then include
+ * items still being enqueued.
+ *
  * @param fifo the FIFO queue
  * @returns the number of elements in the queue
  */
@@ -103,8 +103,13 @@ struct DvzPanel
     DvzBufferRegions br_mvp; // for the uniform buffer containing the MVP
 
     DvzController* controller;
-    DvzCommands* cmds;
     int prority_max;
+
+    // Secondary command buffers (one per swapchain image) recorded by the scene REFILL callback,
+    // so that a panel can be re-recorded independently of the others.
+    DvzCommands cmds;
+    bool cmds_valid[DVZ_MAX_SWAPCHAIN_IMAGES];     // whether the command buffer is up to date
+    uint32_t cmds_epoch[DVZ_MAX_SWAPCHAIN_IMAGES]; // canvas refill epoch at the last recording
 };
 
 
@@ -164,7 +169,7 @@ DVZ_EXPORT void dvz_grid_destroy(DvzGrid* grid);
  * @param grid the grid
  * @param row the row index in the grid
  * @param col the column index in the grid
- * @returns the panel
+ * @returns the panel, or NULL if its uniform buffer exceeds the memory budget of the context
  */
 DVZ_EXPORT DvzPanel* dvz_panel(DvzGrid* grid, uint32_t row, uint32_t col);
 
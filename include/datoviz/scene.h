@@ -73,12 +73,24 @@ typedef enum
 
 
 
+// Status of the scene update thread.
+typedef enum
+{
+    DVZ_SCENE_ASYNC_IDLE,      // no scene update is being processed
+    DVZ_SCENE_ASYNC_REQUESTED, // the thread must process the pending scene updates
+    DVZ_SCENE_ASYNC_READY,     // the visuals have been baked, their GPU upload is pending
+    DVZ_SCENE_ASYNC_STOP,      // the thread must stop
+} DvzSceneAsyncStatus;
+
+
+
 /*************************************************************************************************/
 /*  Typedefs                                                                                     */
 /*************************************************************************************************/
 
 typedef struct DvzScene DvzScene;
 typedef struct DvzSceneUpdate DvzSceneUpdate;
+typedef struct DvzPanelFill DvzPanelFill;
 typedef struct DvzController DvzController;
 typedef struct DvzTransformOLD DvzTransformOLD;
 typedef struct DvzAxes2D DvzAxes2D;
@@ -92,6 +104,16 @@ typedef void (*DvzControllerCallback)(DvzController* controller, DvzEvent ev);
 /*  Structs                                                                                      */
 /*************************************************************************************************/
 
+struct DvzPanelFill
+{
+    DvzPanel* panel;
+    uint32_t img_idx;
+    uint32_t epoch;
+    VkClearColorValue clear_color;
+};
+
+
+
 struct DvzSceneUpdate
 {
     DvzSceneUpdateType type;
@@ -161,6 +183,32 @@ struct DvzScene
 
     // FIFO queue with the pending scene updates.
     DvzFifo update_fifo;
+
+    // Visuals that have changed since the last scene update pass, baked in parallel at the end of
+    // the next one.
+    DvzSceneUpdate* visuals_changed;
+    uint32_t visuals_changed_count, visuals_changed_capacity;
+
+    // Panels whose data coordinates have changed, all their visuals must be renormalized.
+    DvzPanel** panels_changed;
+    uint32_t panels_changed_count, panels_changed_capacity;
+
+    // Panel command buffers to record in parallel, and to execute, during a refill.
+    DvzPanelFill* panel_fills;
+    DvzCommands** panel_cmds;
+    uint32_t panel_fills_capacity;
+
+    // Optional scene update thread, see dvz_scene_async_updates().
+    bool is_async;
+    DvzThread update_thread;
+    pthread_mutex_t async_lock;
+    pthread_cond_t async_cond;
+    atomic(DvzSceneAsyncStatus, async_status);
+    uint64_t async_upload_pass; // transfer pass processing the uploads of the last commit
+
+    // Visuals baked by the scene update thread, uploaded by the render thread at the next frame.
+    DvzSceneUpdate* visuals_baked;
+    uint32_t visuals_baked_count, visuals_baked_capacity;
 };
 
 
@@ -195,6 +243,23 @@ DVZ_EXPORT void dvz_scene_destroy(DvzScene* scene);
 
 
 
+/**
+ * Process the scene updates in a dedicated thread.
+ *
+ * When enabled, the visuals are baked in a background thread while the render thread keeps
+ * drawing the last uploaded data. The baked visuals are uploaded to the GPU at the next frame
+ * boundary, and the next pass only starts once these transfers have been processed. The
+ * controllers stay responsive at the refresh rate while the thread is busy.
+ *
+ * FRAME callbacks that modify visuals must then hold the event lock, see `dvz_event_lock()`.
+ *
+ * @param scene the scene
+ * @param enable whether to process the scene updates in a dedicated thread
+ */
+DVZ_EXPORT void dvz_scene_async_updates(DvzScene* scene, bool enable);
+
+
+
 /*************************************************************************************************/
 /*  Controller                                                                                   */
 /*************************************************************************************************/
@@ -275,7 +340,7 @@ dvz_controller_builtin(DvzPanel* panel, DvzControllerType type, int flags);
  * @param col the column index (0-based)
  * @param type the controller type
  * @param flags flags for the builtin controller
- * @returns the panel
+ * @returns the panel, or NULL if it could not be created
  */
 DVZ_EXPORT DvzPanel*
 dvz_scene_panel(DvzScene* scene, uint32_t row, uint32_t col, DvzControllerType type, int flags);
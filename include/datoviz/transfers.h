@@ -10,6 +10,17 @@
 
 
 
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_MAX_TRANSFER_BATCHES      2
+#define DVZ_MAX_TRANSFER_DOWNLOADS    64
+#define DVZ_MAX_TRANSFER_DESTINATIONS 16
+#define DVZ_TRANSFER_ALIGNMENT        16
+
+
+
 /*************************************************************************************************/
 /*  Transfer enums                                                                               */
 /*************************************************************************************************/
@@ -38,6 +49,17 @@ typedef struct DvzTransferBufferCopy DvzTransferBufferCopy;
 typedef struct DvzTransferTexture DvzTransferTexture;
 typedef struct DvzTransferTextureCopy DvzTransferTextureCopy;
 typedef union DvzTransferUnion DvzTransferUnion;
+typedef struct DvzTransferDownload DvzTransferDownload;
+typedef struct DvzTransferCopies DvzTransferCopies;
+typedef struct DvzTransferBatch DvzTransferBatch;
+typedef struct DvzTransferRelease DvzTransferRelease;
+
+// Callback called when an asynchronous download has completed.
+typedef void (*DvzDownloadCallback)(
+    DvzContext* context, uint64_t download_id, void* data, VkDeviceSize size, void* user_data);
+
+// Callback called when caller-owned data is not used anymore.
+typedef void (*DvzDataReleaseCallback)(void* data, void* user_data);
 
 
 
@@ -95,6 +117,83 @@ struct DvzTransfer
 {
     DvzDataTransferType type;
     DvzTransferUnion u;
+
+    // Asynchronous downloads.
+    uint64_t download_id; // 0 for blocking downloads
+    DvzDownloadCallback callback;
+    void* user_data;
+};
+
+
+
+// Pending download: the data is copied from the staging buffer once its batch has completed.
+struct DvzTransferDownload
+{
+    VkDeviceSize staging_offset, size;
+    void* data;
+
+    uint64_t download_id; // 0 for blocking downloads
+    bool is_last;         // whether this is the last chunk of the download
+    VkDeviceSize total_size;
+    void* total_data;
+    DvzDownloadCallback callback;
+    void* user_data;
+};
+
+
+
+// Pending copies from the staging buffer to the same buffer, recorded with a single command.
+struct DvzTransferCopies
+{
+    DvzBuffer* buffer;
+    VkDeviceSize dst_min, dst_max; // bounds of the destination regions
+    uint32_t count, capacity;
+    VkBufferCopy* regions;
+};
+
+
+
+// Transfers recorded into a single command buffer and submitted together, instead of one
+// submission followed by a queue-wide wait per transfer.
+struct DvzTransferBatch
+{
+    DvzCommands cmds; // one command buffer per batch in flight
+    DvzFences fences; // signaled when the corresponding batch has been executed
+    uint32_t idx;     // index of the command buffer and fence of the current batch
+    bool recording;   // whether the current batch has started recording
+    uint32_t count;   // number of transfers recorded in the current batch
+
+    // Ring allocator in the persistently-mapped staging buffer.
+    VkDeviceSize staging_head;                            // next free byte
+    VkDeviceSize staging_used;                            // reserved bytes, in flight or not
+    VkDeviceSize staging_sizes[DVZ_MAX_TRANSFER_BATCHES]; // reserved bytes per batch
+
+    // Pending uploads, grouped by destination buffer.
+    uint32_t copies_count;
+    DvzTransferCopies copies[DVZ_MAX_TRANSFER_DESTINATIONS];
+
+    // Pending downloads, per batch. The batches with blocking downloads are waited for upon
+    // submission, the other ones are completed when their fence is found signaled.
+    bool download_wait; // whether the current batch has a blocking download
+    uint32_t download_count[DVZ_MAX_TRANSFER_BATCHES];
+    DvzTransferDownload downloads[DVZ_MAX_TRANSFER_BATCHES][DVZ_MAX_TRANSFER_DOWNLOADS];
+
+    atomic(uint64_t, download_next); // last asynchronous download id that has been handed out
+
+    // Serial numbers of the batches, to know which context buffers are used by a pending batch.
+    uint64_t serial;                                // serial of the current or last batch
+    uint64_t serials[DVZ_MAX_TRANSFER_BATCHES];     // serial of the batch recorded in each slot
+    uint64_t buffer_serials[DVZ_BUFFER_TYPE_COUNT]; // last batch accessing each context buffer
+};
+
+
+
+// Caller-owned data released once the pending uploads, which may still read it, are processed.
+struct DvzTransferRelease
+{
+    void* data;
+    DvzDataReleaseCallback release;
+    void* user_data;
 };
 
 
@@ -106,6 +205,11 @@ struct DvzTransfer
 /**
  * Upload data to 1 or N buffer regions on the GPU while the app event loop is running.
  *
+ * The data is normally copied to the staging buffer, and from there to the buffer regions by the
+ * GPU. Host-visible device-local buffers are written directly instead, but only when no frame in
+ * flight may read them: outside of the event loop, or when all canvases render on demand and are
+ * idle. With continuous rendering, the uploads always go through the staging buffer.
+ *
  * @param canvas the canvas
  * @param br the buffer regions to update
  * @param offset the offset within the buffer regions, in bytes
@@ -127,6 +231,28 @@ DVZ_EXPORT void dvz_upload_buffer(
 DVZ_EXPORT void dvz_download_buffer(
     DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size, void* data);
 
+/**
+ * Download data from a buffer region to the CPU without blocking.
+ *
+ * The data is copied to the staging buffer by the GPU, and to `data` once the corresponding fence
+ * has been found signaled, which is checked at every iteration of the event loop. Several
+ * downloads may be in flight at the same time. The `data` pointer must remain valid until the
+ * download has completed. The callback is called at the end of `dvz_process_transfers()`,
+ * without the GPU lock, so that it may enqueue new transfers.
+ *
+ * @param context the context
+ * @param br the buffer regions to download from
+ * @param offset the offset within the buffer regions, in bytes
+ * @param size the size of the data to download, in bytes
+ * @param[out] data pointer to a buffer already allocated to contain `size` bytes
+ * @param callback function called once the data is available (optional)
+ * @param user_data pointer passed to the callback
+ * @returns a download id, to be used with `dvz_download_done()`
+ */
+DVZ_EXPORT uint64_t dvz_download_buffer_async(
+    DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size, void* data,
+    DvzDownloadCallback callback, void* user_data);
+
 /**
  * Copy data between two GPU buffer regions.
  *
@@ -171,6 +297,53 @@ DVZ_EXPORT void dvz_download_texture(
     DvzContext* context, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size,
     void* data);
 
+/**
+ * Download data from a texture without blocking.
+ *
+ * See `dvz_download_buffer_async()`. Large downloads are split into several chunks of the staging
+ * buffer.
+ *
+ * @param context the context
+ * @param texture the texture to download from
+ * @param offset the offset within the texture
+ * @param shape the shape of the region to download within the texture
+ * @param size the size of the downloaded data, in bytes
+ * @param[out] data pointer to the buffer that will hold the downloaded data
+ * @param callback function called once the data is available (optional)
+ * @param user_data pointer passed to the callback
+ * @returns a download id, to be used with `dvz_download_done()`
+ */
+DVZ_EXPORT uint64_t dvz_download_texture_async(
+    DvzContext* context, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size,
+    void* data, DvzDownloadCallback callback, void* user_data);
+
+/**
+ * Return whether an asynchronous download has completed.
+ *
+ * This function may be called from any thread. It takes the GPU lock, and returns true only once
+ * the data has been copied from the staging buffer.
+ *
+ * @param context the context
+ * @param download_id the id returned by an asynchronous download function
+ * @returns whether the downloaded data is available
+ */
+DVZ_EXPORT bool dvz_download_done(DvzContext* context, uint64_t download_id);
+
+/**
+ * Release caller-owned data once the pending uploads have been processed.
+ *
+ * The upload functions keep a pointer to the data until the transfers are processed. When the
+ * event loop is running, the release callback is called at the end of the next call to
+ * `dvz_process_transfers()`, once the data has been copied. Otherwise, it is called immediately.
+ *
+ * @param context the context
+ * @param data the data passed to the upload functions
+ * @param release the callback releasing the data
+ * @param user_data the pointer passed to the release callback
+ */
+DVZ_EXPORT void dvz_upload_release(
+    DvzContext* context, void* data, DvzDataReleaseCallback release, void* user_data);
+
 /**
  * Copy part of a texture to another.
  *
@@ -196,6 +369,12 @@ DVZ_EXPORT void dvz_copy_texture(
  * objects while they are being used for rendering. The transfer processing function is called at a
  * deterministic time within the main event loop.
  *
+ * The pending transfers are recorded into a single command buffer, submitted with a fence after
+ * the rendering commands of the current frame, and before the rendering commands of the next
+ * frame. Pipeline barriers guarantee the ordering on the GPU, so that there is no queue-wide wait
+ * on the CPU. The function only blocks when there are pending downloads, or when the event loop
+ * is not running.
+ *
  * @param canvas the canvas
  * @param br the buffer regions to update
  * @param offset the offset within the buffer regions, in bytes
@@ -21,6 +21,11 @@
 #define DVZ_MAX_VISUAL_GROUPS       1024
 #define DVZ_MAX_VISUAL_PRIORITY     4
 #define DVZ_MAX_UNIFORM_SIZE        65536
+#define DVZ_MAX_DIRTY_RANGES        16
+
+// Number of items above which the position casts of the bake functions are split across the
+// thread pool.
+#define DVZ_CAST_TASK_ITEMS 65536
 
 
 /*************************************************************************************************/
@@ -156,6 +161,7 @@ typedef enum
     DVZ_VISUAL_REQUEST_NOT_SET = 0x0000, // object has never been set
     DVZ_VISUAL_REQUEST_SET = 0x0001,     // object has been set
     DVZ_VISUAL_REQUEST_UPLOAD = 0x0002,  // visual requires data GPU upload
+    DVZ_VISUAL_REQUEST_BAKED = 0x0004,   // visual has been baked, its GPU upload is pending
 
     // DVZ_VISUAL_REQUEST_REFILL = 0x0010,  // visual requires a command buffer refill
     // DVZ_VISUAL_REQUEST_NORMALIZATION = 0x0040, // visual requires CPU data normalization
@@ -169,9 +175,11 @@ typedef enum
 /*************************************************************************************************/
 
 typedef struct DvzVisual DvzVisual;
+typedef struct DvzVisualStream DvzVisualStream;
 typedef struct DvzProp DvzProp;
 
 typedef union DvzSourceUnion DvzSourceUnion;
+typedef struct DvzDirtyRanges DvzDirtyRanges;
 typedef struct DvzSource DvzSource;
 
 typedef struct DvzVisualFillEvent DvzVisualFillEvent;
@@ -204,6 +212,14 @@ enqueue data transfers
 
 
 
+typedef void (*DvzVisualChangedCallback)(DvzVisual* visual, void* user_data);
+/*
+called whenever a visual source is marked as needing a GPU upload
+used by the scene to keep track of the visuals to update, without scanning all visuals
+*/
+
+
+
 /*************************************************************************************************/
 /*  Source structs                                                                               */
 /*************************************************************************************************/
@@ -216,6 +232,16 @@ union DvzSourceUnion
 
 
 
+// Items of a source that have changed since the last upload, as sorted and disjoint
+// [first, end) ranges. No range means that all items have changed.
+struct DvzDirtyRanges
+{
+    uint32_t count;
+    uvec2 ranges[DVZ_MAX_DIRTY_RANGES];
+};
+
+
+
 // Within a visual, a source is uniquely identified by (1) its type, (2) the source_idx
 struct DvzSource
 {
@@ -236,6 +262,8 @@ struct DvzSource
     uint32_t slot_idx;         // Binding slot, or 0 for vertex/index
     int flags;
     DvzArray arr; // array to be uploaded to that source
+    DvzDirtyRanges dirty;
+    DvzProp* alias; // wrapped prop whose data is used as the source array, without baking
 
     DvzSourceOrigin origin; // whether the underlying GPU object is handled by the user or datoviz
     DvzSourceUnion u;
@@ -267,6 +295,13 @@ struct DvzProp
     DvzDataType target_dtype; // used for casting during the copy to the vertex array
     DvzArrayCopyType copy_type;
     uint32_t reps; // number of repeats when copying
+
+    uint64_t append_count; // total number of appended items, in streaming mode
+
+    // Caller-owned data referenced by the original array, instead of a copy.
+    bool is_wrapped;
+    DvzDataReleaseCallback release;
+    void* release_data;
 };
 
 
@@ -275,6 +310,21 @@ struct DvzProp
 /*  Visual struct                                                                                */
 /*************************************************************************************************/
 
+// In streaming mode, the vertex source is a fixed-capacity ring buffer. It has an extra item
+// copying the first one, so that line strips wrapping around the end of the buffer are drawn with
+// two draw calls.
+struct DvzVisualStream
+{
+    uint32_t capacity; // 0 when the streaming mode is disabled
+    DvzSource* source;
+    uint64_t count; // total number of POS items appended
+
+    DvzBufferRegions br_draws; // indirect draw commands
+    VkDrawIndirectCommand draws[2];
+};
+
+
+
 struct DvzVisual
 {
     DvzObject obj;
@@ -304,6 +354,11 @@ struct DvzVisual
     // DvzVisualDataCallback callback_transform;
     DvzVisualDataCallback callback_bake;
 
+    // Change notification.
+    DvzVisualChangedCallback callback_changed;
+    void* callback_changed_data;
+    bool is_dirty; // set by the owner of the change callback until it has processed the visual
+
     // Sources.
     DvzContainer sources;
 
@@ -319,6 +374,9 @@ struct DvzVisual
     DvzViewportClip clip[DVZ_MAX_GRAPHICS_PER_VISUAL];
     DvzViewport viewport; // usually the visual's panel viewport, but may be customized
 
+    // Streaming mode.
+    DvzVisualStream stream;
+
     // GPU data
     DvzContainer bindings;
     DvzContainer bindings_comp;
@@ -546,6 +604,45 @@ DVZ_EXPORT void dvz_visual_data_partial(
 DVZ_EXPORT void dvz_visual_data_append(
     DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data);
 
+/**
+ * Set the data of a visual prop by referencing caller-owned memory, without copying it.
+ *
+ * If the prop is the only one copied to its source and it already has the layout of the source
+ * items (no offset, no cast, no repeat, no transformation), the baking step is skipped and the
+ * data is uploaded directly from the passed memory.
+ *
+ * The memory must remain valid until the release callback is called, which happens when the prop
+ * data is set again, or when the visual is destroyed. Calling this function again with the same
+ * pointer notifies the visual that the data has been modified in place. Partial updates and
+ * appends make a copy of the data and release it.
+ *
+ * @param visual the visual
+ * @param prop_type the prop type
+ * @param prop_idx the prop index
+ * @param count the number of elements in `data`
+ * @param data the data, that should be in the dtype of the prop
+ * @param release the callback called when the data is no longer used, may be NULL
+ * @param user_data the pointer passed to the release callback
+ */
+DVZ_EXPORT void dvz_visual_data_wrap(
+    DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, void* data,
+    DvzDataReleaseCallback release, void* user_data);
+
+/**
+ * Enable the streaming mode of a visual, for append-only data such as time series.
+ *
+ * The vertex buffer becomes a ring buffer with a fixed capacity. `dvz_visual_data_append()` only
+ * bakes and uploads the appended items, and the oldest items are dropped once the capacity is
+ * reached. Setting the data of a streamed prop with `dvz_visual_data()` restarts the stream.
+ *
+ * Only visuals with a single graphics pipeline, a vertex source and no index source are
+ * supported, for example the point, marker, and single line strip builtin visuals.
+ *
+ * @param visual the visual
+ * @param capacity the maximum number of items
+ */
+DVZ_EXPORT void dvz_visual_stream(DvzVisual* visual, uint32_t capacity);
+
 /**
  * Set partial data for a given source.
  *
@@ -600,6 +697,16 @@ DVZ_EXPORT void dvz_visual_flags(DvzVisual* visual, int flags);
 
 DVZ_EXPORT uint32_t dvz_visual_item_count(DvzVisual* visual);
 
+/**
+ * Return the amount of GPU memory used by the buffers and textures handled by a visual.
+ *
+ * The sources handled by the user are not taken into account.
+ *
+ * @param visual the visual
+ * @returns the size in bytes
+ */
+DVZ_EXPORT VkDeviceSize dvz_visual_memory(DvzVisual* visual);
+
 
 
 /*************************************************************************************************/
@@ -658,6 +765,18 @@ DVZ_EXPORT void dvz_visual_fill_end(DvzCanvas* canvas, DvzCommands* cmds, uint32
  */
 DVZ_EXPORT void dvz_visual_callback_bake(DvzVisual* visual, DvzVisualDataCallback callback);
 
+/**
+ * Set the function called whenever the visual data changes.
+ *
+ * Callback function signature: `void(DvzVisual*, void*)`
+ *
+ * @param visual the visual
+ * @param callback the change callback function
+ * @param user_data the pointer passed to the callback
+ */
+DVZ_EXPORT void dvz_visual_callback_changed(
+    DvzVisual* visual, DvzVisualChangedCallback callback, void* user_data);
+
 
 
 /*************************************************************************************************/
@@ -734,9 +853,35 @@ DVZ_EXPORT void* dvz_prop_item(DvzProp* prop, uint32_t prop_idx);
 /*  Data update                                                                                  */
 /*************************************************************************************************/
 
+/**
+ * Fill the visual sources from the visual props, by calling the bake callback.
+ *
+ * This function does not make any GPU call and only modifies the visual itself, so that several
+ * visuals may be baked concurrently. The scene bakes the changed visuals in the app worker
+ * threads, custom bake callbacks should therefore not access other visuals or GPU objects.
+ *
+ * @param visual the visual
+ * @param viewport the viewport
+ * @param coords the data coordinates and transformation
+ * @param user_data arbitrary user data pointer
+ */
+DVZ_EXPORT void dvz_visual_bake(
+    DvzVisual* visual, DvzViewport viewport, DvzDataCoords coords, const void* user_data);
+
+/**
+ * Upload the changed visual sources to the GPU buffers and textures, and update the bindings.
+ *
+ * This function must be called after dvz_visual_bake(), from the thread owning the canvas.
+ *
+ * @param visual the visual
+ */
+DVZ_EXPORT void dvz_visual_upload(DvzVisual* visual);
+
 /**
  * Update all GPU buffers and textures from the visual props and sources.
  *
+ * This is equivalent to calling dvz_visual_bake() then dvz_visual_upload().
+ *
  * @param visual the visual
  * @param viewport the viewport
  * @param coords the data coordinates and transformation
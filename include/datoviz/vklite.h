@@ -340,13 +340,17 @@ struct DvzGpu
     VkPhysicalDeviceProperties device_properties;
     VkPhysicalDeviceFeatures device_features;
     VkPhysicalDeviceMemoryProperties memory_properties;
-    VkDeviceSize vram; // amount of VRAM
+    VkDeviceSize vram;      // amount of VRAM
+    bool has_memory_budget; // whether VK_EXT_memory_budget is enabled
 
     uint32_t present_mode_count;
     VkPresentModeKHR present_modes[DVZ_MAX_PRESENT_MODES];
 
     DvzQueues queues;
     VkDescriptorPool dset_pool;
+    // Recursive lock protecting the queues and the shared command pools, see dvz_gpu_lock().
+    pthread_mutex_t queue_lock;
+    uint32_t lock_depth; // number of nested dvz_gpu_lock() calls by the owner of the lock
 
     VkPhysicalDeviceFeatures requested_features;
     VkDevice device;
@@ -401,6 +405,8 @@ struct DvzCommands
 
     uint32_t queue_idx;
     uint32_t count;
+    VkCommandBufferLevel level;
+    VkCommandPool pool; // dedicated pool, for command buffers recorded in other threads
     VkCommandBuffer cmds[DVZ_MAX_COMMAND_BUFFERS_PER_SET];
 };
 
@@ -425,6 +431,7 @@ struct DvzBuffer
     VkMemoryPropertyFlags memory;
 
     void* mmap;
+    uint32_t version; // incremented every time the Vulkan buffer is recreated
 };
 
 
@@ -516,6 +523,7 @@ struct DvzBindings
     VkDescriptorSet dsets[DVZ_MAX_SWAPCHAIN_IMAGES];
 
     DvzBufferRegions br[DVZ_MAX_BINDINGS_SIZE];
+    uint32_t br_versions[DVZ_MAX_BINDINGS_SIZE]; // buffer versions at the last update
     DvzImages* images[DVZ_MAX_BINDINGS_SIZE];
     DvzSampler* samplers[DVZ_MAX_BINDINGS_SIZE];
 };
@@ -910,6 +918,37 @@ DVZ_EXPORT void dvz_app_wait(DvzApp* app);
  */
 DVZ_EXPORT void dvz_gpu_wait(DvzGpu* gpu);
 
+/**
+ * Lock the queues and the shared command pools of a GPU.
+ *
+ * Vulkan queues and command pools must be externally synchronized. The submission, presentation
+ * and wait functions take this lock, so that several threads (for example, the render threads of
+ * several canvases) can use the same GPU. The lock is recursive.
+ *
+ * @param gpu the GPU
+ */
+DVZ_EXPORT void dvz_gpu_lock(DvzGpu* gpu);
+
+/**
+ * Unlock the queues and the shared command pools of a GPU.
+ *
+ * @param gpu the GPU
+ */
+DVZ_EXPORT void dvz_gpu_unlock(DvzGpu* gpu);
+
+/**
+ * Get the memory budget and usage of the device-local heaps of a GPU.
+ *
+ * The values are only accurate with the VK_EXT_memory_budget extension. Otherwise, the budget is
+ * the total amount of VRAM, and the usage is unknown (0).
+ *
+ * @param gpu the GPU
+ * @param[out] budget the amount of device-local memory the process can allocate, in bytes
+ * @param[out] usage the amount of device-local memory currently used by the process, in bytes
+ * @returns whether the values come from the VK_EXT_memory_budget extension
+ */
+DVZ_EXPORT bool dvz_gpu_memory_budget(DvzGpu* gpu, VkDeviceSize* budget, VkDeviceSize* usage);
+
 /**
  * Destroy the resources associated to a GPU.
  *
@@ -1100,6 +1139,32 @@ DVZ_EXPORT void dvz_swapchain_destroy(DvzSwapchain* swapchain);
  */
 DVZ_EXPORT DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count);
 
+/**
+ * Create a set of primary command buffers with a dedicated command pool.
+ *
+ * Unlike the command buffers created with `dvz_commands()`, which share the command pool of their
+ * queue family, these command buffers can be recorded in another thread.
+ *
+ * @param gpu the GPU
+ * @param queue the queue index within the GPU
+ * @param count the number of command buffers to create
+ * @returns the set of command buffers
+ */
+DVZ_EXPORT DvzCommands dvz_commands_dedicated(DvzGpu* gpu, uint32_t queue, uint32_t count);
+
+/**
+ * Create a set of secondary command buffers to be executed within a render pass.
+ *
+ * The command buffers are allocated from a dedicated command pool, so that they can be recorded
+ * in a different thread than the other command buffers.
+ *
+ * @param gpu the GPU
+ * @param queue the queue index within the GPU
+ * @param count the number of command buffers to create
+ * @returns the set of command buffers
+ */
+DVZ_EXPORT DvzCommands dvz_commands_secondary(DvzGpu* gpu, uint32_t queue, uint32_t count);
+
 /**
  * Start recording a command buffer.
  *
@@ -1108,6 +1173,16 @@ DVZ_EXPORT DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
  */
 DVZ_EXPORT void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx);
 
+/**
+ * Start recording a secondary command buffer that continues a render pass.
+ *
+ * @param cmds the set of secondary command buffers
+ * @param idx the index of the command buffer to begin recording on
+ * @param renderpass the render pass the command buffer will be executed in
+ */
+DVZ_EXPORT void
+dvz_cmd_begin_secondary(DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass);
+
 /**
  * Stop recording a command buffer.
  *
@@ -1205,6 +1280,8 @@ DVZ_EXPORT void dvz_buffer_queue_access(DvzBuffer* buffer, uint32_t queue_idx);
 /**
  * Create the buffer after it has been set.
  *
+ * Host-visible buffers are permanently mapped in `buffer->mmap` until they are destroyed.
+ *
  * @param buffer the buffer
  */
 DVZ_EXPORT void dvz_buffer_create(DvzBuffer* buffer);
@@ -1212,14 +1289,31 @@ DVZ_EXPORT void dvz_buffer_create(DvzBuffer* buffer);
 /**
  * Resize a buffer.
  *
+ * Host-visible buffers are automatically remapped after the resize.
+ *
  * @param buffer the buffer
  * @param size the new buffer size, in bytes
  */
 DVZ_EXPORT void dvz_buffer_resize(DvzBuffer* buffer, VkDeviceSize size);
 
+/**
+ * Recreate the Vulkan buffer with a new size, without copying the data nor waiting for the GPU.
+ *
+ * The old Vulkan objects are moved to `old`, which must be destroyed with `dvz_buffer_destroy()`
+ * once the GPU does not use it anymore. The buffer version is incremented so that the objects
+ * referring to the Vulkan buffer can be updated.
+ *
+ * @param buffer the buffer
+ * @param size the new buffer size, in bytes
+ * @param[out] old the buffer holding the old Vulkan objects
+ */
+DVZ_EXPORT void dvz_buffer_recreate(DvzBuffer* buffer, VkDeviceSize size, DvzBuffer* old);
+
 /**
  * Memory-map a buffer.
  *
+ * For permanently mapped buffers, this function just returns a pointer within the mapped memory.
+ *
  * @param buffer the buffer
  * @param offset the offset within the buffer, in bytes
  * @param size the size to map, in bytes
@@ -1229,10 +1323,36 @@ DVZ_EXPORT void* dvz_buffer_map(DvzBuffer* buffer, VkDeviceSize offset, VkDevice
 /**
  * Unmap a buffer.
  *
+ * This function does nothing on permanently mapped buffers.
+ *
  * @param buffer the buffer
  */
 DVZ_EXPORT void dvz_buffer_unmap(DvzBuffer* buffer);
 
+/**
+ * Make host writes to a mapped buffer range visible to the device.
+ *
+ * This is only required for buffers with non-coherent memory, and does nothing otherwise.
+ * `dvz_buffer_upload()` calls it automatically.
+ *
+ * @param buffer the buffer
+ * @param offset the offset within the buffer, in bytes
+ * @param size the size of the range, in bytes (or VK_WHOLE_SIZE)
+ */
+DVZ_EXPORT void dvz_buffer_flush(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size);
+
+/**
+ * Make device writes to a mapped buffer range visible to the host.
+ *
+ * This is only required for buffers with non-coherent memory, and does nothing otherwise.
+ * `dvz_buffer_download()` calls it automatically.
+ *
+ * @param buffer the buffer
+ * @param offset the offset within the buffer, in bytes
+ * @param size the size of the range, in bytes (or VK_WHOLE_SIZE)
+ */
+DVZ_EXPORT void dvz_buffer_invalidate(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size);
+
 /**
  * Download a buffer data to the CPU.
  *
@@ -1611,6 +1731,14 @@ DVZ_EXPORT void dvz_bindings_texture(DvzBindings* bindings, uint32_t idx, DvzTex
  */
 DVZ_EXPORT void dvz_bindings_update(DvzBindings* bindings);
 
+/**
+ * Return whether some bound buffers have been recreated since the last update of the bindings.
+ *
+ * @param bindings the bindings
+ * @returns whether the bindings need to be updated
+ */
+DVZ_EXPORT bool dvz_bindings_outdated(DvzBindings* bindings);
+
 /**
  * Destroy bindings.
  *
@@ -2269,6 +2397,17 @@ DVZ_EXPORT void dvz_submit_reset(DvzSubmit* submit);
 DVZ_EXPORT void dvz_cmd_begin_renderpass(
     DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers);
 
+/**
+ * Begin a render pass whose commands are recorded in secondary command buffers.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param renderpass the render pass
+ * @param framebuffers the framebuffers
+ */
+DVZ_EXPORT void dvz_cmd_begin_renderpass_secondary(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers);
+
 /**
  * End a render pass.
  *
@@ -2277,6 +2416,19 @@ DVZ_EXPORT void dvz_cmd_begin_renderpass(
  */
 DVZ_EXPORT void dvz_cmd_end_renderpass(DvzCommands* cmds, uint32_t idx);
 
+/**
+ * Execute secondary command buffers.
+ *
+ * The render pass must have been begun with dvz_cmd_begin_renderpass_secondary().
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record, and of the secondary command buffers
+ * @param count the number of secondary command buffer sets
+ * @param secondary the secondary command buffer sets
+ */
+DVZ_EXPORT void
+dvz_cmd_execute(DvzCommands* cmds, uint32_t idx, uint32_t count, DvzCommands** secondary);
+
 /**
  * Launch a compute task.
  *
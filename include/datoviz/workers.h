@@ -0,0 +1,183 @@
+/*************************************************************************************************/
+/*  Standalone work-stealing thread pool                                                         */
+/*************************************************************************************************/
+
+#ifndef DVZ_WORKERS_HEADER
+#define DVZ_WORKERS_HEADER
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_MAX_WORKERS           16
+#define DVZ_WORKER_QUEUE_CAPACITY 256
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzWorkers DvzWorkers;
+typedef struct DvzWorker DvzWorker;
+typedef struct DvzWorkerTask DvzWorkerTask;
+typedef struct DvzWorkerGroup DvzWorkerGroup;
+
+typedef void (*DvzWorkerCallback)(void* user_data);
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+struct DvzWorkerTask
+{
+    DvzWorkerCallback callback;
+    void* user_data;
+    DvzWorkerGroup* group; // NULL if the task does not belong to a group
+};
+
+
+
+// Tasks that can be waited for independently of the other tasks submitted to the pool.
+struct DvzWorkerGroup
+{
+    DvzWorkers* workers;
+    atomic(uint32_t, pending); // number of tasks of the group that have not completed yet
+};
+
+
+
+struct DvzWorker
+{
+    DvzWorkers* workers;
+    uint32_t idx;
+    pthread_t thread;
+
+    // Pending tasks: the worker takes the most recent task of its own queue, idle workers steal
+    // the oldest tasks of the other queues.
+    pthread_mutex_t lock;
+    uint32_t head, tail;
+    DvzWorkerTask tasks[DVZ_WORKER_QUEUE_CAPACITY];
+};
+
+
+
+struct DvzWorkers
+{
+    uint32_t count;
+    DvzWorker workers[DVZ_MAX_WORKERS];
+
+    atomic(uint32_t, next);    // queue receiving the next submitted task
+    atomic(uint32_t, queued);  // number of tasks waiting in the queues
+    atomic(uint32_t, pending); // number of submitted tasks that have not completed yet
+    atomic(bool, is_running);
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond_task; // signaled when a task is submitted
+    pthread_cond_t cond_done; // signaled when all tasks, or all tasks of a group, have completed
+};
+
+
+
+/*************************************************************************************************/
+/*  Thread pool                                                                                  */
+/*************************************************************************************************/
+
+/**
+ * Create a thread pool.
+ *
+ * @param count the number of worker threads, if 0 the tasks run in the thread that waits for them
+ * @returns a pointer to the thread pool
+ */
+DVZ_EXPORT DvzWorkers* dvz_workers(uint32_t count);
+
+/**
+ * Return the default number of worker threads.
+ *
+ * This is the number of online processors minus one (the main thread also executes tasks while
+ * waiting for them), unless the `DVZ_WORKERS` environment variable is set.
+ *
+ * @returns the number of worker threads
+ */
+DVZ_EXPORT uint32_t dvz_workers_default_count(void);
+
+/**
+ * Submit a task to a thread pool.
+ *
+ * The task is executed immediately in the calling thread if the pool has no worker thread or if
+ * the queues are full.
+ *
+ * @param workers the thread pool
+ * @param callback the task function
+ * @param user_data the pointer passed to the task function
+ */
+DVZ_EXPORT void
+dvz_workers_submit(DvzWorkers* workers, DvzWorkerCallback callback, void* user_data);
+
+/**
+ * Wait until all submitted tasks have completed.
+ *
+ * The calling thread executes pending tasks while waiting.
+ *
+ * @param workers the thread pool
+ */
+DVZ_EXPORT void dvz_workers_wait(DvzWorkers* workers);
+
+/**
+ * Create a group of tasks.
+ *
+ * The tasks of a group are waited for with `dvz_workers_group_wait()`, which does not wait for
+ * the tasks submitted by other threads to the same pool.
+ *
+ * @param workers the thread pool
+ * @returns a group of tasks
+ */
+DVZ_EXPORT DvzWorkerGroup dvz_workers_group(DvzWorkers* workers);
+
+/**
+ * Submit a task of a group to a thread pool.
+ *
+ * See `dvz_workers_submit()`. The tasks of a group should be submitted by the thread that waits
+ * for them.
+ *
+ * @param group the group of tasks
+ * @param callback the task function
+ * @param user_data the pointer passed to the task function
+ */
+DVZ_EXPORT void
+dvz_workers_group_submit(DvzWorkerGroup* group, DvzWorkerCallback callback, void* user_data);
+
+/**
+ * Wait until all tasks of a group have completed.
+ *
+ * The calling thread executes the queued tasks of the group while waiting, but not the tasks of
+ * other groups.
+ *
+ * @param group the group of tasks
+ */
+DVZ_EXPORT void dvz_workers_group_wait(DvzWorkerGroup* group);
+
+/**
+ * Stop the worker threads and destroy a thread pool.
+ *
+ * @param workers the thread pool
+ */
+DVZ_EXPORT void dvz_workers_destroy(DvzWorkers* workers);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,339 @@
+#include "../include/datoviz/alloc.h"
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static uint64_t _align(uint64_t size, uint64_t alignment)
+{
+    ASSERT(alignment > 0);
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+
+
+// Return the index of the block starting at a given offset, or UINT32_MAX if there is none.
+static uint32_t _find_block(DvzAlloc* alloc, uint64_t offset)
+{
+    ASSERT(alloc != NULL);
+    uint32_t lo = 0, hi = alloc->count, mid = 0;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (alloc->blocks[mid].offset == offset)
+            return mid;
+        if (alloc->blocks[mid].offset < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return UINT32_MAX;
+}
+
+
+
+static void _insert_block(DvzAlloc* alloc, uint32_t idx, DvzAllocBlock block)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(idx <= alloc->count);
+    if (alloc->count == alloc->capacity)
+    {
+        alloc->capacity *= 2;
+        REALLOC(alloc->blocks, alloc->capacity * sizeof(DvzAllocBlock));
+    }
+    ASSERT(alloc->count < alloc->capacity);
+    memmove(
+        &alloc->blocks[idx + 1], &alloc->blocks[idx],
+        (alloc->count - idx) * sizeof(DvzAllocBlock));
+    alloc->blocks[idx] = block;
+    alloc->count++;
+}
+
+
+
+static void _remove_block(DvzAlloc* alloc, uint32_t idx)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(idx < alloc->count);
+    memmove(
+        &alloc->blocks[idx], &alloc->blocks[idx + 1],
+        (alloc->count - idx - 1) * sizeof(DvzAllocBlock));
+    alloc->count--;
+}
+
+
+
+// Return the index of the smallest free block with at least the given size, or UINT32_MAX.
+static uint32_t _best_fit(DvzAlloc* alloc, uint64_t size)
+{
+    ASSERT(alloc != NULL);
+    uint32_t best = UINT32_MAX;
+    DvzAllocBlock* block = NULL;
+    for (uint32_t i = 0; i < alloc->count; i++)
+    {
+        block = &alloc->blocks[i];
+        if (!block->is_free || block->size < size)
+            continue;
+        if (best == UINT32_MAX || block->size < alloc->blocks[best].size)
+            best = i;
+        // Exact fit, no need to look further.
+        if (block->size == size)
+            break;
+    }
+    return best;
+}
+
+
+
+// Return the total size of the managed memory so that a block of the given size can be allocated
+// at the end.
+static uint64_t _grow_size(DvzAlloc* alloc, uint64_t size)
+{
+    ASSERT(alloc != NULL);
+    DvzAllocBlock* last = alloc->count > 0 ? &alloc->blocks[alloc->count - 1] : NULL;
+    uint64_t end = last != NULL && last->is_free ? last->offset : alloc->total_size;
+    return dvz_next_pow2(end + size);
+}
+
+
+
+// Enlarge the managed memory so that a block of the given size can be allocated at the end.
+static uint64_t _grow(DvzAlloc* alloc, uint64_t size)
+{
+    ASSERT(alloc != NULL);
+    DvzAllocBlock* last = alloc->count > 0 ? &alloc->blocks[alloc->count - 1] : NULL;
+    uint64_t new_total = _grow_size(alloc, size);
+    ASSERT(new_total > alloc->total_size);
+
+    if (last != NULL && last->is_free)
+        last->size += new_total - alloc->total_size;
+    else
+        _insert_block(
+            alloc, alloc->count,
+            (DvzAllocBlock){alloc->total_size, new_total - alloc->total_size, true});
+
+    log_debug(
+        "enlarging sub-allocator from %" PRIu64 " to %" PRIu64 " bytes", //
+        alloc->total_size, new_total);
+    alloc->total_size = new_total;
+    return new_total;
+}
+
+
+
+/*************************************************************************************************/
+/*  Sub-allocator                                                                                */
+/*************************************************************************************************/
+
+DvzAlloc dvz_alloc(uint64_t size, uint64_t alignment)
+{
+    DvzAlloc alloc = {0};
+    alloc.alignment = alignment > 0 ? alignment : 1;
+    // The alignment must be a power of two.
+    ASSERT((alloc.alignment & (alloc.alignment - 1)) == 0);
+    alloc.total_size = size;
+    alloc.capacity = DVZ_ALLOC_DEFAULT_BLOCKS;
+    alloc.blocks = calloc(alloc.capacity, sizeof(DvzAllocBlock));
+    dvz_alloc_clear(&alloc);
+    return alloc;
+}
+
+
+
+uint64_t dvz_alloc_new(DvzAlloc* alloc, uint64_t req_size, uint64_t* resized)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(req_size > 0);
+    uint64_t size = _align(req_size, alloc->alignment);
+    if (resized != NULL)
+        *resized = 0;
+
+    uint32_t idx = _best_fit(alloc, size);
+
+    // No free block is large enough: enlarge the managed memory, the last block is then free and
+    // large enough.
+    if (idx == UINT32_MAX)
+    {
+        uint64_t new_total = _grow(alloc, size);
+        if (resized != NULL)
+            *resized = new_total;
+        idx = alloc->count - 1;
+    }
+    ASSERT(idx < alloc->count);
+
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    ASSERT(block->is_free);
+    ASSERT(block->size >= size);
+    uint64_t offset = block->offset;
+    ASSERT(offset % alloc->alignment == 0);
+
+    // Split the block, the remaining part stays free.
+    if (block->size > size)
+        _insert_block(alloc, idx + 1, (DvzAllocBlock){offset + size, block->size - size, true});
+
+    block = &alloc->blocks[idx]; // the block array may have been reallocated
+    block->size = size;
+    block->is_free = false;
+    return offset;
+}
+
+
+
+uint64_t dvz_alloc_new_size(DvzAlloc* alloc, uint64_t req_size)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(req_size > 0);
+    uint64_t size = _align(req_size, alloc->alignment);
+    if (_best_fit(alloc, size) != UINT32_MAX)
+        return alloc->total_size;
+    return _grow_size(alloc, size);
+}
+
+
+
+bool dvz_alloc_resize(DvzAlloc* alloc, uint64_t offset, uint64_t new_size)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(new_size > 0);
+
+    uint32_t idx = _find_block(alloc, offset);
+    if (idx == UINT32_MAX || alloc->blocks[idx].is_free)
+    {
+        log_warn("no allocated region at offset %" PRIu64, offset);
+        return false;
+    }
+
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    DvzAllocBlock* next = idx + 1 < alloc->count ? &alloc->blocks[idx + 1] : NULL;
+    uint64_t size = _align(new_size, alloc->alignment);
+
+    if (size == block->size)
+        return true;
+
+    // Shrink the region: give the tail back to the next free block, or to a new free block.
+    if (size < block->size)
+    {
+        uint64_t diff = block->size - size;
+        block->size = size;
+        if (next != NULL && next->is_free)
+        {
+            next->offset -= diff;
+            next->size += diff;
+        }
+        else
+        {
+            _insert_block(alloc, idx + 1, (DvzAllocBlock){offset + size, diff, true});
+        }
+        return true;
+    }
+
+    // Grow the region into the next block if it is free and large enough.
+    ASSERT(size > block->size);
+    uint64_t diff = size - block->size;
+    if (next != NULL && next->is_free && next->size >= diff)
+    {
+        block->size = size;
+        next->offset += diff;
+        next->size -= diff;
+        if (next->size == 0)
+            _remove_block(alloc, idx + 1);
+        return true;
+    }
+
+    return false;
+}
+
+
+
+void dvz_alloc_free(DvzAlloc* alloc, uint64_t offset)
+{
+    ASSERT(alloc != NULL);
+
+    uint32_t idx = _find_block(alloc, offset);
+    if (idx == UINT32_MAX || alloc->blocks[idx].is_free)
+    {
+        log_warn("no allocated region at offset %" PRIu64, offset);
+        return;
+    }
+    alloc->blocks[idx].is_free = true;
+
+    // Merge with the next block.
+    if (idx + 1 < alloc->count && alloc->blocks[idx + 1].is_free)
+    {
+        alloc->blocks[idx].size += alloc->blocks[idx + 1].size;
+        _remove_block(alloc, idx + 1);
+    }
+
+    // Merge with the previous block.
+    if (idx > 0 && alloc->blocks[idx - 1].is_free)
+    {
+        alloc->blocks[idx - 1].size += alloc->blocks[idx].size;
+        _remove_block(alloc, idx);
+    }
+}
+
+
+
+uint64_t dvz_alloc_get(DvzAlloc* alloc, uint64_t offset)
+{
+    ASSERT(alloc != NULL);
+    uint32_t idx = _find_block(alloc, offset);
+    if (idx == UINT32_MAX || alloc->blocks[idx].is_free)
+        return 0;
+    return alloc->blocks[idx].size;
+}
+
+
+
+uint64_t dvz_alloc_size(DvzAlloc* alloc)
+{
+    ASSERT(alloc != NULL);
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < alloc->count; i++)
+    {
+        if (!alloc->blocks[i].is_free)
+            size += alloc->blocks[i].size;
+    }
+    return size;
+}
+
+
+
+uint64_t dvz_alloc_end(DvzAlloc* alloc)
+{
+    ASSERT(alloc != NULL);
+    DvzAllocBlock* block = NULL;
+    for (int64_t i = (int64_t)alloc->count - 1; i >= 0; i--)
+    {
+        block = &alloc->blocks[i];
+        if (!block->is_free)
+            return block->offset + block->size;
+    }
+    return 0;
+}
+
+
+
+void dvz_alloc_clear(DvzAlloc* alloc)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(alloc->blocks != NULL);
+    alloc->count = 0;
+    if (alloc->total_size > 0)
+    {
+        alloc->blocks[0] = (DvzAllocBlock){0, alloc->total_size, true};
+        alloc->count = 1;
+    }
+}
+
+
+
+void dvz_alloc_destroy(DvzAlloc* alloc)
+{
+    ASSERT(alloc != NULL);
+    FREE(alloc->blocks);
+    alloc->count = 0;
+    alloc->capacity = 0;
+}
@@ -73,6 +73,91 @@ static int _key_modifiers(int key_code)
     return mods;
 }
 
+// Pass an input event from the backend to the event system.
+static void _event_input(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(canvas != NULL);
+    switch (ev.type)
+    {
+    case DVZ_EVENT_KEY_PRESS:
+        dvz_event_key_press(canvas, ev.u.k.key_code, ev.u.k.modifiers);
+        break;
+    case DVZ_EVENT_KEY_RELEASE:
+        dvz_event_key_release(canvas, ev.u.k.key_code, ev.u.k.modifiers);
+        break;
+    case DVZ_EVENT_MOUSE_PRESS:
+        dvz_event_mouse_press(canvas, ev.u.b.button, ev.u.b.modifiers);
+        break;
+    case DVZ_EVENT_MOUSE_RELEASE:
+        dvz_event_mouse_release(canvas, ev.u.b.button, ev.u.b.modifiers);
+        break;
+    case DVZ_EVENT_MOUSE_MOVE:
+        dvz_event_mouse_move(canvas, ev.u.m.pos, canvas->mouse.modifiers);
+        break;
+    case DVZ_EVENT_MOUSE_WHEEL:
+        // HACK: glfw doesn't seem to give a way to probe the keyboard modifiers while using the
+        // mouse wheel, so we have to determine the modifiers manually.
+        // Limitation: a single modifier is allowed here.
+        // TODO: allow for multiple simultlaneous modifiers, will require updating the keyboard
+        // struct so that it supports multiple simultaneous keys
+        dvz_event_mouse_wheel(
+            canvas, canvas->mouse.cur_pos, ev.u.w.dir, _key_modifiers(canvas->keyboard.key_code));
+        break;
+    default:
+        break;
+    }
+}
+
+// The input of the canvases with a render thread is forwarded to that thread, which dispatches
+// it at the next frame, see _event_input_flush(). The main thread never waits for the render
+// thread: when the input queue is full, mouse moves are coalesced into a single pending position
+// and the other events are dropped.
+static void _backend_input(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(canvas != NULL);
+    if (atomic_load(&canvas->is_threaded))
+    {
+        if (!dvz_fifo_push(&canvas->input_queue, &ev))
+        {
+            if (ev.type == DVZ_EVENT_MOUSE_MOVE)
+            {
+                uint64_t pos = 0;
+                memcpy(&pos, ev.u.m.pos, sizeof(pos));
+                atomic_store(&canvas->input_move_pos, pos);
+                atomic_store(&canvas->input_move_pending, true);
+            }
+            else
+            {
+                log_warn("input queue of the render thread is full, dropping event %d", ev.type);
+            }
+        }
+        dvz_canvas_redraw(canvas);
+    }
+    else
+    {
+        _event_input(canvas, ev);
+    }
+}
+
+// Dispatch the input events forwarded to the render thread, at the beginning of the frame.
+static void _event_input_flush(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzEvent ev = {0};
+    while (dvz_fifo_pop(&canvas->input_queue, &ev, false))
+        _event_input(canvas, ev);
+
+    // The mouse moves coalesced while the queue was full come after the queued events.
+    if (atomic_exchange(&canvas->input_move_pending, false))
+    {
+        uint64_t pos = atomic_load(&canvas->input_move_pos);
+        ev = (DvzEvent){0};
+        ev.type = DVZ_EVENT_MOUSE_MOVE;
+        memcpy(ev.u.m.pos, &pos, sizeof(pos));
+        _event_input(canvas, ev);
+    }
+}
+
 static void _glfw_key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     DvzCanvas* canvas = (DvzCanvas*)glfwGetWindowUserPointer(window);
@@ -88,17 +173,19 @@ static void _glfw_key_callback(GLFWwindow* window, int key, int scancode, int ac
         return;
     }
 
-    DvzKeyCode key_code = {0};
+    DvzEvent ev = {0};
 
     // NOTE: we use the GLFW key codes here, should actually do a proper mapping between GLFW
     // key codes and Datoviz key codes.
-    key_code = key;
+    ev.u.k.key_code = key;
+    ev.u.k.modifiers = mods;
 
     // Find the key event type.
     if (action == GLFW_PRESS || action == GLFW_REPEAT)
-        dvz_event_key_press(canvas, key_code, mods);
+        ev.type = DVZ_EVENT_KEY_PRESS;
     else
-        dvz_event_key_release(canvas, key_code, mods);
+        ev.type = DVZ_EVENT_KEY_RELEASE;
+    _backend_input(canvas, ev);
 }
 
 static void _glfw_wheel_callback(GLFWwindow* window, double dx, double dy)
@@ -109,13 +196,11 @@ static void _glfw_wheel_callback(GLFWwindow* window, double dx, double dy)
     if (!canvas->mouse.is_active)
         return;
 
-    // HACK: glfw doesn't seem to give a way to probe the keyboard modifiers while using the mouse
-    // wheel, so we have to determine the modifiers manually.
-    // Limitation: a single modifier is allowed here.
-    // TODO: allow for multiple simultlaneous modifiers, will require updating the keyboard struct
-    // so that it supports multiple simultaneous keys
-    dvz_event_mouse_wheel(
-        canvas, canvas->mouse.cur_pos, (vec2){dx, dy}, _key_modifiers(canvas->keyboard.key_code));
+    DvzEvent ev = {0};
+    ev.type = DVZ_EVENT_MOUSE_WHEEL;
+    ev.u.w.dir[0] = dx;
+    ev.u.w.dir[1] = dy;
+    _backend_input(canvas, ev);
 }
 
 static void _glfw_button_callback(GLFWwindow* window, int button, int action, int mods)
@@ -127,20 +212,19 @@ static void _glfw_button_callback(GLFWwindow* window, int button, int action, in
         return;
 
     // Map mouse button.
-    DvzMouseButton b = {0};
+    DvzEvent ev = {0};
     if (button == GLFW_MOUSE_BUTTON_LEFT)
-        b = DVZ_MOUSE_BUTTON_LEFT;
+        ev.u.b.button = DVZ_MOUSE_BUTTON_LEFT;
     if (button == GLFW_MOUSE_BUTTON_RIGHT)
-        b = DVZ_MOUSE_BUTTON_RIGHT;
+        ev.u.b.button = DVZ_MOUSE_BUTTON_RIGHT;
     if (button == GLFW_MOUSE_BUTTON_MIDDLE)
-        b = DVZ_MOUSE_BUTTON_MIDDLE;
+        ev.u.b.button = DVZ_MOUSE_BUTTON_MIDDLE;
 
     // Find mouse button action type
     // NOTE: Datoviz modifiers code must match GLFW
-    if (action == GLFW_PRESS)
-        dvz_event_mouse_press(canvas, b, mods);
-    else
-        dvz_event_mouse_release(canvas, b, mods);
+    ev.u.b.modifiers = mods;
+    ev.type = action == GLFW_PRESS ? DVZ_EVENT_MOUSE_PRESS : DVZ_EVENT_MOUSE_RELEASE;
+    _backend_input(canvas, ev);
 }
 
 static void _glfw_move_callback(GLFWwindow* window, double xpos, double ypos)
@@ -167,6 +251,11 @@ static void _glfw_frame_callback(DvzCanvas* canvas, DvzEvent ev)
     // log_debug("mouse event %d", canvas->frame_idx);
     canvas->mouse.prev_state = canvas->mouse.cur_state;
 
+    // The cursor position cannot be polled from a render thread, the mouse move events are
+    // forwarded by the main thread instead.
+    if (atomic_load(&canvas->is_threaded))
+        return;
+
     // Mouse move event.
     double xpos, ypos;
     glfwGetCursorPos(w, &xpos, &ypos);
@@ -184,6 +273,44 @@ static void _glfw_frame_callback(DvzCanvas* canvas, DvzEvent ev)
     // }
 }
 
+// In on-demand rendering mode, the mouse position is still polled at every frame, these
+// callbacks only request a new frame. The mouse move events of the canvases with a render thread
+// are forwarded to that thread.
+static void _glfw_cursor_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    DvzCanvas* canvas = (DvzCanvas*)glfwGetWindowUserPointer(window);
+    ASSERT(canvas != NULL);
+    if (!canvas->mouse.is_active)
+        return;
+
+    if (atomic_load(&canvas->is_threaded))
+    {
+        DvzEvent ev = {0};
+        ev.type = DVZ_EVENT_MOUSE_MOVE;
+        ev.u.m.pos[0] = xpos;
+        ev.u.m.pos[1] = ypos;
+        _backend_input(canvas, ev);
+    }
+    else
+    {
+        dvz_canvas_redraw(canvas);
+    }
+}
+
+static void _glfw_framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    DvzCanvas* canvas = (DvzCanvas*)glfwGetWindowUserPointer(window);
+    ASSERT(canvas != NULL);
+    dvz_canvas_redraw(canvas);
+}
+
+static void _glfw_refresh_callback(GLFWwindow* window)
+{
+    DvzCanvas* canvas = (DvzCanvas*)glfwGetWindowUserPointer(window);
+    ASSERT(canvas != NULL);
+    dvz_canvas_redraw(canvas);
+}
+
 static void _backend_next_frame(DvzCanvas* canvas)
 {
     ASSERT(canvas != NULL);
@@ -222,6 +349,11 @@ static void backend_event_callbacks(DvzCanvas* canvas)
         // Register the mouse move callback.
         // glfwSetCursorPosCallback(w, _glfw_move_callback);
 
+        // Wake up the on-demand rendering loop.
+        glfwSetCursorPosCallback(w, _glfw_cursor_callback);
+        glfwSetFramebufferSizeCallback(w, _glfw_framebuffer_size_callback);
+        glfwSetWindowRefreshCallback(w, _glfw_refresh_callback);
+
         // Register a function called at every frame, after event polling and state update
         dvz_event_callback(
             canvas, DVZ_EVENT_INTERACT, 0, DVZ_EVENT_MODE_SYNC, _glfw_frame_callback, NULL);
@@ -271,11 +403,16 @@ static void _event_timer(DvzCanvas* canvas)
     DvzEvent ev = {0};
     DvzEventCallbackRegister* r = NULL;
     ev.type = DVZ_EVENT_TIMER;
-    for (uint32_t i = 0; i < canvas->callbacks_count; i++)
-    {
-        r = &canvas->callbacks[i];
-        if (r->type == DVZ_EVENT_TIMER)
+    uint32_t indices[DVZ_MAX_EVENT_CALLBACKS] = {0};
+    uint32_t count = 0;
+    for (uint32_t mode = 0; mode < DVZ_EVENT_MODE_COUNT; mode++)
+    {
+        count = _event_callbacks(canvas, DVZ_EVENT_TIMER, (DvzEventMode)mode, indices);
+        if (count > 0 && mode == DVZ_EVENT_MODE_ASYNC)
+            dvz_event_lock(canvas);
+        for (uint32_t i = 0; i < count; i++)
         {
+            r = &canvas->callbacks[indices[i]];
             interval = r->param;
 
             // At what time was the last TIMER event for this callback?
@@ -301,7 +438,32 @@ static void _event_timer(DvzCanvas* canvas)
                 r->callback(canvas, ev);
             }
         }
+        if (count > 0 && mode == DVZ_EVENT_MODE_ASYNC)
+            dvz_event_unlock(canvas);
+    }
+}
+
+
+
+// Return the delay, in seconds, until the next TIMER event.
+static double _event_timer_delay(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    double cur_time = _clock_get(&canvas->clock);
+    double delay = INFINITY;
+    DvzEventCallbackRegister* r = NULL;
+    uint32_t indices[DVZ_MAX_EVENT_CALLBACKS] = {0};
+    uint32_t count = 0;
+    for (uint32_t mode = 0; mode < DVZ_EVENT_MODE_COUNT; mode++)
+    {
+        count = _event_callbacks(canvas, DVZ_EVENT_TIMER, (DvzEventMode)mode, indices);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            r = &canvas->callbacks[indices[i]];
+            delay = fmin(delay, fmax(0, (r->idx + 1) * r->param - cur_time));
+        }
     }
+    return delay;
 }
 
 
@@ -373,6 +535,7 @@ static void _refill_canvas(DvzCanvas* canvas, uint32_t img_idx)
     DvzEvent ev = {0};
     ev.type = DVZ_EVENT_REFILL;
     ev.u.rf.img_idx = img_idx;
+    ev.u.rf.epoch = atomic_load(&canvas->refills.epoch);
 
     // First commands passed is the default cmds_render DvzCommands instance used for rendering.
     uint32_t k = 0;
@@ -435,7 +598,10 @@ static void _refill_frame(DvzCanvas* canvas)
         // If refill has just been requested, reset the ongoing refill by setting completed to
         // false for all swapchain images.
         if (atomic_load(&canvas->refills.status) == DVZ_REFILL_REQUESTED)
+        {
             memset(canvas->refills.completed, 0, DVZ_MAX_SWAPCHAIN_IMAGES);
+            canvas->refills.buffer_epoch = atomic_load(&canvas->gpu->context->buffer_epoch);
+        }
 
         // Skip this step if the current swapchain image has already been processed.
         if (canvas->refills.completed[img_idx])
@@ -460,8 +626,11 @@ static void _refill_frame(DvzCanvas* canvas)
         if (_all_true(canvas->swapchain.img_count, canvas->refills.completed))
         {
             log_trace("all command buffers updated, no longer need to update");
-            status = DVZ_REFILL_NONE;
-            atomic_store(&canvas->refills.status, status);
+            atomic_store(&canvas->refills.buffer_epoch_done, canvas->refills.buffer_epoch);
+            // NOTE: if another refill has been requested in the meantime, for example by a
+            // REFILL callback or by another thread, it will start at the next frame.
+            status = DVZ_REFILL_PROCESSING;
+            atomic_compare_exchange_strong(&canvas->refills.status, &status, DVZ_REFILL_NONE);
             // Reset the img_updated bool array.
             memset(canvas->refills.completed, 0, DVZ_MAX_SWAPCHAIN_IMAGES);
         }
@@ -575,6 +744,33 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     canvas->overlay = overlay;
     canvas->flags = flags;
 
+    // Event callback locks.
+    {
+        if (pthread_rwlock_init(&canvas->callbacks_lock, NULL) != 0)
+            log_error("rwlock creation failed");
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        if (pthread_mutex_init(&canvas->event_lock, &attr) != 0)
+            log_error("mutex creation failed");
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    // Input event coalescing.
+    if (pthread_mutex_init(&canvas->coalesce_lock, NULL) != 0)
+        log_error("mutex creation failed");
+    atomic_store(&canvas->coalesce_events, (flags & DVZ_CANVAS_FLAGS_COALESCE) != 0);
+
+    // Render thread, started at the end of the canvas creation if requested.
+    if (pthread_mutex_init(&canvas->render_lock, NULL) != 0)
+        log_error("mutex creation failed");
+    if (pthread_cond_init(&canvas->render_cond, NULL) != 0)
+        log_error("cond creation failed");
+    atomic_init(&canvas->is_threaded, false);
+    atomic_init(&canvas->input_move_pending, false);
+    atomic_init(&canvas->input_move_pos, 0);
+    atomic_init(&canvas->render_status, DVZ_RENDER_THREAD_RUNNING);
+
     bool show_fps = _show_fps(canvas);
     bool support_pick = _support_pick(canvas);
     log_trace("creating canvas with show_fps=%d, support_pick=%d", show_fps, support_pick);
@@ -586,6 +782,12 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     // to the main thread (REFILL or CLOSE events).
     atomic_init(&canvas->to_close, false);
     atomic_init(&canvas->refills.status, DVZ_REFILL_NONE);
+    atomic_init(&canvas->refills.epoch, 0);
+    atomic_init(&canvas->refills.buffer_epoch_done, 0);
+
+    // On-demand rendering, only for canvases with a window.
+    atomic_init(&canvas->on_demand, (flags & DVZ_CANVAS_FLAGS_ON_DEMAND) != 0 && !offscreen);
+    atomic_init(&canvas->to_redraw, true);
 
     // Allocate memory for canvas objects.
     canvas->commands =
@@ -716,7 +918,7 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
 
     // Create synchronization objects.
     {
-        uint32_t frames_in_flight = offscreen ? 1 : DVZ_MAX_FRAMES_IN_FLIGHT;
+        uint32_t frames_in_flight = offscreen ? 1 : DVZ_DEFAULT_FRAMES_IN_FLIGHT;
 
         canvas->sem_img_available = dvz_semaphores(gpu, frames_in_flight);
         canvas->sem_render_finished = dvz_semaphores(gpu, frames_in_flight);
@@ -732,10 +934,11 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
         canvas->cmds_transfer = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_TRANSFER, 1);
     }
 
-    // Default render commands.
+    // Default render commands, with a dedicated command pool as they may be refilled in the
+    // render thread of the canvas.
     {
         canvas->cmds_render =
-            dvz_commands(gpu, DVZ_DEFAULT_QUEUE_RENDER, canvas->swapchain.img_count);
+            dvz_commands_dedicated(gpu, DVZ_DEFAULT_QUEUE_RENDER, canvas->swapchain.img_count);
     }
 
     // Default submit instance.
@@ -743,9 +946,14 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
 
     // Event system.
     {
-        canvas->event_queue = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
+        // Events are enqueued by several threads (backend callbacks, timers, user threads) and
+        // dequeued by the event thread only.
+        canvas->event_queue = dvz_fifo_mpsc(DVZ_EVENT_QUEUE_CAPACITY, sizeof(DvzEvent));
         canvas->event_thread = dvz_thread(_event_thread, canvas);
 
+        // Input events forwarded by the main thread to the render thread, if any.
+        canvas->input_queue = dvz_fifo_mpsc(DVZ_EVENT_QUEUE_CAPACITY, sizeof(DvzEvent));
+
         canvas->mouse = dvz_mouse();
         canvas->keyboard = dvz_keyboard();
 
@@ -785,6 +993,9 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
                 canvas, DVZ_EVENT_IMGUI, 0, DVZ_EVENT_MODE_SYNC, dvz_gui_callback_fps, NULL);
     }
 
+    if ((flags & DVZ_CANVAS_FLAGS_RENDER_THREAD) != 0)
+        dvz_canvas_render_thread(canvas, true);
+
     ASSERT(canvas->swapchain.images != NULL);
     log_debug(
         "created canvas of size %dx%d", //
@@ -911,7 +1122,18 @@ void dvz_canvas_reset(DvzCanvas* canvas)
     _clock_init(&canvas->clock);
     atomic_store(&canvas->to_close, false);
     atomic_store(&canvas->refills.status, DVZ_REFILL_NONE);
+    atomic_fetch_add(&canvas->refills.epoch, 1);
+    atomic_store(&canvas->to_redraw, true);
+    pthread_rwlock_wrlock(&canvas->callbacks_lock);
     canvas->callbacks_count = 0;
+    for (uint32_t type = 0; type < DVZ_EVENT_COUNT; type++)
+        for (uint32_t mode = 0; mode < DVZ_EVENT_MODE_COUNT; mode++)
+            atomic_store(&canvas->callback_tables[type][mode].count, 0);
+    pthread_rwlock_unlock(&canvas->callbacks_lock);
+    pthread_mutex_lock(&canvas->coalesce_lock);
+    canvas->coalesced_move.type = DVZ_EVENT_NONE;
+    canvas->coalesced_wheel.type = DVZ_EVENT_NONE;
+    pthread_mutex_unlock(&canvas->coalesce_lock);
     canvas->cur_frame = 0;
     dvz_fifo_reset(&canvas->event_queue);
     canvas->frame_idx = 0;
@@ -1115,6 +1337,14 @@ void dvz_event_callback(
     }
 #endif
 
+    ASSERT(type < DVZ_EVENT_COUNT);
+    ASSERT(mode < DVZ_EVENT_MODE_COUNT);
+    if (canvas->callbacks_count >= DVZ_MAX_EVENT_CALLBACKS)
+    {
+        log_error("maximum number of event callbacks reached (%d)", DVZ_MAX_EVENT_CALLBACKS);
+        return;
+    }
+
     DvzEventCallbackRegister r = {0};
     r.callback = callback;
     r.type = type;
@@ -1122,26 +1352,61 @@ void dvz_event_callback(
     r.user_data = user_data;
     r.param = param;
 
-    // Automatically enable the global lock if there is at least one async callback. The lock
-    // is used when calling any callback.
-    // TODO: improve this if this causes performance issues (locking/unlocking at every frame)
-    if (mode == DVZ_EVENT_MODE_ASYNC)
+    pthread_rwlock_wrlock(&canvas->callbacks_lock);
+
+    uint32_t idx = canvas->callbacks_count;
+    canvas->callbacks[idx] = r;
+    canvas->callbacks_count++;
+
+    // Insert the callback in the table of its type and mode, after the callbacks with a lower or
+    // equal param.
+    DvzEventCallbackTable* table = &canvas->callback_tables[type][mode];
+    uint32_t count = atomic_load(&table->count);
+    uint32_t k = count;
+    while (k > 0 && canvas->callbacks[table->indices[k - 1]].param > param)
     {
-        // enable the global callback lock that surrounds all callbacks. This ensures
-        // that scene objects can be modified by both the main thread (internal scene
-        // system implemented in a sync callback) and in async callbacks (running in the
-        // background thread)
-        log_debug("enable the global callback lock");
-        canvas->enable_lock = true;
+        table->indices[k] = table->indices[k - 1];
+        k--;
     }
+    table->indices[k] = idx;
+    atomic_store(&table->count, count + 1);
+
+    pthread_rwlock_unlock(&canvas->callbacks_lock);
+}
 
-    if (canvas->enable_lock)
-        dvz_thread_lock(&canvas->event_thread);
 
-    canvas->callbacks[canvas->callbacks_count++] = r;
 
-    if (canvas->enable_lock)
-        dvz_thread_unlock(&canvas->event_thread);
+void dvz_event_coalesce(DvzCanvas* canvas, bool enable)
+{
+    ASSERT(canvas != NULL);
+    atomic_store(&canvas->coalesce_events, enable);
+    // Do not lose the events coalesced so far.
+    if (!enable)
+        _event_coalesced_flush(canvas);
+}
+
+
+
+void dvz_event_lock(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    pthread_mutex_lock(&canvas->event_lock);
+}
+
+
+
+bool dvz_event_trylock(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    return pthread_mutex_trylock(&canvas->event_lock) == 0;
+}
+
+
+
+void dvz_event_unlock(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    pthread_mutex_unlock(&canvas->event_lock);
 }
 
 
@@ -1151,10 +1416,20 @@ void dvz_event_callback(
 /*************************************************************************************************/
 
 void dvz_canvas_to_refill(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    atomic_fetch_add(&canvas->refills.epoch, 1);
+    dvz_canvas_to_refill_partial(canvas);
+}
+
+
+
+void dvz_canvas_to_refill_partial(DvzCanvas* canvas)
 {
     ASSERT(canvas != NULL);
     DvzRefillStatus status = DVZ_REFILL_REQUESTED;
     atomic_store(&canvas->refills.status, status);
+    dvz_canvas_redraw(canvas);
 }
 
 
@@ -1164,6 +1439,136 @@ void dvz_canvas_to_close(DvzCanvas* canvas)
     ASSERT(canvas != NULL);
     bool value = true;
     atomic_store(&canvas->to_close, value);
+    dvz_canvas_redraw(canvas);
+
+    // The canvases with a render thread are destroyed by the main thread.
+    if (atomic_load(&canvas->is_threaded))
+        backend_post_empty_event(canvas->app->backend);
+}
+
+
+
+void dvz_canvas_on_demand(DvzCanvas* canvas, bool enable)
+{
+    ASSERT(canvas != NULL);
+    if (enable && canvas->offscreen)
+    {
+        log_warn("on-demand rendering is not supported with offscreen canvases");
+        return;
+    }
+    atomic_store(&canvas->on_demand, enable);
+    atomic_store(&canvas->to_redraw, true);
+}
+
+
+
+void dvz_canvas_redraw(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    // Only wake up the event loop, or the render thread of the canvas, once per frame.
+    if (!atomic_exchange(&canvas->to_redraw, true) && atomic_load(&canvas->on_demand))
+    {
+        ASSERT(canvas->app != NULL);
+        if (atomic_load(&canvas->is_threaded))
+        {
+            pthread_mutex_lock(&canvas->render_lock);
+            pthread_cond_broadcast(&canvas->render_cond);
+            pthread_mutex_unlock(&canvas->render_lock);
+        }
+        else
+        {
+            backend_post_empty_event(canvas->app->backend);
+        }
+    }
+}
+
+
+
+void dvz_canvas_present_mode(DvzCanvas* canvas, VkPresentModeKHR present_mode)
+{
+    ASSERT(canvas != NULL);
+    if (canvas->offscreen)
+    {
+        log_warn("the present mode cannot be changed with offscreen canvases");
+        return;
+    }
+    if (atomic_load(&canvas->is_threaded))
+    {
+        log_warn("the present mode cannot be changed while the canvas has a render thread");
+        return;
+    }
+    log_debug("change the canvas present mode to VkPresentModeKHR #%02d", present_mode);
+    uint32_t img_count = canvas->swapchain.img_count;
+    dvz_swapchain_present_mode(&canvas->swapchain, present_mode);
+
+    // Recreate the swapchain with the new present mode.
+    dvz_canvas_recreate(canvas);
+    if (canvas->swapchain.img_count != img_count)
+        log_error(
+            "the number of swapchain images changed from %d to %d", //
+            img_count, canvas->swapchain.img_count);
+    dvz_canvas_to_refill(canvas);
+}
+
+
+
+void dvz_canvas_frames_in_flight(DvzCanvas* canvas, uint32_t count)
+{
+    ASSERT(canvas != NULL);
+    DvzGpu* gpu = canvas->gpu;
+    ASSERT(gpu != NULL);
+    if (canvas->offscreen)
+    {
+        log_warn("the number of frames in flight cannot be changed with offscreen canvases");
+        return;
+    }
+    if (atomic_load(&canvas->is_threaded))
+    {
+        log_warn("the frames in flight cannot be changed while the canvas has a render thread");
+        return;
+    }
+    count = CLIP(count, 1, DVZ_MAX_FRAMES_IN_FLIGHT);
+    if (count == canvas->fences_render_finished.count)
+        return;
+    log_debug("set %d frames in flight", count);
+
+    // The synchronization objects must not be in use.
+    dvz_gpu_wait(gpu);
+
+    dvz_semaphores_destroy(&canvas->sem_img_available);
+    dvz_semaphores_destroy(&canvas->sem_render_finished);
+    dvz_fences_destroy(&canvas->fences_render_finished);
+
+    canvas->sem_img_available = dvz_semaphores(gpu, count);
+    canvas->sem_render_finished = dvz_semaphores(gpu, count);
+    canvas->present_semaphores = &canvas->sem_render_finished;
+    canvas->fences_render_finished = dvz_fences(gpu, count, true);
+
+    // The swapchain images no longer refer to the destroyed fences.
+    for (uint32_t i = 0; i < canvas->fences_flight.count; i++)
+        canvas->fences_flight.fences[i] = VK_NULL_HANDLE;
+    canvas->pacing.submit_pending = false;
+    canvas->cur_frame = 0;
+}
+
+
+
+void dvz_canvas_low_latency(DvzCanvas* canvas, bool enable)
+{
+    ASSERT(canvas != NULL);
+    if (enable && canvas->offscreen)
+    {
+        log_warn("the low-latency mode is not supported with offscreen canvases");
+        return;
+    }
+    if (atomic_load(&canvas->is_threaded))
+    {
+        log_warn("the low-latency mode cannot be changed while the canvas has a render thread");
+        return;
+    }
+    DvzFramePacing* pacing = &canvas->pacing;
+    memset(pacing, 0, sizeof(DvzFramePacing));
+    pacing->low_latency = enable;
 }
 
 
@@ -1655,24 +2060,20 @@ int dvz_event_pending(DvzCanvas* canvas, DvzEventType type)
 {
     ASSERT(canvas != NULL);
     DvzFifo* fifo = &canvas->event_queue;
+    // The lock prevents the event thread from dequeuing events while they are being counted. The
+    // size of the lock-free event queue can be obtained while holding the lock.
+    ASSERT(fifo->is_mpsc);
     pthread_mutex_lock(&fifo->lock);
-    int i, j;
-    if (fifo->head <= fifo->tail)
-    {
-        i = fifo->head;
-        j = fifo->tail;
-    }
-    else
-    {
-        i = fifo->tail;
-        j = fifo->head;
-    }
-    ASSERT(i <= j);
+    int size = dvz_fifo_size(fifo);
+    ASSERT(0 <= size && size <= fifo->capacity);
     // Count the pending events with the given type.
     int count = 0;
-    for (int k = i; k <= j; k++)
+    DvzEvent* ev = NULL;
+    for (int k = 0; k < size; k++)
     {
-        if (((DvzEvent*)fifo->items[k])->type == type)
+        // Skip the events that are still being enqueued.
+        ev = (DvzEvent*)dvz_fifo_peek(fifo, k);
+        if (ev != NULL && ev->type == type)
             count++;
     }
 
@@ -2242,14 +2643,22 @@ static void _canvas_frame_logic(DvzCanvas* canvas)
     // Update the global and local clocks.
     // These calls update canvas->clock.elapsed and canvas->clock.interval, the latter is
     // the delay since the last frame.
-    _clock_set(&canvas->app->clock); // global clock
-    _clock_set(&canvas->clock);      // canvas-local clock
+    // The global clock is updated by the main thread for the canvases with a render thread.
+    if (!atomic_load(&canvas->is_threaded))
+        _clock_set(&canvas->app->clock); // global clock
+    _clock_set(&canvas->clock);          // canvas-local clock
     // Compute the maximum delay between two successive frames.
     canvas->max_delay = fmax(canvas->max_delay, canvas->clock.interval);
 
     // Call INTERACT callbacks (for backends only), which may enqueue some events.
     _event_interact(canvas);
 
+    // Dispatch the input events forwarded by the main thread to the render thread.
+    _event_input_flush(canvas);
+
+    // Dispatch the mouse move and wheel events coalesced since the last frame.
+    _event_coalesced_flush(canvas);
+
     // Call FRAME callbacks.
     _event_frame(canvas);
 
@@ -2269,6 +2678,198 @@ static void _canvas_frame_logic(DvzCanvas* canvas)
 
 
 
+// Whether the canvas or its window has been requested to close.
+static bool _canvas_should_close(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    if (atomic_load(&canvas->to_close) || canvas->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY)
+        return true;
+    if (canvas->window == NULL)
+        return false;
+    return canvas->window->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY ||
+           backend_window_should_close(canvas->app->backend, canvas->window->backend_window);
+}
+
+
+
+// Destroy a canvas that has been requested to close, at the end of its frame loop.
+static void _canvas_close(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    log_trace("destroying canvas");
+    canvas->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
+    if (canvas->window != NULL)
+        canvas->window->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
+
+    // Stop the transfer queue.
+    dvz_event_stop(canvas);
+
+    // Wait for all GPUs to be idle.
+    dvz_app_wait(canvas->app);
+
+    // Destroy the canvas.
+    dvz_canvas_destroy(canvas);
+}
+
+
+
+// Recreate the swapchain, for example after a resize.
+static void _canvas_recreate_swapchain(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    log_trace("swapchain image acquisition failed, recreating the canvas");
+
+    // Recreate the canvas.
+    dvz_canvas_recreate(canvas);
+
+    // Update the DvzViewport struct and call RESIZE callbacks.
+    _event_resize(canvas);
+    canvas->resized = true;
+    if (canvas->screencast != NULL)
+        log_error("resizing is not supported during a screencast");
+
+    // Refill the canvas after the DvzViewport has been updated.
+    // _refill_canvas(canvas, UINT32_MAX);
+    dvz_canvas_to_refill(canvas);
+}
+
+
+
+// Whether a canvas needs to render a new frame, always true unless in on-demand rendering mode.
+static bool _canvas_needs_frame(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->app != NULL);
+    if (!atomic_load(&canvas->on_demand) || canvas->offscreen || canvas->frame_idx == 0)
+        return true;
+
+    // Pending input events, scene updates, transfers, explicit requests...
+    if (atomic_exchange(&canvas->to_redraw, false))
+        return true;
+
+    // Command buffer refills span several frames.
+    if (atomic_load(&canvas->refills.status) != DVZ_REFILL_NONE)
+        return true;
+
+    // The canvas destruction happens in dvz_canvas_frame().
+    if (_canvas_should_close(canvas))
+        return true;
+
+    // Screencasts and videos need all frames.
+    if (canvas->screencast != NULL && canvas->screencast->is_active)
+        return true;
+
+    return _event_timer_delay(canvas) <= 0;
+}
+
+
+
+// Update a smoothed frame pacing timing with a new measurement.
+static void _pacing_smooth(double* value, double sample)
+{
+    ASSERT(value != NULL);
+    if (*value <= 0)
+        *value = sample;
+    else
+        *value += DVZ_PACING_SMOOTHING * (sample - *value);
+}
+
+
+
+// Wait for the render finished fence of a frame, and measure the GPU time of the last submitted
+// frame in low-latency mode.
+static void _pacing_wait_fence(DvzCanvas* canvas, uint32_t idx)
+{
+    ASSERT(canvas != NULL);
+    DvzFramePacing* pacing = &canvas->pacing;
+    DvzFences* fences = &canvas->fences_render_finished;
+
+    bool measure = pacing->low_latency && pacing->submit_pending && idx == pacing->submit_frame;
+    bool was_ready = measure && dvz_fences_ready(fences, idx);
+    dvz_fences_wait(fences, idx);
+    if (!measure)
+        return;
+
+    // If the fence was already signaled, the measurement is only an upper bound.
+    double sample = _clock_get(&canvas->clock) - pacing->submit_time;
+    if (was_ready && pacing->gpu_time > 0)
+        sample = fmin(sample, pacing->gpu_time);
+    _pacing_smooth(&pacing->gpu_time, sample);
+    pacing->submit_pending = false;
+}
+
+
+
+// Record the time of the swapchain image acquisition.
+static void _pacing_acquired(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzFramePacing* pacing = &canvas->pacing;
+    double now = _clock_get(&canvas->clock);
+    if (pacing->frame_start > 0 && now - pacing->frame_start < DVZ_PACING_MAX_PERIOD)
+        _pacing_smooth(&pacing->frame_period, now - pacing->frame_start);
+    pacing->frame_start = now;
+}
+
+
+
+// In low-latency mode, wait for the previous frame, then wait until the latest time at which the
+// frame can be prepared and rendered before the next presentation, and only then sample the input.
+static void _pacing_wait(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzFramePacing* pacing = &canvas->pacing;
+    uint32_t count = canvas->fences_render_finished.count;
+    _pacing_wait_fence(canvas, (canvas->cur_frame + count - 1) % count);
+
+    double deadline = pacing->frame_start + pacing->frame_period - pacing->cpu_time -
+                      pacing->gpu_time - DVZ_LOW_LATENCY_MARGIN;
+    double delay = deadline - _clock_get(&canvas->clock);
+    if (delay > 0)
+        dvz_sleep((int)(delay * 1000));
+
+    // The window events of the canvases with a render thread are polled by the main thread.
+    if (canvas->window != NULL && !atomic_load(&canvas->is_threaded))
+        dvz_window_poll_events(canvas->window);
+}
+
+
+
+// Record the CPU time of the frame and the submission time.
+static void _pacing_submitted(DvzCanvas* canvas, uint32_t frame, double logic_start)
+{
+    ASSERT(canvas != NULL);
+    DvzFramePacing* pacing = &canvas->pacing;
+    double now = _clock_get(&canvas->clock);
+    _pacing_smooth(&pacing->cpu_time, now - logic_start);
+    pacing->submit_time = now;
+    pacing->submit_frame = frame;
+    pacing->submit_pending = true;
+}
+
+
+
+// Wait for window events when no canvas has rendered a frame, until the next TIMER event at most.
+static void _app_wait_events(DvzApp* app)
+{
+    ASSERT(app != NULL);
+    double timeout = DVZ_ON_DEMAND_MAX_WAIT;
+    DvzContainerIterator iterator = dvz_container_iterator(&app->canvases);
+    DvzCanvas* canvas = NULL;
+    while (iterator.item != NULL)
+    {
+        canvas = (DvzCanvas*)iterator.item;
+        // The TIMER events of the canvases with a render thread are handled in that thread.
+        if (dvz_obj_is_created(&canvas->obj) && !atomic_load(&canvas->is_threaded))
+            timeout = fmin(timeout, _event_timer_delay(canvas));
+        dvz_container_iter(&iterator);
+    }
+    if (timeout > 0)
+        backend_wait_events(app->backend, timeout);
+}
+
+
+
 void dvz_canvas_frame_submit(DvzCanvas* canvas)
 {
     ASSERT(canvas != NULL);
@@ -2345,11 +2946,13 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
 
 
 
-static void _process_gpu_transfers(DvzApp* app)
+// Return whether there were pending transfers.
+static bool _process_gpu_transfers(DvzApp* app)
 {
     // NOTE: this has never been tested with multiple GPUs yet.
     DvzContainerIterator iterator = dvz_container_iterator(&app->gpus);
     DvzGpu* gpu = NULL;
+    bool has_transfers = false;
     while (iterator.item != NULL)
     {
         gpu = iterator.item;
@@ -2358,7 +2961,10 @@ static void _process_gpu_transfers(DvzApp* app)
 
         // Pending transfers.
         ASSERT(gpu->context != NULL);
-        // NOTE: the function below uses hard GPU synchronization primitives
+        has_transfers |= dvz_fifo_size(&gpu->context->transfers) > 0;
+        // NOTE: the transfers are submitted to the render queue after the frames that have just
+        // been submitted, so the next frames will see the transferred data without any
+        // queue-wide wait.
         dvz_process_transfers(gpu->context);
 
         // IMPORTANT: we need to wait for the present queue to be idle, otherwise the GPU hangs
@@ -2375,6 +2981,7 @@ static void _process_gpu_transfers(DvzApp* app)
 
         dvz_container_iter(&iterator);
     }
+    return has_transfers;
 }
 
 
@@ -2404,8 +3011,15 @@ int dvz_canvas_frame(DvzCanvas* canvas)
         _event_produce(canvas, ev);
     }
 
-    // Poll events.
-    if (canvas->window != NULL)
+    // Limit the number of frames in flight: wait until the GPU has rendered the last frame that
+    // used the same synchronization objects.
+    _pacing_wait_fence(canvas, canvas->cur_frame);
+
+    // Poll events. In low-latency mode, this happens just before the frame logic. The window
+    // events of the canvases with a render thread are polled by the main thread.
+    bool low_latency = canvas->pacing.low_latency;
+    bool is_threaded = atomic_load(&canvas->is_threaded);
+    if (canvas->window != NULL && !low_latency && !is_threaded)
         dvz_window_poll_events(canvas->window);
 
     // NOTE: swapchain image acquisition happens here
@@ -2418,78 +3032,62 @@ int dvz_canvas_frame(DvzCanvas* canvas)
 
     // Wait for fence.
     dvz_fences_wait(&canvas->fences_flight, canvas->swapchain.img_idx);
+    if (low_latency)
+        _pacing_acquired(canvas);
 
     // If there is a problem with swapchain image acquisition, wait and try again later.
     if (canvas->swapchain.obj.status == DVZ_OBJECT_STATUS_INVALID)
     {
         log_trace("swapchain image acquisition failed, waiting and skipping this frame");
         dvz_gpu_wait(canvas->gpu);
+        // The window events must still be processed, for example when the window is minimized.
+        if (canvas->window != NULL && low_latency && !is_threaded)
+            dvz_window_poll_events(canvas->window);
 
         // dvz_container_iter(&iterator);
         // continue;
         return 1;
     }
 
-    // If the swapchain needs to be recreated (for example, after a resize), do it.
+    // If the swapchain needs to be recreated (for example, after a resize), do it. The backend
+    // window of the canvases with a render thread may only be accessed by the main thread, which
+    // recreates the swapchain while the render thread waits.
     if (canvas->swapchain.obj.status == DVZ_OBJECT_STATUS_NEED_RECREATE)
     {
-        log_trace("swapchain image acquisition failed, recreating the canvas");
-
-        // Recreate the canvas.
-        dvz_canvas_recreate(canvas);
-
-        // Update the DvzViewport struct and call RESIZE callbacks.
-        _event_resize(canvas);
-        canvas->resized = true;
-        if (canvas->screencast != NULL)
-            log_error("resizing is not supported during a screencast");
-
-        // Refill the canvas after the DvzViewport has been updated.
-        // _refill_canvas(canvas, UINT32_MAX);
-        dvz_canvas_to_refill(canvas);
-
-        // n_canvas_active++;
-        // dvz_container_iter(&iterator);
-        // continue;
+        DvzRenderThreadStatus running = DVZ_RENDER_THREAD_RUNNING;
+        if (!is_threaded)
+            _canvas_recreate_swapchain(canvas);
+        else if (atomic_compare_exchange_strong(
+                     &canvas->render_status, &running, DVZ_RENDER_THREAD_RECREATE))
+            backend_post_empty_event(app->backend);
         return 0;
     }
 
     // Destroy the canvas if needed.
-    // Check canvas.to_close, and whether the user as requested to close the window.
-    if (atomic_load(&canvas->to_close) ||
-        (canvas->window != NULL &&
-         backend_window_should_close(app->backend, canvas->window->backend_window)))
-    {
-        canvas->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
-        if (canvas->window != NULL)
-            canvas->window->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
-    }
-    if (canvas->window != NULL && canvas->window->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY)
-        canvas->obj.status = DVZ_OBJECT_STATUS_NEED_DESTROY;
-
-    if (canvas->obj.status == DVZ_OBJECT_STATUS_NEED_DESTROY)
+    // Check canvas.to_close, and whether the user as requested to close the window. The canvases
+    // with a render thread are destroyed by the main thread.
+    if (!is_threaded && _canvas_should_close(canvas))
     {
-        log_trace("destroying canvas");
-
-        // Stop the transfer queue.
-        dvz_event_stop(canvas);
-
-        // Wait for all GPUs to be idle.
-        dvz_app_wait(app);
-
-        // Destroy the canvas.
-        dvz_canvas_destroy(canvas);
-
+        _canvas_close(canvas);
         return 1;
     }
 
     // Frame logic.
+    double logic_start = 0;
+    if (low_latency)
+    {
+        _pacing_wait(canvas);
+        logic_start = _clock_get(&canvas->clock);
+    }
     _canvas_frame_logic(canvas);
     canvas->resized = false;
 
     // Submit the command buffers and swapchain logic.
     // log_trace("submitting frame for canvas #%d", canvas_idx);
+    uint32_t frame = canvas->cur_frame;
     dvz_canvas_frame_submit(canvas);
+    if (low_latency)
+        _pacing_submitted(canvas, frame, logic_start);
 
     canvas->frame_idx++;
 
@@ -2498,6 +3096,183 @@ int dvz_canvas_frame(DvzCanvas* canvas)
 
 
 
+/*************************************************************************************************/
+/*  Render thread                                                                                */
+/*************************************************************************************************/
+
+// Whether the render thread has frames to render, or should stop.
+static bool _render_thread_ready(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzRenderThreadStatus status = atomic_load(&canvas->render_status);
+    return status == DVZ_RENDER_THREAD_STOP ||
+           (status == DVZ_RENDER_THREAD_RUNNING && canvas->render_frames > 0);
+}
+
+
+
+// Wait until a new frame is requested with dvz_canvas_redraw(), for at most the given delay in
+// seconds.
+static void _render_thread_wait(DvzCanvas* canvas, double timeout)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(timeout >= 0);
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    double t = ts.tv_nsec * 1e-9 + timeout;
+    ts.tv_sec += (time_t)t;
+    ts.tv_nsec = (long)((t - floor(t)) * 1e9);
+
+    pthread_mutex_lock(&canvas->render_lock);
+    if (!atomic_load(&canvas->to_redraw) &&
+        atomic_load(&canvas->render_status) == DVZ_RENDER_THREAD_RUNNING)
+        pthread_cond_timedwait(&canvas->render_cond, &canvas->render_lock, &ts);
+    pthread_mutex_unlock(&canvas->render_lock);
+}
+
+
+
+static void* _render_thread(void* user_data)
+{
+    DvzCanvas* canvas = (DvzCanvas*)user_data;
+    ASSERT(canvas != NULL);
+    DvzApp* app = canvas->app;
+    ASSERT(app != NULL);
+    ASSERT(canvas->gpu->context != NULL);
+    log_debug("starting canvas render thread");
+
+    bool is_last = false;
+    while (true)
+    {
+        // Wait until dvz_app_run() requests frames, or until the main thread has recreated the
+        // swapchain.
+        pthread_mutex_lock(&canvas->render_lock);
+        while (!_render_thread_ready(canvas))
+            pthread_cond_wait(&canvas->render_cond, &canvas->render_lock);
+        pthread_mutex_unlock(&canvas->render_lock);
+        if (atomic_load(&canvas->render_status) == DVZ_RENDER_THREAD_STOP)
+            break;
+
+        // In on-demand rendering mode, skipped frames wait for the next redraw request or TIMER
+        // event.
+        if (_canvas_needs_frame(canvas))
+            dvz_canvas_frame(canvas);
+        else
+            _render_thread_wait(canvas, fmin(DVZ_ON_DEMAND_MAX_WAIT, _event_timer_delay(canvas)));
+
+        pthread_mutex_lock(&canvas->render_lock);
+        canvas->render_frames--;
+        is_last = canvas->render_frames == 0;
+        pthread_mutex_unlock(&canvas->render_lock);
+
+        // Wake up the main thread to process the transfers requested by this frame, or to return
+        // from dvz_app_run() after the last frame.
+        if (is_last || dvz_fifo_size(&canvas->gpu->context->transfers) > 0)
+            backend_post_empty_event(app->backend);
+    }
+
+    log_debug("end canvas render thread");
+    return NULL;
+}
+
+
+
+// Request frames to the render threads of all canvases, at the beginning of dvz_app_run().
+static void _render_threads_start(DvzApp* app, uint64_t frame_count)
+{
+    ASSERT(app != NULL);
+    DvzContainerIterator iterator = dvz_container_iterator(&app->canvases);
+    DvzCanvas* canvas = NULL;
+    while (iterator.item != NULL)
+    {
+        canvas = (DvzCanvas*)iterator.item;
+        if (dvz_obj_is_created(&canvas->obj) && atomic_load(&canvas->is_threaded))
+        {
+            pthread_mutex_lock(&canvas->render_lock);
+            canvas->render_frames = frame_count;
+            pthread_cond_broadcast(&canvas->render_cond);
+            pthread_mutex_unlock(&canvas->render_lock);
+        }
+        dvz_container_iter(&iterator);
+    }
+}
+
+
+
+// Whether the render thread of a canvas still has frames to render.
+static bool _render_thread_busy(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    pthread_mutex_lock(&canvas->render_lock);
+    bool busy = canvas->render_frames > 0;
+    pthread_mutex_unlock(&canvas->render_lock);
+    return busy;
+}
+
+
+
+// Handle the requests of the render thread of a canvas in the main thread: swapchain recreation
+// and canvas destruction. Return whether the canvas is still active.
+static bool _render_thread_requests(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    if (_canvas_should_close(canvas))
+    {
+        dvz_canvas_render_thread(canvas, false);
+        _canvas_close(canvas);
+        return false;
+    }
+
+    if (atomic_load(&canvas->render_status) == DVZ_RENDER_THREAD_RECREATE)
+    {
+        _canvas_recreate_swapchain(canvas);
+        pthread_mutex_lock(&canvas->render_lock);
+        atomic_store(&canvas->render_status, DVZ_RENDER_THREAD_RUNNING);
+        pthread_cond_broadcast(&canvas->render_cond);
+        pthread_mutex_unlock(&canvas->render_lock);
+    }
+    return true;
+}
+
+
+
+void dvz_canvas_render_thread(DvzCanvas* canvas, bool enable)
+{
+    ASSERT(canvas != NULL);
+    if (enable == atomic_load(&canvas->is_threaded))
+        return;
+    if (enable && (canvas->offscreen || canvas->overlay))
+    {
+        log_warn("render threads are not supported with offscreen canvases or GUIs");
+        return;
+    }
+
+    if (enable)
+    {
+        log_debug("start the render thread of the canvas");
+        canvas->render_frames = 0;
+        atomic_store(&canvas->render_status, DVZ_RENDER_THREAD_RUNNING);
+        atomic_store(&canvas->is_threaded, true);
+        canvas->render_thread = dvz_thread(_render_thread, canvas);
+    }
+    else
+    {
+        log_debug("stop the render thread of the canvas");
+        pthread_mutex_lock(&canvas->render_lock);
+        atomic_store(&canvas->render_status, DVZ_RENDER_THREAD_STOP);
+        pthread_cond_broadcast(&canvas->render_cond);
+        pthread_mutex_unlock(&canvas->render_lock);
+        dvz_thread_join(&canvas->render_thread);
+        atomic_store(&canvas->is_threaded, false);
+    }
+}
+
+
+
+/*************************************************************************************************/
+/*  App run                                                                                      */
+/*************************************************************************************************/
+
 static int _app_autorun(DvzApp* app)
 {
     ASSERT(app != NULL);
@@ -2573,10 +3348,18 @@ int dvz_app_run(DvzApp* app, uint64_t frame_count)
     DvzContainerIterator iterator;
     DvzCanvas* canvas = NULL;
     uint32_t n_canvas_active = 0;
+    uint32_t n_canvas_rendered = 0;
+    uint32_t n_threads_busy = 0;
     uint64_t iter = 0;
-    for (iter = 0; iter < frame_count; iter++)
+
+    // The canvases with a render thread run their frames concurrently, while the main thread
+    // polls the window events and processes the GPU transfers until they are done.
+    _render_threads_start(app, frame_count);
+    for (iter = 0; iter < frame_count || n_threads_busy > 0; iter++)
     {
         n_canvas_active = 0;
+        n_canvas_rendered = 0;
+        n_threads_busy = 0;
 
         // Loop over all canvases.
         iterator = dvz_container_iterator(&app->canvases);
@@ -2586,17 +3369,62 @@ int dvz_app_run(DvzApp* app, uint64_t frame_count)
             canvas = (DvzCanvas*)iterator.item;
             ASSERT(canvas != NULL);
 
+            // The frames of these canvases are rendered by their render thread.
+            if (atomic_load(&canvas->is_threaded))
+            {
+                if (_render_thread_requests(canvas))
+                {
+                    n_canvas_active++;
+                    n_threads_busy += _render_thread_busy(canvas) ? 1 : 0;
+                }
+                dvz_container_iter(&iterator);
+                continue;
+            }
+
+            // In on-demand rendering mode, skip the frame if nothing has changed. Once all
+            // frames have been rendered, wait for the render threads.
+            if (canvas->obj.status >= DVZ_OBJECT_STATUS_CREATED &&
+                (iter >= frame_count || !_canvas_needs_frame(canvas)))
+            {
+                n_canvas_active++;
+                dvz_container_iter(&iterator);
+                continue;
+            }
+
             // Run and present the next canvas frame, and count the canvas as active if the
             // presentation was successfull.
             if (dvz_canvas_frame(canvas) == 0)
                 n_canvas_active++;
+            n_canvas_rendered++;
 
             // Go to the next canvas.
             dvz_container_iter(&iterator);
         }
 
-        // Process the pending GPU transfers after all canvases have executed their frame.
-        _process_gpu_transfers(app);
+        // Update the global clock on behalf of the render threads.
+        if (n_threads_busy > 0)
+            _clock_set(&app->clock);
+
+        // Process the pending GPU transfers after all canvases have executed their frame. The
+        // transferred data will only be visible at the next frame.
+        if (_process_gpu_transfers(app))
+        {
+            iterator = dvz_container_iterator(&app->canvases);
+            while (iterator.item != NULL)
+            {
+                canvas = (DvzCanvas*)iterator.item;
+                if (atomic_load(&canvas->is_threaded))
+                    dvz_canvas_redraw(canvas);
+                else
+                    atomic_store(&canvas->to_redraw, true);
+                dvz_container_iter(&iterator);
+            }
+        }
+
+        // Block until the next window event if no canvas needed a new frame. The render
+        // threads post an empty event when they need the main thread.
+        if (n_canvas_rendered == 0 && n_canvas_active > 0)
+            _app_wait_events(app);
 
         // Close the application if all canvases have been closed.
         if (n_canvas_active == 0 && frame_count != 1)
@@ -2642,6 +3470,12 @@ void dvz_canvas_destroy(DvzCanvas* canvas)
     ASSERT(canvas->app != NULL);
     ASSERT(canvas->gpu != NULL);
 
+    // Stop the render thread.
+    dvz_canvas_render_thread(canvas, false);
+    dvz_fifo_destroy(&canvas->input_queue);
+    pthread_mutex_destroy(&canvas->render_lock);
+    pthread_cond_destroy(&canvas->render_cond);
+
     // Stop the event thread.
     dvz_gpu_wait(canvas->gpu);
     dvz_event_stop(canvas);
@@ -2650,6 +3484,9 @@ void dvz_canvas_destroy(DvzCanvas* canvas)
 
     // Destroy callbacks.
     _destroy_callbacks(canvas);
+    pthread_rwlock_destroy(&canvas->callbacks_lock);
+    pthread_mutex_destroy(&canvas->event_lock);
+    pthread_mutex_destroy(&canvas->coalesce_lock);
 
     // Destroy the graphics.
     log_trace("canvas destroy graphics pipelines");
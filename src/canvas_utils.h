@@ -13,15 +13,28 @@ extern "C" {
 /*  Event system                                                                                 */
 /*************************************************************************************************/
 
-// Enqueue an event.
+// Whether an event is superseded by the next event of the same type, so that it can be dropped.
+static bool _event_coalescable(DvzEventType type)
+{
+    return type == DVZ_EVENT_MOUSE_MOVE || type == DVZ_EVENT_FRAME || type == DVZ_EVENT_TIMER;
+}
+
+
+
+// Enqueue an event. This never waits for the event thread, which may be the calling thread when
+// an async callback emits an event: when the queue is full, the event is dropped.
 static void _event_enqueue(DvzCanvas* canvas, DvzEvent event)
 {
     ASSERT(canvas != NULL);
     DvzFifo* fifo = &canvas->event_queue;
     ASSERT(fifo != NULL);
-    DvzEvent* ev = (DvzEvent*)calloc(1, sizeof(DvzEvent));
-    *ev = event;
-    dvz_fifo_enqueue(fifo, ev);
+    ASSERT(fifo->item_size == sizeof(DvzEvent));
+    if (dvz_fifo_push(fifo, &event))
+        return;
+    if (_event_coalescable(event.type))
+        log_trace("event queue is full, dropping event %d", event.type);
+    else
+        log_warn("event queue is full, dropping event %d", event.type);
 }
 
 
@@ -32,14 +45,9 @@ static DvzEvent _event_dequeue(DvzCanvas* canvas, bool wait)
     ASSERT(canvas != NULL);
     DvzFifo* fifo = &canvas->event_queue;
     ASSERT(fifo != NULL);
-    DvzEvent* item = (DvzEvent*)dvz_fifo_dequeue(fifo, wait);
-    DvzEvent out;
-    out.type = DVZ_EVENT_NONE;
-    if (item == NULL)
-        return out;
-    ASSERT(item != NULL);
-    out = *item;
-    FREE(item);
+    DvzEvent out = {0};
+    if (!dvz_fifo_pop(fifo, &out, wait))
+        out.type = DVZ_EVENT_NONE;
     return out;
 }
 
@@ -51,12 +59,8 @@ static bool _has_async_callbacks(DvzCanvas* canvas, DvzEventType type)
     if (canvas == NULL)
         return false;
     ASSERT(canvas != NULL);
-    for (uint32_t i = 0; i < canvas->callbacks_count; i++)
-    {
-        if (canvas->callbacks[i].type == type && canvas->callbacks[i].mode == DVZ_EVENT_MODE_ASYNC)
-            return true;
-    }
-    return false;
+    ASSERT(type < DVZ_EVENT_COUNT);
+    return atomic_load(&canvas->callback_tables[type][DVZ_EVENT_MODE_ASYNC].count) > 0;
 }
 
 
@@ -67,10 +71,42 @@ static bool _has_event_callbacks(DvzCanvas* canvas, DvzEventType type)
     ASSERT(canvas != NULL);
     if (type == DVZ_EVENT_NONE || type == DVZ_EVENT_INIT)
         return true;
-    for (uint32_t i = 0; i < canvas->callbacks_count; i++)
-        if (canvas->callbacks[i].type == type)
-            return true;
-    return false;
+    ASSERT(type < DVZ_EVENT_COUNT);
+    return atomic_load(&canvas->callback_tables[type][DVZ_EVENT_MODE_SYNC].count) > 0 ||
+           atomic_load(&canvas->callback_tables[type][DVZ_EVENT_MODE_ASYNC].count) > 0;
+}
+
+
+
+static bool _event_is_input(DvzEventType type)
+{
+    return (type >= DVZ_EVENT_MOUSE_PRESS && type <= DVZ_EVENT_KEY_RELEASE) ||
+           type == DVZ_EVENT_GUI;
+}
+
+
+
+// Copy the indices of the callbacks registered for a given type and mode, sorted by param, and
+// return their number. The registers are never moved, so that the callbacks can be called
+// without the table lock, and they can register new callbacks.
+static uint32_t _event_callbacks(
+    DvzCanvas* canvas, DvzEventType type, DvzEventMode mode, uint32_t* indices)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(type < DVZ_EVENT_COUNT);
+    ASSERT(mode < DVZ_EVENT_MODE_COUNT);
+    ASSERT(indices != NULL);
+
+    DvzEventCallbackTable* table = &canvas->callback_tables[type][mode];
+    if (atomic_load(&table->count) == 0)
+        return 0;
+
+    pthread_rwlock_rdlock(&canvas->callbacks_lock);
+    uint32_t count = atomic_load(&table->count);
+    ASSERT(count <= DVZ_MAX_EVENT_CALLBACKS);
+    memcpy(indices, table->indices, count * sizeof(uint32_t));
+    pthread_rwlock_unlock(&canvas->callbacks_lock);
+    return count;
 }
 
 
@@ -80,45 +116,39 @@ static int _event_consume(DvzCanvas* canvas, DvzEvent ev, DvzEventMode mode)
 {
     ASSERT(canvas != NULL);
 
-    if (canvas->enable_lock)
-        dvz_thread_lock(&canvas->event_thread);
+    uint32_t indices[DVZ_MAX_EVENT_CALLBACKS] = {0};
+    uint32_t count = _event_callbacks(canvas, ev.type, mode, indices);
+    if (count == 0)
+        return 0;
 
-    // HACK: we first call the callbacks with no param, then we call the callbacks with a non-zero
-    // param. This is a way to use the param as a priority value. This is used by the scene FRAME
-    // callback so that it occurs after the user callbacks.
-    int n_callbacks = 0;
+    // Only the async callbacks hold the event lock, so that slow async callbacks do not block the
+    // sync callbacks called at every frame.
+    if (mode == DVZ_EVENT_MODE_ASYNC)
+        dvz_event_lock(canvas);
+
+    // The callbacks are sorted by param, which is used as a priority value. This is used by the
+    // scene FRAME callback so that it occurs after the user callbacks.
     DvzEventCallbackRegister* r = NULL;
-    for (uint32_t pass = 0; pass < 2; pass++)
+    for (uint32_t i = 0; i < count; i++)
     {
-        for (uint32_t i = 0; i < canvas->callbacks_count; i++)
-        {
-            r = &canvas->callbacks[i];
-            // Will pass the user_data that was registered, to the callback function.
-            ev.user_data = r->user_data;
-
-            // Only call the callbacks registered for the specified type.
-            if ((r->type == ev.type) &&              //
-                (r->mode == mode) &&                 //
-                (((pass == 0) && (r->param == 0)) || //
-                 ((pass == 1) && (r->param > 0))))   //
-            {
-                r->callback(canvas, ev);
-                n_callbacks++;
-            }
-        }
+        r = &canvas->callbacks[indices[i]];
+        ASSERT(r->type == ev.type);
+        ASSERT(r->mode == mode);
+        // Will pass the user_data that was registered, to the callback function.
+        ev.user_data = r->user_data;
+        r->callback(canvas, ev);
     }
 
-    if (canvas->enable_lock)
-        dvz_thread_unlock(&canvas->event_thread);
+    if (mode == DVZ_EVENT_MODE_ASYNC)
+        dvz_event_unlock(canvas);
 
-    return n_callbacks;
+    return (int)count;
 }
 
 
 
-// Produce an event, call the sync callbacks, and enqueue the event if there is at least one async
-// callback.
-static int _event_produce(DvzCanvas* canvas, DvzEvent ev)
+// Call the sync callbacks, and enqueue the event if there is at least one async callback.
+static int _event_dispatch(DvzCanvas* canvas, DvzEvent ev)
 {
     ASSERT(canvas != NULL);
 
@@ -134,6 +164,140 @@ static int _event_produce(DvzCanvas* canvas, DvzEvent ev)
 
 
 
+/*************************************************************************************************/
+/*  Event coalescing                                                                             */
+/*************************************************************************************************/
+
+static bool _event_coalescable(DvzEventType type)
+{
+    return type == DVZ_EVENT_MOUSE_MOVE || type == DVZ_EVENT_MOUSE_WHEEL;
+}
+
+
+
+// Merge an event into a previous event of the same type: the latest position and modifiers are
+// kept, and the wheel deltas are accumulated.
+static void _event_merge(DvzEvent* dst, const DvzEvent* src)
+{
+    ASSERT(dst != NULL);
+    ASSERT(src != NULL);
+    ASSERT(dst->type == src->type);
+    switch (src->type)
+    {
+    case DVZ_EVENT_MOUSE_MOVE:
+        dst->u.m = src->u.m;
+        break;
+    case DVZ_EVENT_MOUSE_WHEEL:
+        dst->u.w.pos[0] = src->u.w.pos[0];
+        dst->u.w.pos[1] = src->u.w.pos[1];
+        dst->u.w.dir[0] += src->u.w.dir[0];
+        dst->u.w.dir[1] += src->u.w.dir[1];
+        dst->u.w.modifiers = src->u.w.modifiers;
+        break;
+    default:
+        log_error("event type %d cannot be coalesced", src->type);
+        break;
+    }
+}
+
+
+
+// Store a MOUSE_MOVE or MOUSE_WHEEL event until the next frame, merging it with the pending event
+// of the same type.
+static void _event_coalesce(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(_event_coalescable(ev.type));
+    DvzEvent* pending =
+        ev.type == DVZ_EVENT_MOUSE_MOVE ? &canvas->coalesced_move : &canvas->coalesced_wheel;
+
+    pthread_mutex_lock(&canvas->coalesce_lock);
+    if (pending->type == DVZ_EVENT_NONE)
+        *pending = ev;
+    else
+        _event_merge(pending, &ev);
+    pthread_mutex_unlock(&canvas->coalesce_lock);
+}
+
+
+
+// Dispatch the coalesced events, called once per frame.
+static void _event_coalesced_flush(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+
+    pthread_mutex_lock(&canvas->coalesce_lock);
+    DvzEvent move = canvas->coalesced_move;
+    DvzEvent wheel = canvas->coalesced_wheel;
+    canvas->coalesced_move.type = DVZ_EVENT_NONE;
+    canvas->coalesced_wheel.type = DVZ_EVENT_NONE;
+    pthread_mutex_unlock(&canvas->coalesce_lock);
+
+    if (move.type != DVZ_EVENT_NONE)
+        _event_dispatch(canvas, move);
+    if (wheel.type != DVZ_EVENT_NONE)
+        _event_dispatch(canvas, wheel);
+}
+
+
+
+static bool _event_same_type(const void* item, void* user_data)
+{
+    ASSERT(item != NULL);
+    ASSERT(user_data != NULL);
+    return ((const DvzEvent*)item)->type == *((DvzEventType*)user_data);
+}
+
+
+
+// Merge the events of the same type that directly follow a dequeued event in the queue.
+static void _event_dequeue_coalesced(DvzCanvas* canvas, DvzEvent* ev)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(ev != NULL);
+    if (!atomic_load(&canvas->coalesce_events) || !_event_coalescable(ev->type))
+        return;
+
+    DvzEventType type = ev->type;
+    DvzEvent next = {0};
+    uint32_t count = 0;
+    while (dvz_fifo_pop_if(&canvas->event_queue, &next, _event_same_type, &type))
+    {
+        _event_merge(ev, &next);
+        count++;
+    }
+    if (count > 0)
+        log_trace("coalesced %d pending events of type %d", count, type);
+}
+
+
+
+/*************************************************************************************************/
+/*  Event producer and consumer                                                                  */
+/*************************************************************************************************/
+
+// Produce an event, call the sync callbacks, and enqueue the event if there is at least one async
+// callback. Mouse move and wheel events are deferred until the next frame when coalescing is
+// enabled.
+static int _event_produce(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(canvas != NULL);
+
+    // User input requires a new frame in on-demand rendering mode.
+    if (_event_is_input(ev.type))
+        dvz_canvas_redraw(canvas);
+
+    if (atomic_load(&canvas->coalesce_events) && _event_coalescable(ev.type))
+    {
+        _event_coalesce(canvas, ev);
+        return 0;
+    }
+
+    return _event_dispatch(canvas, ev);
+}
+
+
+
 // Event loop running in the background thread, waiting for events and dequeuing them.
 static void* _event_thread(void* p_canvas)
 {
@@ -160,6 +324,9 @@ static void* _event_thread(void* p_canvas)
             break;
         }
 
+        // Merge the following mouse move or wheel events, if coalescing is enabled.
+        _event_dequeue_coalesced(canvas, &ev);
+
         // Logic to discard some events if the queue is getting overloaded because of long-running
         // callbacks.
 
@@ -1,5 +1,6 @@
 #include "../include/datoviz/context.h"
 #include "../include/datoviz/atlas.h"
+#include "../include/datoviz/canvas.h"
 #include "context_utils.h"
 #include "vklite_utils.h"
 #include <stdlib.h>
@@ -42,6 +43,12 @@ static void _context_default_buffers(DvzContext* context)
     VkBufferUsageFlagBits transferable =
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
+    // When the device-local memory is also host-visible, the vertex and storage buffers are
+    // permanently mapped and the uploads are written directly, without staging.
+    VkMemoryPropertyFlags direct = _direct_write_memory(context->gpu);
+    if (direct != 0)
+        log_info("using host-visible device-local memory for the vertex and storage buffers");
+
     // Staging buffer
     {
         buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
@@ -53,9 +60,7 @@ static void _context_default_buffers(DvzContext* context)
             buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
         dvz_buffer_create(buffer);
         ASSERT(dvz_obj_is_created(&buffer->obj));
-
-        // Permanently map the buffer.
-        buffer->mmap = dvz_buffer_map(buffer, 0, VK_WHOLE_SIZE);
+        ASSERT(buffer->mmap != NULL);
     }
 
     // Vertex buffer
@@ -67,7 +72,7 @@ static void _context_default_buffers(DvzContext* context)
         dvz_buffer_usage(
             buffer,
             transferable | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | direct);
         dvz_buffer_create(buffer);
         ASSERT(dvz_obj_is_created(&buffer->obj));
     }
@@ -84,14 +89,16 @@ static void _context_default_buffers(DvzContext* context)
         ASSERT(dvz_obj_is_created(&buffer->obj));
     }
 
-    // Storage buffer
+    // Storage buffer, also used for indirect draw commands.
     {
         buffer = dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STORAGE);
         ASSERT(buffer != NULL);
         dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_STORAGE);
         dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_STORAGE_SIZE);
-        dvz_buffer_usage(buffer, transferable | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
-        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        dvz_buffer_usage(
+            buffer, transferable | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | direct);
         dvz_buffer_create(buffer);
         ASSERT(dvz_obj_is_created(&buffer->obj));
     }
@@ -119,9 +126,15 @@ static void _context_default_buffers(DvzContext* context)
             buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
         dvz_buffer_create(buffer);
         ASSERT(dvz_obj_is_created(&buffer->obj));
+        ASSERT(buffer->mmap != NULL);
+    }
 
-        // Permanently map the buffer.
-        buffer->mmap = dvz_buffer_map(buffer, 0, VK_WHOLE_SIZE);
+    // Sub-allocators of the buffer regions.
+    for (uint32_t i = 0; i < DVZ_BUFFER_TYPE_COUNT; i++)
+    {
+        buffer = dvz_container_get(&context->buffers, i);
+        context->allocators[i] =
+            dvz_alloc(buffer->size, _buffer_alignment(context->gpu, (DvzBufferType)i));
     }
 }
 
@@ -157,8 +170,14 @@ static void _destroy_resources(DvzContext* context)
 {
     ASSERT(context != NULL);
 
+    // Make sure no transfer batch is still using the buffers.
+    _transfer_batch_wait(context);
+    _deferred_buffers_destroy(context, true);
+
     log_trace("context destroy buffers");
     CONTAINER_DESTROY_ITEMS(DvzBuffer, context->buffers, dvz_buffer_destroy)
+    for (uint32_t i = 0; i < DVZ_BUFFER_TYPE_COUNT; i++)
+        dvz_alloc_destroy(&context->allocators[i]);
 
     log_trace("context destroy sets of images");
     CONTAINER_DESTROY_ITEMS(DvzImages, context->images, dvz_images_destroy)
@@ -228,11 +247,11 @@ DvzContext* dvz_context(DvzGpu* gpu)
             DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzCompute), DVZ_OBJECT_TYPE_COMPUTE);
     }
 
-    // Transfer command buffer.
-    // context->transfer_cmd = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_TRANSFER, 1);
-
     // FIFO queue with the pending transfers.
-    context->transfers = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
+    context->transfers = dvz_fifo_typed(DVZ_MAX_FIFO_CAPACITY, sizeof(DvzTransfer));
+
+    // Transfer command buffers and fences.
+    context->transfer_batch = _transfer_batch(gpu);
 
     // HACK: the vklite module makes the assumption that the queue #0 supports transfers.
     // Here, in the context, we make the same assumption. The first queue is reserved to transfers.
@@ -291,8 +310,16 @@ void dvz_context_destroy(DvzContext* context)
     // Destroy the buffers, images, samplers, textures, computes.
     _destroy_resources(context);
 
-    // Destroy the transfers queue.
+    // Destroy the transfers queue and the transfer command buffers.
     dvz_fifo_destroy(&context->transfers);
+    _transfer_batch_destroy(context);
+
+    // Complete the last downloads, and release the caller-owned data that was waiting for the
+    // transfers.
+    _download_callbacks_flush(context);
+    uint32_t release_count = 0;
+    DvzTransferRelease* releases = _deferred_releases_take(context, &release_count);
+    _deferred_releases_run(releases, release_count);
 
     // Free the allocated memory.
     dvz_container_destroy(&context->buffers);
@@ -323,11 +350,188 @@ void dvz_app_reset(DvzApp* app)
 
 
 
+/*************************************************************************************************/
+/*  Memory                                                                                       */
+/*************************************************************************************************/
+
+DvzMemoryStats dvz_context_memory_stats(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzMemoryStats stats = {0};
+
+    // Default buffers.
+    DvzBuffer* buffer = NULL;
+    for (uint32_t i = 0; i < DVZ_BUFFER_TYPE_COUNT; i++)
+    {
+        buffer = dvz_container_get(&context->buffers, i);
+        if (buffer == NULL || !dvz_obj_is_created(&buffer->obj))
+            continue;
+        stats.buffer_allocated[i] = buffer->size;
+        // NOTE: the staging buffer is not sub-allocated.
+        if (i != DVZ_BUFFER_TYPE_STAGING)
+            stats.buffer_used[i] = dvz_alloc_size(&context->allocators[i]);
+        stats.total += buffer->size;
+    }
+    for (uint32_t i = 0; i < context->deferred_count; i++)
+        stats.buffer_deferred += context->deferred[i].buffer.size;
+    stats.total += stats.buffer_deferred;
+
+    // Textures.
+    DvzContainerIterator iter = dvz_container_iterator(&context->textures);
+    DvzTexture* texture = NULL;
+    while (iter.item != NULL)
+    {
+        texture = (DvzTexture*)iter.item;
+        if (dvz_obj_is_created(&texture->obj))
+        {
+            stats.texture_count++;
+            stats.texture_allocated += dvz_texture_memory(texture);
+        }
+        dvz_container_iter(&iter);
+    }
+    stats.total += stats.texture_allocated;
+
+    stats.budget = context->memory_budget;
+    stats.has_heap_budget =
+        dvz_gpu_memory_budget(context->gpu, &stats.heap_budget, &stats.heap_usage);
+
+    return stats;
+}
+
+
+
+void dvz_context_memory_budget(DvzContext* context, VkDeviceSize budget)
+{
+    ASSERT(context != NULL);
+    log_debug("set context memory budget to %s", pretty_size(budget));
+    context->memory_budget = budget;
+    VkDeviceSize total = dvz_context_memory_stats(context).total;
+    if (budget > 0 && total > budget)
+        log_warn(
+            "the context already uses %s, more than the budget of %s", //
+            pretty_size(total), pretty_size(budget));
+}
+
+
+
+VkDeviceSize dvz_texture_memory(DvzTexture* texture)
+{
+    ASSERT(texture != NULL);
+    if (texture->image == NULL)
+        return 0;
+    return texture->image->size * texture->image->count;
+}
+
+
+
 /*************************************************************************************************/
 /*  Buffer allocation                                                                            */
 /*************************************************************************************************/
 
-DvzBufferRegions dvz_ctx_buffers(
+// Size in bytes of a texel with a given uncompressed color or depth format, used to estimate the
+// memory size of an image before creating it.
+static VkDeviceSize _format_size(VkFormat format)
+{
+    if (format == VK_FORMAT_R4G4_UNORM_PACK8)
+        return 1;
+    if (format >= VK_FORMAT_R4G4B4A4_UNORM_PACK16 && format <= VK_FORMAT_A1R5G5B5_UNORM_PACK16)
+        return 2;
+    if (format >= VK_FORMAT_R8_UNORM && format <= VK_FORMAT_R8_SRGB)
+        return 1;
+    if (format >= VK_FORMAT_R8G8_UNORM && format <= VK_FORMAT_R8G8_SRGB)
+        return 2;
+    if (format >= VK_FORMAT_R8G8B8_UNORM && format <= VK_FORMAT_B8G8R8_SRGB)
+        return 3;
+    if (format >= VK_FORMAT_R8G8B8A8_UNORM && format <= VK_FORMAT_A2B10G10R10_SINT_PACK32)
+        return 4;
+    if (format >= VK_FORMAT_R16_UNORM && format <= VK_FORMAT_R16_SFLOAT)
+        return 2;
+    if (format >= VK_FORMAT_R16G16_UNORM && format <= VK_FORMAT_R16G16_SFLOAT)
+        return 4;
+    if (format >= VK_FORMAT_R16G16B16_UNORM && format <= VK_FORMAT_R16G16B16_SFLOAT)
+        return 6;
+    if (format >= VK_FORMAT_R16G16B16A16_UNORM && format <= VK_FORMAT_R16G16B16A16_SFLOAT)
+        return 8;
+    if (format >= VK_FORMAT_R32_UINT && format <= VK_FORMAT_R32_SFLOAT)
+        return 4;
+    if (format >= VK_FORMAT_R32G32_UINT && format <= VK_FORMAT_R32G32_SFLOAT)
+        return 8;
+    if (format >= VK_FORMAT_R32G32B32_UINT && format <= VK_FORMAT_R32G32B32_SFLOAT)
+        return 12;
+    if (format >= VK_FORMAT_R32G32B32A32_UINT && format <= VK_FORMAT_R32G32B32A32_SFLOAT)
+        return 16;
+    if (format >= VK_FORMAT_R64_UINT && format <= VK_FORMAT_R64G64B64A64_SFLOAT)
+        return 8 * (1 + (VkDeviceSize)(format - VK_FORMAT_R64_UINT) / 3);
+    if (format == VK_FORMAT_D16_UNORM)
+        return 2;
+    if (format >= VK_FORMAT_B10G11R11_UFLOAT_PACK32 && format <= VK_FORMAT_D32_SFLOAT)
+        return 4;
+    if (format == VK_FORMAT_D24_UNORM_S8_UINT)
+        return 4;
+    if (format == VK_FORMAT_D32_SFLOAT_S8_UINT)
+        return 8;
+    log_warn("unknown texel size of format %d, assuming 4 bytes", format);
+    return 4;
+}
+
+
+
+// Estimated memory size of an image, before its creation.
+static VkDeviceSize _image_size(uvec3 size, VkFormat format)
+{
+    return (VkDeviceSize)MAX(size[0], 1) * MAX(size[1], 1) * MAX(size[2], 1) *
+           _format_size(format);
+}
+
+
+
+// Whether some more GPU memory can be allocated within the memory budget of the context.
+static bool _memory_check(DvzContext* context, VkDeviceSize size)
+{
+    ASSERT(context != NULL);
+    if (context->memory_budget == 0 || size == 0)
+        return true;
+    return dvz_context_memory_stats(context).total + size <= context->memory_budget;
+}
+
+
+
+// Enlarge a context buffer without blocking the rendering.
+static void _ctx_buffer_grow(DvzContext* context, DvzBuffer* buffer, VkDeviceSize size)
+{
+    ASSERT(context != NULL);
+    ASSERT(context->gpu != NULL);
+    DvzApp* app = context->gpu->app;
+    ASSERT(app != NULL);
+
+    dvz_gpu_lock(context->gpu);
+    _buffer_grow(context, buffer, size);
+
+    // The command buffers refer to the old Vulkan buffer and need to be refilled.
+    DvzContainerIterator iter = dvz_container_iterator(&app->canvases);
+    DvzCanvas* canvas = NULL;
+    while (iter.item != NULL)
+    {
+        canvas = (DvzCanvas*)iter.item;
+        if (dvz_obj_is_created(&canvas->obj))
+            dvz_canvas_to_refill(canvas);
+        dvz_container_iter(&iter);
+    }
+
+    // Outside of the event loop, the copy is done synchronously.
+    if (!app->is_running)
+    {
+        _transfer_batch_submit(context);
+        _transfer_batch_wait(context);
+        _deferred_buffers_destroy(context, true);
+    }
+    dvz_gpu_unlock(context->gpu);
+}
+
+
+
+// Allocate buffer regions, the caller must hold the GPU lock.
+static DvzBufferRegions _ctx_buffers(
     DvzContext* context, DvzBufferType buffer_type, uint32_t buffer_count, VkDeviceSize size)
 {
     ASSERT(context != NULL);
@@ -353,29 +557,42 @@ DvzBufferRegions dvz_ctx_buffers(
     }
     ASSERT(buffer != NULL);
     ASSERT(buffer->type == buffer_type);
-    ASSERT(dvz_obj_is_created(&buffer->obj));
+    if (!dvz_obj_is_created(&buffer->obj))
+    {
+        log_error("invalid buffer %d", buffer_type);
+        return (DvzBufferRegions){0};
+    }
 
     VkDeviceSize alignment = 0;
-    VkDeviceSize offset = buffer->allocated_size;
     bool needs_align =
         buffer_type == DVZ_BUFFER_TYPE_UNIFORM || buffer_type == DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE;
     if (needs_align)
-    {
         alignment = context->gpu->device_properties.limits.minUniformBufferOffsetAlignment;
-        ASSERT(offset % alignment == 0); // offset should be already aligned
-    }
-
-    DvzBufferRegions regions = dvz_buffer_regions(buffer, buffer_count, offset, size, alignment);
-    VkDeviceSize alsize = regions.aligned_size;
-    if (alsize == 0)
-        alsize = size;
+    VkDeviceSize alsize = alignment > 0 ? aligned_size(size, alignment) : size;
     ASSERT(alsize > 0);
 
-    if (!dvz_obj_is_created(&buffer->obj))
+    // Find a free location in the buffer, which may need to be enlarged.
+    DvzAlloc* alloc = &context->allocators[buffer_type];
+    // When the buffer is enlarged, the old one is only destroyed once the GPU is done with it, so
+    // both buffers are alive at the same time.
+    VkDeviceSize new_size = dvz_alloc_new_size(alloc, alsize * buffer_count);
+    if (new_size > alloc->total_size && !_memory_check(context, new_size))
     {
-        log_error("invalid buffer %d", buffer_type);
-        return regions;
+        log_error(
+            "cannot allocate %d buffers (type %d) with size %s: memory budget exceeded", //
+            buffer_count, buffer_type, pretty_size(size));
+        return (DvzBufferRegions){0};
     }
+    VkDeviceSize offset = dvz_alloc_new(alloc, alsize * buffer_count, &new_size);
+    if (new_size > 0)
+    {
+        log_info("reallocating buffer %d to %s", buffer_type, pretty_size(new_size));
+        _ctx_buffer_grow(context, buffer, new_size);
+    }
+    ASSERT(alloc->total_size == buffer->size);
+
+    DvzBufferRegions regions = dvz_buffer_regions(buffer, buffer_count, offset, size, alignment);
+    ASSERT(regions.aligned_size == 0 || regions.aligned_size == alsize);
 
     // Check alignment for uniform buffers.
     if (needs_align)
@@ -386,21 +603,27 @@ DvzBufferRegions dvz_ctx_buffers(
             ASSERT(regions.offsets[i] % alignment == 0);
     }
 
-    // Need to reallocate?
-    if (offset + alsize * buffer_count > regions.buffer->size)
-    {
-        VkDeviceSize new_size = dvz_next_pow2(offset + alsize * buffer_count);
-        log_info("reallocating buffer %d to %s", buffer_type, pretty_size(new_size));
-        dvz_buffer_resize(regions.buffer, new_size);
-    }
-
     log_debug(
         "allocating %d buffers (type %d) with size %s (aligned size %s)", //
         buffer_count, buffer_type, pretty_size(size), pretty_size(alsize));
     ASSERT(offset + alsize * buffer_count <= regions.buffer->size);
-    buffer->allocated_size += alsize * buffer_count;
+    buffer->allocated_size = dvz_alloc_end(alloc);
+
+    return regions;
+}
+
+
 
-    ASSERT(regions.offsets[buffer_count - 1] + alsize == buffer->allocated_size);
+DvzBufferRegions dvz_ctx_buffers(
+    DvzContext* context, DvzBufferType buffer_type, uint32_t buffer_count, VkDeviceSize size)
+{
+    ASSERT(context != NULL);
+    ASSERT(context->gpu != NULL);
+
+    // The allocators and the buffers are shared with the transfer and event threads.
+    dvz_gpu_lock(context->gpu);
+    DvzBufferRegions regions = _ctx_buffers(context, buffer_type, buffer_count, size);
+    dvz_gpu_unlock(context->gpu);
     return regions;
 }
 
@@ -408,11 +631,10 @@ DvzBufferRegions dvz_ctx_buffers(
 
 void dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceSize new_size)
 {
-    // NOTE: this function tries to resize a buffer region in-place, which only works if
-    // it is the last allocated region in the buffer. Otherwise a brand new region is allocated,
-    // which wastes space. TODO: smarter memory management, defragmentation etc.
+    ASSERT(context != NULL);
     ASSERT(br->buffer != NULL);
     ASSERT(br->count > 0);
+    ASSERT(new_size > 0);
     if (br->count > 1)
     {
         log_error("dvz_buffer_regions_resize() currently only supports regions with buf count=1");
@@ -420,32 +642,62 @@ void dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceS
     }
     ASSERT(br->count == 1);
 
-    // The region is the last allocated in the buffer, we can safely resize it.
-    VkDeviceSize old_size = br->aligned_size > 0 ? br->aligned_size : br->size;
-    ASSERT(old_size > 0);
-    if (br->offsets[0] + old_size == br->buffer->allocated_size)
+    dvz_gpu_lock(context->gpu);
+    DvzBuffer* buffer = br->buffer;
+    ASSERT(buffer->type < DVZ_BUFFER_TYPE_COUNT);
+    DvzAlloc* alloc = &context->allocators[buffer->type];
+    VkDeviceSize alsize = br->alignment > 0 ? aligned_size(new_size, br->alignment) : new_size;
+
+    // Try to resize the region in place, which works if it is followed by enough free space.
+    if (dvz_alloc_resize(alloc, br->offsets[0], alsize))
     {
         log_debug("resize the buffer region in-place");
         br->size = new_size;
         if (br->alignment > 0)
-            br->aligned_size = aligned_size(new_size, br->alignment);
-        br->buffer->allocated_size = br->offsets[0] + new_size;
-
-        // Need to reallocate a new underlying buffer.
-        if (br->offsets[0] + old_size > br->buffer->size)
-        {
-            VkDeviceSize bs = dvz_next_pow2(br->offsets[0] + old_size);
-            log_info("reallocating buffer #%d to %s", br->buffer->type, pretty_size(bs));
-            dvz_buffer_resize(br->buffer, bs);
-        }
+            br->aligned_size = alsize;
+        buffer->allocated_size = dvz_alloc_end(alloc);
     }
 
     // The region cannot be resized directly, need to make a new region allocation.
     else
     {
         log_debug("failed to resize the buffer region in-place, allocating a new region");
-        *br = dvz_ctx_buffers(context, br->buffer->type, 1, new_size);
+        DvzBufferRegions old = *br;
+        DvzBufferRegions new_br = _ctx_buffers(context, buffer->type, 1, new_size);
+        // The allocation may fail, in which case the old regions are kept.
+        if (new_br.buffer != NULL)
+        {
+            *br = new_br;
+            dvz_ctx_buffers_free(context, &old);
+        }
     }
+    dvz_gpu_unlock(context->gpu);
+}
+
+
+
+void dvz_ctx_buffers_free(DvzContext* context, DvzBufferRegions* br)
+{
+    ASSERT(context != NULL);
+    ASSERT(br != NULL);
+    if (br->buffer == NULL || br->count == 0)
+        return;
+
+    dvz_gpu_lock(context->gpu);
+    DvzBuffer* buffer = br->buffer;
+    ASSERT(buffer->type < DVZ_BUFFER_TYPE_COUNT);
+    DvzAlloc* alloc = &context->allocators[buffer->type];
+    log_debug(
+        "free %d buffers (type %d) at offset %s", br->count, buffer->type,
+        pretty_size(br->offsets[0]));
+
+    // NOTE: the freed space may be reused by a subsequent upload before the GPU is done with the
+    // frames still referring to these regions. This is safe as the uploads are recorded in
+    // transfer batches that are ordered after the previously submitted rendering commands.
+    dvz_alloc_free(alloc, br->offsets[0]);
+    buffer->allocated_size = dvz_alloc_end(alloc);
+    *br = (DvzBufferRegions){0};
+    dvz_gpu_unlock(context->gpu);
 }
 
 
@@ -500,6 +752,15 @@ DvzTexture* dvz_ctx_texture(DvzContext* context, uint32_t dims, uvec3 size, VkFo
         "creating %dD texture with shape %dx%dx%d and format %d", //
         dims, size[0], size[1], size[2], format);
 
+    // Enforce the memory budget of the context, before allocating any GPU memory.
+    if (!_memory_check(context, _image_size(size, format)))
+    {
+        log_error(
+            "cannot create texture with shape %dx%dx%d: memory budget exceeded", //
+            size[0], size[1], size[2]);
+        return NULL;
+    }
+
     DvzTexture* texture = dvz_container_alloc(&context->textures);
     DvzImages* image = dvz_container_alloc(&context->images);
     DvzSampler* sampler = dvz_container_alloc(&context->samplers);
@@ -544,12 +805,25 @@ DvzTexture* dvz_ctx_texture(DvzContext* context, uint32_t dims, uvec3 size, VkFo
 
 
 
-void dvz_texture_resize(DvzTexture* texture, uvec3 size)
+bool dvz_texture_resize(DvzTexture* texture, uvec3 size)
 {
     ASSERT(texture != NULL);
     ASSERT(texture->image != NULL);
+    DvzImages* image = texture->image;
+
+    // Enforce the memory budget of the context, the old image is destroyed upon resize.
+    VkDeviceSize new_size = _image_size(size, image->format) * image->count;
+    VkDeviceSize old_size = image->size * image->count;
+    if (new_size > old_size && !_memory_check(texture->context, new_size - old_size))
+    {
+        log_error(
+            "cannot resize texture to shape %dx%dx%d: memory budget exceeded", //
+            size[0], size[1], size[2]);
+        return false;
+    }
 
-    dvz_images_resize(texture->image, size[0], size[1], size[2]);
+    dvz_images_resize(image, size[0], size[1], size[2]);
+    return true;
 }
 
 
@@ -600,18 +874,14 @@ void dvz_texture_upload(
     ASSERT(size > 0);
     ASSERT(data != NULL);
 
-    // Take the staging buffer.
-    DvzBuffer* staging = staging_buffer(context, size);
-
-    // Memcpy into the staging buffer.
-    dvz_buffer_upload(staging, 0, size, data);
-
-    // Copy from the staging buffer to the texture.
-    _copy_texture_from_staging(context, texture, offset, shape, size);
-
-    // IMPORTANT: need to wait for the texture to be copied to the staging buffer, *before*
-    // downloading the data from the staging buffer.
-    dvz_queue_wait(context->gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    // The upload goes through the staging ring of the transfer batches. The GPU lock ensures that
+    // the transfer is processed here, and the texture is updated when the function returns.
+    dvz_gpu_lock(context->gpu);
+    dvz_upload_texture(context, texture, offset, shape, size, (void*)data);
+    dvz_process_transfers(context);
+    _transfer_batch_wait(context);
+    dvz_gpu_unlock(context->gpu);
+    _download_callbacks_flush(context);
 }
 
 
@@ -625,18 +895,13 @@ void dvz_texture_download(
     ASSERT(size > 0);
     ASSERT(data != NULL);
 
-    // Take the staging buffer.
-    DvzBuffer* staging = staging_buffer(context, size);
-
-    // Copy from the staging buffer to the texture.
-    _copy_texture_to_staging(context, texture, offset, shape, size);
-
-    // IMPORTANT: need to wait for the texture to be copied to the staging buffer, *before*
-    // downloading the data from the staging buffer.
-    dvz_queue_wait(context->gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
-
-    // Memcpy into the staging buffer.
-    dvz_buffer_download(staging, 0, size, data);
+    // Blocking download through the transfer batches: the batch is waited for upon submission,
+    // and the data is copied from the staging ring before dvz_process_transfers() returns.
+    dvz_gpu_lock(context->gpu);
+    dvz_download_texture(context, texture, offset, shape, size, data);
+    dvz_process_transfers(context);
+    dvz_gpu_unlock(context->gpu);
+    _download_callbacks_flush(context);
 }
 
 
@@ -650,7 +915,8 @@ void dvz_texture_copy(
     DvzGpu* gpu = context->gpu;
     ASSERT(context != NULL);
 
-    // Take transfer cmd buf.
+    // Take transfer cmd buf, from the shared command pool.
+    dvz_gpu_lock(gpu);
     DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
     DvzCommands* cmds = &cmds_;
     dvz_cmd_reset(cmds, 0);
@@ -740,6 +1006,7 @@ void dvz_texture_copy(
     dvz_submit_commands(&submit, cmds);
     log_debug("copy %dx%dx%d between 2 textures", shape[0], shape[1], shape[2]);
     dvz_submit_send(&submit, 0, NULL, 0);
+    dvz_gpu_unlock(gpu);
 
     // Wait for the transfer queue to be idle.
     // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
@@ -753,6 +1020,7 @@ void dvz_texture_transition(DvzTexture* tex)
     ASSERT(tex->context != NULL);
     DvzGpu* gpu = tex->context->gpu;
     ASSERT(gpu != NULL);
+    dvz_gpu_lock(gpu);
     DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
     DvzCommands* cmds = &cmds_;
 
@@ -768,6 +1036,7 @@ void dvz_texture_transition(DvzTexture* tex)
 
     dvz_cmd_end(cmds, 0);
     dvz_cmd_submit_sync(cmds, 0);
+    dvz_gpu_unlock(gpu);
 }
 
 
@@ -2,6 +2,8 @@
 #define DVZ_CONTEXT_UTILS_HEADER
 
 #include "../include/datoviz/context.h"
+#include "../include/datoviz/canvas.h"
+#include "vklite_utils.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -10,239 +12,1000 @@ extern "C" {
 
 
 /*************************************************************************************************/
-/*  Staging buffer                                                                               */
+/*  Buffer allocation                                                                            */
 /*************************************************************************************************/
 
-// Get the staging buffer, and make sure it can contain `size` bytes.
-static DvzBuffer* staging_buffer(DvzContext* context, VkDeviceSize size)
+// Alignment of the buffer regions allocated in a buffer of a given type.
+static VkDeviceSize _buffer_alignment(DvzGpu* gpu, DvzBufferType type)
 {
-    log_trace("requesting staging buffer of size %s", pretty_size(size));
+    ASSERT(gpu != NULL);
+    VkPhysicalDeviceLimits* limits = &gpu->device_properties.limits;
+    VkDeviceSize alignment = DVZ_BUFFER_ALIGNMENT;
+    switch (type)
+    {
+    case DVZ_BUFFER_TYPE_UNIFORM:
+    case DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE:
+        alignment = MAX(alignment, limits->minUniformBufferOffsetAlignment);
+        break;
+    // NOTE: vertex buffers may also be bound as storage buffers.
+    case DVZ_BUFFER_TYPE_VERTEX:
+    case DVZ_BUFFER_TYPE_STORAGE:
+        alignment = MAX(alignment, limits->minStorageBufferOffsetAlignment);
+        break;
+    default:
+        break;
+    }
+    return alignment;
+}
+
+
+
+// Return the extra memory properties of the buffers that may be written directly by the CPU:
+// host-visible and host-coherent if the device-local memory is also host-visible (integrated
+// GPUs, CPU-based drivers, resizable BAR), 0 otherwise.
+static VkMemoryPropertyFlags _direct_write_memory(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+    VkPhysicalDeviceMemoryProperties* props = &gpu->memory_properties;
+    VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkMemoryType* type = NULL;
+    for (uint32_t i = 0; i < props->memoryTypeCount; i++)
+    {
+        type = &props->memoryTypes[i];
+        // NOTE: without resizable BAR, discrete GPUs only expose a small host-visible window of
+        // their VRAM, which we keep for the driver.
+        if ((type->propertyFlags & flags) == flags &&
+            props->memoryHeaps[type->heapIndex].size > DVZ_DIRECT_WRITE_MIN_HEAP_SIZE)
+            return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Transfer batches                                                                             */
+/*************************************************************************************************/
+
+static DvzTransferBatch _transfer_batch(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+
+    DvzTransferBatch batch = {0};
+
+    // NOTE: the transfer batches are submitted to the render queue, so that submission order and
+    // pipeline barriers are enough to order them with respect to the rendering commands, without
+    // any queue-wide wait.
+    uint32_t queue_idx = DVZ_DEFAULT_QUEUE_RENDER < gpu->queues.queue_count
+                             ? DVZ_DEFAULT_QUEUE_RENDER
+                             : DVZ_DEFAULT_QUEUE_TRANSFER;
+    batch.cmds = dvz_commands(gpu, queue_idx, DVZ_MAX_TRANSFER_BATCHES);
+    batch.fences = dvz_fences(gpu, DVZ_MAX_TRANSFER_BATCHES, true);
+
+    return batch;
+}
+
+
+
+// Copy the downloaded data of an executed batch from the staging buffer, and queue the completion
+// callbacks of the downloads that are complete, see _download_callbacks_take().
+static void _transfer_downloads_complete(DvzContext* context, uint32_t slot)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    ASSERT(slot < DVZ_MAX_TRANSFER_BATCHES);
+    uint32_t count = batch->download_count[slot];
+    if (count == 0)
+        return;
+
     DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
     ASSERT(staging != NULL);
-    ASSERT(staging->buffer != VK_NULL_HANDLE);
 
-    // Make sure the staging buffer is idle before using it.
-    // TODO: optimize this and avoid hard synchronization here before copying data into
-    // the staging buffer.
-    // dvz_queue_wait(context->gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    DvzTransferDownload* download = NULL;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        download = &batch->downloads[slot][i];
+        dvz_buffer_download(staging, download->staging_offset, download->size, download->data);
+
+        // The callbacks are not called here, as the caller holds the GPU lock and may be
+        // recording a transfer batch.
+        if (!download->is_last || download->callback == NULL)
+            continue;
+        log_trace("asynchronous download #%" PRIu64 " complete", download->download_id);
+        if (context->downloads_done_count >= context->downloads_done_capacity)
+        {
+            context->downloads_done_capacity = MAX(16, 2 * context->downloads_done_capacity);
+            REALLOC(
+                context->downloads_done,
+                context->downloads_done_capacity * sizeof(DvzTransferDownload));
+        }
+        context->downloads_done[context->downloads_done_count++] = *download;
+    }
+    batch->download_count[slot] = 0;
+}
 
-    // Resize the staging buffer is needed.
-    // TODO: keep staging buffer fixed and copy parts of the data to staging buffer in several
-    // steps?
-    if (staging->size < size)
+
+
+// Release the staging space reserved by the batches that have been executed, oldest first, and
+// complete their downloads.
+static void _transfer_batch_reclaim(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    if (!dvz_obj_is_created(&batch->fences.obj))
+        return;
+
+    // NOTE: the batches are submitted in order, the oldest one is the next one to be recorded.
+    uint32_t slot = 0;
+    for (uint32_t k = 0; k < DVZ_MAX_TRANSFER_BATCHES; k++)
     {
-        VkDeviceSize new_size = dvz_next_pow2(size);
-        log_debug("reallocating staging buffer to %s", pretty_size(new_size));
-        dvz_buffer_resize(staging, new_size);
+        slot = (batch->idx + k) % DVZ_MAX_TRANSFER_BATCHES;
+        if (batch->recording && slot == batch->idx)
+            continue;
+        if (batch->staging_sizes[slot] == 0)
+            continue;
+        if (!dvz_fences_ready(&batch->fences, slot))
+            break;
+        // The staging space must not be reused before the downloaded data has been copied.
+        _transfer_downloads_complete(context, slot);
+        ASSERT(batch->staging_used >= batch->staging_sizes[slot]);
+        batch->staging_used -= batch->staging_sizes[slot];
+        batch->staging_sizes[slot] = 0;
     }
-    ASSERT(staging->size >= size);
-    return staging;
+
+    // Restart at the beginning of the staging buffer when it is not used anymore.
+    if (batch->staging_used == 0)
+        batch->staging_head = 0;
 }
 
 
 
-static void _copy_buffer_from_staging(
-    DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size)
+// Wait until all submitted transfer batches have been executed by the GPU.
+static void _transfer_batch_wait(DvzContext* context)
 {
     ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    if (!dvz_obj_is_created(&batch->fences.obj))
+        return;
+    // The downloads are completed with the GPU lock, see dvz_download_done().
+    dvz_gpu_lock(context->gpu);
+    for (uint32_t i = 0; i < batch->fences.count; i++)
+        dvz_fences_wait(&batch->fences, i);
+    _transfer_batch_reclaim(context);
+    dvz_gpu_unlock(context->gpu);
+}
 
-    DvzGpu* gpu = context->gpu;
-    ASSERT(gpu != NULL);
 
-    DvzBuffer* staging = staging_buffer(context, size);
-    ASSERT(staging != NULL);
 
-    // Take transfer cmd buf.
-    DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
-    DvzCommands* cmds = &cmds_;
-    dvz_cmd_reset(cmds, 0);
-    dvz_cmd_begin(cmds, 0);
-
-    VkBufferCopy region = {0};
-    region.size = size;
-    region.srcOffset = 0;
-    region.dstOffset = br.offsets[0] + offset;
-    vkCmdCopyBuffer(cmds->cmds[0], staging->buffer, br.buffer->buffer, br.count, &region);
-    dvz_cmd_end(cmds, 0);
-
-    // Wait for the render queue to be idle.
-    // TODO: less brutal synchronization with semaphores. Here we stop all
-    // rendering so that we're sure that the buffer we're going to write to is not
-    // being used by the GPU.
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_RENDER);
-
-    // Submit the commands to the transfer queue.
-    DvzSubmit submit = dvz_submit(gpu);
-    dvz_submit_commands(&submit, cmds);
-    log_debug("copy %s from staging buffer", pretty_size(size));
-    dvz_submit_send(&submit, 0, NULL, 0);
+static void _transfer_batch_destroy(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    _transfer_batch_wait(context);
+    dvz_commands_destroy(&batch->cmds);
+    dvz_fences_destroy(&batch->fences);
+    for (uint32_t i = 0; i < DVZ_MAX_TRANSFER_DESTINATIONS; i++)
+        FREE(batch->copies[i].regions);
+}
+
 
-    // Wait for the transfer queue to be idle.
-    // TODO: less brutal synchronization with semaphores. Here we wait for the
-    // transfer to be complete before we send new rendering commands.
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+
+/*************************************************************************************************/
+/*  Deferred deletion                                                                            */
+/*************************************************************************************************/
+
+// Whether the frames submitted by a canvas have all been executed, without waiting.
+static bool _canvas_frames_done(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzFences* fences = &canvas->fences_render_finished;
+    if (!dvz_obj_is_created(&fences->obj))
+        return true;
+    for (uint32_t i = 0; i < fences->count; i++)
+    {
+        if (fences->fences[i] != VK_NULL_HANDLE && !dvz_fences_ready(fences, i))
+            return false;
+    }
+    return true;
 }
 
 
 
-static void _copy_buffer_to_staging(
-    DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size)
+// Whether the canvases of the context do not use the buffers recreated at a given epoch anymore:
+// their command buffers have all been refilled since, and the frames in flight have completed.
+// The canvases may render in their own thread, so this does not depend on the number of calls
+// to the transfer processing function.
+static bool _canvases_released(DvzContext* context, uint64_t epoch)
 {
     ASSERT(context != NULL);
+    DvzApp* app = context->gpu->app;
+    ASSERT(app != NULL);
+    DvzContainerIterator iter = dvz_container_iterator(&app->canvases);
+    DvzCanvas* canvas = NULL;
+    while (iter.item != NULL)
+    {
+        canvas = (DvzCanvas*)iter.item;
+        if (dvz_obj_is_created(&canvas->obj) && canvas->gpu == context->gpu)
+        {
+            if (atomic_load(&canvas->refills.buffer_epoch_done) < epoch ||
+                !_canvas_frames_done(canvas))
+                return false;
+        }
+        dvz_container_iter(&iter);
+    }
+    return true;
+}
+
+
+
+// Destroy the recreated buffers that are not used by the GPU anymore. This is called once per
+// iteration of the event loop. With `force`, the caller guarantees that the GPU is idle.
+static void _deferred_buffers_destroy(DvzContext* context, bool force)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    DvzDeferredBuffer* deferred = NULL;
+    bool done = false;
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < context->deferred_count; i++)
+    {
+        deferred = &context->deferred[i];
+        // The batch with the copy of the old data must have been executed, and no canvas may
+        // bind the old buffer anymore.
+        done = force || (!(batch->recording && batch->idx == deferred->batch_idx) &&
+                         dvz_fences_ready(&batch->fences, deferred->batch_idx) &&
+                         _canvases_released(context, deferred->epoch));
+        if (!done)
+        {
+            context->deferred[k++] = *deferred;
+            continue;
+        }
+        log_debug("destroy old buffer %d after recreation", deferred->buffer.type);
+        dvz_buffer_destroy(&deferred->buffer);
+    }
+    context->deferred_count = k;
+}
+
+
+
+// Take the list of caller-owned data to release. The caller must hold the GPU lock, and must have
+// processed all transfers enqueued so far, so that none of them refers to the data anymore.
+static DvzTransferRelease* _deferred_releases_take(DvzContext* context, uint32_t* count)
+{
+    ASSERT(context != NULL);
+    ASSERT(count != NULL);
+    DvzTransferRelease* releases = context->releases;
+    *count = context->release_count;
+    context->releases = NULL;
+    context->release_count = 0;
+    context->release_capacity = 0;
+    return releases;
+}
+
+
+
+// Call the release callbacks of a list returned by _deferred_releases_take(), and free the list.
+// This is done without the GPU lock, as the callbacks may call back into the library.
+static void _deferred_releases_run(DvzTransferRelease* releases, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ASSERT(releases != NULL);
+        if (releases[i].release != NULL)
+            releases[i].release(releases[i].data, releases[i].user_data);
+    }
+    FREE(releases);
+}
+
+
+
+// Take the list of completed downloads whose callbacks have not been called yet. The caller must
+// hold the GPU lock. Nothing is returned if the lock is also held by an outer caller, which could
+// not be released before the callbacks: they are then taken at the next transfer processing.
+static DvzTransferDownload* _download_callbacks_take(DvzContext* context, uint32_t* count)
+{
+    ASSERT(context != NULL);
+    ASSERT(count != NULL);
+    ASSERT(context->gpu->lock_depth > 0);
+    *count = 0;
+    if (context->gpu->lock_depth > 1)
+        return NULL;
+    DvzTransferDownload* downloads = context->downloads_done;
+    *count = context->downloads_done_count;
+    context->downloads_done = NULL;
+    context->downloads_done_count = 0;
+    context->downloads_done_capacity = 0;
+    return downloads;
+}
+
+
+
+// Call the completion callbacks of a list returned by _download_callbacks_take(), and free the
+// list. This is done without the GPU lock, as the callbacks may enqueue and process transfers.
+static void
+_download_callbacks_run(DvzContext* context, DvzTransferDownload* downloads, uint32_t count)
+{
+    ASSERT(context != NULL);
+    DvzTransferDownload* download = NULL;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ASSERT(downloads != NULL);
+        download = &downloads[i];
+        ASSERT(download->callback != NULL);
+        download->callback(
+            context, download->download_id, download->total_data, download->total_size,
+            download->user_data);
+    }
+    FREE(downloads);
+}
+
+
+
+// Call the completion callbacks of the downloads completed so far, unless the caller holds the
+// GPU lock.
+static void _download_callbacks_flush(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    uint32_t count = 0;
+    dvz_gpu_lock(context->gpu);
+    DvzTransferDownload* downloads = _download_callbacks_take(context, &count);
+    dvz_gpu_unlock(context->gpu);
+    _download_callbacks_run(context, downloads, count);
+}
+
+
+
+/*************************************************************************************************/
+/*  Transfer batch recording                                                                     */
+/*************************************************************************************************/
+
+// Start recording a new transfer batch if needed.
+static DvzCommands* _transfer_batch_begin(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    DvzCommands* cmds = &batch->cmds;
+    if (batch->recording)
+        return cmds;
+    uint32_t idx = batch->idx;
+
+    // Wait until the command buffer is not used by the GPU anymore. With several batches in
+    // flight, this is normally the case already.
+    dvz_fences_wait(&batch->fences, idx);
+    _transfer_batch_reclaim(context);
+
+    dvz_cmd_reset(cmds, idx);
+    dvz_cmd_begin(cmds, idx);
+    batch->serials[idx] = ++batch->serial;
+
+    // The transfers must not overwrite data still used by the commands submitted before.
+    vkCmdPipelineBarrier(
+        cmds->cmds[idx], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, //
+        0, NULL, 0, NULL, 0, NULL);
+
+    batch->recording = true;
+    return cmds;
+}
+
+
+
+// Mark a context buffer as accessed by the current batch.
+static void _transfer_batch_use(DvzContext* context, DvzBuffer* buffer)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    ASSERT(batch->recording);
+    ASSERT(buffer->type < DVZ_BUFFER_TYPE_COUNT);
+    batch->buffer_serials[buffer->type] = batch->serial;
+}
+
+
+
+// Whether a context buffer is accessed by the batch being recorded, or by a submitted batch that
+// has not been executed yet.
+static bool _transfer_batch_busy(DvzContext* context, DvzBuffer* buffer)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    ASSERT(buffer->type < DVZ_BUFFER_TYPE_COUNT);
+    uint64_t serial = batch->buffer_serials[buffer->type];
+    if (serial == 0)
+        return false;
+    for (uint32_t slot = 0; slot < DVZ_MAX_TRANSFER_BATCHES; slot++)
+    {
+        if (batch->serials[slot] != serial)
+            continue;
+        if (batch->recording && slot == batch->idx)
+            return true;
+        return !dvz_fences_ready(&batch->fences, slot);
+    }
+    // The slot has been reused since, so the batch has been executed.
+    return false;
+}
+
+
+
+// Make sure the next transfer commands in the batch do not start before the previous ones.
+static void _transfer_barrier(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    ASSERT(batch->recording);
+
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        batch->cmds.cmds[batch->idx], VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
 
-    DvzGpu* gpu = context->gpu;
-    ASSERT(gpu != NULL);
 
-    DvzBuffer* staging = staging_buffer(context, size);
+
+// Record the pending uploads, with a single copy command per destination buffer.
+static void _transfer_copies_flush(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    if (batch->copies_count == 0)
+        return;
+    ASSERT(batch->recording);
+
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
     ASSERT(staging != NULL);
+    VkCommandBuffer cb = batch->cmds.cmds[batch->idx];
 
-    // Take transfer cmd buf.
-    DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
-    DvzCommands* cmds = &cmds_;
-    dvz_cmd_reset(cmds, 0);
-    dvz_cmd_begin(cmds, 0);
-
-    // Determine the offset in the source buffer.
-    // Should be consecutive offsets.
-    VkDeviceSize vk_offset = br.offsets[0];
-    uint32_t n_regions = br.count;
-    for (uint32_t i = 1; i < n_regions; i++)
+    DvzTransferCopies* copies = NULL;
+    for (uint32_t i = 0; i < batch->copies_count; i++)
     {
-        ASSERT(br.offsets[i] == vk_offset + i * size);
+        copies = &batch->copies[i];
+        ASSERT(copies->buffer != NULL);
+        ASSERT(copies->count > 0);
+        log_trace(
+            "record %d copy region(s) from staging buffer to buffer type %d", //
+            copies->count, copies->buffer->type);
+        vkCmdCopyBuffer(
+            cb, staging->buffer, copies->buffer->buffer, copies->count, copies->regions);
+        copies->count = 0;
     }
-    // Take into account the transfer offset.
-    vk_offset += offset;
+    batch->copies_count = 0;
+
+    // The next commands in the batch may read or overwrite the copied data.
+    _transfer_barrier(context);
+}
+
 
-    // Copy to staging buffer
-    ASSERT(br.buffer != 0);
-    dvz_cmd_copy_buffer(cmds, 0, br.buffer, vk_offset, staging, 0, size * n_regions);
-    dvz_cmd_end(cmds, 0);
 
-    // Wait for the compute queue to be idle, as we assume the buffer to be copied from may
-    // be modified by compute shaders.
-    // TODO: more efficient synchronization (semaphores?)
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_COMPUTE);
+// Add a pending upload, merged with the previous one when both are contiguous.
+static void _transfer_copies_add(
+    DvzContext* context, DvzBuffer* buffer, VkDeviceSize src_offset, VkDeviceSize dst_offset,
+    VkDeviceSize size)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer != NULL);
+    ASSERT(size > 0);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    _transfer_batch_use(context, buffer);
+
+    // Find the pending copies to the same buffer.
+    DvzTransferCopies* copies = NULL;
+    for (uint32_t i = 0; i < batch->copies_count; i++)
+    {
+        if (batch->copies[i].buffer == buffer)
+        {
+            copies = &batch->copies[i];
+            break;
+        }
+    }
 
-    // Submit the commands to the transfer queue.
-    DvzSubmit submit = dvz_submit(gpu);
+    // Regions of a single copy command must not overlap: if the new region overwrites a
+    // pending one, the pending copies are recorded first.
+    if (copies != NULL && dst_offset < copies->dst_max && dst_offset + size > copies->dst_min)
+    {
+        VkBufferCopy* r = NULL;
+        for (uint32_t i = 0; i < copies->count; i++)
+        {
+            r = &copies->regions[i];
+            if (dst_offset < r->dstOffset + r->size && dst_offset + size > r->dstOffset)
+            {
+                _transfer_copies_flush(context);
+                copies = NULL;
+                break;
+            }
+        }
+    }
+
+    // New destination buffer.
+    if (copies == NULL)
+    {
+        if (batch->copies_count >= DVZ_MAX_TRANSFER_DESTINATIONS)
+            _transfer_copies_flush(context);
+        ASSERT(batch->copies_count < DVZ_MAX_TRANSFER_DESTINATIONS);
+        copies = &batch->copies[batch->copies_count++];
+        copies->buffer = buffer;
+        copies->count = 0;
+        copies->dst_min = dst_offset;
+        copies->dst_max = dst_offset + size;
+    }
+
+    // Merge with the last region if the new one directly follows it, in both buffers.
+    VkBufferCopy* last = copies->count > 0 ? &copies->regions[copies->count - 1] : NULL;
+    if (last != NULL && last->srcOffset + last->size == src_offset &&
+        last->dstOffset + last->size == dst_offset)
+    {
+        last->size += size;
+    }
+    else
+    {
+        if (copies->count >= copies->capacity)
+        {
+            copies->capacity = copies->capacity == 0 ? 16 : 2 * copies->capacity;
+            REALLOC(copies->regions, copies->capacity * sizeof(VkBufferCopy));
+        }
+        ASSERT(copies->count < copies->capacity);
+        copies->regions[copies->count++] = (VkBufferCopy){
+            .srcOffset = src_offset,
+            .dstOffset = dst_offset,
+            .size = size,
+        };
+    }
+    copies->dst_min = MIN(copies->dst_min, dst_offset);
+    copies->dst_max = MAX(copies->dst_max, dst_offset + size);
+}
+
+
+
+// Submit the current transfer batch, and wait for it to complete if it has blocking downloads.
+static void _transfer_batch_submit(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    if (!batch->recording)
+        return;
+    DvzCommands* cmds = &batch->cmds;
+    uint32_t idx = batch->idx;
+
+    // Record the pending uploads.
+    _transfer_copies_flush(context);
+
+    // Make the transferred data visible to the commands submitted afterwards, and to the host.
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(
+        cmds->cmds[idx], VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, //
+        1, &barrier, 0, NULL, 0, NULL);
+    dvz_cmd_end(cmds, idx);
+
+    // Submit the batch, the fence will be signaled when all transfers have been executed.
+    DvzSubmit submit = dvz_submit(context->gpu);
     dvz_submit_commands(&submit, cmds);
-    log_debug("copy %s to staging buffer", pretty_size(size));
-    dvz_submit_send(&submit, 0, NULL, 0);
+    log_debug("submit transfer batch #%d with %d transfer(s)", idx, batch->count);
+    dvz_submit_send(&submit, idx, &batch->fences, idx);
 
-    // Wait for the transfer queue to be idle.
-    // TODO: less brutal synchronization with semaphores. Here we wait for the
-    // transfer to be complete before we send new rendering commands.
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    batch->recording = false;
+    batch->count = 0;
+    batch->idx = (idx + 1) % DVZ_MAX_TRANSFER_BATCHES;
+
+    // Blocking downloads: wait for this batch only, and copy the data from the staging buffer.
+    // The asynchronous downloads are completed later, when the fence is found signaled.
+    if (batch->download_wait)
+    {
+        batch->download_wait = false;
+        dvz_fences_wait(&batch->fences, idx);
+        _transfer_downloads_complete(context, idx);
+    }
 }
 
 
 
-static void _copy_texture_from_staging(
-    DvzContext* context, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size)
+// Wait for the oldest batch in flight to free some staging space. If the current batch is the
+// only one using the staging buffer, it is submitted first.
+static void _transfer_batch_wait_oldest(DvzContext* context)
 {
     ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+
+    uint32_t slot = 0;
+    for (uint32_t k = 1; k <= DVZ_MAX_TRANSFER_BATCHES; k++)
+    {
+        slot = (batch->idx + k) % DVZ_MAX_TRANSFER_BATCHES;
+        if (batch->recording && slot == batch->idx)
+            continue;
+        if (batch->staging_sizes[slot] > 0)
+        {
+            log_trace("staging buffer full, waiting for transfer batch #%d", slot);
+            dvz_fences_wait(&batch->fences, slot);
+            _transfer_batch_reclaim(context);
+            return;
+        }
+    }
+
+    // The current batch uses the whole staging buffer.
+    slot = batch->idx;
+    log_trace("staging buffer full, submitting transfer batch #%d", slot);
+    _transfer_batch_submit(context);
+    dvz_fences_wait(&batch->fences, slot);
+    _transfer_batch_reclaim(context);
+    _transfer_batch_begin(context);
+}
 
-    DvzGpu* gpu = context->gpu;
-    ASSERT(gpu != NULL);
 
-    DvzBuffer* staging = staging_buffer(context, size);
+
+// Reserve some space in the staging ring buffer for the current batch, and return its offset,
+// which is a multiple of `alignment`.
+static VkDeviceSize
+_transfer_batch_staging_aligned(DvzContext* context, VkDeviceSize size, VkDeviceSize alignment)
+{
+    ASSERT(context != NULL);
+    ASSERT(size > 0);
+    ASSERT(alignment > 0);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
     ASSERT(staging != NULL);
+    VkDeviceSize capacity = staging->size;
+    ASSERT(size <= capacity);
 
-    // Take transfer cmd buf.
-    DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
-    DvzCommands* cmds = &cmds_;
-    dvz_cmd_reset(cmds, 0);
-    dvz_cmd_begin(cmds, 0);
+    _transfer_batch_begin(context);
 
-    // Image transition.
-    DvzBarrier barrier = dvz_barrier(gpu);
-    dvz_barrier_stages(&barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-    ASSERT(texture != NULL);
-    ASSERT(texture->image != NULL);
-    dvz_barrier_images(&barrier, texture->image);
-    dvz_barrier_images_layout(
-        &barrier, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    dvz_barrier_images_access(&barrier, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
-    dvz_cmd_barrier(cmds, 0, &barrier);
+    VkDeviceSize head = 0, offset = 0, needed = 0;
+    while (true)
+    {
+        head = batch->staging_head;
+        offset = aligned_size(head, alignment);
+        // Wrap around if the data does not fit before the end of the staging buffer, the space
+        // left at the end is wasted until the ring is reclaimed.
+        if (offset + size > capacity)
+            offset = 0;
+        needed = (offset >= head ? offset - head : capacity - head) + size;
+
+        // The free space in the ring is contiguous, starting at the head.
+        if (batch->staging_used + needed <= capacity)
+            break;
+        _transfer_batch_wait_oldest(context);
+    }
+
+    batch->staging_used += needed;
+    batch->staging_sizes[batch->idx] += needed;
+    batch->staging_head = offset + size;
+    batch->count++;
+    return offset;
+}
 
-    // Copy to staging buffer
-    dvz_cmd_copy_buffer_to_image(cmds, 0, staging, texture->image);
 
-    // Image transition.
-    dvz_barrier_images_layout(
-        &barrier, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->image->layout);
-    dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
-    dvz_cmd_barrier(cmds, 0, &barrier);
 
-    dvz_cmd_end(cmds, 0);
+static VkDeviceSize _transfer_batch_staging(DvzContext* context, VkDeviceSize size)
+{
+    return _transfer_batch_staging_aligned(context, size, DVZ_TRANSFER_ALIGNMENT);
+}
 
-    // Wait for the render queue to be idle.
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_RENDER);
 
-    // Submit the commands to the transfer queue.
-    DvzSubmit submit = dvz_submit(gpu);
-    dvz_submit_commands(&submit, cmds);
-    dvz_submit_send(&submit, 0, NULL, 0);
 
-    // Wait for the transfer queue to be idle.
-    // TODO: less brutal synchronization with semaphores. Here we wait for the
-    // transfer to be complete before we send new rendering commands.
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+// Maximum size of a single copy through the staging buffer. Larger transfers are split into
+// several chunks, so that the staging buffer never needs to grow, and so that the next chunk
+// may be copied into the staging buffer while the GPU processes the previous one.
+static VkDeviceSize _transfer_chunk_size(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
+    ASSERT(staging != NULL);
+    return aligned_size(staging->size / DVZ_MAX_TRANSFER_BATCHES, DVZ_TRANSFER_ALIGNMENT);
 }
 
 
 
-static void _copy_texture_to_staging(
-    DvzContext* context, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size)
+// Add a copy from the staging buffer to a buffer region in the current batch. The copies are
+// recorded when the batch is submitted, grouped by destination buffer.
+static void _copy_buffer_from_staging(
+    DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, //
+    VkDeviceSize staging_offset, VkDeviceSize size)
 {
     ASSERT(context != NULL);
+    ASSERT(br.buffer != NULL);
 
-    DvzGpu* gpu = context->gpu;
-    ASSERT(gpu != NULL);
+    _transfer_batch_begin(context);
+    _transfer_copies_add(context, br.buffer, staging_offset, br.offsets[0] + offset, size);
+}
+
+
+
+// Record a copy from a buffer region to the staging buffer in the current batch.
+static void _copy_buffer_to_staging(
+    DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, //
+    VkDeviceSize staging_offset, VkDeviceSize size)
+{
+    ASSERT(context != NULL);
 
-    DvzBuffer* staging = staging_buffer(context, size);
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
     ASSERT(staging != NULL);
 
-    // Take transfer cmd buf.
-    DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
-    DvzCommands* cmds = &cmds_;
-    dvz_cmd_reset(cmds, 0);
-    dvz_cmd_begin(cmds, 0);
+    DvzCommands* cmds = _transfer_batch_begin(context);
+    uint32_t idx = context->transfer_batch.idx;
 
-    // Image transition.
-    DvzBarrier barrier = dvz_barrier(gpu);
-    dvz_barrier_stages(&barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    // The source buffer may have pending uploads.
+    _transfer_copies_flush(context);
+
+    // Take into account the transfer offset.
+    ASSERT(br.buffer != 0);
+    VkDeviceSize vk_offset = br.offsets[0] + offset;
+
+    dvz_cmd_copy_buffer(cmds, idx, br.buffer, vk_offset, staging, staging_offset, size);
+    _transfer_batch_use(context, br.buffer);
+    log_trace("record copy of %s to staging buffer", pretty_size(size));
+
+    // The source buffer may be overwritten by the next uploads.
+    _transfer_barrier(context);
+}
+
+
+
+// Record a copy from a texture region to the staging buffer in the current batch.
+static void _copy_texture_to_staging_async(
+    DvzContext* context, DvzTexture* texture, uvec3 offset, uvec3 shape, //
+    VkDeviceSize staging_offset)
+{
+    ASSERT(context != NULL);
     ASSERT(texture != NULL);
     ASSERT(texture->image != NULL);
-    dvz_barrier_images(&barrier, texture->image);
-    dvz_barrier_images_layout(
-        &barrier, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-    dvz_barrier_images_access(&barrier, 0, VK_ACCESS_TRANSFER_READ_BIT);
-    dvz_cmd_barrier(cmds, 0, &barrier);
 
-    // Copy to staging buffer
-    dvz_cmd_copy_image_to_buffer(cmds, 0, texture->image, staging);
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
+    ASSERT(staging != NULL);
+
+    DvzCommands* cmds = _transfer_batch_begin(context);
+    uint32_t idx = context->transfer_batch.idx;
+
+    // The texture may be used by the commands submitted before, and by the pending uploads.
+    _transfer_copies_flush(context);
 
     // Image transition.
-    dvz_barrier_images_layout(
-        &barrier, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->image->layout);
+    DvzImages* img = texture->image;
+    DvzBarrier barrier = dvz_barrier(context->gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_images(&barrier, img);
+    dvz_barrier_images_layout(&barrier, img->layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    dvz_cmd_barrier(cmds, idx, &barrier);
+
+    // Copy the texture region to the staging buffer.
+    VkBufferImageCopy region = {0};
+    region.bufferOffset = staging_offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset.x = (int32_t)offset[0];
+    region.imageOffset.y = (int32_t)offset[1];
+    region.imageOffset.z = (int32_t)offset[2];
+    region.imageExtent.width = shape[0];
+    region.imageExtent.height = shape[1];
+    region.imageExtent.depth = shape[2];
+    vkCmdCopyImageToBuffer(
+        cmds->cmds[idx], img->images[0], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, //
+        staging->buffer, 1, &region);
+    log_trace("record copy of texture region to staging buffer");
+
+    // Image transition back to the original layout.
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    dvz_barrier_images_layout(&barrier, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, img->layout);
     dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_MEMORY_READ_BIT);
-    dvz_cmd_barrier(cmds, 0, &barrier);
+    dvz_cmd_barrier(cmds, idx, &barrier);
+}
 
-    dvz_cmd_end(cmds, 0);
 
-    // Wait for the render queue to be idle.
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_RENDER);
 
-    // Submit the commands to the transfer queue.
-    DvzSubmit submit = dvz_submit(gpu);
-    dvz_submit_commands(&submit, cmds);
-    dvz_submit_send(&submit, 0, NULL, 0);
+// Record a copy from the staging buffer to a texture region in the current batch.
+static void _copy_texture_from_staging_async(
+    DvzContext* context, DvzTexture* texture, uvec3 offset, uvec3 shape, //
+    VkDeviceSize staging_offset)
+{
+    ASSERT(context != NULL);
+    ASSERT(texture != NULL);
+    ASSERT(texture->image != NULL);
+
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
+    ASSERT(staging != NULL);
+
+    DvzCommands* cmds = _transfer_batch_begin(context);
+    uint32_t idx = context->transfer_batch.idx;
+
+    // The texture may be used by the commands submitted before: the frames in flight on the same
+    // queue, and the previous transfers of the batch.
+    _transfer_copies_flush(context);
+
+    // Image transition.
+    DvzImages* img = texture->image;
+    DvzBarrier barrier = dvz_barrier(context->gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_images(&barrier, img);
+    dvz_barrier_images_layout(&barrier, img->layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    dvz_barrier_images_access(
+        &barrier, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT);
+    dvz_cmd_barrier(cmds, idx, &barrier);
+
+    // Copy the staging buffer to the texture region.
+    VkBufferImageCopy region = {0};
+    region.bufferOffset = staging_offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset.x = (int32_t)offset[0];
+    region.imageOffset.y = (int32_t)offset[1];
+    region.imageOffset.z = (int32_t)offset[2];
+    region.imageExtent.width = shape[0];
+    region.imageExtent.height = shape[1];
+    region.imageExtent.depth = shape[2];
+    vkCmdCopyBufferToImage(
+        cmds->cmds[idx], staging->buffer, img->images[0], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, //
+        1, &region);
+    log_trace("record copy of staging buffer to texture region");
+
+    // Image transition back to the original layout.
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    dvz_barrier_images_layout(&barrier, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, img->layout);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
+    dvz_cmd_barrier(cmds, idx, &barrier);
+}
+
+
+
+// Record a copy between two texture regions in the current batch.
+static void _copy_texture_async(
+    DvzContext* context, DvzTexture* src, uvec3 src_offset, DvzTexture* dst, uvec3 dst_offset,
+    uvec3 shape)
+{
+    ASSERT(context != NULL);
+    ASSERT(src != NULL);
+    ASSERT(dst != NULL);
+    ASSERT(src->image != NULL);
+    ASSERT(dst->image != NULL);
+
+    DvzCommands* cmds = _transfer_batch_begin(context);
+    uint32_t idx = context->transfer_batch.idx;
+    _transfer_copies_flush(context);
+
+    // A copy within the same image requires the general layout.
+    bool same = src->image == dst->image;
+    VkImageLayout src_layout =
+        same ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    VkImageLayout dst_layout =
+        same ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+    // Image transitions.
+    DvzBarrier src_barrier = dvz_barrier(context->gpu);
+    dvz_barrier_stages(
+        &src_barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_images(&src_barrier, src->image);
+    dvz_barrier_images_layout(&src_barrier, src->image->layout, src_layout);
+    dvz_barrier_images_access(
+        &src_barrier, VK_ACCESS_MEMORY_WRITE_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT | (same ? VK_ACCESS_TRANSFER_WRITE_BIT : 0));
+    dvz_cmd_barrier(cmds, idx, &src_barrier);
+
+    DvzBarrier dst_barrier = dvz_barrier(context->gpu);
+    if (!same)
+    {
+        dvz_barrier_stages(
+            &dst_barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        dvz_barrier_images(&dst_barrier, dst->image);
+        dvz_barrier_images_layout(&dst_barrier, dst->image->layout, dst_layout);
+        dvz_barrier_images_access(
+            &dst_barrier, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+        dvz_cmd_barrier(cmds, idx, &dst_barrier);
+    }
+
+    // Copy texture command.
+    VkImageCopy copy = {0};
+    copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.srcSubresource.layerCount = 1;
+    copy.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.dstSubresource.layerCount = 1;
+    copy.extent.width = shape[0];
+    copy.extent.height = shape[1];
+    copy.extent.depth = shape[2];
+    copy.srcOffset.x = (int32_t)src_offset[0];
+    copy.srcOffset.y = (int32_t)src_offset[1];
+    copy.srcOffset.z = (int32_t)src_offset[2];
+    copy.dstOffset.x = (int32_t)dst_offset[0];
+    copy.dstOffset.y = (int32_t)dst_offset[1];
+    copy.dstOffset.z = (int32_t)dst_offset[2];
+    vkCmdCopyImage(
+        cmds->cmds[idx], src->image->images[0], src_layout, dst->image->images[0], dst_layout, //
+        1, &copy);
+    log_trace("record copy %dx%dx%d between 2 textures", shape[0], shape[1], shape[2]);
+
+    // Image transitions back to the original layouts.
+    dvz_barrier_stages(
+        &src_barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    dvz_barrier_images_layout(&src_barrier, src_layout, src->image->layout);
+    dvz_barrier_images_access(
+        &src_barrier, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_MEMORY_READ_BIT);
+    dvz_cmd_barrier(cmds, idx, &src_barrier);
+
+    if (!same)
+    {
+        dvz_barrier_stages(
+            &dst_barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        dvz_barrier_images_layout(&dst_barrier, dst_layout, dst->image->layout);
+        dvz_barrier_images_access(
+            &dst_barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
+        dvz_cmd_barrier(cmds, idx, &dst_barrier);
+    }
+    context->transfer_batch.count++;
+}
+
+
+
+/*************************************************************************************************/
+/*  Buffer growth                                                                                */
+/*************************************************************************************************/
+
+// Enlarge a buffer without waiting for the GPU. The old data is copied to the new Vulkan buffer
+// in the current transfer batch, and the old Vulkan buffer is destroyed once it is not used
+// anymore. The DvzBuffer struct is updated in place, so that the buffer regions referring to it
+// remain valid.
+static void _buffer_grow(DvzContext* context, DvzBuffer* buffer, VkDeviceSize size)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer != NULL);
+    ASSERT(size >= buffer->size);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    dvz_gpu_lock(context->gpu);
+
+    // Too many old buffers waiting to be destroyed, need to wait for the GPU.
+    if (context->deferred_count >= DVZ_MAX_DEFERRED_BUFFERS)
+    {
+        log_warn("too many buffers waiting to be destroyed, waiting for the GPU");
+        _transfer_batch_submit(context);
+        _transfer_batch_wait(context);
+        dvz_gpu_wait(context->gpu);
+        _deferred_buffers_destroy(context, true);
+    }
+    ASSERT(context->deferred_count < DVZ_MAX_DEFERRED_BUFFERS);
+
+    // The pending uploads to this buffer must be recorded with the old Vulkan buffer, before the
+    // copy to the new one.
+    DvzCommands* cmds = _transfer_batch_begin(context);
+    _transfer_copies_flush(context);
+
+    DvzDeferredBuffer* deferred = &context->deferred[context->deferred_count++];
+    dvz_buffer_recreate(buffer, size, &deferred->buffer);
+    deferred->batch_idx = batch->idx;
+    // The caller requests a refill of the canvases after this point.
+    deferred->epoch = atomic_fetch_add(&context->buffer_epoch, 1) + 1;
+    DvzBuffer* old = &deferred->buffer;
+
+    // The mappable uniform buffers are only written by the CPU, at any time, so the old data is
+    // copied right away. The other buffers, even host-visible ones, may have pending staged copies
+    // or GPU writes in the batches in flight, so the copy is recorded in the current batch. The
+    // direct writes to the new buffer are not allowed until this batch has been executed.
+    if (buffer->type == DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE)
+    {
+        ASSERT(old->mmap != NULL && buffer->mmap != NULL);
+        dvz_buffer_upload(buffer, 0, old->size, old->mmap);
+        dvz_gpu_unlock(context->gpu);
+        return;
+    }
 
-    // Wait for the transfer queue to be idle.
-    // TODO: less brutal synchronization with semaphores. Here we wait for the
-    // transfer to be complete before we send new rendering commands.
-    // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    ASSERT(old->usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    ASSERT(buffer->usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    dvz_cmd_copy_buffer(cmds, batch->idx, old, 0, buffer, 0, old->size);
+    _transfer_batch_use(context, buffer);
+    log_trace("record copy of %s to the recreated buffer", pretty_size(old->size));
+    _transfer_barrier(context);
+    batch->count++;
+    dvz_gpu_unlock(context->gpu);
 }
 
 
@@ -26,58 +26,296 @@ DvzFifo dvz_fifo(int32_t capacity)
 
 
 
+DvzFifo dvz_fifo_typed(int32_t capacity, uint32_t item_size)
+{
+    ASSERT(item_size > 0);
+    DvzFifo fifo = dvz_fifo(capacity);
+    fifo.item_size = item_size;
+    fifo.values = calloc((uint32_t)capacity, item_size);
+    return fifo;
+}
+
+
+
+DvzFifo dvz_fifo_mpsc(int32_t capacity, uint32_t item_size)
+{
+    ASSERT(capacity >= 2);
+    DvzFifo fifo = {0};
+    fifo.is_mpsc = true;
+    fifo.capacity = (int32_t)dvz_next_pow2((uint64_t)capacity);
+    log_trace("creating lock-free FIFO queue with a capacity of %d items", fifo.capacity);
+    fifo.item_size = item_size;
+    fifo.is_empty = true;
+    fifo.items = calloc((uint32_t)fifo.capacity, sizeof(void*));
+    if (item_size > 0)
+        fifo.values = calloc((uint32_t)fifo.capacity, item_size);
+
+    // Slot i is free for the enqueue position i.
+    fifo.seqs = calloc((uint32_t)fifo.capacity, sizeof(*fifo.seqs));
+    for (uint32_t i = 0; i < (uint32_t)fifo.capacity; i++)
+        atomic_init(&fifo.seqs[i], i);
+    atomic_init(&fifo.enqueue_pos, 0);
+    atomic_init(&fifo.dequeue_pos, 0);
+    atomic_init(&fifo.is_waiting, false);
+
+    if (pthread_mutex_init(&fifo.lock, NULL) != 0)
+        log_error("mutex creation failed");
+    if (pthread_cond_init(&fifo.cond, NULL) != 0)
+        log_error("cond creation failed");
+
+    return fifo;
+}
+
+
+
+// Store an item in a slot of the queue, by value for typed queues, by pointer otherwise.
+static void _fifo_store(DvzFifo* fifo, int32_t idx, const void* item)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(0 <= idx && idx < fifo->capacity);
+    if (fifo->item_size > 0)
+    {
+        ASSERT(fifo->values != NULL);
+        ASSERT(item != NULL);
+        memcpy(&fifo->values[(uint32_t)idx * fifo->item_size], item, fifo->item_size);
+    }
+    else
+    {
+        fifo->items[idx] = (void*)item;
+    }
+}
+
+
+
+static bool _fifo_is_full(DvzFifo* fifo)
+{
+    ASSERT(fifo != NULL);
+    return (fifo->tail + 1) % fifo->capacity == fifo->head;
+}
+
+
+
+// Whether a queue is enlarged when it is full. Typed queues have a fixed capacity by default, so
+// that enqueueing never allocates memory.
+static bool _fifo_can_grow(DvzFifo* fifo)
+{
+    ASSERT(fifo != NULL);
+    return !fifo->is_mpsc && (fifo->item_size == 0 || fifo->is_growable);
+}
+
+
+
+// Enlarge a pointer queue, or a growable typed queue, when it is full.
 static void _fifo_resize(DvzFifo* fifo)
 {
+    ASSERT(fifo != NULL);
+    ASSERT(_fifo_can_grow(fifo));
+    if (!_fifo_is_full(fifo))
+        return;
+
     // Old size
     int size = fifo->tail - fifo->head;
     if (size < 0)
         size += fifo->capacity;
+    ASSERT(size == fifo->capacity - 1);
 
     // Old capacity
     int old_cap = fifo->capacity;
 
-    // Resize if queue is full.
-    if ((fifo->tail + 1) % fifo->capacity == fifo->head)
-    {
-        ASSERT(fifo->items != NULL);
-        ASSERT(size == fifo->capacity - 1);
-        ASSERT(fifo->capacity <= DVZ_MAX_FIFO_CAPACITY);
-
-        fifo->capacity *= 2;
-        log_debug("FIFO queue is full, enlarging it to %d", fifo->capacity);
-        REALLOC(fifo->items, (uint32_t)fifo->capacity * sizeof(void*));
-    }
-
-    if ((fifo->tail + 1) % fifo->capacity == fifo->head)
+    ASSERT(fifo->items != NULL);
+    fifo->capacity *= 2;
+    log_debug("FIFO queue is full, enlarging it to %d", fifo->capacity);
+    REALLOC(fifo->items, (uint32_t)fifo->capacity * sizeof(void*));
+    uint32_t item_size = fifo->item_size;
+    if (item_size > 0)
+        REALLOC(fifo->values, (uint32_t)fifo->capacity * item_size);
+
+    if (fifo->tail < fifo->head)
     {
         // Here, the queue buffer has been resized, but the new space should be used instead of the
         // part of the buffer before the head.
 
-        ASSERT(fifo->tail > 0);
-        ASSERT(old_cap < fifo->capacity);
+        ASSERT(fifo->tail >= 0);
         memcpy(&fifo->items[old_cap], &fifo->items[0], (uint32_t)fifo->tail * sizeof(void*));
+        if (item_size > 0)
+            memcpy(
+                &fifo->values[(uint32_t)old_cap * item_size], &fifo->values[0],
+                (uint32_t)fifo->tail * item_size);
 
         // Move the tail to the new position.
         fifo->tail += old_cap;
+    }
+
+    // Check new size.
+    ASSERT(fifo->tail - fifo->head == size);
+}
+
+
 
-        // Check new size.
-        ASSERT(fifo->tail - fifo->head > 0);
-        ASSERT(fifo->tail - fifo->head == size);
+/*************************************************************************************************/
+/*  Lock-free queue                                                                              */
+/*************************************************************************************************/
+
+// Enqueue an item without taking the lock. A slot whose sequence number is equal to the enqueue
+// position is free, the producer reserves it by incrementing the enqueue position, writes the
+// item, and publishes it by setting the sequence number to the position plus one. Return false
+// without waiting if the queue is full: the consumer may be the calling thread itself, or a
+// thread that must not be stalled, so the caller decides whether to drop, coalesce or retry.
+static bool _mpsc_enqueue(DvzFifo* fifo, const void* item)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->is_mpsc);
+    ASSERT(fifo->seqs != NULL);
+
+    uint64_t mask = (uint64_t)fifo->capacity - 1;
+    uint64_t pos = atomic_load_explicit(&fifo->enqueue_pos, memory_order_relaxed);
+    uint64_t seq = 0;
+    int64_t diff = 0;
+    while (true)
+    {
+        seq = atomic_load_explicit(&fifo->seqs[pos & mask], memory_order_acquire);
+        diff = (int64_t)(seq - pos);
+        if (diff == 0)
+        {
+            // Reserve the slot. On failure, pos is updated with the current enqueue position.
+            if (atomic_compare_exchange_weak_explicit(
+                    &fifo->enqueue_pos, &pos, pos + 1, //
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // The slot has not been released by the consumer yet: the queue is full.
+            log_trace("lock-free FIFO queue is full");
+            return false;
+        }
+        else
+        {
+            // Another producer reserved the slot in the meantime.
+            pos = atomic_load_explicit(&fifo->enqueue_pos, memory_order_relaxed);
+        }
     }
+
+    _fifo_store(fifo, (int32_t)(pos & mask), item);
+    atomic_store_explicit(&fifo->seqs[pos & mask], pos + 1, memory_order_release);
+
+    // Only take the lock to wake up the consumer when it waits for the queue to be non-empty.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&fifo->is_waiting, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&fifo->lock);
+        pthread_cond_signal(&fifo->cond);
+        pthread_mutex_unlock(&fifo->lock);
+    }
+    return true;
 }
 
 
 
-void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
+// Return the slot index of the item at the given index from the dequeue position, or -1 if it
+// has not been published yet. The lock must be held.
+static int32_t _mpsc_slot(DvzFifo* fifo, uint64_t idx)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->is_mpsc);
+    uint64_t mask = (uint64_t)fifo->capacity - 1;
+    uint64_t pos = atomic_load_explicit(&fifo->dequeue_pos, memory_order_relaxed) + idx;
+    uint64_t seq = atomic_load_explicit(&fifo->seqs[pos & mask], memory_order_acquire);
+    return seq == pos + 1 ? (int32_t)(pos & mask) : -1;
+}
+
+
+
+// Free the first slot once its item has been read, so that producers can reuse it. The lock must
+// be held.
+static void _mpsc_release(DvzFifo* fifo)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->is_mpsc);
+    uint64_t mask = (uint64_t)fifo->capacity - 1;
+    uint64_t pos = atomic_load_explicit(&fifo->dequeue_pos, memory_order_relaxed);
+    ASSERT(atomic_load(&fifo->seqs[pos & mask]) == pos + 1);
+    atomic_store_explicit(&fifo->seqs[pos & mask], pos + mask + 1, memory_order_release);
+    atomic_store_explicit(&fifo->dequeue_pos, pos + 1, memory_order_release);
+}
+
+
+
+// Return the slot index of the first item, or -1 if the queue is empty. The lock is held when the
+// function returns.
+static int32_t _mpsc_dequeue(DvzFifo* fifo, bool wait)
 {
     ASSERT(fifo != NULL);
     pthread_mutex_lock(&fifo->lock);
 
-    // Resize the FIFO queue if needed.
-    _fifo_resize(fifo);
+    int32_t idx = _mpsc_slot(fifo, 0);
+    while (wait && idx < 0)
+    {
+        // Tell the producers to signal the condition variable, and check the queue again in case
+        // an item was published in the meantime.
+        atomic_store(&fifo->is_waiting, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        idx = _mpsc_slot(fifo, 0);
+        if (idx < 0)
+            pthread_cond_wait(&fifo->cond, &fifo->lock);
+        atomic_store(&fifo->is_waiting, false);
+        if (idx < 0)
+            idx = _mpsc_slot(fifo, 0);
+    }
+    return idx;
+}
+
+
+
+static int _mpsc_size(DvzFifo* fifo)
+{
+    ASSERT(fifo != NULL);
+    uint64_t head = atomic_load_explicit(&fifo->dequeue_pos, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&fifo->enqueue_pos, memory_order_acquire);
+    return tail > head ? (int)(tail - head) : 0;
+}
+
+
+
+// Discard the oldest published items until at most max_size items remain. The lock must be held.
+static void _mpsc_discard(DvzFifo* fifo, int max_size)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(max_size >= 0);
+    int count = _mpsc_size(fifo) - max_size;
+    if (count > 0)
+        log_trace("discarding %d items in the FIFO queue which is getting overloaded", count);
+    for (int i = 0; i < count && _mpsc_slot(fifo, 0) >= 0; i++)
+        _mpsc_release(fifo);
+}
+
+
+
+/*************************************************************************************************/
+/*  Queue operations                                                                             */
+/*************************************************************************************************/
+
+// Enqueue an item, return false if the typed or lock-free queue is full.
+static bool _fifo_enqueue(DvzFifo* fifo, const void* item)
+{
+    ASSERT(fifo != NULL);
+    if (fifo->is_mpsc)
+        return _mpsc_enqueue(fifo, item);
+    pthread_mutex_lock(&fifo->lock);
+
+    // Resize the pointer and growable queues if needed, the other typed queues have a fixed
+    // capacity.
+    if (_fifo_can_grow(fifo))
+        _fifo_resize(fifo);
+    else if (_fifo_is_full(fifo))
+    {
+        pthread_mutex_unlock(&fifo->lock);
+        log_trace("typed FIFO queue is full");
+        return false;
+    }
 
     ASSERT((fifo->tail + 1) % fifo->capacity != fifo->head);
-    fifo->items[fifo->tail] = item;
+    _fifo_store(fifo, fifo->tail, item);
     fifo->tail++;
     if (fifo->tail >= fifo->capacity)
         fifo->tail -= fifo->capacity;
@@ -86,17 +324,29 @@ void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
     ASSERT(0 <= fifo->tail && fifo->tail < fifo->capacity);
     pthread_cond_signal(&fifo->cond);
     pthread_mutex_unlock(&fifo->lock);
+    return true;
 }
 
 
 
-void dvz_fifo_enqueue_first(DvzFifo* fifo, void* item)
+// Enqueue an item first, return false if the typed queue is full.
+static bool _fifo_enqueue_first(DvzFifo* fifo, const void* item)
 {
     ASSERT(fifo != NULL);
+    // Lock-free queues can only be appended to.
+    ASSERT(!fifo->is_mpsc);
     pthread_mutex_lock(&fifo->lock);
 
-    // Resize the FIFO queue if needed.
-    _fifo_resize(fifo);
+    // Resize the pointer and growable queues if needed, the other typed queues have a fixed
+    // capacity.
+    if (_fifo_can_grow(fifo))
+        _fifo_resize(fifo);
+    else if (_fifo_is_full(fifo))
+    {
+        pthread_mutex_unlock(&fifo->lock);
+        log_trace("typed FIFO queue is full");
+        return false;
+    }
 
     ASSERT((fifo->tail + 1) % fifo->capacity != fifo->head);
     fifo->head--;
@@ -104,7 +354,7 @@ void dvz_fifo_enqueue_first(DvzFifo* fifo, void* item)
         fifo->head += fifo->capacity;
     ASSERT(0 <= fifo->head && fifo->head < fifo->capacity);
 
-    fifo->items[fifo->head] = item;
+    _fifo_store(fifo, fifo->head, item);
     fifo->is_empty = false;
 
     ASSERT(0 <= fifo->tail && fifo->tail < fifo->capacity);
@@ -115,13 +365,18 @@ void dvz_fifo_enqueue_first(DvzFifo* fifo, void* item)
 
     pthread_cond_signal(&fifo->cond);
     pthread_mutex_unlock(&fifo->lock);
+    return true;
 }
 
 
 
-void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait)
+// Dequeue the first item. Return the slot index, or -1 if the queue is empty. The lock is held
+// when the function returns, the caller must read the slot and unlock the mutex.
+static int32_t _fifo_dequeue(DvzFifo* fifo, bool wait)
 {
     ASSERT(fifo != NULL);
+    if (fifo->is_mpsc)
+        return _mpsc_dequeue(fifo, wait);
     pthread_mutex_lock(&fifo->lock);
 
     // Wait until the queue is not empty.
@@ -136,16 +391,14 @@ void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait)
     if (fifo->tail == fifo->head)
     {
         // log_trace("FIFO queue was empty");
-        // Don't forget to unlock the mutex before exiting this function.
-        pthread_mutex_unlock(&fifo->lock);
         fifo->is_empty = true;
-        return NULL;
+        return -1;
     }
 
     ASSERT(0 <= fifo->head && fifo->head < fifo->capacity);
 
     // log_trace("dequeue item, tail %d, head %d", fifo->tail, fifo->head);
-    void* item = fifo->items[fifo->head];
+    int32_t idx = fifo->head;
 
     fifo->head++;
     if (fifo->head >= fifo->capacity)
@@ -156,15 +409,144 @@ void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait)
     if (fifo->tail == fifo->head)
         fifo->is_empty = true;
 
+    return idx;
+}
+
+
+
+// Unlock the mutex once the item in the dequeued slot has been read. With lock-free queues, the
+// slot is only given back to the producers at that point.
+static void _fifo_dequeue_end(DvzFifo* fifo, int32_t idx)
+{
+    ASSERT(fifo != NULL);
+    if (fifo->is_mpsc && idx >= 0)
+        _mpsc_release(fifo);
     pthread_mutex_unlock(&fifo->lock);
+}
+
+
+
+void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size == 0);
+    // Only the lock-free pointer queues have a fixed capacity.
+    if (!_fifo_enqueue(fifo, item))
+        log_error("lock-free FIFO queue is full, dropping the item");
+}
+
+
+
+void dvz_fifo_enqueue_first(DvzFifo* fifo, void* item)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size == 0);
+    _fifo_enqueue_first(fifo, item);
+}
+
+
+
+void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size == 0);
+    int32_t idx = _fifo_dequeue(fifo, wait);
+    // Don't forget to unlock the mutex before exiting this function.
+    void* item = idx >= 0 ? fifo->items[idx] : NULL;
+    _fifo_dequeue_end(fifo, idx);
     return item;
 }
 
 
 
+bool dvz_fifo_push(DvzFifo* fifo, const void* item)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size > 0);
+    return _fifo_enqueue(fifo, item);
+}
+
+
+
+bool dvz_fifo_push_first(DvzFifo* fifo, const void* item)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size > 0);
+    return _fifo_enqueue_first(fifo, item);
+}
+
+
+
+bool dvz_fifo_pop(DvzFifo* fifo, void* out, bool wait)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size > 0);
+    ASSERT(out != NULL);
+    int32_t idx = _fifo_dequeue(fifo, wait);
+    // The item must be copied before unlocking, as the slot may be overwritten afterwards.
+    if (idx >= 0)
+        memcpy(out, &fifo->values[(uint32_t)idx * fifo->item_size], fifo->item_size);
+    _fifo_dequeue_end(fifo, idx);
+    return idx >= 0;
+}
+
+
+
+bool dvz_fifo_pop_if(DvzFifo* fifo, void* out, DvzFifoPredicate predicate, void* user_data)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size > 0);
+    ASSERT(out != NULL);
+    ASSERT(predicate != NULL);
+
+    pthread_mutex_lock(&fifo->lock);
+    bool is_empty = fifo->is_mpsc ? _mpsc_slot(fifo, 0) < 0 : fifo->tail == fifo->head;
+    void* item = is_empty ? NULL : dvz_fifo_peek(fifo, 0);
+    bool pop = item != NULL && predicate(item, user_data);
+    if (pop)
+    {
+        memcpy(out, item, fifo->item_size);
+        if (fifo->is_mpsc)
+        {
+            _mpsc_release(fifo);
+        }
+        else
+        {
+            fifo->head++;
+            if (fifo->head >= fifo->capacity)
+                fifo->head -= fifo->capacity;
+            if (fifo->tail == fifo->head)
+                fifo->is_empty = true;
+        }
+    }
+    pthread_mutex_unlock(&fifo->lock);
+    return pop;
+}
+
+
+
+void* dvz_fifo_peek(DvzFifo* fifo, int32_t idx)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size > 0);
+    ASSERT(idx >= 0);
+    if (fifo->is_mpsc)
+    {
+        int32_t slot = _mpsc_slot(fifo, (uint64_t)idx);
+        return slot >= 0 ? &fifo->values[(uint32_t)slot * fifo->item_size] : NULL;
+    }
+    int32_t k = (fifo->head + idx) % fifo->capacity;
+    ASSERT(0 <= k && k < fifo->capacity);
+    return &fifo->values[(uint32_t)k * fifo->item_size];
+}
+
+
+
 int dvz_fifo_size(DvzFifo* fifo)
 {
     ASSERT(fifo != NULL);
+    if (fifo->is_mpsc)
+        return _mpsc_size(fifo);
     pthread_mutex_lock(&fifo->lock);
     // log_debug("tail %d head %d", fifo->tail, fifo->head);
     int size = fifo->tail - fifo->head;
@@ -183,6 +565,12 @@ void dvz_fifo_discard(DvzFifo* fifo, int max_size)
     if (max_size == 0)
         return;
     pthread_mutex_lock(&fifo->lock);
+    if (fifo->is_mpsc)
+    {
+        _mpsc_discard(fifo, max_size);
+        pthread_mutex_unlock(&fifo->lock);
+        return;
+    }
     int size = fifo->tail - fifo->head;
     if (size < 0)
         size += fifo->capacity;
@@ -204,6 +592,8 @@ void dvz_fifo_reset(DvzFifo* fifo)
 {
     ASSERT(fifo != NULL);
     pthread_mutex_lock(&fifo->lock);
+    if (fifo->is_mpsc)
+        _mpsc_discard(fifo, 0);
     fifo->tail = 0;
     fifo->head = 0;
     pthread_cond_signal(&fifo->cond);
@@ -220,6 +610,8 @@ void dvz_fifo_destroy(DvzFifo* fifo)
 
     ASSERT(fifo->items != NULL);
     FREE(fifo->items);
+    FREE(fifo->values);
+    FREE(fifo->seqs);
 }
 
 
@@ -264,8 +656,13 @@ DvzDeq dvz_deq(uint32_t nq)
 {
     DvzDeq deq = {0};
     deq.queue_count = nq;
+    // The queues grow when they are full: the items are owned by the caller and must not be
+    // dropped, and the producer may be the consumer thread itself, which cannot wait.
     for (uint32_t i = 0; i < nq; i++)
-        deq.queues[i] = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
+    {
+        deq.queues[i] = dvz_fifo_typed(DVZ_MAX_FIFO_CAPACITY, sizeof(DvzDeqItem));
+        deq.queues[i].is_growable = true;
+    }
     return deq;
 }
 
@@ -293,12 +690,9 @@ void dvz_deq_enqueue(DvzDeq* deq, uint32_t deq_idx, int type, void* item)
     ASSERT(deq != NULL);
     ASSERT(deq_idx < deq->queue_count);
     DvzFifo* fifo = _deq_fifo(deq, deq_idx);
-    DvzDeqItem* deq_item = calloc(1, sizeof(DvzDeqItem));
-    ASSERT(deq_item != NULL);
-    deq_item->deq_idx = deq_idx;
-    deq_item->type = type;
-    deq_item->item = item;
-    dvz_fifo_enqueue(fifo, deq_item);
+    DvzDeqItem deq_item = {.deq_idx = deq_idx, .type = type, .item = item};
+    // The queue grows when it is full, the item is never dropped.
+    dvz_fifo_push(fifo, &deq_item);
 }
 
 
@@ -308,12 +702,9 @@ void dvz_deq_enqueue_first(DvzDeq* deq, uint32_t deq_idx, int type, void* item)
     ASSERT(deq != NULL);
     ASSERT(deq_idx < deq->queue_count);
     DvzFifo* fifo = _deq_fifo(deq, deq_idx);
-    DvzDeqItem* deq_item = calloc(1, sizeof(DvzDeqItem));
-    ASSERT(deq_item != NULL);
-    deq_item->deq_idx = deq_idx;
-    deq_item->type = type;
-    deq_item->item = item;
-    dvz_fifo_enqueue_first(fifo, deq_item);
+    DvzDeqItem deq_item = {.deq_idx = deq_idx, .type = type, .item = item};
+    // The queue grows when it is full, the item is never dropped.
+    dvz_fifo_push_first(fifo, &deq_item);
 }
 
 
@@ -333,7 +724,7 @@ DvzDeqItem dvz_deq_peek_first(DvzDeq* deq, uint32_t deq_idx)
     ASSERT(deq != NULL);
     ASSERT(deq_idx < deq->queue_count);
     DvzFifo* fifo = _deq_fifo(deq, deq_idx);
-    return *((DvzDeqItem*)(fifo->items[fifo->head]));
+    return *((DvzDeqItem*)dvz_fifo_peek(fifo, 0));
 }
 
 
@@ -343,11 +734,11 @@ DvzDeqItem dvz_deq_peek_last(DvzDeq* deq, uint32_t deq_idx)
     ASSERT(deq != NULL);
     ASSERT(deq_idx < deq->queue_count);
     DvzFifo* fifo = _deq_fifo(deq, deq_idx);
-    int32_t last = fifo->tail - 1;
+    int32_t last = fifo->tail - fifo->head - 1;
     if (last < 0)
         last += fifo->capacity;
     ASSERT(0 <= last && last < fifo->capacity);
-    return *((DvzDeqItem*)(fifo->items[last]));
+    return *((DvzDeqItem*)dvz_fifo_peek(fifo, last));
 }
 
 
@@ -357,21 +748,17 @@ DvzDeqItem dvz_deq_dequeue(DvzDeq* deq, bool wait)
     ASSERT(deq != NULL);
 
     DvzFifo* fifo = NULL;
-    DvzDeqItem* deq_item = NULL;
     DvzDeqItem item_s = {0};
 
     // Find the first non-empty FIFO queue, and dequeue it.
     for (uint32_t deq_idx = 0; deq_idx < deq->queue_count; deq_idx++)
     {
         fifo = _deq_fifo(deq, deq_idx);
-        deq_item = dvz_fifo_dequeue(fifo, wait);
-        if (deq_item != NULL)
+        if (dvz_fifo_pop(fifo, &item_s, wait))
         {
-            item_s = *deq_item;
             log_trace(
                 "dequeue item from FIFO queue #%d with type %d", item_s.deq_idx, item_s.type);
             ASSERT(item_s.item != NULL);
-            FREE(deq_item);
             break;
         }
     }
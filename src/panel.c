@@ -257,18 +257,19 @@ DvzPanel* dvz_panel(DvzGrid* grid, uint32_t row, uint32_t col)
     panel->data_coords.transform = DVZ_TRANSFORM_CARTESIAN;
     panel->data_coords.transpose = DVZ_CDS_TRANSPOSE_NONE;
 
-    // NOTE: for now just use a single command buffer, as using multiple command buffers
-    // is complicated since we need to use multiple render passes and framebuffers.
-    panel->cmds = &grid->canvas->cmds_render;
-    // Tag the DvzCommands instance with the panel index, so that the REFILL callback knows
-    // which DvzCommands corresponds to which panel.
-    // panel->cmds = dvz_canvas_commands(
-    //     grid->canvas, DVZ_DEFAULT_QUEUE_RENDER, DVZ_COMMANDS_GROUP_PANELS, grid->panel_count -
-    //     1);
+    // Secondary command buffers, executed within the canvas render pass by the primary command
+    // buffers. They will be recorded at the next refill.
+    uint32_t n = canvas->swapchain.img_count;
+    panel->cmds = dvz_commands_secondary(canvas->gpu, DVZ_DEFAULT_QUEUE_RENDER, n);
 
     // MVP uniform buffer.
-    uint32_t n = canvas->swapchain.img_count;
     panel->br_mvp = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE, n, sizeof(DvzMVP));
+    if (panel->br_mvp.buffer == NULL)
+    {
+        log_error("cannot create panel %d,%d: memory budget exceeded", row, col);
+        dvz_panel_destroy(panel);
+        return NULL;
+    }
     // Initialize with identity matrices. Will be later updated by the scene controllers at every
     // frame.
     // dvz_canvas_buffers(canvas, panel->br_mvp, 0, panel->br_mvp.size, &MVP_ID);
@@ -533,5 +534,14 @@ void dvz_panel_destroy(DvzPanel* panel)
     {
         dvz_visual_destroy(panel->visuals[i]);
     }
+
+    // Free the MVP uniform buffer.
+    DvzContext* ctx = panel->grid->canvas->gpu->context;
+    if (ctx != NULL && dvz_obj_is_created(&ctx->obj))
+        dvz_ctx_buffers_free(ctx, &panel->br_mvp);
+
+    // Destroy the secondary command buffers.
+    dvz_commands_destroy(&panel->cmds);
+
     dvz_obj_destroyed(&panel->obj);
 }
@@ -32,7 +32,15 @@ DvzScene* dvz_scene(DvzCanvas* canvas, uint32_t n_rows, uint32_t n_cols)
         DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzController), DVZ_OBJECT_TYPE_CONTROLLER);
 
     // Scene update FIFO queue.
-    canvas->scene->update_fifo = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
+    canvas->scene->update_fifo =
+        dvz_fifo_typed(DVZ_MAX_FIFO_CAPACITY, sizeof(DvzSceneUpdate));
+
+    // Scene update thread, only started with dvz_scene_async_updates().
+    if (pthread_mutex_init(&canvas->scene->async_lock, NULL) != 0)
+        log_error("mutex creation failed");
+    if (pthread_cond_init(&canvas->scene->async_cond, NULL) != 0)
+        log_error("cond creation failed");
+    atomic_init(&canvas->scene->async_status, DVZ_SCENE_ASYNC_IDLE);
 
     // INIT callback
     dvz_event_callback(canvas, DVZ_EVENT_INIT, 0, DVZ_EVENT_MODE_SYNC, _scene_init, canvas->scene);
@@ -208,6 +216,8 @@ dvz_scene_panel(DvzScene* scene, uint32_t row, uint32_t col, DvzControllerType t
         dvz_canvas_clear_color(scene->canvas, 1, 1, 1);
 
     DvzPanel* panel = dvz_panel(&scene->grid, row, col);
+    if (panel == NULL)
+        return NULL;
     panel->scene = scene;
 
     DvzController* controller = dvz_container_alloc(&scene->controllers);
@@ -239,6 +249,9 @@ static void _add_visual(DvzPanel* panel, DvzVisual* visual)
     // Add the visual to the panel.
     dvz_panel_visual(panel, visual);
 
+    // The scene is notified whenever the visual data changes.
+    dvz_visual_callback_changed(visual, _scene_visual_changed, panel);
+
     // Bind the common buffers (MVP, viewport).
     _common_data(panel, visual);
 
@@ -418,6 +431,18 @@ void dvz_scene_destroy(DvzScene* scene)
     DvzGrid* grid = &scene->grid;
     ASSERT(grid != NULL);
 
+    // Stop the scene update thread before destroying the visuals it may be baking.
+    if (scene->is_async)
+    {
+        _scene_async_signal(scene, DVZ_SCENE_ASYNC_STOP);
+        dvz_thread_join(&scene->update_thread);
+        scene->is_async = false;
+    }
+
+    // The panel command buffers may still be in use.
+    ASSERT(scene->canvas != NULL);
+    dvz_gpu_wait(scene->canvas->gpu);
+
     // Destroy all panels.
     DvzContainerIterator iter = dvz_container_iterator(&grid->panels);
     DvzPanel* panel = NULL;
@@ -436,6 +461,13 @@ void dvz_scene_destroy(DvzScene* scene)
     dvz_container_destroy(&scene->controllers);
 
     dvz_fifo_destroy(&scene->update_fifo);
+    FREE(scene->visuals_changed);
+    FREE(scene->visuals_baked);
+    FREE(scene->panels_changed);
+    pthread_mutex_destroy(&scene->async_lock);
+    pthread_cond_destroy(&scene->async_cond);
+    FREE(scene->panel_fills);
+    FREE(scene->panel_cmds);
 
     CONTAINER_DESTROY_ITEMS(DvzVisual, scene->visuals, dvz_visual_destroy)
     dvz_container_destroy(&scene->visuals);
@@ -443,3 +475,35 @@ void dvz_scene_destroy(DvzScene* scene)
     dvz_obj_destroyed(&scene->obj);
     FREE(scene);
 }
+
+
+
+void dvz_scene_async_updates(DvzScene* scene, bool enable)
+{
+    ASSERT(scene != NULL);
+    DvzCanvas* canvas = scene->canvas;
+    ASSERT(canvas != NULL);
+    if (enable == scene->is_async)
+        return;
+
+    if (enable)
+    {
+        log_debug("start the scene update thread");
+        atomic_store(&scene->async_status, DVZ_SCENE_ASYNC_IDLE);
+        scene->is_async = true;
+        scene->update_thread = dvz_thread(_scene_update_thread, scene);
+        return;
+    }
+
+    log_debug("stop the scene update thread");
+    _scene_async_signal(scene, DVZ_SCENE_ASYNC_STOP);
+    dvz_thread_join(&scene->update_thread);
+
+    // Upload the visuals baked by the thread, the pending scene updates will be processed at the
+    // next frame.
+    dvz_event_lock(canvas);
+    _scene_commit(scene);
+    scene->is_async = false;
+    atomic_store(&scene->async_status, DVZ_SCENE_ASYNC_IDLE);
+    dvz_event_unlock(canvas);
+}
@@ -77,6 +77,15 @@ static inline bool _has_coords_changed(DvzDataCoords* coords, DvzBox* box)
 
 
 
+static inline bool _has_scene_updates(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    return dvz_fifo_size(&scene->update_fifo) > 0 || scene->visuals_changed_count > 0 ||
+           scene->panels_changed_count > 0;
+}
+
+
+
 /*************************************************************************************************/
 /*  Utils                                                                                        */
 /*************************************************************************************************/
@@ -286,132 +295,83 @@ static int _transform_flags(DvzControllerType type, int flags)
 
 
 /*************************************************************************************************/
-/*  Scene update enqueueing                                                                      */
+/*  Dirty tracking                                                                               */
 /*************************************************************************************************/
 
-// Enqueue a scene update.
-static void _scene_update_enqueue(DvzScene* scene, DvzSceneUpdate update)
+// Mark a visual as changed: it will be baked and uploaded at the next scene update pass.
+static void _scene_visual_dirty(DvzPanel* panel, DvzVisual* visual)
 {
-    // log_trace("enqueue scene update of type %d", update.type);
-    ASSERT(scene != NULL);
-    DvzFifo* fifo = &scene->update_fifo;
-    ASSERT(fifo != NULL);
-    DvzSceneUpdate* up = (DvzSceneUpdate*)calloc(1, sizeof(DvzSceneUpdate));
-    *up = update;
-    dvz_fifo_enqueue(fifo, up);
-}
-
-
-
-static void _enqueue_visual_changed(DvzPanel* panel, DvzVisual* visual)
-{
-    log_trace("enqueue visual changed");
     ASSERT(panel != NULL);
-    DvzScene* scene = panel->scene;
-    ASSERT(scene != NULL);
     ASSERT(visual != NULL);
-
-    DvzSceneUpdate up = {0};
-    up.type = DVZ_SCENE_UPDATE_VISUAL_CHANGED;
-    up.scene = scene;
-    up.canvas = scene->canvas;
-    up.panel = panel;
-    up.visual = visual;
-    _scene_update_enqueue(scene, up);
-}
-
-
-
-static void _enqueue_visual_added(DvzPanel* panel, DvzVisual* visual)
-{
-    log_trace("enqueue visual added");
-    ASSERT(panel != NULL);
+    if (visual->is_dirty)
+        return;
     DvzScene* scene = panel->scene;
     ASSERT(scene != NULL);
-    ASSERT(visual != NULL);
-
-    DvzSceneUpdate up = {0};
-    up.type = DVZ_SCENE_UPDATE_VISUAL_ADDED;
-    up.scene = scene;
-    up.canvas = scene->canvas;
-    up.panel = panel;
-    up.visual = visual;
-    _scene_update_enqueue(scene, up);
-}
+    visual->is_dirty = true;
+    dvz_canvas_redraw(scene->canvas);
 
-
-
-static void _enqueue_prop_changed(DvzPanel* panel, DvzVisual* visual, DvzProp* prop)
-{
-    log_trace("enqueue prop changed");
-    ASSERT(panel != NULL);
-    DvzScene* scene = panel->scene;
-    ASSERT(scene != NULL);
-    ASSERT(visual != NULL);
-    ASSERT(prop != NULL);
+    if (scene->visuals_changed_count >= scene->visuals_changed_capacity)
+    {
+        scene->visuals_changed_capacity =
+            scene->visuals_changed_capacity == 0 ? 16 : 2 * scene->visuals_changed_capacity;
+        REALLOC(
+            scene->visuals_changed, scene->visuals_changed_capacity * sizeof(DvzSceneUpdate));
+    }
+    ASSERT(scene->visuals_changed_count < scene->visuals_changed_capacity);
 
     DvzSceneUpdate up = {0};
-    up.type = DVZ_SCENE_UPDATE_PROP_CHANGED;
+    up.type = DVZ_SCENE_UPDATE_VISUAL_CHANGED;
     up.scene = scene;
     up.canvas = scene->canvas;
     up.panel = panel;
     up.visual = visual;
-    up.prop = prop;
-    up.source = prop->source;
-    _scene_update_enqueue(scene, up);
+    scene->visuals_changed[scene->visuals_changed_count++] = up;
 }
 
 
 
-static void _enqueue_item_count_changed(DvzPanel* panel, DvzVisual* visual)
+// Called by the visual whenever one of its sources needs to be uploaded.
+static void _scene_visual_changed(DvzVisual* visual, void* user_data)
 {
-    log_trace("enqueue item count changed");
-    ASSERT(panel != NULL);
-    DvzScene* scene = panel->scene;
-    ASSERT(scene != NULL);
-    ASSERT(visual != NULL);
-
-    DvzSceneUpdate up = {0};
-    up.type = DVZ_SCENE_UPDATE_ITEM_COUNT_CHANGED;
-    up.scene = scene;
-    up.canvas = scene->canvas;
-    up.panel = panel;
-    up.visual = visual;
-    _scene_update_enqueue(scene, up);
+    _scene_visual_dirty((DvzPanel*)user_data, visual);
 }
 
 
 
-static void _enqueue_panel_changed(DvzPanel* panel)
+// Mark the data coordinates of a panel as changed: all its visuals will be renormalized at the
+// next scene update pass.
+static void _scene_coords_dirty(DvzPanel* panel)
 {
-    log_trace("enqueue panel changed");
+    log_trace("panel coords changed");
     ASSERT(panel != NULL);
     DvzScene* scene = panel->scene;
     ASSERT(scene != NULL);
 
-    DvzSceneUpdate up = {0};
-    up.type = DVZ_SCENE_UPDATE_PANEL_CHANGED;
-    up.scene = scene;
-    up.canvas = scene->canvas;
-    up.panel = panel;
-    _scene_update_enqueue(scene, up);
+    for (uint32_t i = 0; i < scene->panels_changed_count; i++)
+        if (scene->panels_changed[i] == panel)
+            return;
+    dvz_canvas_redraw(scene->canvas);
+
+    if (scene->panels_changed_count >= scene->panels_changed_capacity)
+    {
+        scene->panels_changed_capacity =
+            scene->panels_changed_capacity == 0 ? 16 : 2 * scene->panels_changed_capacity;
+        REALLOC(scene->panels_changed, scene->panels_changed_capacity * sizeof(DvzPanel*));
+    }
+    ASSERT(scene->panels_changed_count < scene->panels_changed_capacity);
+    scene->panels_changed[scene->panels_changed_count++] = panel;
 }
 
 
 
-static void _enqueue_coords_changed(DvzPanel* panel)
+// Mark the panel command buffers as outdated, only these will be recorded again at the next
+// refill.
+static void _panel_to_refill(DvzPanel* panel)
 {
-    log_trace("enqueue coords changed");
     ASSERT(panel != NULL);
-    DvzScene* scene = panel->scene;
-    ASSERT(scene != NULL);
-
-    DvzSceneUpdate up = {0};
-    up.type = DVZ_SCENE_UPDATE_COORDS_CHANGED;
-    up.scene = scene;
-    up.canvas = scene->canvas;
-    up.panel = panel;
-    _scene_update_enqueue(scene, up);
+    memset(panel->cmds_valid, 0, sizeof(panel->cmds_valid));
+    ASSERT(panel->grid != NULL);
+    dvz_canvas_to_refill_partial(panel->grid->canvas);
 }
 
 
@@ -422,33 +382,33 @@ static void _enqueue_coords_changed(DvzPanel* panel)
 
 // Called when a prop's data has changed.
 // Change the visual and source request, to be picked up by dvz_visual_data() later.
-static void _process_prop_changed(DvzSceneUpdate up)
+static void _process_prop_changed(DvzPanel* panel, DvzVisual* visual, DvzProp* prop)
 {
     log_trace("process prop changed");
-    ASSERT(up.panel != NULL);
+    ASSERT(panel != NULL);
     // Panel coords.
-    DvzDataCoords coords = up.panel->data_coords;
+    DvzDataCoords coords = panel->data_coords;
 
     // if POS prop, we do data normalization
-    ASSERT(up.prop != NULL);
-    ASSERT(up.visual != NULL);
-    if (up.prop->prop_type == DVZ_PROP_POS && _is_visual_to_transform(up.visual))
+    ASSERT(prop != NULL);
+    ASSERT(visual != NULL);
+    if (prop->prop_type == DVZ_PROP_POS && _is_visual_to_transform(visual))
     {
-        _transform_pos_prop(coords, up.prop);
+        _transform_pos_prop(coords, prop);
 
-        if ((up.visual->flags & DVZ_VISUAL_FLAGS_TRANSFORM_BOX_INIT) == 0)
+        if ((visual->flags & DVZ_VISUAL_FLAGS_TRANSFORM_BOX_INIT) == 0)
         {
             // Recompute the visual box.
-            DvzBox box = _visual_box(up.visual);
+            DvzBox box = _visual_box(visual);
 
             // Compute the new panel box: all existing visuals (except the current one), and the
             // current visual with the *new* box.
             // _box_merge(2, (DvzBox[]){box, coords.box});
-            uint32_t n = _count_visuals_to_transform(up.panel);
+            uint32_t n = _count_visuals_to_transform(panel);
             if (n >= 2)
             {
                 DvzBox box_other = coords.box;
-                box_other = _compute_panel_box(up.panel, up.visual);
+                box_other = _compute_panel_box(panel, visual);
                 box = _box_merge(2, (DvzBox[]){box, box_other});
             }
 
@@ -460,25 +420,49 @@ static void _process_prop_changed(DvzSceneUpdate up)
             if (_has_coords_changed(&coords, &box))
             {
                 // Update the data coords.
-                up.panel->data_coords.box = box;
-                _enqueue_coords_changed(up.panel);
+                panel->data_coords.box = box;
+                _scene_coords_dirty(panel);
             }
         }
     }
 
-    // Mark the visual and source has needing update, for dvz_visual_update()
-    ASSERT(up.source != NULL);
-    _source_set_changed(up.source, true);
+    // Mark the visual and source has needing update, for dvz_visual_update(), keeping the
+    // changed item ranges set by dvz_visual_data_partial(), if any.
+    ASSERT(prop->source != NULL);
+    if (!_source_has_changed(prop->source))
+        _source_set_changed(prop->source, true);
+}
+
+
+
+// Called for every changed visual: process its changed POS props, which may change the panel
+// box.
+static void _process_visual_props(DvzSceneUpdate up)
+{
+    DvzVisual* visual = up.visual;
+    ASSERT(visual != NULL);
+    ASSERT(up.panel != NULL);
+
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        if (prop->prop_type == DVZ_PROP_POS && prop->obj.request == DVZ_VISUAL_REQUEST_UPLOAD)
+        {
+            prop->obj.request = DVZ_VISUAL_REQUEST_SET;
+            _process_prop_changed(up.panel, visual, prop);
+        }
+        dvz_container_iter(&iter);
+    }
 }
 
 
 
 // Called when the box coords has changed and ALL visuals in a panel must be renormalized.
-static void _process_coords_changed(DvzSceneUpdate up)
+static void _process_coords_changed(DvzPanel* panel)
 {
     log_trace("process coords changed");
-
-    DvzPanel* panel = up.panel;
     ASSERT(panel != NULL);
 
     // We'll iterate through all visuals.
@@ -508,10 +492,12 @@ static void _process_coords_changed(DvzSceneUpdate up)
             prop = iter.item;
             ASSERT(prop != NULL);
 
-            // Transform all POS props with the panel data coordinates.
-            if (prop->prop_type == DVZ_PROP_POS)
+            // Transform all POS props with the panel data coordinates. The panel box is already
+            // up to date, so there is no need to recompute it for every prop.
+            if (prop->prop_type == DVZ_PROP_POS && prop->source != NULL)
             {
-                _enqueue_prop_changed(panel, visual, prop);
+                _transform_pos_prop(panel->data_coords, prop);
+                _source_set_changed(prop->source, true);
             }
 
             dvz_container_iter(&iter);
@@ -563,33 +549,31 @@ static void _process_visual_added(DvzSceneUpdate up)
     {
         // This function renormalizes all visuals.
         panel->data_coords.box = box;
-        _enqueue_coords_changed(panel);
+        _scene_coords_dirty(panel);
     }
 
     // Once added, we need to trigger the visual data upload.
-    _enqueue_visual_changed(panel, visual);
+    _scene_visual_dirty(panel, visual);
 }
 
 
 
-// Called when visual data has changed.
-static void _process_visual_changed(DvzSceneUpdate up)
+// Called once a changed visual has been baked.
+static void _process_visual_upload(DvzSceneUpdate up)
 {
-    log_trace("process visual changed");
-
     DvzVisual* visual = up.visual;
     ASSERT(visual != NULL);
     DvzPanel* panel = up.panel;
     ASSERT(panel != NULL);
 
     // Visual data GPU upload.
-    dvz_visual_update(visual, panel->viewport, panel->data_coords, NULL);
+    dvz_visual_upload(visual);
 
     // Detect whether the number of vertices/indices has changed, in which case a command buffer
     // refill will be needed.
     if (_has_item_count_changed(visual))
     {
-        _enqueue_item_count_changed(panel, visual);
+        _panel_to_refill(panel);
     }
 
     // TODO: recompute the bounding box when changing the data?
@@ -597,18 +581,106 @@ static void _process_visual_changed(DvzSceneUpdate up)
     // if (_has_coords_changed(&coords, &box))
     // {
     //     // This function renormalizes all visuals.
-    //     _enqueue_coords_changed(panel);
+    //     _scene_coords_dirty(panel);
     // }
 }
 
 
 
+// Append a visual update to a list, unless the visual is already in it.
+static void _scene_updates_append(
+    DvzSceneUpdate** updates, uint32_t* count, uint32_t* capacity, DvzSceneUpdate up)
+{
+    ASSERT(updates != NULL);
+    ASSERT(count != NULL);
+    ASSERT(capacity != NULL);
+    ASSERT(up.visual != NULL);
+
+    for (uint32_t i = 0; i < *count; i++)
+        if ((*updates)[i].visual == up.visual)
+            return;
+
+    if (*count >= *capacity)
+    {
+        *capacity = *capacity == 0 ? 16 : 2 * *capacity;
+        REALLOC(*updates, *capacity * sizeof(DvzSceneUpdate));
+    }
+    ASSERT(*count < *capacity);
+    (*updates)[(*count)++] = up;
+}
+
+
+
+// Worker thread task baking one changed visual.
+static void _visual_bake_task(void* user_data)
+{
+    DvzSceneUpdate* up = (DvzSceneUpdate*)user_data;
+    ASSERT(up != NULL);
+    ASSERT(up->visual != NULL);
+    ASSERT(up->panel != NULL);
+    dvz_visual_bake(up->visual, up->panel->viewport, up->panel->data_coords, NULL);
+}
+
+
+
+// Bake all visuals that have changed since the last pass in the worker threads, then upload their
+// data sequentially. With the scene update thread, the upload is deferred to the next frame.
+static void _process_visuals_changed(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    uint32_t n = scene->visuals_changed_count;
+    if (n == 0)
+        return;
+    log_trace("process %d visuals changed", n);
+
+    ASSERT(scene->canvas != NULL);
+    ASSERT(scene->canvas->app != NULL);
+    DvzWorkers* workers = scene->canvas->app->workers;
+    ASSERT(workers != NULL);
+
+    // Bake the visuals concurrently, each task only modifies its own visual. The render threads
+    // of the other canvases use the same pool, only the tasks of this pass are waited for.
+    DvzWorkerGroup group = dvz_workers_group(workers);
+    for (uint32_t i = 0; i < n; i++)
+        dvz_workers_group_submit(&group, _visual_bake_task, &scene->visuals_changed[i]);
+    dvz_workers_group_wait(&group);
+
+    // The render thread uploads the baked visuals at the next frame boundary, see _scene_commit().
+    // Until then, the GPU buffers keep the data of the previous bake.
+    if (scene->is_async)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            scene->visuals_changed[i].visual->obj.request = DVZ_VISUAL_REQUEST_BAKED;
+            scene->visuals_changed[i].visual->is_dirty = false;
+            _scene_updates_append(
+                &scene->visuals_baked, &scene->visuals_baked_count,
+                &scene->visuals_baked_capacity, scene->visuals_changed[i]);
+        }
+        scene->visuals_changed_count = 0;
+        return;
+    }
+
+    // GPU uploads, once all visuals have been baked.
+    for (uint32_t i = 0; i < n; i++)
+    {
+        _process_visual_upload(scene->visuals_changed[i]);
+        scene->visuals_changed[i].visual->is_dirty = false;
+    }
+    scene->visuals_changed_count = 0;
+}
+
+
+
 // Called when the visibility of a visual has changed.
 static void _process_visibility_changed(DvzSceneUpdate up)
 {
     ASSERT(up.canvas != NULL);
     // Refill command buffer.
-    dvz_canvas_to_refill(up.canvas);
+    if (up.panel != NULL)
+        _panel_to_refill(up.panel);
+    else
+        dvz_canvas_to_refill(up.canvas);
 }
 
 
@@ -616,9 +688,9 @@ static void _process_visibility_changed(DvzSceneUpdate up)
 // Called when the number of vertices/indices has changed.
 static void _process_item_count_changed(DvzSceneUpdate up)
 {
-    ASSERT(up.canvas != NULL);
-    // Refill command buffer.
-    dvz_canvas_to_refill(up.canvas);
+    ASSERT(up.panel != NULL);
+    // Refill the panel command buffers.
+    _panel_to_refill(up.panel);
 }
 
 
@@ -641,9 +713,8 @@ static void _process_panel_changed(DvzSceneUpdate up)
     // // The panel no longer needs to be updated.
     // panel->obj.request = 0;
 
-    // Refill command buffer.
-    ASSERT(up.canvas != NULL);
-    dvz_canvas_to_refill(up.canvas);
+    // Refill the panel command buffers.
+    _panel_to_refill(panel);
 }
 
 
@@ -691,11 +762,11 @@ static void _process_scene_update(DvzSceneUpdate up)
         break;
 
     case DVZ_SCENE_UPDATE_VISUAL_CHANGED:
-        _process_visual_changed(up);
+        _scene_visual_dirty(up.panel, up.visual);
         break;
 
     case DVZ_SCENE_UPDATE_PROP_CHANGED:
-        _process_prop_changed(up);
+        _process_prop_changed(up.panel, up.visual, up.prop);
         break;
 
     case DVZ_SCENE_UPDATE_VISIBILITY_CHANGED:
@@ -715,7 +786,7 @@ static void _process_scene_update(DvzSceneUpdate up)
         break;
 
     case DVZ_SCENE_UPDATE_COORDS_CHANGED:
-        _process_coords_changed(up);
+        _scene_coords_dirty(up.panel);
         break;
 
         // case DVZ_SCENE_UPDATE_CANVAS_RESIZED:
@@ -733,6 +804,24 @@ static void _process_scene_update(DvzSceneUpdate up)
 /*  Scene updates                                                                                */
 /*************************************************************************************************/
 
+// Share the MVP of the linked panels.
+static void _link_controllers(DvzGrid* grid)
+{
+    ASSERT(grid != NULL);
+    DvzPanel* panel = NULL;
+    DvzPanel* target = NULL;
+    for (uint32_t i = 0; i < grid->link_count; i++)
+    {
+        panel = grid->links[i].source;
+        target = grid->links[i].target;
+        ASSERT(panel != NULL);
+        ASSERT(target != NULL);
+        target->controller->interacts[0].mvp = panel->controller->interacts[0].mvp;
+    }
+}
+
+
+
 static void _callback_controllers(DvzScene* scene)
 {
     ASSERT(scene != NULL);
@@ -756,71 +845,38 @@ static void _callback_controllers(DvzScene* scene)
         dvz_container_iter(&iter);
     }
 
-    DvzPanel* target = NULL;
-    for (uint32_t i = 0; i < grid->link_count; i++)
-    {
-        panel = grid->links[i].source;
-        target = grid->links[i].target;
-        ASSERT(panel != NULL);
-        ASSERT(target != NULL);
-        target->controller->interacts[0].mvp = panel->controller->interacts[0].mvp;
-    }
+    _link_controllers(grid);
 }
 
 
 
-static void _enqueue_all_visuals_changed(DvzScene* scene)
+// Only update the interacts of the controllers, without calling the controller callbacks which
+// may modify visuals. Used while the scene update thread holds the event lock.
+static void _callback_interacts(DvzScene* scene)
 {
-    // log_trace("enqueue all visuals changed");
-
     ASSERT(scene != NULL);
     DvzGrid* grid = &scene->grid;
+    DvzCanvas* canvas = scene->canvas;
+    ASSERT(canvas != NULL);
 
-    // Go through all panels that need to be updated.
     DvzPanel* panel = NULL;
-    DvzContainerIterator iter_panel = dvz_container_iterator(&grid->panels);
-    DvzVisual* visual = NULL;
-    DvzContainerIterator iter_prop;
-    DvzProp* prop = NULL;
-
-    // Go through all panels in the scene to detect the scene updates.
-    while (iter_panel.item != NULL)
+    DvzContainerIterator iter = dvz_container_iterator(&grid->panels);
+    while (iter.item != NULL)
     {
-        panel = iter_panel.item;
-
-        // Determine what has changed in the scene since last frame:
-
-        // Process panel and visual requests.
-        for (uint32_t j = 0; j < panel->visual_count; j++)
+        panel = iter.item;
+        if (panel->controller != NULL)
         {
-            visual = panel->visuals[j];
-
-            // // Require panel update?
-            // if (panel->obj.request == 1)
-            //     _enqueue_panel_changed(panel);
-
-            // Process visual upload.
-            if (visual->obj.request == DVZ_VISUAL_REQUEST_UPLOAD)
+            for (uint32_t i = 0; i < panel->controller->interact_count; i++)
             {
-                // Check if the POS props have been changed.
-                iter_prop = dvz_container_iterator(&visual->props);
-                while (iter_prop.item != NULL)
-                {
-                    prop = iter_prop.item;
-                    if (prop->prop_type == DVZ_PROP_POS &&
-                        prop->obj.request == DVZ_VISUAL_REQUEST_UPLOAD)
-                    {
-                        _enqueue_prop_changed(panel, visual, prop);
-                        prop->obj.request = DVZ_VISUAL_REQUEST_SET;
-                    }
-                    dvz_container_iter(&iter_prop);
-                }
-
-                _enqueue_visual_changed(panel, visual);
+                dvz_interact_update(
+                    &panel->controller->interacts[i], panel->viewport, &canvas->mouse,
+                    &canvas->keyboard);
             }
         }
-        dvz_container_iter(&iter_panel);
+        dvz_container_iter(&iter);
     }
+
+    _link_controllers(grid);
 }
 
 
@@ -833,48 +889,235 @@ static DvzSceneUpdate _scene_update_dequeue(DvzScene* scene)
     ASSERT(scene != NULL);
     DvzFifo* fifo = &scene->update_fifo;
     ASSERT(fifo != NULL);
-    DvzSceneUpdate* item = (DvzSceneUpdate*)dvz_fifo_dequeue(fifo, false);
-    DvzSceneUpdate out;
-    out.type = DVZ_SCENE_UPDATE_NONE;
-    if (item == NULL)
-        return out;
-    ASSERT(item != NULL);
-    out = *item;
-    FREE(item);
+    DvzSceneUpdate out = {0};
+    if (!dvz_fifo_pop(fifo, &out, false))
+        out.type = DVZ_SCENE_UPDATE_NONE;
     return out;
 }
 
 
 
-// Process all pending scene updates.
+// Renormalize the visuals of all panels whose data coordinates have changed.
+static void _process_panels_changed(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    for (uint32_t i = 0; i < scene->panels_changed_count; i++)
+        _process_coords_changed(scene->panels_changed[i]);
+    scene->panels_changed_count = 0;
+}
+
+
+
+// Process all pending scene updates. Only the objects that have changed are visited, in
+// dependency order: structural updates (new visuals, panels), changed POS props, panels whose
+// data coordinates have changed, and finally the changed visuals which are baked and uploaded.
 static void _process_scene_updates(DvzScene* scene)
 {
     ASSERT(scene != NULL);
-    DvzFifo* fifo = &scene->update_fifo;
+    if (!_has_scene_updates(scene))
+        return;
 
-    // Find all visuals that need update, and enqueue them.
-    _enqueue_all_visuals_changed(scene);
+    // Process the pending structural updates.
+    DvzSceneUpdate up = _scene_update_dequeue(scene);
+    while (up.type != DVZ_SCENE_UPDATE_NONE)
+    {
+        _process_scene_update(up);
+        up = _scene_update_dequeue(scene);
+    }
 
-    // Iteratively process the scene updates, which can trigger more visuals changes.
-    DvzSceneUpdate up = {0};
+    // The changed POS props may change the panel boxes, in which case all visuals in these panels
+    // are renormalized and appended to the changed visuals, along with the axes.
     uint32_t i = 0;
-    while (dvz_fifo_size(fifo) > 0 && i <= 1000) // HACK: avoid infinite loop
+    do
     {
-        log_trace("scene update pass #%d", i);
+        for (; i < scene->visuals_changed_count; i++)
+            _process_visual_props(scene->visuals_changed[i]);
+        _process_panels_changed(scene);
+    } while (i < scene->visuals_changed_count);
+
+    // Bake and upload the changed visuals.
+    _process_visuals_changed(scene);
+}
+
+
 
-        // Process all pending updates.
+/*************************************************************************************************/
+/*  Scene update enqueueing                                                                      */
+/*************************************************************************************************/
+
+// Enqueue a scene update. The queue has a fixed capacity: when it is full, the producer processes
+// the pending scene updates itself, with the event lock.
+static void _scene_update_enqueue(DvzScene* scene, DvzSceneUpdate update)
+{
+    // log_trace("enqueue scene update of type %d", update.type);
+    ASSERT(scene != NULL);
+    DvzFifo* fifo = &scene->update_fifo;
+    ASSERT(fifo != NULL);
+    ASSERT(fifo->item_size == sizeof(DvzSceneUpdate));
+    DvzSceneUpdate up = {0};
+    while (!dvz_fifo_push(fifo, &update))
+    {
+        log_debug("scene update queue is full, processing the pending scene updates");
+        dvz_event_lock(scene->canvas);
         up = _scene_update_dequeue(scene);
         while (up.type != DVZ_SCENE_UPDATE_NONE)
         {
             _process_scene_update(up);
             up = _scene_update_dequeue(scene);
         }
+        dvz_event_unlock(scene->canvas);
+    }
+    dvz_canvas_redraw(scene->canvas);
+}
+
+
+
+static void _enqueue_visual_added(DvzPanel* panel, DvzVisual* visual)
+{
+    log_trace("enqueue visual added");
+    ASSERT(panel != NULL);
+    DvzScene* scene = panel->scene;
+    ASSERT(scene != NULL);
+    ASSERT(visual != NULL);
+
+    DvzSceneUpdate up = {0};
+    up.type = DVZ_SCENE_UPDATE_VISUAL_ADDED;
+    up.scene = scene;
+    up.canvas = scene->canvas;
+    up.panel = panel;
+    up.visual = visual;
+    _scene_update_enqueue(scene, up);
+}
+
+
+
+static void _enqueue_panel_changed(DvzPanel* panel)
+{
+    log_trace("enqueue panel changed");
+    ASSERT(panel != NULL);
+    DvzScene* scene = panel->scene;
+    ASSERT(scene != NULL);
+
+    DvzSceneUpdate up = {0};
+    up.type = DVZ_SCENE_UPDATE_PANEL_CHANGED;
+    up.scene = scene;
+    up.canvas = scene->canvas;
+    up.panel = panel;
+    _scene_update_enqueue(scene, up);
+}
+
+
 
-        // Find all visuals that need update, and enqueue them.
-        _enqueue_all_visuals_changed(scene);
+/*************************************************************************************************/
+/*  Scene update thread                                                                          */
+/*************************************************************************************************/
+
+// Upload the visuals baked by the scene update thread. Called in the render thread, with the
+// event lock.
+static void _scene_commit(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    uint32_t n = scene->visuals_baked_count;
+    if (n == 0)
+        return;
+    log_trace("commit %d baked visual(s)", n);
 
-        i++;
+    DvzSceneUpdate up = {0};
+    for (uint32_t i = 0; i < n; i++)
+    {
+        up = scene->visuals_baked[i];
+        ASSERT(up.visual != NULL);
+        ASSERT(up.panel != NULL);
+
+        // The visual has been modified again since it was baked, it will be baked again and
+        // uploaded at a later frame.
+        if (up.visual->obj.request != DVZ_VISUAL_REQUEST_BAKED)
+            continue;
+
+        dvz_visual_upload(up.visual);
+        if (_has_item_count_changed(up.visual))
+            _panel_to_refill(up.panel);
     }
+    scene->visuals_baked_count = 0;
+}
+
+
+
+// Publish the visuals baked by the scene update thread, if any.
+static void _scene_async_commit(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    if (!scene->is_async || atomic_load(&scene->async_status) != DVZ_SCENE_ASYNC_READY)
+        return;
+    _scene_commit(scene);
+
+    // The uploads refer to the arrays of the visuals until they are processed, by the next
+    // transfer pass that starts after this point.
+    DvzContext* ctx = scene->canvas->gpu->context;
+    scene->async_upload_pass = atomic_load(&ctx->transfer_passes_started) + 1;
+    DvzSceneAsyncStatus status = DVZ_SCENE_ASYNC_READY;
+    atomic_compare_exchange_strong(&scene->async_status, &status, DVZ_SCENE_ASYNC_IDLE);
+}
+
+
+
+// Whether the uploads of the last commit have been processed.
+static bool _scene_async_uploaded(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    DvzContext* ctx = scene->canvas->gpu->context;
+    return atomic_load(&ctx->transfer_passes_done) >= scene->async_upload_pass;
+}
+
+
+
+static void _scene_async_signal(DvzScene* scene, DvzSceneAsyncStatus status)
+{
+    ASSERT(scene != NULL);
+    pthread_mutex_lock(&scene->async_lock);
+    atomic_store(&scene->async_status, status);
+    pthread_cond_signal(&scene->async_cond);
+    pthread_mutex_unlock(&scene->async_lock);
+}
+
+
+
+static void* _scene_update_thread(void* user_data)
+{
+    DvzScene* scene = (DvzScene*)user_data;
+    ASSERT(scene != NULL);
+    DvzCanvas* canvas = scene->canvas;
+    ASSERT(canvas != NULL);
+    log_trace("starting scene update thread");
+
+    DvzSceneAsyncStatus status = DVZ_SCENE_ASYNC_IDLE;
+    while (true)
+    {
+        // Wait until the render thread requests a scene update pass.
+        pthread_mutex_lock(&scene->async_lock);
+        status = atomic_load(&scene->async_status);
+        while (status != DVZ_SCENE_ASYNC_REQUESTED && status != DVZ_SCENE_ASYNC_STOP)
+        {
+            pthread_cond_wait(&scene->async_cond, &scene->async_lock);
+            status = atomic_load(&scene->async_status);
+        }
+        pthread_mutex_unlock(&scene->async_lock);
+        if (status == DVZ_SCENE_ASYNC_STOP)
+            break;
+
+        dvz_event_lock(canvas);
+        _process_scene_updates(scene);
+        // NOTE: the status may have been set to STOP in the meantime.
+        status = DVZ_SCENE_ASYNC_REQUESTED;
+        atomic_compare_exchange_strong(&scene->async_status, &status, DVZ_SCENE_ASYNC_READY);
+        dvz_event_unlock(canvas);
+
+        // The baked visuals are uploaded at the next frame.
+        dvz_canvas_redraw(canvas);
+    }
+
+    log_trace("end scene update thread");
+    return NULL;
 }
 
 
@@ -895,6 +1138,8 @@ static void _scene_init(DvzCanvas* canvas, DvzEvent ev)
     DvzGrid* grid = &scene->grid;
     ASSERT(grid != NULL);
 
+    dvz_event_lock(canvas);
+
     // Go through all panels in the scene.
     DvzPanel* panel = NULL;
     DvzContainerIterator iter = dvz_container_iterator(&grid->panels);
@@ -904,7 +1149,7 @@ static void _scene_init(DvzCanvas* canvas, DvzEvent ev)
 
         // Trigger normalization of all visuals initially in the panel.
         panel->data_coords.box = _compute_panel_box(panel, NULL);
-        _enqueue_coords_changed(panel);
+        _scene_coords_dirty(panel);
 
         // Go through all visuals.
         for (uint32_t j = 0; j < panel->visual_count; j++)
@@ -914,6 +1159,63 @@ static void _scene_init(DvzCanvas* canvas, DvzEvent ev)
         }
         dvz_container_iter(&iter);
     }
+
+    dvz_event_unlock(canvas);
+}
+
+
+
+// Record the secondary command buffer of a panel, called in a worker thread.
+static void _panel_fill_task(void* user_data)
+{
+    DvzPanelFill* fill = (DvzPanelFill*)user_data;
+    ASSERT(fill != NULL);
+    DvzPanel* panel = fill->panel;
+    ASSERT(panel != NULL);
+    DvzCanvas* canvas = panel->grid->canvas;
+    ASSERT(canvas != NULL);
+    DvzCommands* cmds = &panel->cmds;
+    uint32_t img_idx = fill->img_idx;
+
+    log_trace("panel fill cmd %d", img_idx);
+    dvz_cmd_reset(cmds, img_idx);
+    dvz_cmd_begin_secondary(cmds, img_idx, &canvas->renderpass);
+
+    // Find the panel viewport.
+    DvzViewport viewport = dvz_panel_viewport(panel);
+    dvz_cmd_viewport(cmds, img_idx, viewport.viewport);
+
+    // Go through all visuals in the panel.
+    DvzVisual* visual = NULL;
+    for (int priority = -panel->prority_max; priority <= panel->prority_max; priority++)
+    {
+        for (uint32_t k = 0; k < panel->visual_count; k++)
+        {
+            visual = panel->visuals[k];
+            if (visual->priority != priority)
+                continue;
+
+            dvz_visual_fill_event(visual, fill->clear_color, cmds, img_idx, viewport, NULL);
+        }
+    }
+
+    dvz_cmd_end(cmds, img_idx);
+
+    // The command buffer is up to date until the panel changes or a complete refill.
+    panel->cmds_valid[img_idx] = true;
+    panel->cmds_epoch[img_idx] = fill->epoch;
+}
+
+
+
+static void _panel_fills_reserve(DvzScene* scene, uint32_t count)
+{
+    ASSERT(scene != NULL);
+    if (count <= scene->panel_fills_capacity)
+        return;
+    scene->panel_fills_capacity = MAX(16, MAX(count, 2 * scene->panel_fills_capacity));
+    REALLOC(scene->panel_fills, scene->panel_fills_capacity * sizeof(DvzPanelFill));
+    REALLOC(scene->panel_cmds, scene->panel_fills_capacity * sizeof(DvzCommands*));
 }
 
 
@@ -928,51 +1230,61 @@ static void _scene_fill(DvzCanvas* canvas, DvzEvent ev)
     DvzScene* scene = (DvzScene*)ev.user_data;
     ASSERT(scene != NULL);
     DvzGrid* grid = &scene->grid;
+    DvzWorkers* workers = canvas->app->workers;
+    ASSERT(workers != NULL);
 
-    DvzViewport viewport = {0};
     DvzCommands* cmds = NULL;
     DvzPanel* panel = NULL;
     DvzContainerIterator iter;
-    DvzVisual* visual = NULL;
-    uint32_t img_idx = 0;
+    uint32_t img_idx = ev.u.rf.img_idx;
+    uint32_t panel_count = 0;
+    uint32_t fill_count = 0;
 
-    // Go through all the current command buffers.
-    for (uint32_t i = 0; i < ev.u.rf.cmd_count; i++)
-    {
-        cmds = ev.u.rf.cmds[i];
-        img_idx = ev.u.rf.img_idx;
+    // The visuals may be modified concurrently by async callbacks.
+    dvz_event_lock(canvas);
 
-        log_trace("visual fill cmd %d begin %d", i, img_idx);
-        dvz_visual_fill_begin(canvas, cmds, img_idx);
+    // The recording uses the item counts of the uploaded visuals.
+    _scene_async_commit(scene);
 
-        iter = dvz_container_iterator(&grid->panels);
-        while (iter.item != NULL)
+    // Record the panels that have changed since their last recording, in parallel.
+    DvzWorkerGroup group = dvz_workers_group(workers);
+    _panel_fills_reserve(scene, grid->panels.capacity);
+    iter = dvz_container_iterator(&grid->panels);
+    while (iter.item != NULL)
+    {
+        panel = iter.item;
+        ASSERT(panel_count < scene->panel_fills_capacity);
+        scene->panel_cmds[panel_count++] = &panel->cmds;
+        if (!panel->cmds_valid[img_idx] || panel->cmds_epoch[img_idx] != ev.u.rf.epoch)
         {
-            panel = iter.item;
-
-            // Find the panel viewport.
-            viewport = dvz_panel_viewport(panel);
-            dvz_cmd_viewport(cmds, img_idx, viewport.viewport);
+            scene->panel_fills[fill_count] = (DvzPanelFill){
+                .panel = panel,
+                .img_idx = img_idx,
+                .epoch = ev.u.rf.epoch,
+                .clear_color = ev.u.rf.clear_color,
+            };
+            dvz_workers_group_submit(&group, _panel_fill_task, &scene->panel_fills[fill_count]);
+            fill_count++;
+        }
+        dvz_container_iter(&iter);
+    }
+    dvz_workers_group_wait(&group);
+    log_trace("recorded %d/%d panel(s) for image #%d", fill_count, panel_count, img_idx);
 
-            // Go through all visuals in the panel.
-            visual = NULL;
-            for (int priority = -panel->prority_max; priority <= panel->prority_max; priority++)
-            {
-                for (uint32_t k = 0; k < panel->visual_count; k++)
-                {
-                    visual = panel->visuals[k];
-                    if (visual->priority != priority)
-                        continue;
-
-                    dvz_visual_fill_event(
-                        visual, ev.u.rf.clear_color, cmds, img_idx, viewport, NULL);
-                }
-            }
+    // The primary command buffers just execute the panel command buffers.
+    for (uint32_t i = 0; i < ev.u.rf.cmd_count; i++)
+    {
+        cmds = ev.u.rf.cmds[i];
 
-            dvz_container_iter(&iter);
-        }
+        log_trace("scene fill cmd %d begin %d", i, img_idx);
+        dvz_cmd_begin(cmds, img_idx);
+        dvz_cmd_begin_renderpass_secondary(
+            cmds, img_idx, &canvas->renderpass, &canvas->framebuffers);
+        dvz_cmd_execute(cmds, img_idx, panel_count, scene->panel_cmds);
         dvz_visual_fill_end(canvas, cmds, img_idx);
     }
+
+    dvz_event_unlock(canvas);
 }
 
 
@@ -992,6 +1304,7 @@ static void _scene_resize(DvzCanvas* canvas, DvzEvent ev)
     DvzContainerIterator iter = dvz_container_iterator(&grid->panels);
     DvzSceneUpdate up = {0};
     up.canvas = canvas;
+    dvz_event_lock(canvas);
     while (iter.item != NULL)
     {
         panel = iter.item;
@@ -1000,6 +1313,7 @@ static void _scene_resize(DvzCanvas* canvas, DvzEvent ev)
         _process_panel_changed(up);
         dvz_container_iter(&iter);
     }
+    dvz_event_unlock(canvas);
 }
 
 
@@ -1014,11 +1328,48 @@ static void _scene_frame(DvzCanvas* canvas, DvzEvent ev)
     DvzScene* scene = (DvzScene*)ev.user_data;
     ASSERT(scene != NULL);
 
+    // With the scene update thread, the render thread never waits for it.
+    if (scene->is_async)
+    {
+        // The thread is busy: only the interacts are updated, so that the interactivity stays at
+        // the refresh rate while the GPU buffers keep the last uploaded data.
+        if (!dvz_event_trylock(canvas))
+        {
+            _callback_interacts(scene);
+            return;
+        }
+        _callback_controllers(scene);
+
+        // Upload the visuals baked by the thread at the previous frames.
+        _scene_async_commit(scene);
+
+        // Start a new scene update pass if there are pending scene updates. The pass may
+        // reallocate the arrays of the visuals, so it must wait until the uploads of the last
+        // commit have been processed.
+        if (atomic_load(&scene->async_status) == DVZ_SCENE_ASYNC_IDLE &&
+            _has_scene_updates(scene))
+        {
+            if (_scene_async_uploaded(scene))
+                _scene_async_signal(scene, DVZ_SCENE_ASYNC_REQUESTED);
+            else
+                dvz_canvas_redraw(canvas);
+        }
+
+        dvz_event_unlock(canvas);
+        return;
+    }
+
+    // The scene and its visuals may be modified concurrently by async callbacks. The lock is only
+    // held here, so that the other sync FRAME callbacks do not wait for slow async callbacks.
+    dvz_event_lock(canvas);
+
     // Call the controller callbacks of all panels.
     _callback_controllers(scene);
 
     // Process the scene updates.
     _process_scene_updates(scene);
+
+    dvz_event_unlock(canvas);
 }
 
 
@@ -1059,6 +1410,10 @@ static void _upload_mvp(DvzCanvas* canvas, DvzEvent ev)
 
             // IMPORTANT: we **must** update the uniform buffer at every frame.
             dvz_canvas_buffers(canvas, panel->br_mvp, 0, panel->br_mvp.size, &interact->mvp);
+
+            // An ongoing interaction may keep changing the MVP without any input event.
+            if (interact->is_active)
+                dvz_canvas_redraw(canvas);
         }
         dvz_container_iter(&iter);
     }
@@ -10,32 +10,130 @@
 /*  FIFO                                                                                         */
 /*************************************************************************************************/
 
-static void _transfer_enqueue(DvzFifo* fifo, DvzTransfer transfer)
+// Enqueue a transfer. The queue has a fixed capacity: when it is full, the producer processes
+// the pending transfers itself instead of waiting for the next iteration of the event loop.
+static void _transfer_enqueue(DvzContext* context, DvzTransfer transfer)
 {
+    ASSERT(context != NULL);
+    DvzFifo* fifo = &context->transfers;
     ASSERT(fifo->capacity > 0);
-    ASSERT(0 <= fifo->tail && fifo->tail < fifo->capacity);
-    DvzTransfer* tr = (DvzTransfer*)calloc(1, sizeof(DvzTransfer));
-    *tr = transfer;
-    dvz_fifo_enqueue(fifo, tr);
+    ASSERT(fifo->item_size == sizeof(DvzTransfer));
+    while (!dvz_fifo_push(fifo, &transfer))
+    {
+        log_debug("transfer queue is full, processing the pending transfers");
+        dvz_process_transfers(context);
+    }
 }
 
 
 
 static DvzTransfer _transfer_dequeue(DvzFifo* fifo, bool wait)
 {
-    DvzTransfer* item = (DvzTransfer*)dvz_fifo_dequeue(fifo, wait);
-    DvzTransfer out;
-    out.type = DVZ_TRANSFER_NONE;
-    if (item == NULL)
-        return out;
-    ASSERT(item != NULL);
-    out = *item;
-    FREE(item);
+    DvzTransfer out = {0};
+    if (!dvz_fifo_pop(fifo, &out, wait))
+        out.type = DVZ_TRANSFER_NONE;
     return out;
 }
 
 
 
+/*************************************************************************************************/
+/*  Downloads                                                                                    */
+/*************************************************************************************************/
+
+// Make sure the current batch can hold one more download.
+static void _transfer_download_reserve(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    if (batch->download_count[batch->idx] >= DVZ_MAX_TRANSFER_DOWNLOADS)
+        _transfer_batch_submit(context);
+}
+
+
+
+// Register a chunk of a download in the current batch, the data will be copied from the staging
+// buffer once the batch has completed.
+static void _transfer_download_add(
+    DvzContext* context, DvzTransfer tr, VkDeviceSize staging_offset, VkDeviceSize size,
+    void* data, bool is_last)
+{
+    ASSERT(context != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    ASSERT(batch->recording);
+    uint32_t idx = batch->idx;
+    ASSERT(batch->download_count[idx] < DVZ_MAX_TRANSFER_DOWNLOADS);
+
+    DvzTransferDownload* download = &batch->downloads[idx][batch->download_count[idx]++];
+    download->staging_offset = staging_offset;
+    download->size = size;
+    download->data = data;
+
+    download->download_id = tr.download_id;
+    download->is_last = is_last;
+    download->callback = tr.callback;
+    download->user_data = tr.user_data;
+    if (tr.type == DVZ_TRANSFER_TEXTURE_DOWNLOAD)
+    {
+        download->total_size = tr.u.tex.size;
+        download->total_data = tr.u.tex.data;
+    }
+    else
+    {
+        download->total_size = tr.u.buf.size;
+        download->total_data = tr.u.buf.data;
+    }
+
+    // Blocking downloads are completed upon submission of the batch.
+    if (tr.download_id == 0)
+        batch->download_wait = true;
+}
+
+
+
+/*************************************************************************************************/
+/*  Direct writes                                                                                */
+/*************************************************************************************************/
+
+// Whether the CPU may write directly into a host-visible GPU buffer: no frame in flight may be
+// reading the data, and no pending transfer batch may access the same buffer. The caller holds
+// the GPU lock, so that no canvas render thread submits a new frame before the write.
+// NOTE: the frames in flight are not tracked per buffer region, as the command buffers of the
+// canvases bind all the visuals, so the direct writes only happen when the canvases are idle
+// (rendering on demand, or outside of the event loop). The other uploads go through the staging
+// buffer and are ordered after the frames in flight on the GPU.
+static bool _direct_write_safe(DvzContext* context, DvzBuffer* buffer)
+{
+    ASSERT(context != NULL);
+    DvzGpu* gpu = context->gpu;
+    ASSERT(gpu != NULL);
+    DvzApp* app = gpu->app;
+    ASSERT(app != NULL);
+
+    // The uploads to the same buffer must be done in order, and must not overwrite the data read
+    // by a pending copy or download.
+    if (_transfer_batch_busy(context, buffer))
+        return false;
+
+    // Outside of the event loop, there is no frame in flight.
+    if (!app->is_running)
+        return true;
+
+    // Check the frames in flight of all canvases, without waiting.
+    DvzContainerIterator iter = dvz_container_iterator(&app->canvases);
+    DvzCanvas* canvas = NULL;
+    while (iter.item != NULL)
+    {
+        canvas = (DvzCanvas*)iter.item;
+        if (dvz_obj_is_created(&canvas->obj) && !_canvas_frames_done(canvas))
+            return false;
+        dvz_container_iter(&iter);
+    }
+    return true;
+}
+
+
+
 /*************************************************************************************************/
 /*  Buffer transfers                                                                             */
 /*************************************************************************************************/
@@ -57,18 +155,38 @@ static void _process_buffer_upload(DvzContext* context, DvzTransfer tr)
         br.buffer->type != DVZ_BUFFER_TYPE_STAGING &&
         br.buffer->type != DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE);
 
-    // Take the staging buffer and ensure it is big enough.
-    DvzBuffer* staging = staging_buffer(context, tr.u.buf.size);
+    // Host-visible device-local buffers are written directly when the GPU does not use them.
+    // Otherwise, the upload goes through the staging buffer, which orders it after the frames in
+    // flight.
+    if (br.buffer->mmap != NULL && _direct_write_safe(context, br.buffer))
+    {
+        log_trace("direct write of %s", pretty_size(tr.u.buf.size));
+        dvz_buffer_upload(
+            br.buffer, br.offsets[0] + tr.u.buf.offset, tr.u.buf.size, tr.u.buf.data);
+        return;
+    }
 
-    // Memcpy into the staging buffer.
-    dvz_buffer_upload(staging, 0, tr.u.buf.size, tr.u.buf.data);
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
+    ASSERT(staging != NULL);
 
-    // Copy from the staging buffer to the target buffer.
-    _copy_buffer_from_staging(context, tr.u.buf.regions, tr.u.buf.offset, tr.u.buf.size);
+    // Large transfers are split into several chunks.
+    VkDeviceSize chunk_size = _transfer_chunk_size(context);
+    VkDeviceSize staging_offset = 0, size = 0;
+    for (VkDeviceSize done = 0; done < tr.u.buf.size; done += size)
+    {
+        size = MIN(chunk_size, tr.u.buf.size - done);
+
+        // Reserve some space in the staging buffer for the current transfer batch.
+        staging_offset = _transfer_batch_staging(context, size);
+
+        // Memcpy into the staging buffer.
+        dvz_buffer_upload(
+            staging, staging_offset, size, (const void*)((uint64_t)tr.u.buf.data + done));
 
-    // IMPORTANT: need to wait for the texture to be copied to the staging buffer, *before*
-    // downloading the data from the staging buffer.
-    dvz_queue_wait(context->gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+        // Record the copy from the staging buffer to the target buffer.
+        _copy_buffer_from_staging(
+            context, tr.u.buf.regions, tr.u.buf.offset + done, staging_offset, size);
+    }
 }
 
 
@@ -88,18 +206,26 @@ static void _process_buffer_download(DvzContext* context, DvzTransfer tr)
         br.buffer->type != DVZ_BUFFER_TYPE_STAGING &&
         br.buffer->type != DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE);
 
-    // Take the staging buffer and ensure it is big enough.
-    DvzBuffer* staging = staging_buffer(context, tr.u.buf.size);
+    // Large transfers are split into several chunks.
+    VkDeviceSize chunk_size = _transfer_chunk_size(context);
+    VkDeviceSize staging_offset = 0, size = 0;
+    for (VkDeviceSize done = 0; done < tr.u.buf.size; done += size)
+    {
+        size = MIN(chunk_size, tr.u.buf.size - done);
+        _transfer_download_reserve(context);
 
-    // Copy from the source buffer to the staging buffer.
-    _copy_buffer_to_staging(context, tr.u.buf.regions, tr.u.buf.offset, tr.u.buf.size);
+        // Reserve some space in the staging buffer for the current transfer batch.
+        staging_offset = _transfer_batch_staging(context, size);
 
-    // IMPORTANT: need to wait for the texture to be copied to the staging buffer, *before*
-    // downloading the data from the staging buffer.
-    dvz_queue_wait(context->gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+        // Record the copy from the source buffer to the staging buffer.
+        _copy_buffer_to_staging(
+            context, tr.u.buf.regions, tr.u.buf.offset + done, staging_offset, size);
 
-    // Memcpy into the staging buffer.
-    dvz_buffer_download(staging, 0, tr.u.buf.size, tr.u.buf.data);
+        // The data will be copied from the staging buffer once the batch has completed.
+        _transfer_download_add(
+            context, tr, staging_offset, size, (void*)((uint64_t)tr.u.buf.data + done),
+            done + size == tr.u.buf.size);
+    }
 }
 
 
@@ -112,12 +238,29 @@ static void _process_buffer_copy(DvzContext* context, DvzTransfer tr)
     DvzBufferRegions* src = &tr.u.buf_copy.src;
     DvzBufferRegions* dst = &tr.u.buf_copy.dst;
     ASSERT(src->count == dst->count);
+    ASSERT(src->count <= DVZ_MAX_BUFFER_REGIONS_PER_SET);
 
     VkDeviceSize size = tr.u.buf_copy.size;
     VkDeviceSize src_offset = tr.u.buf_copy.src_offset;
     VkDeviceSize dst_offset = tr.u.buf_copy.dst_offset;
 
-    dvz_buffer_regions_copy(src, src_offset, dst, dst_offset, size);
+    // Record the copy in the current transfer batch, after the pending uploads.
+    DvzCommands* cmds = _transfer_batch_begin(context);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    _transfer_copies_flush(context);
+    VkBufferCopy regions[DVZ_MAX_BUFFER_REGIONS_PER_SET] = {0};
+    for (uint32_t i = 0; i < src->count; i++)
+    {
+        regions[i].size = size;
+        regions[i].srcOffset = src->offsets[i] + src_offset;
+        regions[i].dstOffset = dst->offsets[i] + dst_offset;
+    }
+    vkCmdCopyBuffer(
+        cmds->cmds[batch->idx], src->buffer->buffer, dst->buffer->buffer, src->count, regions);
+    _transfer_batch_use(context, src->buffer);
+    _transfer_batch_use(context, dst->buffer);
+    _transfer_barrier(context);
+    batch->count++;
 }
 
 
@@ -126,36 +269,156 @@ static void _process_buffer_copy(DvzContext* context, DvzTransfer tr)
 /*  Texture transfers                                                                            */
 /*************************************************************************************************/
 
+// Process a texture transfer by chunks fitting in the staging buffer: groups of whole layers or
+// rows, or parts of a single row if it does not fit. The chunks are contiguous in the
+// tightly-packed host data, in order.
+typedef void (*DvzTextureChunkCallback)(
+    DvzContext* context, DvzTransfer* tr, uvec3 offset, uvec3 shape, VkDeviceSize data_offset,
+    VkDeviceSize size, VkDeviceSize alignment, bool is_last);
+
+static void _texture_chunks(DvzContext* context, DvzTransfer* tr, DvzTextureChunkCallback callback)
+{
+    ASSERT(context != NULL);
+    ASSERT(tr != NULL);
+    ASSERT(callback != NULL);
+
+    uint32_t w = tr->u.tex.shape[0], h = tr->u.tex.shape[1], d = tr->u.tex.shape[2];
+    VkDeviceSize count = (VkDeviceSize)w * h * d;
+    ASSERT(count > 0);
+    VkDeviceSize texel = tr->u.tex.size / count;
+    ASSERT(texel > 0);
+    ASSERT(texel * count == tr->u.tex.size);
+
+    // The staging offsets must be a multiple of the texel size.
+    VkDeviceSize alignment = DVZ_TRANSFER_ALIGNMENT;
+    while (alignment % texel != 0)
+        alignment += DVZ_TRANSFER_ALIGNMENT;
+
+    // Number of texels along each axis in a chunk.
+    VkDeviceSize chunk_size = _transfer_chunk_size(context);
+    VkDeviceSize row = texel * w, layer = row * h;
+    uint32_t nx = w, ny = h, nz = 1;
+    if (layer <= chunk_size)
+        nz = (uint32_t)MIN(d, chunk_size / layer);
+    else if (row <= chunk_size)
+        ny = (uint32_t)(chunk_size / row);
+    else
+    {
+        ny = 1;
+        nx = (uint32_t)(chunk_size / texel);
+    }
+    ASSERT(nx > 0 && ny > 0 && nz > 0);
+
+    uvec3 offset = {0}, shape = {0};
+    VkDeviceSize data_offset = 0, size = 0;
+    for (uint32_t z = 0; z < d; z += nz)
+    {
+        for (uint32_t y = 0; y < h; y += ny)
+        {
+            for (uint32_t x = 0; x < w; x += nx)
+            {
+                shape[0] = MIN(nx, w - x);
+                shape[1] = MIN(ny, h - y);
+                shape[2] = MIN(nz, d - z);
+                offset[0] = tr->u.tex.offset[0] + x;
+                offset[1] = tr->u.tex.offset[1] + y;
+                offset[2] = tr->u.tex.offset[2] + z;
+                data_offset = (((VkDeviceSize)z * h + y) * w + x) * texel;
+                size = (VkDeviceSize)shape[0] * shape[1] * shape[2] * texel;
+                callback(
+                    context, tr, offset, shape, data_offset, size, alignment,
+                    data_offset + size == tr->u.tex.size);
+            }
+        }
+    }
+}
+
+
+
+static void _texture_upload_chunk(
+    DvzContext* context, DvzTransfer* tr, uvec3 offset, uvec3 shape, VkDeviceSize data_offset,
+    VkDeviceSize size, VkDeviceSize alignment, bool is_last)
+{
+    ASSERT(context != NULL);
+    ASSERT(tr != NULL);
+
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&context->buffers, DVZ_BUFFER_TYPE_STAGING);
+    ASSERT(staging != NULL);
+
+    // Reserve some space in the staging buffer for the current transfer batch.
+    VkDeviceSize staging_offset = _transfer_batch_staging_aligned(context, size, alignment);
+
+    // Memcpy into the staging buffer.
+    dvz_buffer_upload(
+        staging, staging_offset, size, (const void*)((uint64_t)tr->u.tex.data + data_offset));
+
+    // Record the copy from the staging buffer to the texture.
+    _copy_texture_from_staging_async(context, tr->u.tex.texture, offset, shape, staging_offset);
+}
+
+
+
+static void _texture_download_chunk(
+    DvzContext* context, DvzTransfer* tr, uvec3 offset, uvec3 shape, VkDeviceSize data_offset,
+    VkDeviceSize size, VkDeviceSize alignment, bool is_last)
+{
+    ASSERT(context != NULL);
+    ASSERT(tr != NULL);
+
+    _transfer_download_reserve(context);
+
+    // Reserve some space in the staging buffer for the current transfer batch.
+    VkDeviceSize staging_offset = _transfer_batch_staging_aligned(context, size, alignment);
+
+    // Record the copy from the texture to the staging buffer.
+    _copy_texture_to_staging_async(context, tr->u.tex.texture, offset, shape, staging_offset);
+
+    // The data will be copied from the staging buffer once the batch has completed.
+    _transfer_download_add(
+        context, *tr, staging_offset, size, (void*)((uint64_t)tr->u.tex.data + data_offset),
+        is_last);
+}
+
+
+
+// Record a texture upload in the current transfer batch.
 static void _process_texture_upload(DvzContext* context, DvzTransfer tr)
 {
     ASSERT(context != NULL);
     ASSERT(tr.type == DVZ_TRANSFER_TEXTURE_UPLOAD);
+    ASSERT(tr.u.tex.texture != NULL);
+    ASSERT(tr.u.tex.data != NULL);
+    ASSERT(tr.u.tex.size > 0);
 
-    dvz_texture_upload(
-        tr.u.tex.texture, tr.u.tex.offset, tr.u.tex.shape, tr.u.tex.size, tr.u.tex.data);
+    _texture_chunks(context, &tr, _texture_upload_chunk);
 }
 
 
 
+// Record a texture download in the current transfer batch. Blocking downloads (without download
+// id) only wait for the completion of this batch when it is submitted.
 static void _process_texture_download(DvzContext* context, DvzTransfer tr)
 {
     ASSERT(context != NULL);
     ASSERT(tr.type == DVZ_TRANSFER_TEXTURE_DOWNLOAD);
+    ASSERT(tr.u.tex.texture != NULL);
+    ASSERT(tr.u.tex.data != NULL);
+    ASSERT(tr.u.tex.size > 0);
 
-    dvz_texture_download(
-        tr.u.tex.texture, tr.u.tex.offset, tr.u.tex.shape, tr.u.tex.size, tr.u.tex.data);
+    _texture_chunks(context, &tr, _texture_download_chunk);
 }
 
 
 
+// Record a texture copy in the current transfer batch.
 static void _process_texture_copy(DvzContext* context, DvzTransfer tr)
 {
     ASSERT(context != NULL);
     ASSERT(tr.type == DVZ_TRANSFER_TEXTURE_COPY);
 
-    dvz_texture_copy(
-        tr.u.tex_copy.src, tr.u.tex_copy.src_offset, tr.u.tex_copy.dst, tr.u.tex_copy.dst_offset,
-        tr.u.tex_copy.shape);
+    _copy_texture_async(
+        context, tr.u.tex_copy.src, tr.u.tex_copy.src_offset, tr.u.tex_copy.dst,
+        tr.u.tex_copy.dst_offset, tr.u.tex_copy.shape);
 }
 
 
@@ -166,25 +429,50 @@ static void _process_texture_copy(DvzContext* context, DvzTransfer tr)
 
 void dvz_process_transfers(DvzContext* context)
 {
-    // WARNING: comment below OBSOLETE.
-
-    // This function is to be called at every frame, after the FRAME callbacks (so that FRAME
-    // callbacks calling dvz_upload_buffer() have their transfers processed immediately in the
-    // same frame), but before queue submit, so that we may get a chance to ask for a command
-    // buffer refill before submission (if a transfer requires a refill, e.g. after a vertex buffer
-    // count change)
+    // This function is called once per iteration of the main loop, after all canvases have
+    // submitted their rendering commands (except the canvases rendering in their own thread,
+    // which submit their frames independently). The transfers are recorded into a single command
+    // buffer submitted to the render queue, which orders them after the current frames and before
+    // the next frames on the GPU, without stalling the CPU.
 
     ASSERT(context != NULL);
     DvzGpu* gpu = context->gpu;
     ASSERT(gpu != NULL);
 
+    // The GPU lock protects the shared command pool of the transfer batches, and prevents the
+    // canvas render threads from submitting frames while the transfers are being processed.
+    dvz_gpu_lock(gpu);
     DvzFifo* fifo = &context->transfers;
+    DvzTransferRelease* releases = NULL;
+    uint32_t release_count = 0;
+    DvzTransferDownload* downloads = NULL;
+    uint32_t download_count = 0;
+
+    // A nested call (when a producer waits for space in the queue) may happen while a transfer
+    // of the outer call is still being copied, so only the outer call releases the data.
+    bool nested = fifo->is_processing;
+    if (!nested)
+        atomic_fetch_add(&context->transfer_passes_started, 1);
+
+    // Complete the asynchronous downloads of the batches that have been executed since the last
+    // call, and destroy the old buffers that are not used anymore.
+    _transfer_batch_reclaim(context);
+    _deferred_buffers_destroy(context, false);
+
     // Do nothing if there are no pending transfers.
     if (fifo->is_empty)
+    {
+        if (!nested)
+        {
+            releases = _deferred_releases_take(context, &release_count);
+            downloads = _download_callbacks_take(context, &download_count);
+            atomic_fetch_add(&context->transfer_passes_done, 1);
+        }
+        dvz_gpu_unlock(gpu);
+        _deferred_releases_run(releases, release_count);
+        _download_callbacks_run(context, downloads, download_count);
         return;
-
-    // NOTE: wait until all render tasks have finished.
-    dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_RENDER);
+    }
 
     // Process all pending transfer tasks.
     DvzTransfer tr = {0};
@@ -195,7 +483,7 @@ void dvz_process_transfers(DvzContext* context)
             break;
         fifo->is_processing = true;
 
-        // Process buffer transfers.
+        // Process buffer transfers, recorded in the current transfer batch.
         if (tr.type == DVZ_TRANSFER_BUFFER_UPLOAD)
             _process_buffer_upload(context, tr);
         if (tr.type == DVZ_TRANSFER_BUFFER_DOWNLOAD)
@@ -203,7 +491,7 @@ void dvz_process_transfers(DvzContext* context)
         if (tr.type == DVZ_TRANSFER_BUFFER_COPY)
             _process_buffer_copy(context, tr);
 
-        // Process texture transfers.
+        // Process texture transfers, also recorded in the current transfer batch.
         if (tr.type == DVZ_TRANSFER_TEXTURE_UPLOAD)
             _process_texture_upload(context, tr);
         if (tr.type == DVZ_TRANSFER_TEXTURE_DOWNLOAD)
@@ -211,11 +499,60 @@ void dvz_process_transfers(DvzContext* context)
         if (tr.type == DVZ_TRANSFER_TEXTURE_COPY)
             _process_texture_copy(context, tr);
 
-        fifo->is_processing = false;
+        fifo->is_processing = nested;
+    }
+
+    // Submit the pending transfers. This only blocks if there are pending downloads.
+    _transfer_batch_submit(context);
+
+    // Outside of the event loop, the transfers are synchronous.
+    if (!gpu->app->is_running)
+    {
+        _transfer_batch_wait(context);
+        _deferred_buffers_destroy(context, true);
+    }
+
+    // All the data enqueued before the release requests has been copied by now.
+    // The download callbacks are called without the GPU lock, and outside of the transfer
+    // processing, as they may enqueue and process new transfers.
+    if (!nested)
+    {
+        releases = _deferred_releases_take(context, &release_count);
+        downloads = _download_callbacks_take(context, &download_count);
+        atomic_fetch_add(&context->transfer_passes_done, 1);
+    }
+    dvz_gpu_unlock(gpu);
+    _deferred_releases_run(releases, release_count);
+    _download_callbacks_run(context, downloads, download_count);
+}
+
+
+
+void dvz_upload_release(
+    DvzContext* context, void* data, DvzDataReleaseCallback release, void* user_data)
+{
+    ASSERT(context != NULL);
+    if (release == NULL)
+        return;
+
+    // Outside of the event loop, the uploads have already been processed.
+    if (!context->gpu->app->is_running)
+    {
+        release(data, user_data);
+        return;
     }
 
-    // NOTE: wait until all transfer tasks have finished.
-    dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
+    // The release requests are protected by the GPU lock, held while the transfers are processed.
+    dvz_gpu_lock(context->gpu);
+    if (context->release_count >= context->release_capacity)
+    {
+        context->release_capacity = MAX(16, 2 * context->release_capacity);
+        REALLOC(context->releases, context->release_capacity * sizeof(DvzTransferRelease));
+    }
+    ASSERT(context->release_count < context->release_capacity);
+    context->releases[context->release_count++] =
+        (DvzTransferRelease){.data = data, .release = release, .user_data = user_data};
+    dvz_gpu_unlock(context->gpu);
 }
 
 
@@ -224,7 +561,7 @@ void dvz_process_transfers(DvzContext* context)
 /*  Canvas buffer transfers                                                                      */
 /*************************************************************************************************/
 
-static void _enqueue_buffer_transfer(
+static DvzTransfer _buffer_transfer(
     DvzContext* context, DvzDataTransferType type, DvzBufferRegions br, //
     VkDeviceSize offset, VkDeviceSize size, void* data)
 {
@@ -243,8 +580,17 @@ static void _enqueue_buffer_transfer(
     tr.u.buf.offset = offset;
     tr.u.buf.size = size;
     tr.u.buf.data = data;
+    return tr;
+}
+
+
 
-    _transfer_enqueue(&context->transfers, tr);
+static void _enqueue_buffer_transfer(
+    DvzContext* context, DvzDataTransferType type, DvzBufferRegions br, //
+    VkDeviceSize offset, VkDeviceSize size, void* data)
+{
+    DvzTransfer tr = _buffer_transfer(context, type, br, offset, size, data);
+    _transfer_enqueue(context, tr);
 }
 
 
@@ -272,6 +618,28 @@ void dvz_download_buffer(
 
 
 
+uint64_t dvz_download_buffer_async(
+    DvzContext* context, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize size, void* data,
+    DvzDownloadCallback callback, void* user_data)
+{
+    DvzTransfer tr =
+        _buffer_transfer(context, DVZ_TRANSFER_BUFFER_DOWNLOAD, br, offset, size, data);
+    dvz_gpu_lock(context->gpu);
+    tr.download_id = ++context->transfer_batch.download_next;
+    dvz_gpu_unlock(context->gpu);
+    tr.callback = callback;
+    tr.user_data = user_data;
+    _transfer_enqueue(context, tr);
+
+    // Outside of the event loop, the download completes before this function returns.
+    if (!context->gpu->app->is_running)
+        dvz_process_transfers(context);
+
+    return tr.download_id;
+}
+
+
+
 void dvz_copy_buffer(
     DvzContext* context, DvzBufferRegions src, VkDeviceSize src_offset, //
     DvzBufferRegions dst, VkDeviceSize dst_offset, VkDeviceSize size)
@@ -294,7 +662,7 @@ void dvz_copy_buffer(
     tr.u.buf_copy.dst_offset = dst_offset;
     tr.u.buf_copy.size = size;
 
-    _transfer_enqueue(&context->transfers, tr);
+    _transfer_enqueue(context, tr);
 
     if (!context->gpu->app->is_running)
         dvz_process_transfers(context);
@@ -306,7 +674,7 @@ void dvz_copy_buffer(
 /*  Canvas texture transfers                                                                     */
 /*************************************************************************************************/
 
-static void _enqueue_texture_transfer(
+static DvzTransfer _texture_transfer(
     DvzContext* context, DvzDataTransferType type, DvzTexture* texture, //
     uvec3 offset, uvec3 shape, VkDeviceSize size, void* data)
 {
@@ -338,7 +706,17 @@ static void _enqueue_texture_transfer(
     tr.u.tex.data = data;
     tr.u.tex.texture = texture;
 
-    _transfer_enqueue(&context->transfers, tr);
+    return tr;
+}
+
+
+
+static void _enqueue_texture_transfer(
+    DvzContext* context, DvzDataTransferType type, DvzTexture* texture, //
+    uvec3 offset, uvec3 shape, VkDeviceSize size, void* data)
+{
+    DvzTransfer tr = _texture_transfer(context, type, texture, offset, shape, size, data);
+    _transfer_enqueue(context, tr);
 }
 
 
@@ -369,6 +747,31 @@ void dvz_download_texture(
 
 
 
+uint64_t dvz_download_texture_async(
+    DvzContext* context, DvzTexture* texture, uvec3 offset, uvec3 shape, VkDeviceSize size,
+    void* data, DvzDownloadCallback callback, void* user_data)
+{
+    ASSERT(context != NULL);
+    dvz_gpu_lock(context->gpu);
+    uint64_t download_id = ++context->transfer_batch.download_next;
+    dvz_gpu_unlock(context->gpu);
+
+    DvzTransfer tr = _texture_transfer(
+        context, DVZ_TRANSFER_TEXTURE_DOWNLOAD, texture, offset, shape, size, data);
+    tr.download_id = download_id;
+    tr.callback = callback;
+    tr.user_data = user_data;
+    _transfer_enqueue(context, tr);
+
+    // Outside of the event loop, the download completes before this function returns.
+    if (!context->gpu->app->is_running)
+        dvz_process_transfers(context);
+
+    return download_id;
+}
+
+
+
 void dvz_copy_texture(
     DvzContext* context, DvzTexture* src, uvec3 src_offset, DvzTexture* dst, uvec3 dst_offset,
     uvec3 shape, VkDeviceSize size)
@@ -392,8 +795,53 @@ void dvz_copy_texture(
     memcpy(tr.u.tex_copy.dst_offset, dst_offset, sizeof(uvec3));
     memcpy(tr.u.tex_copy.shape, shape, sizeof(uvec3));
 
-    _transfer_enqueue(&context->transfers, tr);
+    _transfer_enqueue(context, tr);
 
     if (!context->gpu->app->is_running)
         dvz_process_transfers(context);
 }
+
+
+
+/*************************************************************************************************/
+/*  Download status                                                                              */
+/*************************************************************************************************/
+
+bool dvz_download_done(DvzContext* context, uint64_t download_id)
+{
+    ASSERT(context != NULL);
+    ASSERT(context->gpu != NULL);
+    DvzTransferBatch* batch = &context->transfer_batch;
+    if (download_id == 0 || download_id > batch->download_next)
+        return false;
+
+    // The GPU lock is held while the transfers are dequeued and recorded in the batches, and while
+    // the downloads are completed, so that the download is found in one of these places until its
+    // data has been copied.
+    dvz_gpu_lock(context->gpu);
+
+    // The download may still be in the transfer queue.
+    DvzFifo* fifo = &context->transfers;
+    bool pending = false;
+    DvzTransfer* tr = NULL;
+    pthread_mutex_lock(&fifo->lock);
+    int32_t size = fifo->tail - fifo->head;
+    if (size < 0)
+        size += fifo->capacity;
+    for (int32_t i = 0; i < size && !pending; i++)
+    {
+        tr = (DvzTransfer*)dvz_fifo_peek(fifo, i);
+        pending = tr != NULL && tr->download_id == download_id;
+    }
+    pthread_mutex_unlock(&fifo->lock);
+
+    // Or in a transfer batch that has not completed yet.
+    for (uint32_t slot = 0; slot < DVZ_MAX_TRANSFER_BATCHES && !pending; slot++)
+    {
+        for (uint32_t i = 0; i < batch->download_count[slot] && !pending; i++)
+            pending = batch->downloads[slot][i].download_id == download_id;
+    }
+
+    dvz_gpu_unlock(context->gpu);
+    return !pending;
+}
@@ -135,6 +135,11 @@ static void _line_strip_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
     // Number of line strips.
     uint32_t n_strips = arr_length->item_count;
+    if (n_strips >= 2 && visual->stream.capacity > 0)
+    {
+        log_warn("multiple line strips are not supported in streaming mode");
+        n_strips = 1;
+    }
 
     if (n_strips >= 2)
     {
@@ -364,9 +369,12 @@ static void _rectangle_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
     // First, we obtain the array instances holding the prop data as specified by the user.
     DvzArray* arr_p0 = dvz_prop_array(visual, DVZ_PROP_POS, 0);
-    DvzArray* arr_p1 = dvz_prop_array(visual, DVZ_PROP_POS, 1);
     DvzArray* arr_color = dvz_prop_array(visual, DVZ_PROP_COLOR, 0);
 
+    // The positions are in double precision, we cast them all at once to single precision.
+    DvzArray arr_p0_f = _prop_pos_cast(visual, dvz_prop_get(visual, DVZ_PROP_POS, 0));
+    DvzArray arr_p1_f = _prop_pos_cast(visual, dvz_prop_get(visual, DVZ_PROP_POS, 1));
+
     // We also get the array of the vertex buffer, which we'll need to fill with the triangulation.
     DvzArray* arr_vertex = dvz_source_array(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
 
@@ -379,8 +387,8 @@ static void _rectangle_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     dvz_array_resize(arr_vertex, 6 * rectangle_count);
 
     // Pointers to the input data.
-    dvec3* p0 = NULL;
-    dvec3* p1 = NULL;
+    vec3* p0 = NULL;
+    vec3* p1 = NULL;
     cvec4* color = NULL;
 
     // Pointer to the output vertex.
@@ -390,8 +398,8 @@ static void _rectangle_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     for (uint32_t i = 0; i < rectangle_count; i++)
     {
         // We get a pointer to the current item in each prop array.
-        p0 = dvz_array_item(arr_p0, i);
-        p1 = dvz_array_item(arr_p1, i);
+        p0 = dvz_array_item(&arr_p0_f, i);
+        p1 = dvz_array_item(&arr_p1_f, i);
         color = dvz_array_item(arr_color, i);
 
         // First triangle:
@@ -428,6 +436,9 @@ static void _rectangle_bake(DvzVisual* visual, DvzVisualDataEvent ev)
         for (uint32_t j = 0; j < 6; j++)
             memcpy(vertex[6 * i + j].color, color, sizeof(cvec4));
     }
+
+    dvz_array_destroy(&arr_p0_f);
+    dvz_array_destroy(&arr_p1_f);
 }
 
 static void _visual_rectangle(DvzVisual* visual)
@@ -764,7 +775,6 @@ static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     ASSERT(n_points > 0);
     ASSERT(n_paths > 0);
 
-    dvec3* point = NULL;
     cvec4* color = NULL;
     uint32_t* path_length = NULL;
     int32_t* is_closed = NULL;
@@ -774,6 +784,10 @@ static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     // Copy the positions from the pos prop to the vertex buffer.
     _prop_copy(visual, prop_pos);
 
+    // Cast all positions to single precision at once, as each point is used by 4 vertices.
+    DvzArray arr_pos_f = _prop_pos_cast(visual, prop_pos);
+    vec3* pos = (vec3*)arr_pos_f.data;
+
     // Graphics data.
     DvzGraphicsData data = dvz_graphics_data(visual->graphics[0], arr_vertex, NULL, NULL);
     dvz_graphics_alloc(&data, n_points_tot);
@@ -797,12 +811,10 @@ static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
         // Add join point at the beginning of each path.
         {
-            point = dvz_array_item(arr_pos, (uint32_t)idx);
-
-            _vec3_cast((const dvec3*)point, &item.p0);
-            _vec3_cast((const dvec3*)point, &item.p1);
-            _vec3_cast((const dvec3*)point, &item.p2);
-            _vec3_cast((const dvec3*)point, &item.p3);
+            _vec3_copy(pos[idx], item.p0);
+            _vec3_copy(pos[idx], item.p1);
+            _vec3_copy(pos[idx], item.p2);
+            _vec3_copy(pos[idx], item.p3);
 
             memset(item.color, 0, sizeof(cvec4));
 
@@ -836,17 +848,10 @@ static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
             ASSERT(0 <= j2 && j2 < path_size);
             ASSERT(0 <= j3 && j3 < path_size);
 
-            point = dvz_array_item(arr_pos, (uint32_t)(idx + j0));
-            _vec3_cast((const dvec3*)point, &item.p0);
-
-            point = dvz_array_item(arr_pos, (uint32_t)(idx + j1));
-            _vec3_cast((const dvec3*)point, &item.p1);
-
-            point = dvz_array_item(arr_pos, (uint32_t)(idx + j2));
-            _vec3_cast((const dvec3*)point, &item.p2);
-
-            point = dvz_array_item(arr_pos, (uint32_t)(idx + j3));
-            _vec3_cast((const dvec3*)point, &item.p3);
+            _vec3_copy(pos[idx + j0], item.p0);
+            _vec3_copy(pos[idx + j1], item.p1);
+            _vec3_copy(pos[idx + j2], item.p2);
+            _vec3_copy(pos[idx + j3], item.p3);
 
             color = dvz_array_item(arr_color, (uint32_t)(idx + j1));
             memcpy(item.color, color, sizeof(cvec4));
@@ -856,12 +861,10 @@ static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
         // Add join point at the end of each path.
         {
-            point = dvz_array_item(arr_pos, (uint32_t)(idx + path_size - 1));
-
-            _vec3_cast((const dvec3*)point, &item.p0);
-            _vec3_cast((const dvec3*)point, &item.p1);
-            _vec3_cast((const dvec3*)point, &item.p2);
-            _vec3_cast((const dvec3*)point, &item.p3);
+            _vec3_copy(pos[idx + path_size - 1], item.p0);
+            _vec3_copy(pos[idx + path_size - 1], item.p1);
+            _vec3_copy(pos[idx + path_size - 1], item.p2);
+            _vec3_copy(pos[idx + path_size - 1], item.p3);
 
             memset(item.color, 0, sizeof(cvec4));
 
@@ -871,6 +874,7 @@ static void _path_bake(DvzVisual* visual, DvzVisualDataEvent ev)
         idx += path_size;
     }
     ASSERT(idx == (int32_t)n_points);
+    dvz_array_destroy(&arr_pos_f);
 }
 
 static void _visual_path(DvzVisual* visual)
@@ -962,7 +966,6 @@ static void _text_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     DvzProp* prop_anchor = dvz_prop_get(visual, DVZ_PROP_ANCHOR, 0);  // vec2
     DvzProp* prop_angle = dvz_prop_get(visual, DVZ_PROP_ANGLE, 0);    // float
 
-    DvzArray* arr_pos = _prop_array(prop_pos, DVZ_PROP_ARRAY_DEFAULT);
     DvzArray* arr_text = _prop_array(prop_text, DVZ_PROP_ARRAY_DEFAULT);
     DvzArray* arr_glyph = _prop_array(prop_glyph, DVZ_PROP_ARRAY_DEFAULT);
     DvzArray* arr_length = _prop_array(prop_length, DVZ_PROP_ARRAY_DEFAULT);
@@ -1032,6 +1035,9 @@ static void _text_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     DvzGraphicsData data = dvz_graphics_data(visual->graphics[0], arr_vertex, NULL, NULL);
     dvz_graphics_alloc(&data, n_chars);
 
+    // Cast the string positions to single precision.
+    DvzArray arr_pos_f = _prop_pos_cast(visual, prop_pos);
+
     DvzGraphicsTextItem item = {0};
     // Add all of the strings.
     cvec4* colors = calloc(n_chars, sizeof(cvec4));
@@ -1060,7 +1066,7 @@ static void _text_bake(DvzVisual* visual, DvzVisualDataEvent ev)
         item.font_size = *(float*)dvz_array_item(arr_size, i);
 
         // String position.
-        _vec3_cast(dvz_array_item(arr_pos, i), &item.vertex.pos);
+        _vec3_copy(*(vec3*)dvz_array_item(&arr_pos_f, i), item.vertex.pos);
         // Anchor.
         memcpy(item.vertex.anchor, dvz_array_item(arr_anchor, i), sizeof(vec2));
 
@@ -1078,6 +1084,7 @@ static void _text_bake(DvzVisual* visual, DvzVisualDataEvent ev)
         dvz_graphics_append(&data, &item);
     }
     FREE(colors);
+    dvz_array_destroy(&arr_pos_f);
 }
 
 static void _visual_text(DvzVisual* visual)
@@ -1215,13 +1222,18 @@ static void _visual_image_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     DvzGraphicsData data = dvz_graphics_data(visual->graphics[0], &source->arr, NULL, NULL);
     dvz_graphics_alloc(&data, img_count);
 
+    // Cast the positions to single precision.
+    DvzArray pos_f[] = {
+        _prop_pos_cast(visual, pos0), _prop_pos_cast(visual, pos1), //
+        _prop_pos_cast(visual, pos2), _prop_pos_cast(visual, pos3)};
+
     DvzGraphicsImageItem item = {0};
     for (uint32_t i = 0; i < img_count; i++)
     {
-        _vec3_cast((const dvec3*)dvz_prop_item(pos0, i), &item.pos0);
-        _vec3_cast((const dvec3*)dvz_prop_item(pos1, i), &item.pos1);
-        _vec3_cast((const dvec3*)dvz_prop_item(pos2, i), &item.pos2);
-        _vec3_cast((const dvec3*)dvz_prop_item(pos3, i), &item.pos3);
+        _vec3_copy(((vec3*)pos_f[0].data)[i], item.pos0);
+        _vec3_copy(((vec3*)pos_f[1].data)[i], item.pos1);
+        _vec3_copy(((vec3*)pos_f[2].data)[i], item.pos2);
+        _vec3_copy(((vec3*)pos_f[3].data)[i], item.pos3);
 
         memcpy(&item.uv0, dvz_prop_item(uv0, i), sizeof(vec2));
         memcpy(&item.uv1, dvz_prop_item(uv1, i), sizeof(vec2));
@@ -1230,6 +1242,8 @@ static void _visual_image_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
         dvz_graphics_append(&data, &item);
     }
+    for (uint32_t k = 0; k < 4; k++)
+        dvz_array_destroy(&pos_f[k]);
 }
 
 static void _visual_image(DvzVisual* visual)
@@ -1990,14 +2004,19 @@ static void _visual_volume_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     DvzGraphicsData data = dvz_graphics_data(visual->graphics[0], &source->arr, NULL, NULL);
     dvz_graphics_alloc(&data, img_count);
 
+    // Cast the positions to single precision.
+    DvzArray pos_f[] = {_prop_pos_cast(visual, pos0), _prop_pos_cast(visual, pos1)};
+
     DvzGraphicsVolumeItem item = {0};
     for (uint32_t i = 0; i < img_count; i++)
     {
-        _vec3_cast((const dvec3*)dvz_prop_item(pos0, i), &item.pos0);
-        _vec3_cast((const dvec3*)dvz_prop_item(pos1, i), &item.pos1);
+        _vec3_copy(((vec3*)pos_f[0].data)[i], item.pos0);
+        _vec3_copy(((vec3*)pos_f[1].data)[i], item.pos1);
 
         dvz_graphics_append(&data, &item);
     }
+    for (uint32_t k = 0; k < 2; k++)
+        dvz_array_destroy(&pos_f[k]);
 }
 
 static void _visual_volume(DvzVisual* visual)
@@ -2149,13 +2168,18 @@ static void _visual_volume_slice_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     DvzGraphicsData data = dvz_graphics_data(visual->graphics[0], &source->arr, NULL, NULL);
     dvz_graphics_alloc(&data, img_count);
 
+    // Cast the positions to single precision.
+    DvzArray pos_f[] = {
+        _prop_pos_cast(visual, pos0), _prop_pos_cast(visual, pos1), //
+        _prop_pos_cast(visual, pos2), _prop_pos_cast(visual, pos3)};
+
     DvzGraphicsVolumeSliceItem item = {0};
     for (uint32_t i = 0; i < img_count; i++)
     {
-        _vec3_cast((const dvec3*)dvz_prop_item(pos0, i), &item.pos0);
-        _vec3_cast((const dvec3*)dvz_prop_item(pos1, i), &item.pos1);
-        _vec3_cast((const dvec3*)dvz_prop_item(pos2, i), &item.pos2);
-        _vec3_cast((const dvec3*)dvz_prop_item(pos3, i), &item.pos3);
+        _vec3_copy(((vec3*)pos_f[0].data)[i], item.pos0);
+        _vec3_copy(((vec3*)pos_f[1].data)[i], item.pos1);
+        _vec3_copy(((vec3*)pos_f[2].data)[i], item.pos2);
+        _vec3_copy(((vec3*)pos_f[3].data)[i], item.pos3);
 
         // memcpy(&item.pos0, dvz_prop_item(pos0, i), sizeof(vec3));
         // memcpy(&item.pos1, dvz_prop_item(pos1, i), sizeof(vec3));
@@ -2169,6 +2193,8 @@ static void _visual_volume_slice_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
         dvz_graphics_append(&data, &item);
     }
+    for (uint32_t k = 0; k < 4; k++)
+        dvz_array_destroy(&pos_f[k]);
 }
 
 static void _visual_volume_slice(DvzVisual* visual)
@@ -38,6 +38,7 @@ static void dvz_prop_destroy(DvzProp* prop)
 {
     ASSERT(prop != NULL);
     log_trace("destroy prop");
+    ASSERT(!prop->is_wrapped);
     dvz_array_destroy(&prop->arr_orig);
     dvz_array_destroy(&prop->arr_trans);
     dvz_array_destroy(&prop->arr_staging);
@@ -50,6 +51,19 @@ static void dvz_source_destroy(DvzSource* source)
 {
     ASSERT(source != NULL);
     log_trace("destroy source");
+
+    // Free the buffer regions allocated by the library.
+    bool is_lib =
+        source->origin == DVZ_SOURCE_ORIGIN_LIB || source->origin == DVZ_SOURCE_ORIGIN_NOBAKE;
+    if (is_lib && source->source_kind < DVZ_SOURCE_KIND_TEXTURE_1D &&
+        source->u.br.buffer != NULL && source->visual->canvas != NULL)
+    {
+        DvzContext* ctx = source->visual->canvas->gpu->context;
+        if (ctx != NULL && dvz_obj_is_created(&ctx->obj))
+            dvz_ctx_buffers_free(ctx, &source->u.br);
+    }
+
+    _source_unalias(source, false);
     dvz_array_destroy(&source->arr);
     dvz_obj_destroyed(&source->obj);
 }
@@ -59,6 +73,14 @@ void dvz_visual_destroy(DvzVisual* visual)
     ASSERT(visual != NULL);
     log_trace("destroy visual");
 
+    // Release the caller-owned data of the props.
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        _prop_unwrap(visual, (DvzProp*)iter.item, false);
+        dvz_container_iter(&iter);
+    }
+
     CONTAINER_DESTROY_ITEMS(DvzProp, visual->props, dvz_prop_destroy)
     dvz_container_destroy(&visual->props);
 
@@ -71,6 +93,14 @@ void dvz_visual_destroy(DvzVisual* visual)
     CONTAINER_DESTROY_ITEMS(DvzBindings, visual->bindings_comp, dvz_bindings_destroy)
     dvz_container_destroy(&visual->bindings_comp);
 
+    // Free the indirect draw commands of the streaming mode.
+    if (visual->stream.br_draws.buffer != NULL && visual->canvas != NULL)
+    {
+        DvzContext* ctx = visual->canvas->gpu->context;
+        if (ctx != NULL && dvz_obj_is_created(&ctx->obj))
+            dvz_ctx_buffers_free(ctx, &visual->stream.br_draws);
+    }
+
     dvz_obj_destroyed(&visual->obj);
 }
 
@@ -303,6 +333,10 @@ static void _visual_data(
     DvzProp* prop = dvz_prop_get(visual, prop_type, prop_idx);
     ASSERT(prop != NULL);
 
+    // The prop array must own its data before being modified. The wrapped data is only needed
+    // for partial updates.
+    _prop_unwrap(visual, prop, !do_resize);
+
     // Get the associated source.
     DvzSource* source = prop->source;
     if (source != NULL)
@@ -321,7 +355,28 @@ static void _visual_data(
         count = 1;
     }
 
+    // Streaming mode: setting the data fills the ring buffer and restarts the stream.
+    if (do_resize && _prop_is_streamed(prop))
+    {
+        uint32_t capacity = visual->stream.capacity;
+        uint32_t n = MIN(data_item_count, capacity);
+        const void* last = (const char*)data + (data_item_count - n) * prop->arr_orig.item_size;
+        dvz_array_data(&prop->arr_orig, 0, capacity, n, last);
+        prop->append_count = MIN(item_count, capacity);
+        if (prop->prop_type == DVZ_PROP_POS && prop->prop_idx == 0)
+            visual->stream.count = prop->append_count;
+        prop->obj.request = DVZ_VISUAL_REQUEST_UPLOAD;
+        _source_set_changed(source, true);
+        return;
+    }
+    if (_prop_is_streamed(prop) && count > visual->stream.capacity)
+    {
+        log_error("partial data beyond the capacity of the streaming visual");
+        return;
+    }
+
     // Make sure the array has the right size.
+    uint32_t old_count = prop->arr_orig.item_count;
     if (!do_resize)
         count = MAX(count, prop->arr_orig.item_count);
     dvz_array_resize(&prop->arr_orig, count);
@@ -334,8 +389,20 @@ static void _visual_data(
     if (source != NULL)
     {
         log_trace("source type %d #%d handled by lib", source->source_type, source->source_idx);
+
+        // With the default baking function, prop item i goes to the source items
+        // [i * reps, (i + 1) * reps), and the last prop item is repeated until the end of the
+        // source. Only these source items need to be baked and uploaded again, unless the number
+        // of items has changed.
+        uint32_t reps = MAX(1, prop->reps);
+        uint32_t end =
+            first_item + item_count < count ? (first_item + item_count) * reps : UINT32_MAX;
+        if (source->origin == DVZ_SOURCE_ORIGIN_LIB && count == old_count &&
+            visual->callback_bake == _default_visual_bake)
+            _source_set_changed_range(source, first_item * reps, end);
+        else
+            _source_set_changed(source, true);
         source->origin = DVZ_SOURCE_ORIGIN_LIB;
-        _source_set_changed(source, true);
     }
 }
 
@@ -368,12 +435,104 @@ void dvz_visual_data_append(
     ASSERT(visual != NULL);
     DvzProp* prop = dvz_prop_get(visual, prop_type, prop_idx);
     ASSERT(prop != NULL);
+
+    // Streaming mode: write the new items after the last appended ones in the ring buffer.
+    if (_prop_is_streamed(prop))
+    {
+        _stream_write(visual, prop, prop->append_count, count, data);
+        return;
+    }
+
     uint32_t first_item = prop->arr_orig.item_count;
     dvz_visual_data_partial(visual, prop_type, prop_idx, first_item, count, count, data);
 }
 
 
 
+void dvz_visual_data_wrap(
+    DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, void* data,
+    DvzDataReleaseCallback release, void* user_data)
+{
+    ASSERT(visual != NULL);
+    ASSERT(count > 0);
+    ASSERT(data != NULL);
+    DvzProp* prop = dvz_prop_get(visual, prop_type, prop_idx);
+    ASSERT(prop != NULL);
+
+    if (prop->arr_orig.item_size == 0 || _prop_is_streamed(prop))
+    {
+        log_error("prop type %d #%d cannot wrap external data", prop_type, prop_idx);
+        return;
+    }
+
+    // The same pointer means that the caller has modified the data in place.
+    DvzArray* arr = &prop->arr_orig;
+    if (!prop->is_wrapped || arr->data != data)
+    {
+        _prop_unwrap(visual, prop, false);
+        FREE(arr->data);
+        arr->data = data;
+        prop->is_wrapped = true;
+    }
+    prop->release = release;
+    prop->release_data = user_data;
+    arr->item_count = count;
+    arr->buffer_size = count * arr->item_size;
+
+    prop->obj.request = DVZ_VISUAL_REQUEST_UPLOAD;
+    if (prop->source != NULL)
+    {
+        _source_set_changed(prop->source, true);
+        prop->source->origin = DVZ_SOURCE_ORIGIN_LIB;
+    }
+}
+
+
+
+void dvz_visual_stream(DvzVisual* visual, uint32_t capacity)
+{
+    ASSERT(visual != NULL);
+    ASSERT(capacity > 0);
+
+    DvzSource* source = dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    if (source == NULL || visual->graphics_count != 1 ||
+        dvz_source_get(visual, DVZ_SOURCE_TYPE_INDEX, 0) != NULL)
+    {
+        log_error(
+            "the streaming mode requires a single graphics pipeline, a vertex source and no "
+            "index source");
+        return;
+    }
+    log_debug("enable streaming mode with a capacity of %d items", capacity);
+
+    DvzVisualStream* stream = &visual->stream;
+    stream->capacity = capacity;
+    stream->source = source;
+    stream->count = 0;
+
+    // The streamed props have a fixed size. The existing items are kept, and the last one is
+    // repeated, so that the props that are not appended keep their value for all items.
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        if (prop->source == source)
+        {
+            _prop_unwrap(visual, prop, true);
+            prop->append_count = MIN(prop->arr_orig.item_count, capacity);
+            dvz_array_resize(&prop->arr_orig, capacity);
+            if (prop->prop_type == DVZ_PROP_POS && prop->prop_idx == 0)
+                stream->count = prop->append_count;
+        }
+        dvz_container_iter(&iter);
+    }
+    source->origin = DVZ_SOURCE_ORIGIN_LIB;
+    _source_set_changed(source, true);
+}
+
+
+
 static DvzSource*
 _assert_source_exists(DvzVisual* visual, DvzSourceType source_type, uint32_t source_idx)
 {
@@ -421,15 +580,21 @@ void dvz_visual_data_source(
     ASSERT(source->source_type == source_type);
 
     // Make sure the array has the right size.
+    _source_unalias(source, true);
+    uint32_t old_count = source->arr.item_count;
     dvz_array_resize(&source->arr, count);
 
     // Copy the specified array to the prop array.
     dvz_array_data(&source->arr, first_item, item_count, data_item_count, data);
 
-    source->origin = DVZ_SOURCE_ORIGIN_NOBAKE;
     // source->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
     // visual->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
-    _source_set_changed(source, true);
+    // Only upload the specified items if the number of items has not changed.
+    if (source->origin == DVZ_SOURCE_ORIGIN_NOBAKE && count == old_count)
+        _source_set_changed_range(source, first_item, count);
+    else
+        _source_set_changed(source, true);
+    source->origin = DVZ_SOURCE_ORIGIN_NOBAKE;
 }
 
 
@@ -495,12 +660,46 @@ void dvz_visual_flags(DvzVisual* visual, int flags)
 
 uint32_t dvz_visual_item_count(DvzVisual* visual)
 {
+    if (visual->stream.capacity > 0)
+        return (uint32_t)MIN(visual->stream.count, visual->stream.capacity);
     DvzProp* prop = dvz_prop_get(visual, DVZ_PROP_POS, 0);
     return dvz_prop_size(prop);
 }
 
 
 
+VkDeviceSize dvz_visual_memory(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    VkDeviceSize size = 0;
+    DvzBufferRegions* br = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->sources);
+    DvzSource* source = NULL;
+    while (iter.item != NULL)
+    {
+        source = (DvzSource*)iter.item;
+        if (source->origin != DVZ_SOURCE_ORIGIN_LIB && source->origin != DVZ_SOURCE_ORIGIN_NOBAKE)
+        {
+            dvz_container_iter(&iter);
+            continue;
+        }
+        if (_source_is_buffer(source->source_kind))
+        {
+            br = &source->u.br;
+            if (br->buffer != NULL)
+                size += br->count * (br->aligned_size > 0 ? br->aligned_size : br->size);
+        }
+        else if (_source_is_texture(source->source_kind) && source->u.tex != NULL)
+        {
+            size += dvz_texture_memory(source->u.tex);
+        }
+        dvz_container_iter(&iter);
+    }
+    return size;
+}
+
+
+
 /*************************************************************************************************/
 /*  Visual events                                                                                */
 /*************************************************************************************************/
@@ -513,6 +712,16 @@ void dvz_visual_callback_bake(DvzVisual* visual, DvzVisualDataCallback callback)
 
 
 
+void dvz_visual_callback_changed(
+    DvzVisual* visual, DvzVisualChangedCallback callback, void* user_data)
+{
+    ASSERT(visual != NULL);
+    visual->callback_changed = callback;
+    visual->callback_changed_data = user_data;
+}
+
+
+
 void dvz_visual_fill_callback(DvzVisual* visual, DvzVisualFillCallback callback)
 {
     ASSERT(visual != NULL);
@@ -537,6 +746,9 @@ void dvz_visual_fill_event(
     ev.viewport = viewport;
     ev.user_data = user_data;
 
+    // The bound buffers may have been recreated since the last update.
+    _visual_bindings_update(visual);
+
     visual->callback_fill(visual, ev);
 }
 
@@ -656,11 +868,11 @@ void* dvz_prop_item(DvzProp* prop, uint32_t prop_idx)
 /*  Data update                                                                                  */
 /*************************************************************************************************/
 
-void dvz_visual_update(
+void dvz_visual_bake(
     DvzVisual* visual, DvzViewport viewport, DvzDataCoords coords, const void* user_data)
 {
     ASSERT(visual != NULL);
-    log_debug("visual update");
+    log_debug("visual bake");
 
     DvzVisualDataEvent ev = {0};
     ev.viewport = viewport;
@@ -680,6 +892,14 @@ void dvz_visual_update(
     }
     // NOTE: we bake the UNIFORM sources here.
     _bake_uniforms(visual);
+}
+
+
+
+void dvz_visual_upload(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    log_debug("visual upload");
 
     // Here, we assume that all sources are correctly allocated, which includes VERTEX and INDEX
     // arrays, and that they have their data ready for upload.
@@ -694,7 +914,6 @@ void dvz_visual_update(
 
     DvzContainerIterator iter = dvz_container_iterator(&visual->sources);
     DvzSource* source = NULL;
-    DvzBindings* bindings = NULL;
     while (iter.item != NULL)
     {
         source = iter.item;
@@ -726,9 +945,8 @@ void dvz_visual_update(
                     log_warn("skipping visual data upload as VERTEX source is not set");
                     visual->obj.status = DVZ_OBJECT_STATUS_INVALID;
 
-                    // NOTE: this is needed to avoid an infinite loop. We need to let
-                    // _enqueue_all_visuals_changed() that this visual is invalid and should not
-                    // trigger a visual_changed event.
+                    // NOTE: mark the visual as not set, it will only be updated again once its
+                    // VERTEX source is set.
                     _source_set_changed(source, false);
 
                     return;
@@ -811,7 +1029,20 @@ void dvz_visual_update(
             ASSERT(arr->item_size > 0);
 
             // Make sure the GPU buffer exists and is allocated with the right size.
-            _source_buffer(visual, source);
+            DvzBuffer* old_buffer = br->buffer;
+            VkDeviceSize old_offset = br->offsets[0];
+            if (!_source_buffer(visual, source))
+            {
+                // Over the memory budget: keep the previous region and data, and retry the upload
+                // at the next update.
+                log_error("cannot upload source %d, skipping", source->source_type);
+                dvz_container_iter(&iter);
+                continue;
+            }
+
+            // A new buffer region doesn't contain the previous data, it must be fully uploaded.
+            bool is_partial = source->dirty.count > 0 && br->buffer == old_buffer &&
+                              br->offsets[0] == old_offset;
 
             ASSERT(br->size > 0);
             VkDeviceSize size = arr->item_count * arr->item_size;
@@ -831,6 +1062,8 @@ void dvz_visual_update(
                 for (uint32_t i = 0; i < canvas->swapchain.img_count; i++)
                     dvz_buffer_upload(br->buffer, br->offsets[i], size, arr->data);
             }
+            else if (is_partial)
+                _source_upload_ranges(ctx, source);
             else
                 dvz_upload_buffer(ctx, *br, 0, size, arr->data);
             _source_set(source);
@@ -842,7 +1075,12 @@ void dvz_visual_update(
         else if (_source_is_texture(source->source_kind))
         {
             // Make sure the GPU texture exists and is allocated with the right shape.
-            _source_texture(visual, source);
+            if (!_source_texture(visual, source))
+            {
+                log_error("cannot upload texture source %d, skipping", source->source_type);
+                dvz_container_iter(&iter);
+                continue;
+            }
             texture = source->u.tex;
 
             ASSERT(texture != NULL);
@@ -868,19 +1106,21 @@ void dvz_visual_update(
         dvz_container_iter(&iter);
     }
 
+    // Streaming mode: update the draw commands after the ring buffer.
+    if (visual->stream.capacity > 0 && visual->stream.source->u.br.buffer != NULL)
+        _stream_draws(visual);
+
     // Update the bindings that need to be updated.
-    for (uint32_t i = 0; i < visual->graphics_count; i++)
-    {
-        bindings = dvz_container_get(&visual->bindings, i);
-        ASSERT(bindings != NULL);
-        if (bindings->obj.status == DVZ_OBJECT_STATUS_NEED_UPDATE)
-            dvz_bindings_update(bindings);
-    }
-    for (uint32_t i = 0; i < visual->compute_count; i++)
-    {
-        bindings = dvz_container_get(&visual->bindings_comp, i);
-        ASSERT(bindings != NULL);
-        if (bindings->obj.status == DVZ_OBJECT_STATUS_NEED_UPDATE)
-            dvz_bindings_update(bindings);
-    }
+    _visual_bindings_update(visual);
+}
+
+
+
+void dvz_visual_update(
+    DvzVisual* visual, DvzViewport viewport, DvzDataCoords coords, const void* user_data)
+{
+    ASSERT(visual != NULL);
+    log_debug("visual update");
+    dvz_visual_bake(visual, viewport, coords, user_data);
+    dvz_visual_upload(visual);
 }
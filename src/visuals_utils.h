@@ -84,9 +84,15 @@ static void _source_set_changed(DvzSource* source, bool value)
     ASSERT(source != NULL);
     int req = value ? DVZ_VISUAL_REQUEST_UPLOAD : DVZ_VISUAL_REQUEST_NOT_SET;
     source->obj.request = req;
+    // All items have changed.
+    source->dirty.count = 0;
     ASSERT(source->visual != NULL);
     // Mark the visual as to be changed to.
     source->visual->obj.request = req;
+
+    // Notify the owner of the visual, typically the scene.
+    if (value && source->visual->callback_changed != NULL)
+        source->visual->callback_changed(source->visual, source->visual->callback_changed_data);
 }
 
 
@@ -95,6 +101,7 @@ static void _source_set(DvzSource* source)
 {
     ASSERT(source != NULL);
     source->obj.request = DVZ_VISUAL_REQUEST_SET;
+    source->dirty.count = 0;
     ASSERT(source->visual != NULL);
     source->visual->obj.request = DVZ_VISUAL_REQUEST_SET;
 }
@@ -117,6 +124,96 @@ static bool _source_is_set(DvzSource* source)
 
 
 
+// Add a [first, end) range to a set of dirty ranges, merging the overlapping and adjacent ranges.
+// When there are too many ranges, the two closest ones are merged.
+static void _dirty_ranges_add(DvzDirtyRanges* dirty, uint32_t first, uint32_t end)
+{
+    ASSERT(dirty != NULL);
+    ASSERT(first < end);
+
+    uvec2 merged[DVZ_MAX_DIRTY_RANGES + 1] = {0};
+    uint32_t n = 0;
+    bool inserted = false;
+    uint32_t* r = NULL;
+    for (uint32_t i = 0; i < dirty->count; i++)
+    {
+        r = dirty->ranges[i];
+        if (r[0] > end && !inserted)
+        {
+            merged[n][0] = first;
+            merged[n][1] = end;
+            n++;
+            inserted = true;
+        }
+        if (r[1] < first || r[0] > end)
+        {
+            merged[n][0] = r[0];
+            merged[n][1] = r[1];
+            n++;
+        }
+        else
+        {
+            first = MIN(first, r[0]);
+            end = MAX(end, r[1]);
+        }
+    }
+    if (!inserted)
+    {
+        merged[n][0] = first;
+        merged[n][1] = end;
+        n++;
+    }
+    ASSERT(n <= DVZ_MAX_DIRTY_RANGES + 1);
+
+    if (n > DVZ_MAX_DIRTY_RANGES)
+    {
+        uint32_t k = 0;
+        for (uint32_t i = 1; i < n - 1; i++)
+            if (merged[i + 1][0] - merged[i][1] < merged[k + 1][0] - merged[k][1])
+                k = i;
+        merged[k][1] = merged[k + 1][1];
+        for (uint32_t i = k + 1; i < n - 1; i++)
+        {
+            merged[i][0] = merged[i + 1][0];
+            merged[i][1] = merged[i + 1][1];
+        }
+        n--;
+    }
+
+    ASSERT(n <= DVZ_MAX_DIRTY_RANGES);
+    memcpy(dirty->ranges, merged, n * sizeof(uvec2));
+    dirty->count = n;
+}
+
+
+
+// Mark a [first, end) range of items of a vertex or index source as changed, so that only these
+// items are baked and uploaded. The end may exceed the number of items. The whole source is
+// marked as changed if its data is not on the GPU yet.
+static void _source_set_changed_range(DvzSource* source, uint32_t first, uint32_t end)
+{
+    ASSERT(source != NULL);
+    bool is_partial = source->source_kind == DVZ_SOURCE_KIND_VERTEX ||
+                      source->source_kind == DVZ_SOURCE_KIND_INDEX;
+    is_partial &= source->u.br.buffer != NULL && _source_is_set(source);
+    // No range while the source has changed means that all items have already changed.
+    is_partial &= !_source_has_changed(source) || source->dirty.count > 0;
+    if (!is_partial || first >= end)
+    {
+        _source_set_changed(source, true);
+        return;
+    }
+
+    DvzDirtyRanges dirty = source->dirty;
+    if (!_source_has_changed(source))
+        dirty.count = 0;
+    _dirty_ranges_add(&dirty, first, end);
+    _source_set_changed(source, true);
+    source->dirty = dirty;
+}
+
+
+
 static uint32_t _get_texture_ndims(DvzSourceKind source_kind)
 {
     uint32_t ndims = 1;
@@ -284,6 +381,10 @@ static uint32_t _source_size(DvzVisual* visual, DvzSource* source)
     DvzArray* arr = NULL;
     uint32_t item_count = 0;
 
+    // Streaming mode: the ring buffer has a fixed size, with an extra item copying the first one.
+    if (source == visual->stream.source && visual->stream.capacity > 0)
+        return visual->stream.capacity + 1;
+
     DvzContainerIterator iter = dvz_container_iterator(&visual->props);
     DvzProp* prop = NULL;
     while (iter.item != NULL)
@@ -329,7 +430,7 @@ static void _set_source_bindings(DvzVisual* visual, DvzSource* source)
 
 
 
-static void _create_source_buffer(DvzCanvas* canvas, DvzSource* source, VkDeviceSize size)
+static bool _create_source_buffer(DvzCanvas* canvas, DvzSource* source, VkDeviceSize size)
 {
     DvzContext* ctx = canvas->gpu->context;
     DvzBufferType type = DVZ_BUFFER_TYPE_UNDEFINED;
@@ -350,16 +451,29 @@ static void _create_source_buffer(DvzCanvas* canvas, DvzSource* source, VkDevice
         break;
     default:
         log_error("invalid source kind %d", source->source_kind);
-        return;
+        return false;
         break;
     }
     uint32_t buf_count = source->source_type == mappable ? canvas->swapchain.img_count : 1;
-    source->u.br = dvz_ctx_buffers(ctx, type, buf_count, size);
+
+    // The allocation fails if the memory budget would be exceeded, the previous regions are kept.
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, type, buf_count, size);
+    if (br.buffer == NULL)
+        return false;
+
+    // Free the previous regions, if any, after the new ones have been allocated so that they
+    // don't overlap.
+    DvzBufferRegions old = source->u.br;
+    source->u.br = br;
+    if (old.buffer != NULL && source->origin != DVZ_SOURCE_ORIGIN_USER)
+        dvz_ctx_buffers_free(ctx, &old);
+    return true;
 }
 
 
 
-static void _source_buffer(DvzVisual* visual, DvzSource* source)
+// Return false if the buffer could not be allocated, the source data must not be uploaded then.
+static bool _source_buffer(DvzVisual* visual, DvzSource* source)
 {
     ASSERT(visual != NULL);
     ASSERT(source != NULL);
@@ -379,16 +493,20 @@ static void _source_buffer(DvzVisual* visual, DvzSource* source)
         log_debug(
             "need to %sallocate new buffer region to fit %d elements (%d bytes)",
             source->u.br.size > 0 ? "re" : "", count, size);
-        _create_source_buffer(canvas, source, size);
+        if (!_create_source_buffer(canvas, source, size))
+            return false;
         // Set the pipeline bindings with the source buffer.
         _set_source_bindings(visual, source);
     }
     ASSERT(source->u.br.buffer != VK_NULL_HANDLE);
+    return true;
 }
 
 
 
-static void _source_texture(DvzVisual* visual, DvzSource* source)
+// Return false if the texture could not be created or enlarged, the source data must not be
+// uploaded then.
+static bool _source_texture(DvzVisual* visual, DvzSource* source)
 {
     ASSERT(visual != NULL);
     ASSERT(source != NULL);
@@ -420,13 +538,16 @@ static void _source_texture(DvzVisual* visual, DvzSource* source)
                 "need to create new texture with shape %dx%dx%d", //
                 shape[0], shape[1], shape[2]);
             tex = source->u.tex = dvz_ctx_texture(ctx, ndims, shape, format);
+            if (tex == NULL)
+                return false;
         }
         else
         {
             log_debug(
                 "need to resize texture to new shape %dx%dx%d", //
                 shape[0], shape[1], shape[2]);
-            dvz_texture_resize(source->u.tex, shape);
+            if (!dvz_texture_resize(tex, shape))
+                return false;
         }
         ASSERT(tex != NULL);
 
@@ -435,6 +556,141 @@ static void _source_texture(DvzVisual* visual, DvzSource* source)
         dvz_bindings_texture(bindings, source->slot_idx, tex);
     }
     ASSERT(source->u.tex != NULL);
+    return true;
+}
+
+
+
+// Update the bindings that need to be updated, including those referring to buffers that have
+// been recreated since the last update.
+static void _visual_bindings_update(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    DvzBindings* bindings = NULL;
+    for (uint32_t i = 0; i < visual->graphics_count; i++)
+    {
+        bindings = dvz_container_get(&visual->bindings, i);
+        ASSERT(bindings != NULL);
+        if (bindings->obj.status == DVZ_OBJECT_STATUS_NEED_UPDATE ||
+            dvz_bindings_outdated(bindings))
+            dvz_bindings_update(bindings);
+    }
+    for (uint32_t i = 0; i < visual->compute_count; i++)
+    {
+        bindings = dvz_container_get(&visual->bindings_comp, i);
+        ASSERT(bindings != NULL);
+        if (bindings->obj.status == DVZ_OBJECT_STATUS_NEED_UPDATE ||
+            dvz_bindings_outdated(bindings))
+            dvz_bindings_update(bindings);
+    }
+}
+
+
+
+/*************************************************************************************************/
+/*  Wrapped prop data                                                                            */
+/*************************************************************************************************/
+
+// Detach a source array from the wrapped prop data it points to, optionally keeping a copy.
+static void _source_unalias(DvzSource* source, bool keep)
+{
+    ASSERT(source != NULL);
+    if (source->alias == NULL)
+        return;
+
+    DvzArray* arr = &source->arr;
+    void* data = arr->data;
+    source->alias = NULL;
+    arr->data = NULL;
+    if (keep && arr->item_count > 0)
+    {
+        arr->data = malloc(arr->buffer_size);
+        memcpy(arr->data, data, arr->buffer_size);
+        return;
+    }
+    arr->item_count = 0;
+    arr->buffer_size = 0;
+    source->dirty.count = 0;
+}
+
+
+
+// Stop referencing the caller-owned data of a prop, optionally keeping a copy, and release it.
+// The pending uploads may still refer to the data, so the release is deferred until they are
+// processed.
+static void _prop_unwrap(DvzVisual* visual, DvzProp* prop, bool keep)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    if (!prop->is_wrapped)
+        return;
+
+    if (prop->source != NULL && prop->source->alias == prop)
+        _source_unalias(prop->source, false);
+
+    DvzArray* arr = &prop->arr_orig;
+    void* data = arr->data;
+    arr->data = NULL;
+    if (keep && arr->item_count > 0)
+    {
+        arr->data = malloc(arr->buffer_size);
+        memcpy(arr->data, data, arr->buffer_size);
+    }
+    else
+    {
+        arr->item_count = 0;
+        arr->buffer_size = 0;
+    }
+
+    log_trace("release wrapped data of prop %d #%d", prop->prop_type, prop->prop_idx);
+    DvzContext* ctx = visual->canvas != NULL ? visual->canvas->gpu->context : NULL;
+    if (ctx != NULL && dvz_obj_is_created(&ctx->obj))
+        dvz_upload_release(ctx, data, prop->release, prop->release_data);
+    else if (prop->release != NULL)
+        prop->release(data, prop->release_data);
+    prop->is_wrapped = false;
+    prop->release = NULL;
+    prop->release_data = NULL;
+}
+
+
+
+// Return the wrapped prop whose data can be used as is as the source array, or NULL. This is the
+// case when it is the only prop copied to the source and its items have the source layout.
+static DvzProp* _source_alias_prop(DvzVisual* visual, DvzSource* source, uint32_t count)
+{
+    ASSERT(visual != NULL);
+    ASSERT(source != NULL);
+
+    if (source == visual->stream.source)
+        return NULL;
+
+    DvzProp* alias = NULL;
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        if (prop->source == source && prop->copy_type != DVZ_ARRAY_COPY_NONE)
+        {
+            if (alias != NULL)
+                return NULL;
+            alias = prop;
+        }
+        dvz_container_iter(&iter);
+    }
+
+    if (alias == NULL || !alias->is_wrapped)
+        return NULL;
+    bool is_cast = alias->target_dtype != DVZ_DTYPE_NONE &&
+                   alias->target_dtype != alias->arr_orig.dtype;
+    if (alias->copy_type != DVZ_ARRAY_COPY_SINGLE || alias->reps > 1 || alias->offset != 0 ||
+        alias->item_size != source->arr.item_size || is_cast)
+        return NULL;
+    if (alias->dpi_scaling != 1 || alias->arr_trans.item_count > 0 ||
+        alias->arr_staging.item_count > 0 || alias->arr_orig.item_count != count)
+        return NULL;
+    return alias;
 }
 
 
@@ -443,7 +699,8 @@ static void _source_texture(DvzVisual* visual, DvzSource* source)
 /*  Visual baking helpers                                                                        */
 /*************************************************************************************************/
 
-static void _prop_copy(DvzVisual* visual, DvzProp* prop)
+// Copy a prop to the [first, end) item range of its source array.
+static void _prop_copy_range(DvzVisual* visual, DvzProp* prop, uint32_t first, uint32_t end)
 {
     ASSERT(prop != NULL);
 
@@ -468,28 +725,136 @@ static void _prop_copy(DvzVisual* visual, DvzProp* prop)
     ASSERT(source->arr.data != NULL);
     ASSERT(arr->item_count <= source->arr.item_count);
 
-    // Implement DPI scaling here.
+    // Align the range on the repeated items, the last prop item is repeated until the end of
+    // the source.
+    uint32_t reps = MAX(1, prop->reps);
+    first -= first % reps;
+    end = MIN(end, source->arr.item_count);
+    if (first >= end)
+        return;
+
+    // Implement DPI scaling here. Only the copied items are rescaled if the staging array has
+    // the right size.
     if (prop->dpi_scaling != 1)
     {
         arr = _prop_array(prop, DVZ_PROP_ARRAY_TRANSFORMED);
         if (arr->item_count == 0)
             arr = _prop_array(prop, DVZ_PROP_ARRAY_ORIGINAL);
 
-        prop->arr_staging = dvz_array_copy(arr);
-        arr = _prop_array(prop, DVZ_PROP_ARRAY_STAGING);
-        dvz_array_scale(arr, prop->dpi_scaling);
+        DvzArray* staging = &prop->arr_staging;
+        if (staging->item_count != arr->item_count)
+        {
+            dvz_array_destroy(staging);
+            *staging = dvz_array_copy(arr);
+            dvz_array_scale(staging, prop->dpi_scaling);
+        }
+        else
+        {
+            uint32_t i0 = MIN(first / reps, arr->item_count - 1);
+            uint32_t i1 = CLIP((end + reps - 1) / reps, i0 + 1, arr->item_count);
+            dvz_array_copy_region(arr, staging, i0, i0, i1 - i0);
+            if (staging->dtype == DVZ_DTYPE_FLOAT)
+                for (uint32_t i = i0; i < i1; i++)
+                    ((float*)staging->data)[i] *= prop->dpi_scaling;
+        }
+        arr = staging;
     }
+    uint32_t src_first = MIN(first / reps, arr->item_count - 1);
 
-    log_debug("copy prop type %d to source buffer", prop->prop_type);
+    log_debug(
+        "copy prop type %d to source buffer, items %d to %d", prop->prop_type, first, end - 1);
     dvz_array_column(
-        &source->arr, prop->offset, col_size, 0, source->arr.item_count, //
-        arr->item_count, arr->data,                                      //
-        prop->arr_orig.dtype, prop->target_dtype,                        // optional cast
+        &source->arr, prop->offset, col_size, first, end - first,             //
+        arr->item_count - src_first, (char*)arr->data + src_first * col_size, //
+        prop->arr_orig.dtype, prop->target_dtype,                             // optional cast
         prop->copy_type, prop->reps);
 }
 
 
 
+static void _prop_copy(DvzVisual* visual, DvzProp* prop)
+{
+    ASSERT(prop != NULL);
+    ASSERT(prop->source != NULL);
+    _prop_copy_range(visual, prop, 0, prop->source->arr.item_count);
+}
+
+
+
+typedef struct DvzCastTask DvzCastTask;
+struct DvzCastTask
+{
+    DvzArray* src;
+    DvzArray* dst;
+    uint32_t first_item, item_count;
+    int components;
+};
+
+
+
+static void _cast_task(void* user_data)
+{
+    DvzCastTask* task = (DvzCastTask*)user_data;
+    ASSERT(task != NULL);
+    _array_cast_items(task->src, task->dst, task->first_item, task->item_count, task->components);
+}
+
+
+
+// Cast the positions of a dvec3 prop to single precision, in a new array to be destroyed by the
+// caller. The array always has as many items as the prop, large arrays are cast in parallel.
+static DvzArray _prop_pos_cast(DvzVisual* visual, DvzProp* prop)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    DvzArray* src = _prop_array(prop, DVZ_PROP_ARRAY_DEFAULT);
+    DvzArray arr = dvz_array(0, DVZ_DTYPE_VEC3);
+    uint32_t count = src->item_count;
+    if (count == 0)
+        return arr;
+    dvz_array_resize(&arr, count);
+
+    // Unsupported dtype: the positions are left at zero, so that the bake functions can still
+    // index the array.
+    int components = _array_cast_components(src, &arr);
+    if (components < 0)
+    {
+        log_error(
+            "cannot cast prop %d #%d with dtype %d to vec3", //
+            prop->prop_type, prop->prop_idx, src->dtype);
+        return arr;
+    }
+
+    DvzWorkers* workers = visual->canvas != NULL ? visual->canvas->app->workers : NULL;
+    if (workers == NULL || count <= DVZ_CAST_TASK_ITEMS)
+    {
+        _array_cast_items(src, &arr, 0, count, components);
+        return arr;
+    }
+
+    // The bake functions may run in a worker task themselves, the group only waits for, and
+    // helps with, its own tasks.
+    uint32_t task_count = (count + DVZ_CAST_TASK_ITEMS - 1) / DVZ_CAST_TASK_ITEMS;
+    DvzCastTask* tasks = (DvzCastTask*)calloc(task_count, sizeof(DvzCastTask));
+    DvzWorkerGroup group = dvz_workers_group(workers);
+    for (uint32_t i = 0; i < task_count; i++)
+    {
+        tasks[i] = (DvzCastTask){
+            .src = src,
+            .dst = &arr,
+            .first_item = i * DVZ_CAST_TASK_ITEMS,
+            .item_count = MIN(DVZ_CAST_TASK_ITEMS, count - i * DVZ_CAST_TASK_ITEMS),
+            .components = components,
+        };
+        dvz_workers_group_submit(&group, _cast_task, &tasks[i]);
+    }
+    dvz_workers_group_wait(&group);
+    FREE(tasks);
+    return arr;
+}
+
+
+
 static void _source_alloc(DvzVisual* visual, DvzSource* source, uint32_t count)
 {
     ASSERT(visual != NULL);
@@ -510,20 +875,51 @@ static void _source_fill(DvzVisual* visual, DvzSource* source)
     ASSERT(visual != NULL);
     ASSERT(source != NULL);
 
-    // Copy all associated props to the source array.
+    // Copy all associated props to the source array, only over the dirty ranges if any.
     DvzProp* prop = NULL;
+    DvzDirtyRanges* dirty = &source->dirty;
     DvzContainerIterator iter = dvz_container_iterator(&visual->props);
     while (iter.item != NULL)
     {
         prop = iter.item;
-        if (prop->source == source)
+        if (prop->source == source && dirty->count == 0)
             _prop_copy(visual, prop);
+        else if (prop->source == source)
+            for (uint32_t i = 0; i < dirty->count; i++)
+                _prop_copy_range(visual, prop, dirty->ranges[i][0], dirty->ranges[i][1]);
         dvz_container_iter(&iter);
     }
 }
 
 
 
+// Upload the dirty ranges of a buffer source, whose GPU buffer holds the previous data.
+static void _source_upload_ranges(DvzContext* ctx, DvzSource* source)
+{
+    ASSERT(ctx != NULL);
+    ASSERT(source != NULL);
+    ASSERT(source->dirty.count > 0);
+
+    DvzArray* arr = &source->arr;
+    VkDeviceSize item_size = arr->item_size;
+    uint32_t first = 0, end = 0;
+    for (uint32_t i = 0; i < source->dirty.count; i++)
+    {
+        first = source->dirty.ranges[i][0];
+        end = MIN(source->dirty.ranges[i][1], arr->item_count);
+        if (first >= end)
+            continue;
+        log_trace(
+            "upload items %d to %d of source %d #%d", //
+            first, end - 1, source->source_type, source->source_idx);
+        dvz_upload_buffer(
+            ctx, source->u.br, first * item_size, (end - first) * item_size,
+            (char*)arr->data + first * item_size);
+    }
+}
+
+
+
 // Get the first source of a given type for the given pipeline, or none.
 static DvzSource*
 _get_pipeline_source(DvzVisual* visual, DvzSourceType source_type, uint32_t pipeline_idx)
@@ -569,11 +965,36 @@ static void _bake_source(DvzVisual* visual, DvzSource* source)
 
     log_debug("baking source %d", source->source_kind);
 
+    // All items must be baked if the number of items has changed.
+    if (count != source->arr.item_count)
+        source->dirty.count = 0;
+
+    // Wrapped prop data with the layout of the source items: the source array points to it.
+    DvzProp* alias = _source_alias_prop(visual, source, count);
+    if (alias != NULL)
+    {
+        log_debug("skip baking source %d, using the wrapped prop data", source->source_kind);
+        if (source->alias == NULL)
+            FREE(source->arr.data);
+        source->alias = alias;
+        source->arr.data = alias->arr_orig.data;
+        source->arr.item_count = count;
+        source->arr.buffer_size = count * source->arr.item_size;
+        return;
+    }
+    _source_unalias(source, false);
+
     // Allocate the source array.
     _source_alloc(visual, source, count);
 
     // Copy all corresponding props to the array.
     _source_fill(visual, source);
+
+    // Streaming mode: the extra item after the end of the ring buffer copies the first one.
+    if (source == visual->stream.source && visual->stream.capacity > 0)
+        memcpy(
+            dvz_array_item(&source->arr, visual->stream.capacity),
+            dvz_array_item(&source->arr, 0), source->arr.item_size);
 }
 
 
@@ -610,6 +1031,106 @@ static void _bake_uniforms(DvzVisual* visual)
 
 
 
+/*************************************************************************************************/
+/*  Streaming                                                                                    */
+/*************************************************************************************************/
+
+static bool _prop_is_streamed(DvzProp* prop)
+{
+    ASSERT(prop != NULL);
+    if (prop->source == NULL)
+        return false;
+    DvzVisualStream* stream = &prop->source->visual->stream;
+    return stream->capacity > 0 && prop->source == stream->source;
+}
+
+
+
+// Write items into a streamed prop, starting at the given total item index. Only the last items
+// are kept if there are more items than the ring buffer capacity.
+static void
+_stream_write(DvzVisual* visual, DvzProp* prop, uint64_t idx, uint32_t count, const void* data)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    ASSERT(count > 0);
+    ASSERT(data != NULL);
+
+    DvzVisualStream* stream = &visual->stream;
+    uint32_t capacity = stream->capacity;
+    ASSERT(capacity > 0);
+    ASSERT(prop->arr_orig.item_count == capacity);
+    VkDeviceSize item_size = prop->arr_orig.item_size;
+    if (count > capacity)
+    {
+        data = (const char*)data + (count - capacity) * item_size;
+        idx += count - capacity;
+        count = capacity;
+    }
+
+    // The items may wrap around the end of the ring buffer.
+    uint32_t first = idx % capacity;
+    uint32_t n = MIN(count, capacity - first);
+    dvz_array_data(&prop->arr_orig, first, n, n, data);
+    _source_set_changed_range(stream->source, first, first + n);
+    if (n < count)
+    {
+        dvz_array_data(
+            &prop->arr_orig, 0, count - n, count - n, (const char*)data + n * item_size);
+        _source_set_changed_range(stream->source, 0, count - n);
+    }
+    // The extra item copies the first one.
+    if (first == 0 || n < count)
+        _source_set_changed_range(stream->source, capacity, capacity + 1);
+
+    prop->append_count = idx + count;
+    if (prop->prop_type == DVZ_PROP_POS && prop->prop_idx == 0)
+        stream->count = prop->append_count;
+    prop->obj.request = DVZ_VISUAL_REQUEST_UPLOAD;
+}
+
+
+
+// Compute the two draw commands following the head of the ring buffer, and upload them.
+static void _stream_draws(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    DvzVisualStream* stream = &visual->stream;
+    ASSERT(stream->capacity > 0);
+    ASSERT(visual->graphics_count > 0);
+    DvzContext* ctx = visual->canvas->gpu->context;
+
+    if (stream->br_draws.buffer == NULL)
+        stream->br_draws =
+            dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, sizeof(stream->draws));
+    // The allocation fails if the memory budget would be exceeded, it is retried at the next
+    // update, and the visual is not drawn until then.
+    if (stream->br_draws.buffer == NULL)
+        return;
+
+    uint32_t capacity = stream->capacity;
+    memset(stream->draws, 0, sizeof(stream->draws));
+    stream->draws[0].instanceCount = 1;
+    stream->draws[1].instanceCount = 1;
+    if (stream->count <= capacity)
+    {
+        stream->draws[0].vertexCount = (uint32_t)stream->count;
+    }
+    else
+    {
+        // From the oldest item to the end of the ring buffer, then from the start to the newest
+        // item. Line strips also go through the extra item to join the two parts.
+        uint32_t head = stream->count % capacity;
+        bool is_strip = visual->graphics[0]->topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+        stream->draws[0].firstVertex = head;
+        stream->draws[0].vertexCount = capacity - head + (head > 0 && is_strip ? 1 : 0);
+        stream->draws[1].vertexCount = head;
+    }
+    dvz_upload_buffer(ctx, stream->br_draws, 0, sizeof(stream->draws), stream->draws);
+}
+
+
+
 /*************************************************************************************************/
 /*  Visual default callbacks                                                                     */
 /*************************************************************************************************/
@@ -640,6 +1161,19 @@ static void _default_visual_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 
 
 
+// Number of items of a buffer source that can be drawn, which is smaller than the number of items
+// in the source array if its buffer could not be enlarged within the memory budget.
+static uint32_t _source_gpu_count(DvzSource* source)
+{
+    ASSERT(source != NULL);
+    DvzArray* arr = &source->arr;
+    if (source->u.br.buffer == NULL || arr->item_size == 0)
+        return 0;
+    return (uint32_t)MIN((VkDeviceSize)arr->item_count, source->u.br.size / arr->item_size);
+}
+
+
+
 static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
 {
     ASSERT(visual != NULL);
@@ -667,7 +1201,7 @@ static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
         ASSERT(vertex_source != NULL);
         ASSERT(vertex_source->pipeline_idx == pipeline_idx);
 
-        uint32_t vertex_count = vertex_source->arr.item_count;
+        uint32_t vertex_count = _source_gpu_count(vertex_source);
         if (vertex_count == 0)
         {
             log_warn("skip this graphics pipeline as the vertex buffer is empty");
@@ -687,7 +1221,12 @@ static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
         DvzBufferRegions* index_buf = NULL;
         if (index_source != NULL)
         {
-            index_count = index_source->arr.item_count;
+            index_count = _source_gpu_count(index_source);
+            if (index_count == 0 && index_source->arr.item_count > 0)
+            {
+                log_warn("skip this graphics pipeline as the index buffer is not allocated");
+                continue;
+            }
             if (index_count > 0)
             {
                 index_buf = &index_source->u.br;
@@ -699,7 +1238,25 @@ static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
         // Draw command.
         dvz_cmd_bind_graphics(cmds, idx, visual->graphics[pipeline_idx], bindings, 0);
 
-        if (index_count == 0)
+        if (index_count == 0 && vertex_source == visual->stream.source &&
+            visual->stream.capacity > 0)
+        {
+            // Streaming mode: indirect draws following the head of the ring buffer, so that
+            // appending items doesn't require a refill.
+            DvzBufferRegions draws = visual->stream.br_draws;
+            if (draws.buffer == NULL)
+            {
+                log_warn("skip streaming visual that has not been uploaded yet");
+                continue;
+            }
+            log_debug(
+                "draw %d streamed items",
+                (uint32_t)MIN(visual->stream.count, visual->stream.capacity));
+            dvz_cmd_draw_indirect(cmds, idx, draws);
+            draws.offsets[0] += sizeof(VkDrawIndirectCommand);
+            dvz_cmd_draw_indirect(cmds, idx, draws);
+        }
+        else if (index_count == 0)
         {
             log_debug("draw %d vertices", vertex_count);
             // Make sure the bound vertex buffer is large enough.
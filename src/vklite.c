@@ -94,6 +94,9 @@ DvzApp* dvz_app(DvzBackend backend)
     // Initialize the global clock.
     _clock_init(&app->clock);
 
+    // Thread pool, the number of threads may be set with the DVZ_WORKERS env variable.
+    app->workers = dvz_workers(dvz_workers_default_count());
+
     app->gpus = dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzGpu), DVZ_OBJECT_TYPE_GPU);
     app->windows =
         dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzWindow), DVZ_OBJECT_TYPE_WINDOW);
@@ -155,6 +158,10 @@ int dvz_app_destroy(DvzApp* app)
     // Destroy the canvases.
     dvz_canvases_destroy(&app->canvases);
 
+    // Stop the worker threads.
+    dvz_workers_destroy(app->workers);
+    app->workers = NULL;
+
     // Destroy the GPUs.
     CONTAINER_DESTROY_ITEMS(DvzGpu, app->gpus, dvz_gpu_destroy)
     dvz_container_destroy(&app->gpus);
@@ -284,6 +291,15 @@ void dvz_gpu_create(DvzGpu* gpu, VkSurfaceKHR surface)
     log_trace(
         "starting creation of GPU #%d WITH%s surface...", gpu->idx,
         surface != VK_NULL_HANDLE ? "" : "OUT");
+
+    // The queue lock is recursive, as the wait functions may be called while holding it.
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    if (pthread_mutex_init(&gpu->queue_lock, &attr) != 0)
+        log_error("mutex creation failed");
+    pthread_mutexattr_destroy(&attr);
+
     create_device(gpu, surface);
 
     DvzQueues* q = &gpu->queues;
@@ -314,7 +330,9 @@ void dvz_queue_wait(DvzGpu* gpu, uint32_t queue_idx)
     ASSERT(gpu != NULL);
     ASSERT(queue_idx < gpu->queues.queue_count);
     // log_trace("waiting for queue #%d", queue_idx);
+    dvz_gpu_lock(gpu);
     vkQueueWaitIdle(gpu->queues.queues[queue_idx]);
+    dvz_gpu_unlock(gpu);
 }
 
 
@@ -324,7 +342,70 @@ void dvz_gpu_wait(DvzGpu* gpu)
     ASSERT(gpu != NULL);
     log_trace("waiting for device");
     if (gpu->device != VK_NULL_HANDLE)
+    {
+        dvz_gpu_lock(gpu);
         vkDeviceWaitIdle(gpu->device);
+        dvz_gpu_unlock(gpu);
+    }
+}
+
+
+
+void dvz_gpu_lock(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+    pthread_mutex_lock(&gpu->queue_lock);
+    gpu->lock_depth++;
+}
+
+
+
+void dvz_gpu_unlock(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+    ASSERT(gpu->lock_depth > 0);
+    gpu->lock_depth--;
+    pthread_mutex_unlock(&gpu->queue_lock);
+}
+
+
+
+bool dvz_gpu_memory_budget(DvzGpu* gpu, VkDeviceSize* budget, VkDeviceSize* usage)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(budget != NULL);
+    ASSERT(usage != NULL);
+    *budget = gpu->vram;
+    *usage = 0;
+
+    if (!gpu->has_memory_budget)
+        return false;
+    ASSERT(gpu->app != NULL);
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR func =
+        (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(
+            gpu->app->instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+    if (func == NULL)
+        return false;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_props = {0};
+    budget_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 props = {0};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    props.pNext = &budget_props;
+    func(gpu->physical_device, &props);
+
+    // Sum over the device-local heaps.
+    *budget = 0;
+    for (uint32_t i = 0; i < props.memoryProperties.memoryHeapCount; i++)
+    {
+        if ((props.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0)
+            continue;
+        *budget += budget_props.heapBudget[i];
+        *usage += budget_props.heapUsage[i];
+    }
+    return true;
 }
 
 
@@ -394,6 +475,8 @@ void dvz_gpu_destroy(DvzGpu* gpu)
         gpu->device = VK_NULL_HANDLE;
     }
 
+    pthread_mutex_destroy(&gpu->queue_lock);
+
     // dvz_obj_destroyed(&gpu->obj);
     dvz_obj_init(&gpu->obj);
     gpu->queues.queue_count = 0;
@@ -688,7 +771,9 @@ void dvz_swapchain_present(
     info.pSwapchains = &swapchain->swapchain;
     info.pImageIndices = &swapchain->img_idx;
 
+    dvz_gpu_lock(swapchain->gpu);
     VkResult res = vkQueuePresentKHR(swapchain->gpu->queues.queues[queue_idx], &info);
+    dvz_gpu_unlock(swapchain->gpu);
 
     switch (res)
     {
@@ -756,7 +841,40 @@ DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
     commands.gpu = gpu;
     commands.queue_idx = queue;
     commands.count = count;
-    allocate_command_buffers(gpu->device, gpu->queues.cmd_pools[qf], count, commands.cmds);
+    commands.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_command_buffers(
+        gpu->device, gpu->queues.cmd_pools[qf], commands.level, count, commands.cmds);
+
+    dvz_obj_init(&commands.obj);
+
+    return commands;
+}
+
+
+
+static DvzCommands
+_commands_dedicated(DvzGpu* gpu, uint32_t queue, uint32_t count, VkCommandBufferLevel level)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+
+    ASSERT(count <= DVZ_MAX_COMMAND_BUFFERS_PER_SET);
+    ASSERT(queue < gpu->queues.queue_count);
+    ASSERT(count > 0);
+    uint32_t qf = gpu->queues.queue_families[queue];
+    ASSERT(qf < gpu->queues.queue_family_count);
+    log_trace("creating commands with a dedicated pool on queue #%d, queue family #%d", queue, qf);
+
+    DvzCommands commands = {0};
+    commands.gpu = gpu;
+    commands.queue_idx = queue;
+    commands.count = count;
+    commands.level = level;
+
+    // NOTE: command pools are externally synchronized, a dedicated pool lets these command
+    // buffers be recorded in another thread than the other command buffers.
+    create_command_pool(gpu->device, qf, &commands.pool);
+    allocate_command_buffers(gpu->device, commands.pool, commands.level, count, commands.cmds);
 
     dvz_obj_init(&commands.obj);
 
@@ -765,6 +883,20 @@ DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
 
 
 
+DvzCommands dvz_commands_dedicated(DvzGpu* gpu, uint32_t queue, uint32_t count)
+{
+    return _commands_dedicated(gpu, queue, count, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+
+
+DvzCommands dvz_commands_secondary(DvzGpu* gpu, uint32_t queue, uint32_t count)
+{
+    return _commands_dedicated(gpu, queue, count, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+}
+
+
+
 void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx)
 {
     ASSERT(cmds != NULL);
@@ -777,6 +909,30 @@ void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx)
 
 
 
+void dvz_cmd_begin_secondary(DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass)
+{
+    ASSERT(cmds != NULL);
+    ASSERT(cmds->count > 0);
+    ASSERT(cmds->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    ASSERT(renderpass != NULL);
+    ASSERT(renderpass->renderpass != VK_NULL_HANDLE);
+
+    // NOTE: the framebuffer is left unspecified so that the command buffers remain valid when
+    // the framebuffers are recreated.
+    VkCommandBufferInheritanceInfo inheritance = {0};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = renderpass->renderpass;
+    inheritance.subpass = 0;
+
+    VkCommandBufferBeginInfo begin_info = {0};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(cmds->cmds[idx], &begin_info));
+}
+
+
+
 void dvz_cmd_end(DvzCommands* cmds, uint32_t idx)
 {
     ASSERT(cmds != NULL);
@@ -810,9 +966,10 @@ void dvz_cmd_free(DvzCommands* cmds)
     ASSERT(cmds->gpu->device != VK_NULL_HANDLE);
 
     log_trace("free %d command buffer(s)", cmds->count);
-    vkFreeCommandBuffers(
-        cmds->gpu->device, cmds->gpu->queues.cmd_pools[cmds->queue_idx], //
-        cmds->count, cmds->cmds);
+    VkCommandPool pool = cmds->pool;
+    if (pool == VK_NULL_HANDLE)
+        pool = cmds->gpu->queues.cmd_pools[cmds->queue_idx];
+    vkFreeCommandBuffers(cmds->gpu->device, pool, cmds->count, cmds->cmds);
 
     dvz_obj_init(&cmds->obj);
 }
@@ -826,6 +983,7 @@ void dvz_cmd_submit_sync(DvzCommands* cmds, uint32_t idx)
     DvzQueues* q = &cmds->gpu->queues;
     VkQueue queue = q->queues[cmds->queue_idx];
 
+    dvz_gpu_lock(cmds->gpu);
     vkQueueWaitIdle(queue);
     VkSubmitInfo info = {0};
     info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -833,6 +991,7 @@ void dvz_cmd_submit_sync(DvzCommands* cmds, uint32_t idx)
     info.pCommandBuffers = cmds->cmds;
     vkQueueSubmit(queue, 1, &info, VK_NULL_HANDLE);
     vkQueueWaitIdle(queue);
+    dvz_gpu_unlock(cmds->gpu);
 }
 
 
@@ -840,6 +999,16 @@ void dvz_cmd_submit_sync(DvzCommands* cmds, uint32_t idx)
 void dvz_commands_destroy(DvzCommands* cmds)
 {
     ASSERT(cmds != NULL);
+
+    // Destroying the dedicated pool of the command buffers frees them.
+    if (cmds->pool != VK_NULL_HANDLE)
+    {
+        ASSERT(cmds->gpu != NULL);
+        log_trace("destroy dedicated commands pool");
+        vkDestroyCommandPool(cmds->gpu->device, cmds->pool, NULL);
+        cmds->pool = VK_NULL_HANDLE;
+    }
+
     if (!dvz_obj_is_created(&cmds->obj))
     {
         log_trace("skip destruction of already-destroyed commands");
@@ -925,12 +1094,64 @@ static void _buffer_create(DvzBuffer* buffer)
 
 
 
+static void* _buffer_map(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    ASSERT(buffer != NULL);
+    ASSERT(buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    log_debug("memmap buffer %d", buffer->type);
+    void* cdata = NULL;
+    VK_CHECK_RESULT(
+        vkMapMemory(buffer->gpu->device, buffer->device_memory, offset, size, 0, &cdata));
+    return cdata;
+}
+
+
+
+static void _buffer_unmap(DvzBuffer* buffer)
+{
+    ASSERT(buffer != NULL);
+    log_debug("unmap buffer %d", buffer->type);
+    vkUnmapMemory(buffer->gpu->device, buffer->device_memory);
+}
+
+
+
+// Flush or invalidate a mapped range of a buffer with non-coherent memory.
+static void
+_buffer_mapped_range(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size, bool flush)
+{
+    ASSERT(buffer != NULL);
+    if ((buffer->memory & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)
+        return;
+    ASSERT(buffer->mmap != NULL);
+
+    // The range must be aligned to the non-coherent atom size.
+    VkDeviceSize atom = buffer->gpu->device_properties.limits.nonCoherentAtomSize;
+    atom = MAX(atom, 1);
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? buffer->size : offset + size;
+    offset = (offset / atom) * atom;
+    end = aligned_size(end, atom);
+
+    VkMappedMemoryRange range = {0};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = buffer->device_memory;
+    range.offset = offset;
+    range.size = end >= buffer->size ? VK_WHOLE_SIZE : end - offset;
+
+    if (flush)
+        VK_CHECK_RESULT(vkFlushMappedMemoryRanges(buffer->gpu->device, 1, &range));
+    else
+        VK_CHECK_RESULT(vkInvalidateMappedMemoryRanges(buffer->gpu->device, 1, &range));
+}
+
+
+
 static void _buffer_destroy(DvzBuffer* buffer)
 {
     // Unmap permanently-mapped buffers before destruction.
     if (buffer->mmap != NULL)
     {
-        dvz_buffer_unmap(buffer);
+        _buffer_unmap(buffer);
         buffer->mmap = NULL;
     }
 
@@ -951,20 +1172,6 @@ static void _buffer_destroy(DvzBuffer* buffer)
 
 
 
-static void _buffer_copy(DvzBuffer* buffer0, DvzBuffer* buffer1)
-{
-    // Copy the parameters of a buffer.
-    buffer1->gpu = buffer0->gpu;
-    buffer1->obj = buffer0->obj;
-    buffer1->queue_count = buffer0->queue_count;
-    memcpy(buffer1->queues, buffer0->queues, sizeof(buffer0->queues));
-    buffer1->size = buffer0->size;
-    buffer1->usage = buffer0->usage;
-    buffer1->memory = buffer0->memory;
-}
-
-
-
 void dvz_buffer_create(DvzBuffer* buffer)
 {
     ASSERT(buffer != NULL);
@@ -977,48 +1184,73 @@ void dvz_buffer_create(DvzBuffer* buffer)
     log_trace("starting creation of buffer...");
     _buffer_create(buffer);
 
+    // Permanently map host-visible buffers.
+    if (buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        buffer->mmap = _buffer_map(buffer, 0, VK_WHOLE_SIZE);
+
     dvz_obj_created(&buffer->obj);
     log_trace("buffer created");
 }
 
 
 
+void dvz_buffer_recreate(DvzBuffer* buffer, VkDeviceSize size, DvzBuffer* old)
+{
+    ASSERT(buffer != NULL);
+    ASSERT(old != NULL);
+    ASSERT(dvz_obj_is_created(&buffer->obj));
+    log_debug("recreate buffer with size %s", pretty_size(size));
+
+    // Move the old Vulkan objects to the old buffer, which remains valid until it is destroyed.
+    // NOTE: the old buffer stays mapped, it is unmapped when it is destroyed.
+    *old = *buffer;
+
+    // Create the new Vulkan buffer with the new size.
+    buffer->buffer = VK_NULL_HANDLE;
+    buffer->device_memory = VK_NULL_HANDLE;
+    buffer->mmap = NULL;
+    buffer->size = size;
+    _buffer_create(buffer);
+    ASSERT(buffer->buffer != VK_NULL_HANDLE);
+    ASSERT(buffer->device_memory != VK_NULL_HANDLE);
+
+    // Permanently map the new buffer.
+    if (buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        buffer->mmap = _buffer_map(buffer, 0, VK_WHOLE_SIZE);
+
+    // The objects referring to the Vulkan buffer (descriptor sets, command buffers) need to be
+    // updated.
+    buffer->version++;
+}
+
+
+
 void dvz_buffer_resize(DvzBuffer* buffer, VkDeviceSize size)
 {
     ASSERT(buffer != NULL);
     log_debug("[SLOW] resize buffer to size %s", pretty_size(size));
     DvzGpu* gpu = buffer->gpu;
 
-    // Create the new buffer with the new size.
-    DvzBuffer new_buffer = dvz_buffer(gpu);
-    _buffer_copy(buffer, &new_buffer);
     // Make sure we can copy to the new buffer.
     bool proceed = true;
-    if ((new_buffer.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) == 0)
+    if ((buffer->usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) == 0)
     {
         log_warn("buffer was not created with VK_BUFFER_USAGE_TRANSFER_DST_BIT and therefore the "
                  "data cannot be kept while resizing it");
         proceed = false;
     }
-    new_buffer.size = size;
-    _buffer_create(&new_buffer);
-    // At this point, the new buffer is empty.
 
-    // Handle permanent mapping.
-    void* old_mmap = buffer->mmap;
-    if (buffer->mmap != NULL)
-    {
-        // Unmap the to-be-deleted buffer.
-        dvz_buffer_unmap(buffer);
-        // NOTE: buffer->mmap remains not NULL but invalid: it will need to be reset to a new
-        // mapped region after creation of the new buffer.
-        buffer->mmap = NULL;
-    }
+    // Create the new buffer with the new size. At this point, the new buffer is empty.
+    DvzBuffer old = {0};
+    dvz_buffer_recreate(buffer, size, &old);
 
-    // If a DvzCommands object was passed for the data transfer, transfer the data from the
-    // old buffer to the new, by flushing the corresponding queue and waiting for completion.
+    // Transfer the data from the old buffer to the new, by flushing the corresponding queue and
+    // waiting for completion.
+    // NOTE: the context buffers are resized without blocking, see dvz_ctx_buffers().
 
     // HACK: use queue 0 for transfers (convention)
+    // NOTE: the command buffer comes from the shared command pool.
+    dvz_gpu_lock(gpu);
     DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
     DvzCommands* cmds = &cmds_;
     if (proceed)
@@ -1026,38 +1258,22 @@ void dvz_buffer_resize(DvzBuffer* buffer, VkDeviceSize size)
         uint32_t queue_idx = cmds->queue_idx;
         log_debug("copying data from the old buffer to the new one before destroying the old one");
         ASSERT(queue_idx < gpu->queues.queue_count);
-        ASSERT(size >= buffer->size);
+        ASSERT(size >= old.size);
 
         dvz_cmd_reset(cmds, 0);
         dvz_cmd_begin(cmds, 0);
-        dvz_cmd_copy_buffer(cmds, 0, buffer, 0, &new_buffer, 0, buffer->size);
+        dvz_cmd_copy_buffer(cmds, 0, &old, 0, buffer, 0, old.size);
         dvz_cmd_end(cmds, 0);
 
         VkQueue queue = gpu->queues.queues[queue_idx];
         dvz_cmd_submit_sync(cmds, 0);
         vkQueueWaitIdle(queue);
     }
+    dvz_gpu_unlock(gpu);
 
-    // Delete the old buffer after the transfer has finished.
-    _buffer_destroy(buffer);
-
-    // Update the existing buffer's size.
-    buffer->size = new_buffer.size;
+    // Delete the old buffer after the transfer has finished. This also unmaps it.
+    _buffer_destroy(&old);
     ASSERT(buffer->size == size);
-
-    // Update the existing DvzBuffer struct with the newly-created Vulkan objects.
-    buffer->buffer = new_buffer.buffer;
-    buffer->device_memory = new_buffer.device_memory;
-    ASSERT(buffer->buffer != VK_NULL_HANDLE);
-    ASSERT(buffer->device_memory != VK_NULL_HANDLE);
-
-    // If the existing buffer was already mapped, we need to remap the new buffer.
-    if (old_mmap != NULL)
-    {
-        buffer->mmap = dvz_buffer_map(buffer, 0, VK_WHOLE_SIZE);
-        // Make sure the permanent memmap has been updated after the buffer resize.
-        ASSERT(buffer->mmap != old_mmap);
-    }
 }
 
 
@@ -1070,16 +1286,12 @@ void* dvz_buffer_map(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size)
     ASSERT(dvz_obj_is_created(&buffer->obj));
     if (size < UINT64_MAX)
         ASSERT(offset + size <= buffer->size);
-    ASSERT(
-        (buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && //
-        (buffer->memory & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    ASSERT(buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 
-    log_debug("memmap buffer %d", buffer->type);
-    ASSERT(buffer->mmap == NULL);
-    void* cdata = NULL;
-    VK_CHECK_RESULT(
-        vkMapMemory(buffer->gpu->device, buffer->device_memory, offset, size, 0, &cdata));
-    return cdata;
+    // Host-visible buffers are permanently mapped.
+    if (buffer->mmap != NULL)
+        return (void*)((uint8_t*)buffer->mmap + offset);
+    return _buffer_map(buffer, offset, size);
 }
 
 
@@ -1090,13 +1302,28 @@ void dvz_buffer_unmap(DvzBuffer* buffer)
     ASSERT(buffer->gpu != NULL);
     ASSERT(buffer->gpu->device != VK_NULL_HANDLE);
     ASSERT(dvz_obj_is_created(&buffer->obj));
+    ASSERT(buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+    // Permanently mapped buffers are only unmapped when they are destroyed.
+    if (buffer->mmap != NULL)
+        return;
+    _buffer_unmap(buffer);
+}
 
-    ASSERT(
-        (buffer->memory & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && //
-        (buffer->memory & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
 
-    log_debug("unmap buffer %d", buffer->type);
-    vkUnmapMemory(buffer->gpu->device, buffer->device_memory);
+
+void dvz_buffer_flush(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    ASSERT(buffer != NULL);
+    _buffer_mapped_range(buffer, offset, size, true);
+}
+
+
+
+void dvz_buffer_invalidate(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    ASSERT(buffer != NULL);
+    _buffer_mapped_range(buffer, offset, size, false);
 }
 
 
@@ -1108,49 +1335,26 @@ void dvz_buffer_upload(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size
     ASSERT(data != NULL);
     ASSERT(buffer->buffer != VK_NULL_HANDLE);
     ASSERT(offset + size <= buffer->size);
+    ASSERT(buffer->mmap != NULL);
 
     // log_trace("uploading %s to GPU buffer", pretty_size(size));
-    void* mapped = NULL;
-    bool need_unmap = false;
-    if (buffer->mmap == NULL)
-    {
-        mapped = dvz_buffer_map(buffer, offset, size);
-        need_unmap = true;
-    }
-    else
-    {
-        mapped = (void*)((int64_t)buffer->mmap + (int64_t)offset);
-        need_unmap = false;
-    }
-
-    ASSERT(mapped != NULL);
-    memcpy(mapped, data, size);
-
-    if (need_unmap)
-        dvz_buffer_unmap(buffer);
+    memcpy((uint8_t*)buffer->mmap + offset, data, size);
+    dvz_buffer_flush(buffer, offset, size);
 }
 
 
 
 void dvz_buffer_download(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size, void* data)
 {
-    log_trace("downloading %s from GPU buffer", pretty_size(size));
+    ASSERT(buffer != NULL);
+    ASSERT(size > 0);
+    ASSERT(data != NULL);
+    ASSERT(offset + size <= buffer->size);
+    ASSERT(buffer->mmap != NULL);
 
-    void* mapped = NULL;
-    bool need_unmap = false;
-    if (buffer->mmap == NULL)
-    {
-        mapped = dvz_buffer_map(buffer, offset, size);
-        need_unmap = true;
-    }
-    else
-    {
-        mapped = (void*)((int64_t)buffer->mmap + (int64_t)offset);
-        need_unmap = false;
-    }
-    memcpy(data, mapped, size);
-    if (need_unmap)
-        dvz_buffer_unmap(buffer);
+    log_trace("downloading %s from GPU buffer", pretty_size(size));
+    dvz_buffer_invalidate(buffer, offset, size);
+    memcpy(data, (uint8_t*)buffer->mmap + offset, size);
 }
 
 
@@ -1248,25 +1452,8 @@ void dvz_buffer_regions_upload(DvzBufferRegions* br, uint32_t idx, const void* d
     ASSERT(data != NULL);
 
     log_trace("uploading %s to GPU buffer", pretty_size(size));
-
-    void* mapped = NULL;
-    bool need_unmap = false;
-    if (buffer->mmap == NULL)
-    {
-        mapped = dvz_buffer_regions_map(br, idx);
-        need_unmap = true;
-    }
-    else
-    {
-        mapped = buffer->mmap;
-        need_unmap = false;
-    }
-    ASSERT(mapped != NULL);
-
-    memcpy(mapped, data, size);
-
-    if (need_unmap)
-        dvz_buffer_regions_unmap(br);
+    ASSERT(idx < br->count);
+    dvz_buffer_upload(buffer, br->offsets[idx], size, data);
 }
 
 
@@ -1284,6 +1471,8 @@ void dvz_buffer_regions_copy(
     ASSERT(size > 0);
 
     // HACK: use queue 0 for transfers (convention)
+    // NOTE: the command buffer comes from the shared command pool.
+    dvz_gpu_lock(gpu);
     DvzCommands cmds_ = dvz_commands(gpu, 0, 1);
     DvzCommands* cmds = &cmds_;
 
@@ -1311,6 +1500,7 @@ void dvz_buffer_regions_copy(
     dvz_submit_commands(&submit, cmds);
     log_debug("copy %s between 2 buffers", pretty_size(size));
     dvz_submit_send(&submit, 0, NULL, 0);
+    dvz_gpu_unlock(gpu);
 
     // Wait for the transfer queue to be idle.
     // dvz_queue_wait(gpu, DVZ_DEFAULT_QUEUE_TRANSFER);
@@ -1929,12 +2119,34 @@ void dvz_bindings_update(DvzBindings* bindings)
             i, bindings->dsets[i]);
     }
 
+    for (uint32_t i = 0; i < bindings->slots->slot_count; i++)
+    {
+        if (bindings->br[i].buffer != NULL)
+            bindings->br_versions[i] = bindings->br[i].buffer->version;
+    }
+
     if (bindings->obj.status == DVZ_OBJECT_STATUS_NEED_UPDATE)
         bindings->obj.status = DVZ_OBJECT_STATUS_CREATED;
 }
 
 
 
+bool dvz_bindings_outdated(DvzBindings* bindings)
+{
+    ASSERT(bindings != NULL);
+    if (!dvz_obj_is_created(&bindings->obj) || bindings->slots == NULL)
+        return false;
+    for (uint32_t i = 0; i < bindings->slots->slot_count; i++)
+    {
+        if (bindings->br[i].buffer != NULL &&
+            bindings->br[i].buffer->version != bindings->br_versions[i])
+            return true;
+    }
+    return false;
+}
+
+
+
 void dvz_bindings_destroy(DvzBindings* bindings)
 {
     ASSERT(bindings != NULL);
@@ -3182,7 +3394,9 @@ void dvz_submit_send(DvzSubmit* submit, uint32_t cmd_idx, DvzFences* fences, uin
     // log_trace(
     //     "submit queue with %d cmd bufs (%d) and signal fence %d", submit->commands_count,
     //     cmd_idx, vfence);
+    dvz_gpu_lock(submit->gpu);
     VK_CHECK_RESULT(vkQueueSubmit(submit->gpu->queues.queues[queue_idx], 1, &submit_info, vfence));
+    dvz_gpu_unlock(submit->gpu);
 
     // log_trace("submit done");
 }
@@ -3204,8 +3418,9 @@ void dvz_submit_reset(DvzSubmit* submit)
 /*  Command buffer filling                                                                       */
 /*************************************************************************************************/
 
-void dvz_cmd_begin_renderpass(
-    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers)
+static void _cmd_begin_renderpass(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers,
+    VkSubpassContents contents)
 {
     ASSERT(renderpass != NULL);
     ASSERT(framebuffers != NULL);
@@ -3224,12 +3439,29 @@ void dvz_cmd_begin_renderpass(
     ASSERT(framebuffers->framebuffers[iclip] != VK_NULL_HANDLE);
     begin_render_pass(
         renderpass->renderpass, cb, framebuffers->framebuffers[iclip], //
-        width, height, renderpass->clear_count, renderpass->clear_values);
+        width, height, renderpass->clear_count, renderpass->clear_values, contents);
     CMD_END
 }
 
 
 
+void dvz_cmd_begin_renderpass(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers)
+{
+    _cmd_begin_renderpass(cmds, idx, renderpass, framebuffers, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+
+
+void dvz_cmd_begin_renderpass_secondary(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers)
+{
+    _cmd_begin_renderpass(
+        cmds, idx, renderpass, framebuffers, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+}
+
+
+
 void dvz_cmd_end_renderpass(DvzCommands* cmds, uint32_t idx)
 {
     CMD_START
@@ -3239,6 +3471,30 @@ void dvz_cmd_end_renderpass(DvzCommands* cmds, uint32_t idx)
 
 
 
+void dvz_cmd_execute(DvzCommands* cmds, uint32_t idx, uint32_t count, DvzCommands** secondary)
+{
+    ASSERT(secondary != NULL);
+    CMD_START
+    // Execute the secondary command buffers by batches.
+    VkCommandBuffer cbs[64] = {0};
+    uint32_t n = 0;
+    for (uint32_t k = 0; k < count; k++)
+    {
+        ASSERT(secondary[k] != NULL);
+        ASSERT(secondary[k]->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        ASSERT(idx < secondary[k]->count);
+        cbs[n++] = secondary[k]->cmds[idx];
+        if (n == 64 || k == count - 1)
+        {
+            vkCmdExecuteCommands(cb, n, cbs);
+            n = 0;
+        }
+    }
+    CMD_END
+}
+
+
+
 void dvz_cmd_compute(DvzCommands* cmds, uint32_t idx, DvzCompute* compute, uvec3 size)
 {
     ASSERT(compute->bindings != NULL);
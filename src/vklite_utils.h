@@ -429,6 +429,35 @@ static void backend_poll_events(DvzBackend backend, DvzWindow* window)
 
 
 
+static void backend_wait_events(DvzBackend backend, double timeout)
+{
+    switch (backend)
+    {
+    case DVZ_BACKEND_GLFW:
+        glfwWaitEventsTimeout(timeout);
+        break;
+    default:
+        break;
+    }
+}
+
+
+
+// Wake up the thread waiting in backend_wait_events(), may be called from any thread.
+static void backend_post_empty_event(DvzBackend backend)
+{
+    switch (backend)
+    {
+    case DVZ_BACKEND_GLFW:
+        glfwPostEmptyEvent();
+        break;
+    default:
+        break;
+    }
+}
+
+
+
 static void
 backend_window_destroy(VkInstance instance, DvzBackend backend, void* window, VkSurfaceKHR surface)
 {
@@ -993,9 +1022,19 @@ static void create_device(DvzGpu* gpu, VkSurfaceKHR surface)
                           "VK_KHR_portability_subset");
                 // extensions[n_extensions++] = "VK_KHR_get_physical_device_properties2";
                 extensions[n_extensions++] = "VK_KHR_portability_subset";
-                break;
+            }
+
+            // Optional extension to query the memory budget of the heaps.
+            if (strncmp(
+                    ext[i].extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+                    VK_MAX_EXTENSION_NAME_SIZE) == 0)
+            {
+                log_trace("found memory budget extension, enabling it");
+                extensions[n_extensions++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+                gpu->has_memory_budget = true;
             }
         }
+        ASSERT(n_extensions <= 16);
         FREE(ext);
     }
 
@@ -1157,7 +1196,8 @@ static void create_swapchain(
 /*************************************************************************************************/
 
 static void allocate_command_buffers(
-    VkDevice device, VkCommandPool command_pool, uint32_t count, VkCommandBuffer* cmd_bufs)
+    VkDevice device, VkCommandPool command_pool, VkCommandBufferLevel level, uint32_t count,
+    VkCommandBuffer* cmd_bufs)
 {
     ASSERT(count > 0);
     log_trace("allocate %d command buffer(s)", count);
@@ -1167,7 +1207,7 @@ static void allocate_command_buffers(
     VkCommandBufferAllocateInfo info = {0};
     info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     info.commandPool = command_pool;
-    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    info.level = level;
     info.commandBufferCount = count;
     VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &info, cmd_bufs));
 }
@@ -1829,7 +1869,8 @@ static VkAttachmentReference create_attachment_ref(uint32_t attachment, VkImageL
 
 static void begin_render_pass(
     VkRenderPass renderpass, VkCommandBuffer cmd_buf, VkFramebuffer framebuffer, //
-    uint32_t width, uint32_t height, uint32_t clear_count, VkClearValue* clear_colors)
+    uint32_t width, uint32_t height, uint32_t clear_count, VkClearValue* clear_colors,
+    VkSubpassContents contents)
 {
     ASSERT(renderpass != VK_NULL_HANDLE);
     ASSERT(framebuffer != VK_NULL_HANDLE);
@@ -1844,7 +1885,7 @@ static void begin_render_pass(
     info.renderArea = renderArea;
     info.clearValueCount = clear_count;
     info.pClearValues = clear_colors;
-    vkCmdBeginRenderPass(cmd_buf, &info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(cmd_buf, &info, contents);
 }
 
 #endif
@@ -0,0 +1,365 @@
+#include "../include/datoviz/workers.h"
+
+#include <stdlib.h>
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+// Take the most recent task of a worker's own queue.
+static bool _worker_pop(DvzWorker* worker, DvzWorkerTask* task)
+{
+    ASSERT(worker != NULL);
+    ASSERT(task != NULL);
+    bool found = false;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->tail != worker->head)
+    {
+        worker->tail--;
+        *task = worker->tasks[worker->tail % DVZ_WORKER_QUEUE_CAPACITY];
+        found = true;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+
+
+// Take the oldest task of another worker's queue.
+static bool _worker_steal(DvzWorker* worker, DvzWorkerTask* task)
+{
+    ASSERT(worker != NULL);
+    ASSERT(task != NULL);
+    bool found = false;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->tail != worker->head)
+    {
+        *task = worker->tasks[worker->head % DVZ_WORKER_QUEUE_CAPACITY];
+        worker->head++;
+        found = true;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+
+
+// Find a task, first in the given worker's queue, then in the other queues.
+static bool _workers_next(DvzWorkers* workers, uint32_t idx, DvzWorkerTask* task)
+{
+    ASSERT(workers != NULL);
+    if (workers->count == 0 || atomic_load(&workers->queued) == 0)
+        return false;
+    ASSERT(idx < workers->count);
+
+    bool found = _worker_pop(&workers->workers[idx], task);
+    for (uint32_t i = 1; i < workers->count && !found; i++)
+        found = _worker_steal(&workers->workers[(idx + i) % workers->count], task);
+    if (found)
+        atomic_fetch_sub(&workers->queued, 1);
+    return found;
+}
+
+
+
+// Take a queued task of a given group, in any queue.
+static bool _workers_take(DvzWorkers* workers, DvzWorkerGroup* group, DvzWorkerTask* task)
+{
+    ASSERT(workers != NULL);
+    ASSERT(group != NULL);
+    ASSERT(task != NULL);
+    if (workers->count == 0 || atomic_load(&workers->queued) == 0)
+        return false;
+
+    bool found = false;
+    DvzWorker* worker = NULL;
+    for (uint32_t i = 0; i < workers->count && !found; i++)
+    {
+        worker = &workers->workers[i];
+        pthread_mutex_lock(&worker->lock);
+        for (uint32_t k = worker->head; k != worker->tail; k++)
+        {
+            if (worker->tasks[k % DVZ_WORKER_QUEUE_CAPACITY].group != group)
+                continue;
+            // The order of the tasks in a queue does not matter, the last one fills the hole.
+            *task = worker->tasks[k % DVZ_WORKER_QUEUE_CAPACITY];
+            worker->tail--;
+            worker->tasks[k % DVZ_WORKER_QUEUE_CAPACITY] =
+                worker->tasks[worker->tail % DVZ_WORKER_QUEUE_CAPACITY];
+            found = true;
+            break;
+        }
+        pthread_mutex_unlock(&worker->lock);
+    }
+    if (found)
+        atomic_fetch_sub(&workers->queued, 1);
+    return found;
+}
+
+
+
+static void _workers_run(DvzWorkers* workers, DvzWorkerTask task)
+{
+    ASSERT(workers != NULL);
+    ASSERT(task.callback != NULL);
+    task.callback(task.user_data);
+
+    // NOTE: the group may be destroyed by its waiting thread as soon as its counter reaches 0.
+    bool group_done = task.group != NULL && atomic_fetch_sub(&task.group->pending, 1) == 1;
+
+    // Wake up the threads waiting for the tasks when the last one completes.
+    if (atomic_fetch_sub(&workers->pending, 1) == 1 || group_done)
+    {
+        pthread_mutex_lock(&workers->lock);
+        pthread_cond_broadcast(&workers->cond_done);
+        pthread_mutex_unlock(&workers->lock);
+    }
+}
+
+
+
+static void* _worker_thread(void* user_data)
+{
+    DvzWorker* worker = (DvzWorker*)user_data;
+    ASSERT(worker != NULL);
+    DvzWorkers* workers = worker->workers;
+    ASSERT(workers != NULL);
+    log_trace("starting worker thread #%d", worker->idx);
+
+    DvzWorkerTask task = {0};
+    while (true)
+    {
+        if (_workers_next(workers, worker->idx, &task))
+        {
+            _workers_run(workers, task);
+            continue;
+        }
+
+        // Sleep until a task is submitted or the pool is destroyed.
+        pthread_mutex_lock(&workers->lock);
+        while (atomic_load(&workers->is_running) && atomic_load(&workers->queued) == 0)
+            pthread_cond_wait(&workers->cond_task, &workers->lock);
+        pthread_mutex_unlock(&workers->lock);
+
+        if (!atomic_load(&workers->is_running))
+            break;
+    }
+
+    log_trace("end worker thread #%d", worker->idx);
+    return NULL;
+}
+
+
+
+/*************************************************************************************************/
+/*  Thread pool                                                                                  */
+/*************************************************************************************************/
+
+DvzWorkers* dvz_workers(uint32_t count)
+{
+    if (count > DVZ_MAX_WORKERS)
+    {
+        log_warn("the number of worker threads is limited to %d", DVZ_MAX_WORKERS);
+        count = DVZ_MAX_WORKERS;
+    }
+    log_debug("creating thread pool with %d worker threads", count);
+
+    DvzWorkers* workers = calloc(1, sizeof(DvzWorkers));
+    workers->count = count;
+    atomic_init(&workers->next, 0);
+    atomic_init(&workers->queued, 0);
+    atomic_init(&workers->pending, 0);
+    atomic_init(&workers->is_running, true);
+
+    if (pthread_mutex_init(&workers->lock, NULL) != 0)
+        log_error("mutex creation failed");
+    if (pthread_cond_init(&workers->cond_task, NULL) != 0)
+        log_error("cond creation failed");
+    if (pthread_cond_init(&workers->cond_done, NULL) != 0)
+        log_error("cond creation failed");
+
+    // NOTE: all queues must be initialized before starting the threads, as they steal from each
+    // other.
+    DvzWorker* worker = NULL;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        worker = &workers->workers[i];
+        worker->workers = workers;
+        worker->idx = i;
+        if (pthread_mutex_init(&worker->lock, NULL) != 0)
+            log_error("mutex creation failed");
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        worker = &workers->workers[i];
+        if (pthread_create(&worker->thread, NULL, _worker_thread, worker) != 0)
+            log_error("thread creation failed");
+    }
+
+    return workers;
+}
+
+
+
+uint32_t dvz_workers_default_count(void)
+{
+    const char* env = getenv("DVZ_WORKERS");
+    if (env != NULL && strlen(env) > 0)
+        return (uint32_t)strtoul(env, NULL, 10);
+
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n <= 1)
+        return 0;
+    return (uint32_t)MIN(n - 1, DVZ_MAX_WORKERS);
+}
+
+
+
+static void _workers_submit(DvzWorkers* workers, DvzWorkerTask task)
+{
+    ASSERT(workers != NULL);
+    ASSERT(task.callback != NULL);
+    atomic_fetch_add(&workers->pending, 1);
+    if (task.group != NULL)
+        atomic_fetch_add(&task.group->pending, 1);
+
+    // No worker thread: run the task directly.
+    if (workers->count == 0)
+    {
+        _workers_run(workers, task);
+        return;
+    }
+
+    // Distribute the tasks over the worker queues.
+    uint32_t idx = atomic_fetch_add(&workers->next, 1) % workers->count;
+    DvzWorker* worker = &workers->workers[idx];
+    bool is_full = false;
+    pthread_mutex_lock(&worker->lock);
+    is_full = worker->tail - worker->head >= DVZ_WORKER_QUEUE_CAPACITY;
+    if (!is_full)
+    {
+        worker->tasks[worker->tail % DVZ_WORKER_QUEUE_CAPACITY] = task;
+        worker->tail++;
+        atomic_fetch_add(&workers->queued, 1);
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    if (is_full)
+    {
+        log_trace("worker queue #%d is full, running the task in the calling thread", idx);
+        _workers_run(workers, task);
+        return;
+    }
+
+    pthread_mutex_lock(&workers->lock);
+    pthread_cond_signal(&workers->cond_task);
+    pthread_mutex_unlock(&workers->lock);
+}
+
+
+
+void dvz_workers_submit(DvzWorkers* workers, DvzWorkerCallback callback, void* user_data)
+{
+    ASSERT(workers != NULL);
+    ASSERT(callback != NULL);
+    _workers_submit(workers, (DvzWorkerTask){.callback = callback, .user_data = user_data});
+}
+
+
+
+void dvz_workers_wait(DvzWorkers* workers)
+{
+    ASSERT(workers != NULL);
+    DvzWorkerTask task = {0};
+    uint32_t idx = 0;
+    while (atomic_load(&workers->pending) > 0)
+    {
+        // Help the workers instead of sleeping.
+        if (_workers_next(workers, idx, &task))
+        {
+            _workers_run(workers, task);
+            continue;
+        }
+        if (workers->count > 0)
+            idx = (idx + 1) % workers->count;
+
+        // All remaining tasks are running in worker threads.
+        pthread_mutex_lock(&workers->lock);
+        if (atomic_load(&workers->pending) > 0 && atomic_load(&workers->queued) == 0)
+            pthread_cond_wait(&workers->cond_done, &workers->lock);
+        pthread_mutex_unlock(&workers->lock);
+    }
+}
+
+
+
+DvzWorkerGroup dvz_workers_group(DvzWorkers* workers)
+{
+    ASSERT(workers != NULL);
+    DvzWorkerGroup group = {.workers = workers};
+    atomic_init(&group.pending, 0);
+    return group;
+}
+
+
+
+void dvz_workers_group_submit(DvzWorkerGroup* group, DvzWorkerCallback callback, void* user_data)
+{
+    ASSERT(group != NULL);
+    ASSERT(group->workers != NULL);
+    ASSERT(callback != NULL);
+    _workers_submit(
+        group->workers,
+        (DvzWorkerTask){.callback = callback, .user_data = user_data, .group = group});
+}
+
+
+
+void dvz_workers_group_wait(DvzWorkerGroup* group)
+{
+    ASSERT(group != NULL);
+    DvzWorkers* workers = group->workers;
+    ASSERT(workers != NULL);
+    DvzWorkerTask task = {0};
+    while (atomic_load(&group->pending) > 0)
+    {
+        // Run the queued tasks of the group instead of sleeping.
+        if (_workers_take(workers, group, &task))
+        {
+            _workers_run(workers, task);
+            continue;
+        }
+
+        // All remaining tasks of the group are running in worker threads.
+        pthread_mutex_lock(&workers->lock);
+        if (atomic_load(&group->pending) > 0)
+            pthread_cond_wait(&workers->cond_done, &workers->lock);
+        pthread_mutex_unlock(&workers->lock);
+    }
+}
+
+
+
+void dvz_workers_destroy(DvzWorkers* workers)
+{
+    if (workers == NULL)
+        return;
+    dvz_workers_wait(workers);
+
+    pthread_mutex_lock(&workers->lock);
+    atomic_store(&workers->is_running, false);
+    pthread_cond_broadcast(&workers->cond_task);
+    pthread_mutex_unlock(&workers->lock);
+
+    for (uint32_t i = 0; i < workers->count; i++)
+        pthread_join(workers->workers[i].thread, NULL);
+    for (uint32_t i = 0; i < workers->count; i++)
+        pthread_mutex_destroy(&workers->workers[i].lock);
+
+    pthread_mutex_destroy(&workers->lock);
+    pthread_cond_destroy(&workers->cond_task);
+    pthread_cond_destroy(&workers->cond_done);
+    FREE(workers);
+}
@@ -28,6 +28,7 @@ struct EventHolder
 {
     DvzEvent init;
     DvzEvent key;
+    DvzEvent key_last;
     DvzEvent wheel;
     DvzEvent button;
     DvzEvent move;
@@ -178,6 +179,81 @@ int test_canvas_multiple(TestContext* tc)
 
 
 
+int test_canvas_on_demand(TestContext* tc)
+{
+    DvzApp* app = tc->app;
+    OFFSCREEN_SKIP
+
+    DvzGpu* gpu = dvz_gpu_best(app);
+    DvzCanvas* canvas = dvz_canvas(gpu, WIDTH, HEIGHT, 0);
+    dvz_canvas_on_demand(canvas, true);
+    AT(atomic_load(&canvas->on_demand));
+
+    // The first frames are always rendered, until the command buffers are filled.
+    dvz_app_run(app, N_FRAMES);
+    uint64_t frame_idx = canvas->frame_idx;
+    AT(frame_idx > 0);
+
+    // Nothing changes: no frame should be rendered.
+    dvz_app_run(app, 5);
+    AT(canvas->frame_idx == frame_idx);
+
+    // An explicit redraw request renders exactly one frame.
+    dvz_canvas_redraw(canvas);
+    dvz_app_run(app, 5);
+    AT(canvas->frame_idx == frame_idx + 1);
+
+    dvz_canvas_destroy(canvas);
+    return 0;
+}
+
+
+
+int test_canvas_threads(TestContext* tc)
+{
+    DvzApp* app = tc->app;
+    OFFSCREEN_SKIP
+
+    DvzGpu* gpu = dvz_gpu_best(app);
+
+    // Each canvas renders its frames in its own thread.
+    DvzCanvas* canvas0 = dvz_canvas(gpu, WIDTH, HEIGHT, DVZ_CANVAS_FLAGS_RENDER_THREAD);
+    DvzCanvas* canvas1 = dvz_canvas(gpu, WIDTH, HEIGHT, 0);
+    dvz_canvas_render_thread(canvas1, true);
+    AT(atomic_load(&canvas0->is_threaded));
+    AT(atomic_load(&canvas1->is_threaded));
+
+    uvec2 size = {0};
+    dvz_canvas_size(canvas0, DVZ_CANVAS_SIZE_FRAMEBUFFER, size);
+
+    dvz_canvas_clear_color(canvas0, 1, 0, 0);
+    dvz_canvas_clear_color(canvas1, 0, 1, 0);
+
+    dvz_app_run(app, N_FRAMES);
+    AT(canvas0->frame_idx > 0);
+    AT(canvas1->frame_idx > 0);
+
+    // Check canvas background color.
+    uint8_t* rgb0 = dvz_screenshot(canvas0, false);
+    uint8_t* rgb1 = dvz_screenshot(canvas1, false);
+    for (uint32_t i = 0; i < size[0] * size[1] * 3 * sizeof(uint8_t); i++)
+    {
+        AT(rgb0[i] == (i % 3 == 0 ? 255 : 0));
+        AT(rgb1[i] == (i % 3 == 1 ? 255 : 0));
+    }
+    FREE(rgb0);
+    FREE(rgb1);
+
+    dvz_canvas_render_thread(canvas1, false);
+    AT(!atomic_load(&canvas1->is_threaded));
+
+    dvz_canvas_destroy(canvas0);
+    dvz_canvas_destroy(canvas1);
+    return 0;
+}
+
+
+
 static void _init_callback(DvzCanvas* canvas, DvzEvent ev)
 {
     log_debug("init event for canvas");
@@ -242,6 +318,15 @@ static void _key_callback(DvzCanvas* canvas, DvzEvent ev)
     events->key = ev;
 }
 
+static void _key_last_callback(DvzCanvas* canvas, DvzEvent ev)
+{
+    ASSERT(canvas != NULL);
+    EventHolder* events = (EventHolder*)ev.user_data;
+    ASSERT(events != NULL);
+    // This callback has a higher param, it is called after _key_callback().
+    events->key_last = events->key;
+}
+
 
 
 int test_canvas_events(TestContext* tc)
@@ -253,6 +338,8 @@ int test_canvas_events(TestContext* tc)
     DvzCanvas* canvas = dvz_canvas(gpu, WIDTH, HEIGHT, DVZ_CANVAS_FLAGS_FPS);
 
     EventHolder events = {0};
+    dvz_event_callback( //
+        canvas, DVZ_EVENT_KEY_PRESS, 1, DVZ_EVENT_MODE_SYNC, _key_last_callback, &events);
     dvz_event_callback( //
         canvas, DVZ_EVENT_INIT, 0, DVZ_EVENT_MODE_SYNC, _init_callback, &events);
     dvz_event_callback( //
@@ -279,6 +366,7 @@ int test_canvas_events(TestContext* tc)
     dvz_event_key_press(canvas, DVZ_KEY_A, 0);
     // dvz_app_run(app, 3);
     AT(events.key.u.k.key_code == DVZ_KEY_A);
+    AT(events.key_last.u.k.key_code == DVZ_KEY_A);
 
     // Mouse wheel.
     vec2 pos = {10, 10};
@@ -297,6 +385,16 @@ int test_canvas_events(TestContext* tc)
     dvz_event_mouse_press(canvas, DVZ_MOUSE_BUTTON_LEFT, 0);
     AT(events.button.u.b.button == DVZ_MOUSE_BUTTON_LEFT);
 
+    // Coalesced mouse wheel events are dispatched once, at the next frame.
+    dvz_event_coalesce(canvas, true);
+    events.wheel = (DvzEvent){0};
+    dvz_event_mouse_wheel(canvas, pos, (vec2){0, 1}, 0);
+    dvz_event_mouse_wheel(canvas, pos, (vec2){0, 2}, 0);
+    AT(events.wheel.type == DVZ_EVENT_NONE);
+    dvz_app_run(app, 1);
+    AT(events.wheel.type == DVZ_EVENT_MOUSE_WHEEL);
+    AT(events.wheel.u.w.dir[1] == 3);
+
     // TODO: more events.
 
     dvz_canvas_destroy(canvas);
@@ -547,6 +645,52 @@ int test_canvas_triangle_resize(TestContext* tc)
 
 
 
+int test_canvas_triangle_latency(TestContext* tc)
+{
+    DvzApp* app = tc->app;
+
+    OFFSCREEN_SKIP
+
+    DvzGpu* gpu = dvz_gpu_best(app);
+    DvzCanvas* canvas = dvz_canvas(gpu, WIDTH, HEIGHT, 0);
+    TestVisual visual = triangle(canvas, "");
+
+    // Bindings and graphics pipeline.
+    visual.bindings = dvz_bindings(&visual.graphics.slots, 1);
+    dvz_bindings_update(&visual.bindings);
+    dvz_graphics_create(&visual.graphics);
+
+    // Triangle data.
+    triangle_upload(canvas, &visual);
+
+    // Frame pacing.
+    dvz_canvas_present_mode(canvas, VK_PRESENT_MODE_MAILBOX_KHR);
+    dvz_canvas_frames_in_flight(canvas, 1);
+    dvz_canvas_low_latency(canvas, true);
+
+    // Run.
+    dvz_event_callback(canvas, DVZ_EVENT_REFILL, 0, DVZ_EVENT_MODE_SYNC, triangle_refill, &visual);
+    dvz_app_run(app, N_FRAMES);
+    AT(canvas->fences_render_finished.count == 1);
+    AT(canvas->pacing.cpu_time > 0);
+    int res = check_canvas(canvas, "test_canvas_triangle_1");
+
+    // Back to the default frame pacing.
+    dvz_canvas_low_latency(canvas, false);
+    dvz_canvas_frames_in_flight(canvas, DVZ_DEFAULT_FRAMES_IN_FLIGHT);
+    dvz_canvas_present_mode(canvas, VK_PRESENT_MODE_FIFO_KHR);
+    dvz_app_run(app, N_FRAMES);
+    res = res || check_canvas(canvas, "test_canvas_triangle_1");
+
+    // Destroy.
+    destroy_visual(&visual);
+    dvz_canvas_destroy(canvas);
+
+    return res;
+}
+
+
+
 int test_canvas_triangle_offscreen(TestContext* tc)
 {
     DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
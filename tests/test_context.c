@@ -51,6 +51,127 @@ int test_context_buffer(TestContext* tc)
 
 
 
+int test_context_buffers_free(TestContext* tc)
+{
+    DvzContext* ctx = tc->context;
+    ASSERT(ctx != NULL);
+
+    DvzBufferRegions br0 = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 1000);
+    DvzBufferRegions br1 = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 64);
+    AT(br1.offsets[0] > br0.offsets[0]);
+    VkDeviceSize offset = br0.offsets[0];
+    VkDeviceSize allocated = br1.buffer->allocated_size;
+
+    // The freed space is reused by the next allocations.
+    dvz_ctx_buffers_free(ctx, &br0);
+    AT(br0.buffer == NULL);
+    DvzBufferRegions br2 = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 512);
+    AT(br2.offsets[0] == offset);
+    AT(br2.buffer->allocated_size == allocated);
+
+    // Resize in place into the free space following the region.
+    dvz_ctx_buffers_resize(ctx, &br2, 900);
+    AT(br2.offsets[0] == offset);
+    AT(br2.size == 900);
+
+    // Not enough space after the region: it is moved elsewhere.
+    dvz_ctx_buffers_resize(ctx, &br2, 4096);
+    AT(br2.offsets[0] > br1.offsets[0]);
+
+    dvz_ctx_buffers_free(ctx, &br1);
+    dvz_ctx_buffers_free(ctx, &br2);
+    AT(dvz_alloc_size(&ctx->allocators[DVZ_BUFFER_TYPE_VERTEX]) == 0);
+
+    return 0;
+}
+
+
+
+int test_context_buffers_grow(TestContext* tc)
+{
+    DvzContext* ctx = tc->context;
+    ASSERT(ctx != NULL);
+
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, 256);
+    uint8_t data[256] = {0};
+    for (uint32_t i = 0; i < 256; i++)
+        data[i] = i;
+    dvz_upload_buffer(ctx, br, 0, 256, data);
+
+    // Allocate more than the buffer can hold, which recreates the Vulkan buffer.
+    DvzBuffer* buffer = br.buffer;
+    VkBuffer vk_buffer = buffer->buffer;
+    VkDeviceSize size = buffer->size;
+    uint32_t version = buffer->version;
+    DvzBufferRegions br_large = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, size);
+    AT(br_large.buffer == buffer);
+    AT(buffer->size > size);
+    AT(buffer->version == version + 1);
+    AT(buffer->buffer != vk_buffer);
+
+    // Outside of the event loop, the old buffer is destroyed right away.
+    AT(ctx->deferred_count == 0);
+
+    // The data has been copied to the new buffer, and the existing regions remain valid.
+    uint8_t data_2[256] = {0};
+    dvz_download_buffer(ctx, br, 0, 256, data_2);
+    for (uint32_t i = 0; i < 256; i++)
+        AT(data_2[i] == i);
+
+    dvz_ctx_buffers_free(ctx, &br);
+    dvz_ctx_buffers_free(ctx, &br_large);
+    return 0;
+}
+
+
+
+int test_context_memory(TestContext* tc)
+{
+    DvzContext* ctx = tc->context;
+    ASSERT(ctx != NULL);
+
+    DvzMemoryStats stats = dvz_context_memory_stats(ctx);
+    AT(stats.buffer_allocated[DVZ_BUFFER_TYPE_VERTEX] == DVZ_BUFFER_TYPE_VERTEX_SIZE);
+    AT(stats.texture_count > 0);
+    AT(stats.total > stats.texture_allocated);
+    AT(stats.budget == 0);
+    VkDeviceSize used = stats.buffer_used[DVZ_BUFFER_TYPE_VERTEX];
+
+    DvzTexture* tex = dvz_ctx_texture(ctx, 2, (uvec3){16, 16, 1}, VK_FORMAT_R8G8B8A8_UNORM);
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 1024);
+    stats = dvz_context_memory_stats(ctx);
+    AT(stats.buffer_used[DVZ_BUFFER_TYPE_VERTEX] == used + 1024);
+
+    // Soft budget: the allocations that would need more GPU memory fail.
+    dvz_context_memory_budget(ctx, stats.total + 1024);
+    DvzBufferRegions br_large =
+        dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, DVZ_BUFFER_TYPE_VERTEX_SIZE);
+    AT(br_large.buffer == NULL);
+    AT(dvz_ctx_texture(ctx, 2, (uvec3){1024, 1024, 1}, VK_FORMAT_R8G8B8A8_UNORM) == NULL);
+    AT(!dvz_texture_resize(tex, (uvec3){1024, 1024, 1}));
+    AT(tex->image->width == 16);
+    AT(dvz_context_memory_stats(ctx).total == stats.total);
+
+    // The old buffer is kept alive while the enlarged one is created, both count in the budget.
+    dvz_context_memory_budget(ctx, stats.total + DVZ_BUFFER_TYPE_VERTEX_SIZE);
+    br_large = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, DVZ_BUFFER_TYPE_VERTEX_SIZE);
+    AT(br_large.buffer == NULL);
+    AT(dvz_context_memory_stats(ctx).total == stats.total);
+    AT(dvz_context_memory_stats(ctx).texture_count == stats.texture_count);
+
+    // The allocations within the existing buffers still succeed.
+    DvzBufferRegions br_small = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_VERTEX, 1, 1024);
+    AT(br_small.buffer != NULL);
+
+    dvz_context_memory_budget(ctx, 0);
+    dvz_ctx_buffers_free(ctx, &br);
+    dvz_ctx_buffers_free(ctx, &br_small);
+    dvz_texture_destroy(tex);
+    return 0;
+}
+
+
+
 int test_context_transfer_buffer(TestContext* tc)
 {
     DvzContext* ctx = tc->context;
@@ -75,6 +196,147 @@ int test_context_transfer_buffer(TestContext* tc)
     for (uint32_t i = 0; i < 32; i++)
         AT(data_2[i] == i);
 
+    // With host-visible device-local memory, the data has been written directly.
+    if (br.buffer->mmap != NULL)
+        AT(memcmp((uint8_t*)br.buffer->mmap + br.offsets[0] + 64, data, 32) == 0);
+
+    return 0;
+}
+
+
+
+int test_context_transfer_batch(TestContext* tc)
+{
+    DvzContext* ctx = tc->context;
+    ASSERT(ctx != NULL);
+    DvzApp* app = ctx->gpu->app;
+    ASSERT(app != NULL);
+
+    // Allocate buffers.
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, 256);
+    AT(br.count == 1);
+
+    uint8_t data[256] = {0};
+    for (uint32_t i = 0; i < 256; i++)
+        data[i] = i;
+
+    // HACK: pretend the event loop is running so that the transfers are enqueued, and processed
+    // together in the same batch.
+    app->is_running = true;
+    dvz_upload_buffer(ctx, br, 0, 64, data);
+    dvz_upload_buffer(ctx, br, 64, 64, &data[64]);
+    dvz_upload_buffer(ctx, br, 128, 128, &data[128]);
+    AT(!ctx->transfers.is_empty);
+
+    // Overlapping upload in the same batch: the last one wins.
+    uint8_t ones[16] = {0};
+    memset(ones, 1, 16);
+    dvz_upload_buffer(ctx, br, 32, 16, ones);
+
+    uint8_t data_2[256] = {0};
+    dvz_download_buffer(ctx, br, 0, 256, data_2);
+    dvz_process_transfers(ctx);
+    app->is_running = false;
+
+    // The downloaded data is available once dvz_process_transfers() returns.
+    AT(ctx->transfers.is_empty);
+    AT(!ctx->transfer_batch.recording);
+    AT(ctx->transfer_batch.copies_count == 0);
+    for (uint32_t i = 0; i < 256; i++)
+        AT(data_2[i] == (32 <= i && i < 48 ? 1 : i));
+
+    return 0;
+}
+
+
+
+int test_context_transfer_chunks(TestContext* tc)
+{
+    DvzContext* ctx = tc->context;
+    ASSERT(ctx != NULL);
+
+    DvzBuffer* staging = (DvzBuffer*)dvz_container_get(&ctx->buffers, DVZ_BUFFER_TYPE_STAGING);
+    VkDeviceSize staging_size = staging->size;
+
+    // Transfer more data than the staging buffer can hold.
+    VkDeviceSize size = staging_size + staging_size / 4;
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, size);
+    AT(br.count == 1);
+
+    uint32_t n = (uint32_t)(size / sizeof(uint32_t));
+    uint32_t* data = (uint32_t*)calloc(n, sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++)
+        data[i] = i;
+    dvz_upload_buffer(ctx, br, 0, size, data);
+
+    uint32_t* data_2 = (uint32_t*)calloc(n, sizeof(uint32_t));
+    dvz_download_buffer(ctx, br, 0, size, data_2);
+    AT(memcmp(data, data_2, size) == 0);
+
+    // The transfers have been split into chunks instead of growing the staging buffer.
+    AT(staging->size == staging_size);
+
+    FREE(data);
+    FREE(data_2);
+    return 0;
+}
+
+
+
+static void _download_callback(
+    DvzContext* context, uint64_t download_id, void* data, VkDeviceSize size, void* user_data)
+{
+    ASSERT(context != NULL);
+    ASSERT(data != NULL);
+    ASSERT(size > 0);
+    ASSERT(user_data != NULL);
+    // The callbacks are called without the GPU lock.
+    ASSERT(context->gpu->lock_depth == 0);
+    *((uint64_t*)user_data) = download_id;
+}
+
+
+
+int test_context_download_async(TestContext* tc)
+{
+    DvzContext* ctx = tc->context;
+    ASSERT(ctx != NULL);
+    DvzApp* app = ctx->gpu->app;
+    ASSERT(app != NULL);
+
+    DvzBufferRegions br = dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, 256);
+    uint8_t data[256] = {0};
+    for (uint32_t i = 0; i < 256; i++)
+        data[i] = i;
+    dvz_upload_buffer(ctx, br, 0, 256, data);
+
+    // HACK: pretend the event loop is running so that the download does not block.
+    app->is_running = true;
+    uint8_t data_2[128] = {0};
+    uint64_t completed = 0;
+    uint64_t id =
+        dvz_download_buffer_async(ctx, br, 64, 128, data_2, _download_callback, &completed);
+    AT(id > 0);
+    AT(!dvz_download_done(ctx, id));
+
+    // The completion is polled at every call, as in the event loop.
+    for (uint32_t k = 0; k < 1000 && !dvz_download_done(ctx, id); k++)
+        dvz_process_transfers(ctx);
+    app->is_running = false;
+
+    AT(dvz_download_done(ctx, id));
+    AT(completed == id);
+    for (uint32_t i = 0; i < 128; i++)
+        AT(data_2[i] == 64 + i);
+
+    // Outside of the event loop, the download completes before the function returns.
+    memset(data_2, 0, 128);
+    id = dvz_download_buffer_async(ctx, br, 0, 128, data_2, _download_callback, &completed);
+    AT(dvz_download_done(ctx, id));
+    AT(completed == id);
+    for (uint32_t i = 0; i < 128; i++)
+        AT(data_2[i] == i);
+
     return 0;
 }
 
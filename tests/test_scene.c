@@ -154,6 +154,167 @@ int test_scene_double(TestContext* tc)
 
 
 
+int test_scene_async(TestContext* tc)
+{
+    DvzCanvas* canvas = tc->canvas;
+    ASSERT(canvas != NULL);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 2);
+    dvz_scene_async_updates(scene, true);
+
+    _add_visual(dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0));
+    _add_visual(dvz_scene_panel(scene, 0, 1, DVZ_CONTROLLER_PANZOOM, 0));
+    dvz_app_run(canvas->app, N_FRAMES);
+
+    // The baked visuals have been committed, and their uploads have been processed.
+    DvzContext* context = canvas->gpu->context;
+    AT(scene->async_upload_pass > 0);
+    AT(atomic_load(&context->transfer_passes_done) >= scene->async_upload_pass);
+
+    // Stopping the thread uploads the last baked visuals.
+    dvz_scene_async_updates(scene, false);
+
+    // Same screenshot as with the synchronous scene updates.
+    return _scene_run(scene, "double");
+}
+
+
+
+static DvzVisualDataCallback _bake_default;
+
+// Count the bakes of a visual in its user data, before calling its original bake callback.
+static void _bake_count(DvzVisual* visual, DvzVisualDataEvent ev)
+{
+    ASSERT(visual != NULL);
+    ASSERT(visual->user_data != NULL);
+    (*(uint32_t*)visual->user_data)++;
+    _bake_default(visual, ev);
+}
+
+int test_scene_dirty(TestContext* tc)
+{
+    DvzCanvas* canvas = tc->canvas;
+    ASSERT(canvas != NULL);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+
+    // Two visuals transformed with the panel data coordinates.
+    uint32_t bakes[2] = {0};
+    DvzVisual* visuals[2] = {0};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        visuals[i] = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+        _point_data(visuals[i], 50);
+        visuals[i]->user_data = &bakes[i];
+        _bake_default = visuals[i]->callback_bake;
+        dvz_visual_callback_bake(visuals[i], _bake_count);
+    }
+    dvz_app_run(canvas->app, 5);
+    AT(bakes[0] > 0);
+    AT(bakes[1] > 0);
+
+    // An idle scene has no pending update, and bakes nothing.
+    memset(bakes, 0, sizeof(bakes));
+    dvz_app_run(canvas->app, 5);
+    AT(bakes[0] == 0);
+    AT(bakes[1] == 0);
+    AT(dvz_fifo_size(&scene->update_fifo) == 0);
+    AT(scene->visuals_changed_count == 0);
+    AT(scene->panels_changed_count == 0);
+
+    // Enlarging the first visual moves the panel box, so that the second visual is renormalized.
+    // Each visual is baked exactly once.
+    DvzBox box = panel->data_coords.box;
+    uint32_t n = 50;
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        pos[i][0] = 10 * cos(M_2PI * i / (double)n);
+        pos[i][1] = 10 * sin(M_2PI * i / (double)n);
+    }
+    dvz_visual_data(visuals[0], DVZ_PROP_POS, 0, n, pos);
+    FREE(pos);
+    dvz_app_run(canvas->app, 5);
+    AT(panel->data_coords.box.p1[0] > box.p1[0]);
+    AT(bakes[0] == 1);
+    AT(bakes[1] == 1);
+    AT(scene->panels_changed_count == 0);
+
+    dvz_scene_destroy(scene);
+    return 0;
+}
+
+
+
+static DvzVisualFillCallback _fill_default;
+
+// Count the command buffer recordings of a visual in its user data.
+static void _fill_count(DvzVisual* visual, DvzVisualFillEvent ev)
+{
+    ASSERT(visual != NULL);
+    ASSERT(visual->user_data != NULL);
+    (*(uint32_t*)visual->user_data)++;
+    _fill_default(visual, ev);
+}
+
+int test_scene_partial_refill(TestContext* tc)
+{
+    DvzCanvas* canvas = tc->canvas;
+    ASSERT(canvas != NULL);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 2);
+
+    // One visual per panel.
+    uint32_t fills[2] = {0};
+    DvzPanel* panels[2] = {0};
+    DvzVisual* visuals[2] = {0};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        panels[i] = dvz_scene_panel(scene, 0, i, DVZ_CONTROLLER_PANZOOM, 0);
+        visuals[i] = dvz_scene_visual(panels[i], DVZ_VISUAL_POINT, 0);
+        _point_data(visuals[i], 50);
+        visuals[i]->user_data = &fills[i];
+        _fill_default = visuals[i]->callback_fill;
+        dvz_visual_fill_callback(visuals[i], _fill_count);
+    }
+    dvz_app_run(canvas->app, 5);
+    AT(fills[0] > 0);
+    AT(fills[1] > 0);
+
+    uint32_t img_count = canvas->swapchain.img_count;
+    uint32_t epoch = atomic_load(&canvas->refills.epoch);
+    bool cmds_valid[DVZ_MAX_SWAPCHAIN_IMAGES] = {0};
+    uint32_t cmds_epoch[DVZ_MAX_SWAPCHAIN_IMAGES] = {0};
+    memcpy(cmds_valid, panels[1]->cmds_valid, sizeof(cmds_valid));
+    memcpy(cmds_epoch, panels[1]->cmds_epoch, sizeof(cmds_epoch));
+    for (uint32_t i = 0; i < img_count; i++)
+        AT(cmds_valid[i]);
+
+    // Changing the item count of the first visual only records the first panel again, in a
+    // partial refill.
+    memset(fills, 0, sizeof(fills));
+    _point_data(visuals[0], 100);
+    dvz_app_run(canvas->app, 5);
+    AT(fills[0] >= img_count);
+    AT(fills[1] == 0);
+    AT(atomic_load(&canvas->refills.epoch) == epoch);
+    for (uint32_t i = 0; i < img_count; i++)
+    {
+        AT(panels[0]->cmds_valid[i]);
+        AT(panels[0]->cmds_epoch[i] == epoch);
+    }
+
+    // The command buffers of the untouched panel are preserved.
+    AT(memcmp(panels[1]->cmds_valid, cmds_valid, sizeof(cmds_valid)) == 0);
+    AT(memcmp(panels[1]->cmds_epoch, cmds_epoch, sizeof(cmds_epoch)) == 0);
+
+    dvz_scene_destroy(scene);
+    return 0;
+}
+
+
+
 int test_scene_multiple(TestContext* tc)
 {
     DvzCanvas* canvas = tc->canvas;
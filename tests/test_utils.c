@@ -1,7 +1,11 @@
+#include <sched.h>
+
+#include "../include/datoviz/alloc.h"
 #include "../include/datoviz/array.h"
 #include "../include/datoviz/common.h"
 #include "../include/datoviz/fifo.h"
 #include "../include/datoviz/transforms.h"
+#include "../include/datoviz/workers.h"
 #include "../src/ticks.h"
 #include "../src/transforms_utils.h"
 #include "tests.h"
@@ -293,6 +297,14 @@ int test_utils_fifo_resize(TestContext* tc)
         AT(*n == i + 32);
         i++;
     }
+
+    // The pointer queues can grow beyond the initial maximum capacity.
+    for (i = 0; i < 4 * DVZ_MAX_FIFO_CAPACITY; i++)
+        dvz_fifo_enqueue(&fifo, &numbers[i % 256]);
+    AT(dvz_fifo_size(&fifo) == 4 * DVZ_MAX_FIFO_CAPACITY);
+    for (i = 0; i < 4 * DVZ_MAX_FIFO_CAPACITY; i++)
+        AT(dvz_fifo_dequeue(&fifo, false) == &numbers[i % 256]);
+    AT(fifo.is_empty);
     dvz_fifo_destroy(&fifo);
     return 0;
 }
@@ -344,6 +356,262 @@ int test_utils_fifo_first(TestContext* tc)
 
 
 
+int test_utils_fifo_typed(TestContext* tc)
+{
+    DvzFifo fifo = dvz_fifo_typed(8, sizeof(dvec2));
+    AT(fifo.is_empty);
+
+    // The items are copied, so they can be enqueued from the stack.
+    for (uint32_t i = 0; i < 7; i++)
+    {
+        dvec2 item = {i, -(double)i};
+        AT(dvz_fifo_push(&fifo, item));
+    }
+
+    // The capacity is fixed, the queue is full.
+    AT(!dvz_fifo_push(&fifo, (dvec2){7, -7}));
+    AT(!dvz_fifo_push_first(&fifo, (dvec2){-1, 1}));
+    AT(fifo.capacity == 8);
+    AT(dvz_fifo_size(&fifo) == 7);
+
+    dvec2 out = {0};
+    AT(dvz_fifo_pop(&fifo, out, false));
+    AT(out[0] == 0 && out[1] == 0);
+    AT(dvz_fifo_push_first(&fifo, (dvec2){-1, 1}));
+    AT(((double*)dvz_fifo_peek(&fifo, 1))[0] == 1);
+
+    AT(dvz_fifo_pop(&fifo, out, false));
+    AT(out[0] == -1 && out[1] == 1);
+    for (uint32_t i = 1; i < 7; i++)
+    {
+        AT(dvz_fifo_pop(&fifo, out, false));
+        AT(out[0] == i && out[1] == -(double)i);
+    }
+    AT(!dvz_fifo_pop(&fifo, out, false));
+    AT(fifo.is_empty);
+
+    dvz_fifo_destroy(&fifo);
+    return 0;
+}
+
+
+
+#define FIFO_MPSC_PRODUCERS 4
+#define FIFO_MPSC_ITEMS     1000
+
+typedef struct
+{
+    DvzFifo* fifo;
+    uint32_t idx;
+} FifoProducer;
+
+static void* _fifo_mpsc_thread(void* arg)
+{
+    FifoProducer* producer = arg;
+    // The queue never blocks the producers, they retry when it is full.
+    for (uint32_t i = 0; i < FIFO_MPSC_ITEMS; i++)
+        while (!dvz_fifo_push(producer->fifo, (uint32_t[]){producer->idx, i}))
+            sched_yield();
+    return NULL;
+}
+
+static bool _fifo_even(const void* item, void* user_data)
+{
+    return ((const uint32_t*)item)[1] % 2 == 0;
+}
+
+int test_utils_fifo_mpsc(TestContext* tc)
+{
+    // The capacity is rounded up to a power of two.
+    DvzFifo fifo = dvz_fifo_mpsc(12, 2 * sizeof(uint32_t));
+    AT(fifo.capacity == 16);
+
+    uint32_t out[2] = {0};
+    AT(!dvz_fifo_pop(&fifo, out, false));
+    for (uint32_t i = 0; i < 10; i++)
+        dvz_fifo_push(&fifo, (uint32_t[]){0, i});
+    AT(dvz_fifo_size(&fifo) == 10);
+    AT(((uint32_t*)dvz_fifo_peek(&fifo, 2))[1] == 2);
+    AT(dvz_fifo_peek(&fifo, 10) == NULL);
+
+    // Discard the oldest items.
+    dvz_fifo_discard(&fifo, 4);
+    AT(dvz_fifo_size(&fifo) == 4);
+    AT(dvz_fifo_pop(&fifo, out, false));
+    AT(out[1] == 6);
+
+    // Conditional dequeue.
+    AT(!dvz_fifo_pop_if(&fifo, out, _fifo_even, NULL));
+    AT(dvz_fifo_pop(&fifo, out, false));
+    AT(dvz_fifo_pop_if(&fifo, out, _fifo_even, NULL));
+    AT(out[1] == 8);
+    dvz_fifo_reset(&fifo);
+    AT(dvz_fifo_size(&fifo) == 0);
+
+    // Pushing into a full queue fails immediately.
+    for (uint32_t i = 0; i < 16; i++)
+        AT(dvz_fifo_push(&fifo, (uint32_t[]){0, i}));
+    AT(!dvz_fifo_push(&fifo, (uint32_t[]){0, 16}));
+    AT(dvz_fifo_size(&fifo) == 16);
+    AT(dvz_fifo_pop(&fifo, out, false));
+    AT(out[1] == 0);
+    AT(dvz_fifo_push(&fifo, (uint32_t[]){0, 16}));
+    dvz_fifo_reset(&fifo);
+
+    // Several producers, the queue is smaller than the number of items, so that the producers
+    // have to wait for the consumer.
+    pthread_t threads[FIFO_MPSC_PRODUCERS] = {0};
+    FifoProducer producers[FIFO_MPSC_PRODUCERS] = {0};
+    for (uint32_t i = 0; i < FIFO_MPSC_PRODUCERS; i++)
+    {
+        producers[i] = (FifoProducer){&fifo, i};
+        pthread_create(&threads[i], NULL, _fifo_mpsc_thread, &producers[i]);
+    }
+
+    // The items of each producer are dequeued in order.
+    uint32_t next[FIFO_MPSC_PRODUCERS] = {0};
+    for (uint32_t i = 0; i < FIFO_MPSC_PRODUCERS * FIFO_MPSC_ITEMS; i++)
+    {
+        AT(dvz_fifo_pop(&fifo, out, true));
+        AT(out[0] < FIFO_MPSC_PRODUCERS);
+        AT(out[1] == next[out[0]]);
+        next[out[0]]++;
+    }
+    for (uint32_t i = 0; i < FIFO_MPSC_PRODUCERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        AT(next[i] == FIFO_MPSC_ITEMS);
+    }
+    AT(dvz_fifo_size(&fifo) == 0);
+
+    dvz_fifo_destroy(&fifo);
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Thread pool                                                                                  */
+/*************************************************************************************************/
+
+#define WORKERS_TASKS 1000
+
+static void _workers_task(void* user_data)
+{
+    atomic(uint32_t, *counter) = user_data;
+    atomic_fetch_add(counter, 1);
+}
+
+static void _workers_block(void* user_data)
+{
+    atomic(uint32_t, *release) = user_data;
+    while (atomic_load(release) == 0)
+        dvz_sleep(1);
+}
+
+int test_utils_workers(TestContext* tc)
+{
+    atomic(uint32_t, counter);
+    atomic_init(&counter, 0);
+
+    // Without worker threads, the tasks run in the calling thread.
+    DvzWorkers* workers = dvz_workers(0);
+    for (uint32_t i = 0; i < 10; i++)
+        dvz_workers_submit(workers, _workers_task, &counter);
+    AT(atomic_load(&counter) == 10);
+    dvz_workers_wait(workers);
+    dvz_workers_destroy(workers);
+
+    // More tasks than the queue capacity.
+    atomic_store(&counter, 0);
+    workers = dvz_workers(4);
+    AT(workers->count == 4);
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        for (uint32_t i = 0; i < WORKERS_TASKS; i++)
+            dvz_workers_submit(workers, _workers_task, &counter);
+        dvz_workers_wait(workers);
+        AT(atomic_load(&counter) == (k + 1) * WORKERS_TASKS);
+    }
+
+    // Waiting for a group does not wait for the tasks of another group.
+    atomic(uint32_t, release);
+    atomic_init(&release, 0);
+    DvzWorkerGroup blocked = dvz_workers_group(workers);
+    DvzWorkerGroup group = dvz_workers_group(workers);
+    dvz_workers_group_submit(&blocked, _workers_block, &release);
+    atomic_store(&counter, 0);
+    for (uint32_t i = 0; i < WORKERS_TASKS; i++)
+        dvz_workers_group_submit(&group, _workers_task, &counter);
+    dvz_workers_group_wait(&group);
+    AT(atomic_load(&counter) == WORKERS_TASKS);
+    AT(atomic_load(&blocked.pending) == 1);
+    atomic_store(&release, 1);
+    dvz_workers_group_wait(&blocked);
+    AT(atomic_load(&blocked.pending) == 0);
+
+    dvz_workers_destroy(workers);
+
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Sub-allocator                                                                                */
+/*************************************************************************************************/
+
+int test_utils_alloc(TestContext* tc)
+{
+    DvzAlloc alloc = dvz_alloc(1024, 16);
+    uint64_t resized = 0;
+
+    // Allocated sizes are aligned.
+    AT(dvz_alloc_new(&alloc, 10, &resized) == 0);
+    AT(resized == 0);
+    AT(dvz_alloc_get(&alloc, 0) == 16);
+    AT(dvz_alloc_new(&alloc, 100, NULL) == 16);
+    AT(dvz_alloc_new(&alloc, 16, NULL) == 128);
+    AT(dvz_alloc_size(&alloc) == 144);
+    AT(dvz_alloc_end(&alloc) == 144);
+
+    // Free a region and reuse it.
+    dvz_alloc_free(&alloc, 16);
+    AT(dvz_alloc_size(&alloc) == 32);
+    AT(dvz_alloc_new(&alloc, 64, NULL) == 16);
+    AT(dvz_alloc_new(&alloc, 32, NULL) == 80);
+
+    // Resize in place.
+    AT(dvz_alloc_resize(&alloc, 128, 512));
+    AT(dvz_alloc_get(&alloc, 128) == 512);
+    AT(!dvz_alloc_resize(&alloc, 16, 128));
+    AT(dvz_alloc_resize(&alloc, 16, 32));
+    AT(dvz_alloc_new(&alloc, 32, NULL) == 48);
+
+    // Enlarge the managed memory.
+    AT(dvz_alloc_new_size(&alloc, 16) == 1024);
+    AT(dvz_alloc_new_size(&alloc, 1000) == 2048);
+    AT(dvz_alloc_new(&alloc, 1000, &resized) == 640);
+    AT(resized == 2048);
+    AT(alloc.total_size == 2048);
+
+    // Free all regions: the free blocks are merged.
+    dvz_alloc_free(&alloc, 0);
+    dvz_alloc_free(&alloc, 640);
+    dvz_alloc_free(&alloc, 16);
+    dvz_alloc_free(&alloc, 48);
+    dvz_alloc_free(&alloc, 128);
+    dvz_alloc_free(&alloc, 80);
+    AT(alloc.count == 1);
+    AT(dvz_alloc_size(&alloc) == 0);
+    AT(dvz_alloc_end(&alloc) == 0);
+
+    dvz_alloc_destroy(&alloc);
+    return 0;
+}
+
+
+
 /*************************************************************************************************/
 /*  Deq tests                                                                                    */
 /*************************************************************************************************/
@@ -439,6 +707,42 @@ int test_utils_deq_2(TestContext* tc)
 
 
 
+#define DEQ_FULL_ITEMS (3 * DVZ_MAX_FIFO_CAPACITY)
+
+int test_utils_deq_full(TestContext* tc)
+{
+    DvzDeq deq = dvz_deq(1);
+    DvzDeqItem item = {0};
+    int values[DEQ_FULL_ITEMS + 1] = {0};
+    for (int i = 0; i <= DEQ_FULL_ITEMS; i++)
+        values[i] = i;
+
+    // Wrap the ring around before filling the queue.
+    for (int i = 0; i < 10; i++)
+        dvz_deq_enqueue(&deq, 0, 0, &values[0]);
+    for (int i = 0; i < 10; i++)
+        AT(dvz_deq_dequeue(&deq, false).item == &values[0]);
+
+    // Enqueue more items than the initial capacity, none of them is dropped.
+    for (int i = 1; i <= DEQ_FULL_ITEMS; i++)
+        dvz_deq_enqueue(&deq, 0, 0, &values[i]);
+    dvz_deq_enqueue_first(&deq, 0, 0, &values[0]);
+    AT(dvz_fifo_size(&deq.queues[0]) == DEQ_FULL_ITEMS + 1);
+
+    // The items are dequeued in order.
+    for (int i = 0; i <= DEQ_FULL_ITEMS; i++)
+    {
+        item = dvz_deq_dequeue(&deq, false);
+        AT(item.item == &values[i]);
+    }
+    AT(dvz_deq_dequeue(&deq, false).item == NULL);
+
+    dvz_deq_destroy(&deq);
+    return 0;
+}
+
+
+
 /*************************************************************************************************/
 /*  Array tests                                                                                  */
 /*************************************************************************************************/
@@ -677,6 +981,68 @@ int test_utils_array_cast(TestContext* tc)
         AT(item->b == (i % 2 == 0 ? i + .5 : 0));
     }
 
+    // Batch cast of positions.
+    const uint32_t N = 100;
+    DvzArray pos = dvz_array(N, DVZ_DTYPE_DVEC3);
+    DvzArray pos_f = dvz_array(0, DVZ_DTYPE_VEC3);
+    for (uint32_t i = 0; i < 3 * N; i++)
+        ((double*)pos.data)[i] = i + .5;
+    AT(dvz_array_cast(&pos, &pos_f));
+    AT(pos_f.item_count == N);
+    for (uint32_t i = 0; i < 3 * N; i++)
+        AT(((float*)pos_f.data)[i] == i + .5f);
+
+    // Arrays with the same dtype are copied, unsupported casts leave the array unchanged.
+    DvzArray pos_copy = dvz_array(0, DVZ_DTYPE_VEC3);
+    AT(dvz_array_cast(&pos_f, &pos_copy));
+    AT(memcmp(pos_copy.data, pos_f.data, pos_f.buffer_size) == 0);
+    DvzArray pos_u = dvz_array(0, DVZ_DTYPE_UINT);
+    AT(!dvz_array_cast(&pos, &pos_u));
+    AT(pos_u.item_count == 0);
+
+    dvz_array_destroy(&arr);
+    dvz_array_destroy(&pos);
+    dvz_array_destroy(&pos_f);
+    dvz_array_destroy(&pos_copy);
+    dvz_array_destroy(&pos_u);
+    return 0;
+}
+
+
+
+int test_utils_array_column(TestContext* tc)
+{
+    const uint32_t N = 10;
+    DvzArray arr = dvz_array_struct(N, sizeof(DvzVertex));
+    DvzVertex* item = NULL;
+    dvec3 pos[] = {{1, 2, 3}, {4, 5, 6}};
+
+    // Cast with repeats, on a partial range: items 2 to 5 take the first value, and the last
+    // value is repeated until the end.
+    dvz_array_column(
+        &arr, offsetof(DvzVertex, pos), sizeof(dvec3), 2, N - 2, 2, pos, DVZ_DTYPE_DVEC3,
+        DVZ_DTYPE_VEC3, DVZ_ARRAY_COPY_REPEAT, 4);
+    for (uint32_t i = 0; i < N; i++)
+    {
+        item = dvz_array_item(&arr, i);
+        for (uint32_t k = 0; k < 3; k++)
+            AT(item->pos[k] == (i < 2 ? 0 : pos[i < 6 ? 0 : 1][k]));
+    }
+
+    // Single copy of each group of repeats.
+    cvec4 color[] = {{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}};
+    dvz_array_column(
+        &arr, offsetof(DvzVertex, color), sizeof(cvec4), 0, N, 3, color, 0, 0,
+        DVZ_ARRAY_COPY_SINGLE, 4);
+    for (uint32_t i = 0; i < N; i++)
+    {
+        item = dvz_array_item(&arr, i);
+        if (i % 4 == 0)
+            AT(memcmp(item->color, color[i / 4], sizeof(cvec4)) == 0);
+        else
+            AT(item->color[0] == 0);
+    }
+
     dvz_array_destroy(&arr);
     return 0;
 }
@@ -222,6 +222,59 @@ int test_vislib_line_strip(TestContext* tc)
 
 
 
+int test_vislib_line_strip_stream(TestContext* tc)
+{
+    DvzCanvas* canvas = tc->canvas;
+    ASSERT(canvas != NULL);
+
+    // Make visual.
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_LINE_STRIP, 0);
+    _visual_common(&visual);
+
+    // Ring buffer with a fixed capacity.
+    const uint32_t capacity = 1000;
+    dvz_visual_stream(&visual, capacity);
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, 1, (cvec4){255, 0, 0, 255});
+
+    // Append the samples by chunks.
+    const uint32_t n = 2500, chunk = 100;
+    dvec3* pos = calloc(chunk, sizeof(dvec3));
+    for (uint32_t i = 0; i < n; i += chunk)
+    {
+        for (uint32_t j = 0; j < chunk; j++)
+        {
+            pos[j][0] = -1 + 2 * ((i + j) % capacity) / (double)capacity;
+            pos[j][1] = .5 * sin(M_2PI * (i + j) / (double)capacity);
+        }
+        dvz_visual_data_append(&visual, DVZ_PROP_POS, 0, chunk, pos);
+        dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+    }
+    FREE(pos);
+
+    // The oldest samples have been dropped.
+    AT(dvz_visual_item_count(&visual) == capacity);
+    AT(visual.stream.count == n);
+    DvzSource* source = dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    AT(source->arr.item_count == capacity + 1);
+    DvzProp* prop = dvz_prop_get(&visual, DVZ_PROP_POS, 0);
+    AT(prop->arr_orig.item_count == capacity);
+    AT(((dvec3*)dvz_array_item(&prop->arr_orig, 0))[0][0] == -1);
+
+    // Two draws from the oldest sample, going through the extra item joining the two parts.
+    AT(visual.stream.draws[0].firstVertex == n % capacity);
+    AT(visual.stream.draws[0].vertexCount == capacity - n % capacity + 1);
+    AT(visual.stream.draws[1].firstVertex == 0);
+    AT(visual.stream.draws[1].vertexCount == n % capacity);
+
+    // Run app.
+    dvz_app_run(canvas->app, N_FRAMES);
+    dvz_visual_destroy(&visual);
+    return 0;
+}
+
+
+
 int test_vislib_triangle_list(TestContext* tc)
 {
     DvzCanvas* canvas = tc->canvas;
@@ -465,6 +465,151 @@ int test_visuals_partial(TestContext* tc)
 
 
 
+int test_visuals_partial_ranges(TestContext* tc)
+{
+    DvzCanvas* canvas = tc->canvas;
+    DvzContext* context = tc->context;
+
+    ASSERT(canvas != NULL);
+    ASSERT(context != NULL);
+
+    // Create the visual.
+    DvzVisual visual = dvz_visual(canvas);
+    _visual_create(&visual);
+    _visual_bindings(&visual);
+
+    // Vertex data.
+    const uint32_t N = 12;
+    _visual_data(&visual, N);
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+
+    DvzSource* source = dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    AT(source != NULL);
+    AT(source->dirty.count == 0);
+
+    // Partial data updates only mark the changed vertices, adjacent ranges are merged.
+    cvec4 color = {1, 2, 3, 255};
+    dvz_visual_data_partial(&visual, DVZ_PROP_COLOR, 0, 2, 2, 1, color);
+    dvz_visual_data_partial(&visual, DVZ_PROP_COLOR, 0, 4, 1, 1, color);
+    dvz_visual_data_partial(&visual, DVZ_PROP_COLOR, 0, 8, 1, 1, color);
+    AT(source->dirty.count == 2);
+    AT(source->dirty.ranges[0][0] == 2 && source->dirty.ranges[0][1] == 5);
+    AT(source->dirty.ranges[1][0] == 8 && source->dirty.ranges[1][1] == 9);
+
+    // Only the dirty ranges are baked and uploaded.
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+    AT(source->dirty.count == 0);
+
+    // Check the vertex buffer.
+    VkDeviceSize size = N * sizeof(DvzVertex);
+    DvzVertex* vertices = calloc(N, sizeof(DvzVertex));
+    dvz_download_buffer(context, source->u.br, 0, size, vertices);
+    AT(memcmp(vertices, source->arr.data, size) == 0);
+    for (uint32_t i = 0; i < N; i++)
+        AT((memcmp(vertices[i].color, color, sizeof(cvec4)) == 0) ==
+           (i == 2 || i == 3 || i == 4 || i == 8));
+    FREE(vertices);
+
+    // Changing the number of items marks the whole source.
+    dvz_visual_data_append(&visual, DVZ_PROP_COLOR, 0, 1, color);
+    AT(source->dirty.count == 0);
+
+    _visual_destroy(&visual);
+    return 0;
+}
+
+
+
+static void _visual_release(void* data, void* user_data)
+{
+    ASSERT(data != NULL);
+    ASSERT(user_data != NULL);
+    (*(uint32_t*)user_data)++;
+}
+
+int test_visuals_wrap(TestContext* tc)
+{
+    DvzCanvas* canvas = tc->canvas;
+    DvzContext* context = tc->context;
+
+    ASSERT(canvas != NULL);
+    ASSERT(context != NULL);
+
+    // Create the visual.
+    DvzVisual visual = dvz_visual(canvas);
+    _visual_create(&visual);
+    _visual_bindings(&visual);
+
+    // The POS prop contains whole vertices, so that it has the layout of the vertex buffer.
+    DvzProp* prop = dvz_prop_get(&visual, DVZ_PROP_POS, 0);
+    dvz_visual_prop_size(prop, sizeof(DvzVertex));
+    dvz_visual_prop_copy(prop, 0, 0, DVZ_ARRAY_COPY_SINGLE, 1);
+    dvz_visual_prop_copy(dvz_prop_get(&visual, DVZ_PROP_COLOR, 0), 1, 0, DVZ_ARRAY_COPY_NONE, 1);
+
+    // Wrap the vertex data without copying it.
+    const uint32_t N = 12;
+    uint32_t released = 0;
+    DvzVertex* vertices = _visual_data_source(&visual, N);
+    dvz_visual_data_wrap(&visual, DVZ_PROP_POS, 0, N, vertices, _visual_release, &released);
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+
+    // The vertex buffer is uploaded directly from the wrapped data.
+    DvzSource* source = dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    AT(source != NULL);
+    AT(source->alias == prop);
+    AT(source->arr.data == vertices);
+    VkDeviceSize size = N * sizeof(DvzVertex);
+    DvzVertex* downloaded = calloc(N, sizeof(DvzVertex));
+    dvz_download_buffer(context, source->u.br, 0, size, downloaded);
+    AT(memcmp(downloaded, vertices, size) == 0);
+
+    // Data modified in place.
+    vertices[0].color[0] = 1;
+    dvz_visual_data_wrap(&visual, DVZ_PROP_POS, 0, N, vertices, _visual_release, &released);
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+    AT(released == 0);
+    dvz_download_buffer(context, source->u.br, 0, size, downloaded);
+    AT(memcmp(downloaded, vertices, size) == 0);
+
+    // A partial update copies the wrapped data and releases it.
+    DvzVertex vertex = vertices[0];
+    dvz_visual_data_partial(&visual, DVZ_PROP_POS, 0, 2, 1, 1, &vertex);
+    AT(released == 1);
+    AT(!prop->is_wrapped);
+    AT(source->alias == NULL);
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+    dvz_download_buffer(context, source->u.br, 0, size, downloaded);
+    AT(memcmp(&downloaded[2], &vertex, sizeof(DvzVertex)) == 0);
+    AT(memcmp(&downloaded[3], &vertices[3], (N - 3) * sizeof(DvzVertex)) == 0);
+
+    // In the event loop, the upload of the wrapped data is pending until the transfers are
+    // processed, so that wrapping other data only releases it after the transfers.
+    DvzApp* app = canvas->app;
+    DvzVertex* other = _visual_data_source(&visual, N);
+    other[0].color[0] = 2;
+    app->is_running = true;
+    dvz_visual_data_wrap(&visual, DVZ_PROP_POS, 0, N, other, _visual_release, &released);
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+    dvz_visual_data_wrap(&visual, DVZ_PROP_POS, 0, N, vertices, _visual_release, &released);
+    AT(released == 1);
+    dvz_process_transfers(context);
+    AT(released == 2);
+    app->is_running = false;
+    dvz_download_buffer(context, source->u.br, 0, size, downloaded);
+    AT(memcmp(downloaded, other, size) == 0);
+
+    // Destroying the visual releases the wrapped data.
+    _visual_destroy(&visual);
+    AT(released == 3);
+
+    FREE(vertices);
+    FREE(other);
+    FREE(downloaded);
+    return 0;
+}
+
+
+
 static void _visual_append(DvzCanvas* canvas, DvzEvent ev)
 {
     ASSERT(canvas != NULL);
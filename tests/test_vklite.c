@@ -452,6 +452,13 @@ int test_vklite_commands(TestContext* tc)
     dvz_cmd_reset(&cmds, 0);
     dvz_cmd_free(&cmds);
 
+    // Secondary command buffers have their own command pool.
+    DvzCommands secondary = dvz_commands_secondary(gpu, 0, 3);
+    AT(secondary.level == VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    AT(secondary.pool != VK_NULL_HANDLE);
+    dvz_commands_destroy(&secondary);
+    AT(secondary.pool == VK_NULL_HANDLE);
+
     dvz_app_destroy(app);
     return 0;
 }
@@ -474,6 +481,12 @@ int test_vklite_buffer_1(TestContext* tc)
     dvz_buffer_queue_access(&buffer, 0);
     dvz_buffer_create(&buffer);
 
+    // Host-visible buffers are permanently mapped.
+    AT(buffer.mmap != NULL);
+    AT(dvz_buffer_map(&buffer, 16, 16) == (uint8_t*)buffer.mmap + 16);
+    dvz_buffer_unmap(&buffer);
+    AT(buffer.mmap != NULL);
+
     // Send some data to the GPU.
     uint8_t* data = calloc(size, 1);
     for (uint32_t i = 0; i < size; i++)
@@ -516,8 +529,8 @@ int test_vklite_buffer_resize(TestContext* tc)
     dvz_buffer_queue_access(&buffer, 0);
     dvz_buffer_create(&buffer);
 
-    // Map the buffer.
-    buffer.mmap = dvz_buffer_map(&buffer, 0, VK_WHOLE_SIZE);
+    // Host-visible buffers are permanently mapped.
+    ASSERT(buffer.mmap != NULL);
 
     // Send some data to the GPU.
     uint8_t* data = calloc(size, 1);
@@ -530,7 +543,7 @@ int test_vklite_buffer_resize(TestContext* tc)
 
     // Resize the buffer.
     // DvzCommands cmds = dvz_commands(gpu, 0, 1);
-    // NOTE: this should automatically unmap, delete, create, remap, copy old data to new.
+    // NOTE: this should automatically delete, create, remap, copy old data to new.
     dvz_buffer_resize(&buffer, 2 * size);
     ASSERT(buffer.size == 2 * size);
     ASSERT(buffer.mmap != NULL);
@@ -547,9 +560,6 @@ int test_vklite_buffer_resize(TestContext* tc)
     FREE(data);
     FREE(data2);
 
-    // Unmap the buffer.
-    dvz_buffer_unmap(&buffer);
-    buffer.mmap = NULL;
     dvz_buffer_destroy(&buffer);
 
     dvz_app_destroy(app);
@@ -19,8 +19,13 @@ int test_utils_fifo_2(TestContext*);
 int test_utils_fifo_resize(TestContext*);
 int test_utils_fifo_discard(TestContext*);
 int test_utils_fifo_first(TestContext*);
+int test_utils_fifo_typed(TestContext*);
+int test_utils_fifo_mpsc(TestContext*);
+int test_utils_workers(TestContext*);
+int test_utils_alloc(TestContext*);
 int test_utils_deq_1(TestContext*);
 int test_utils_deq_2(TestContext*);
+int test_utils_deq_full(TestContext*);
 
 int test_utils_array_1(TestContext*);
 int test_utils_array_2(TestContext*);
@@ -30,6 +35,7 @@ int test_utils_array_5(TestContext*);
 int test_utils_array_6(TestContext*);
 int test_utils_array_7(TestContext*);
 int test_utils_array_cast(TestContext*);
+int test_utils_array_column(TestContext*);
 int test_utils_array_mvp(TestContext*);
 int test_utils_array_3D(TestContext*);
 
@@ -75,15 +81,23 @@ int test_vklite_canvas_triangle(TestContext*);
 
 // Test context.
 int test_context_buffer(TestContext*);
+int test_context_buffers_free(TestContext*);
+int test_context_buffers_grow(TestContext*);
+int test_context_memory(TestContext*);
 int test_context_texture(TestContext*);
 int test_context_compute(TestContext*);
 int test_context_transfer_buffer(TestContext*);
+int test_context_transfer_batch(TestContext*);
+int test_context_transfer_chunks(TestContext*);
+int test_context_download_async(TestContext*);
 int test_context_transfer_texture(TestContext*);
 int test_context_colormap_custom(TestContext*);
 
 // Test canvas.
 int test_canvas_blank(TestContext*);
 int test_canvas_multiple(TestContext*);
+int test_canvas_on_demand(TestContext*);
+int test_canvas_threads(TestContext*);
 int test_canvas_events(TestContext*);
 int test_canvas_gui(TestContext*);
 int test_canvas_screencast(TestContext*);
@@ -91,6 +105,7 @@ int test_canvas_video(TestContext*);
 
 int test_canvas_triangle_1(TestContext*);
 int test_canvas_triangle_resize(TestContext*);
+int test_canvas_triangle_latency(TestContext*);
 int test_canvas_triangle_offscreen(TestContext*);
 int test_canvas_triangle_push(TestContext*);
 int test_canvas_triangle_upload(TestContext*);
@@ -127,6 +142,8 @@ int test_visuals_props(TestContext*);
 int test_visuals_update_color(TestContext*);
 int test_visuals_update_pos(TestContext*);
 int test_visuals_partial(TestContext*);
+int test_visuals_partial_ranges(TestContext*);
+int test_visuals_wrap(TestContext*);
 int test_visuals_append(TestContext*);
 int test_visuals_shared(TestContext*);
 
@@ -134,6 +151,7 @@ int test_visuals_shared(TestContext*);
 int test_vislib_point(TestContext*);
 int test_vislib_line_list(TestContext*);
 int test_vislib_line_strip(TestContext*);
+int test_vislib_line_strip_stream(TestContext*);
 int test_vislib_triangle_list(TestContext*);
 int test_vislib_triangle_strip(TestContext*);
 int test_vislib_triangle_fan(TestContext*);
@@ -155,6 +173,9 @@ int test_scene_empty(TestContext*);
 int test_scene_empty_visuals(TestContext*);
 int test_scene_single(TestContext*);
 int test_scene_double(TestContext*);
+int test_scene_async(TestContext*);
+int test_scene_dirty(TestContext*);
+int test_scene_partial_refill(TestContext*);
 int test_scene_multiple(TestContext*);
 int test_scene_link(TestContext*);
 int test_scene_different_size(TestContext*);
@@ -181,8 +202,13 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE(NONE, test_utils_fifo_resize),      //
     CASE_FIXTURE(NONE, test_utils_fifo_discard),     //
     CASE_FIXTURE(NONE, test_utils_fifo_first),       //
+    CASE_FIXTURE(NONE, test_utils_fifo_typed),       //
+    CASE_FIXTURE(NONE, test_utils_fifo_mpsc),        //
+    CASE_FIXTURE(NONE, test_utils_workers),          //
+    CASE_FIXTURE(NONE, test_utils_alloc),            //
     CASE_FIXTURE(NONE, test_utils_deq_1),            //
     CASE_FIXTURE(NONE, test_utils_deq_2),            //
+    CASE_FIXTURE(NONE, test_utils_deq_full),         //
     CASE_FIXTURE(NONE, test_utils_array_1),          //
     CASE_FIXTURE(NONE, test_utils_array_2),          //
     CASE_FIXTURE(NONE, test_utils_array_3),          //
@@ -191,6 +217,7 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE(NONE, test_utils_array_6),          //
     CASE_FIXTURE(NONE, test_utils_array_7),          //
     CASE_FIXTURE(NONE, test_utils_array_cast),       //
+    CASE_FIXTURE(NONE, test_utils_array_column),     //
     CASE_FIXTURE(NONE, test_utils_array_mvp),        //
     CASE_FIXTURE(NONE, test_utils_array_3D),         //
     CASE_FIXTURE(NONE, test_utils_transforms_1),     //
@@ -232,21 +259,30 @@ static TestCase TEST_CASES[] = {
 
     // Context.
     CASE_FIXTURE(CONTEXT, test_context_buffer),           //
+    CASE_FIXTURE(CONTEXT, test_context_buffers_free),     //
+    CASE_FIXTURE(CONTEXT, test_context_buffers_grow),     //
+    CASE_FIXTURE(CONTEXT, test_context_memory),           //
     CASE_FIXTURE(CONTEXT, test_context_compute),          //
     CASE_FIXTURE(CONTEXT, test_context_texture),          //
     CASE_FIXTURE(CONTEXT, test_context_transfer_buffer),  //
+    CASE_FIXTURE(CONTEXT, test_context_transfer_batch),   //
+    CASE_FIXTURE(CONTEXT, test_context_transfer_chunks),  //
+    CASE_FIXTURE(CONTEXT, test_context_download_async),   //
     CASE_FIXTURE(CONTEXT, test_context_transfer_texture), //
     CASE_FIXTURE(CONTEXT, test_context_colormap_custom),  //
 
     // Canvas.
     CASE_FIXTURE(APP, test_canvas_blank),              //
     CASE_FIXTURE(APP, test_canvas_multiple),           //
+    CASE_FIXTURE(APP, test_canvas_on_demand),          //
+    CASE_FIXTURE(APP, test_canvas_threads),            //
     CASE_FIXTURE(APP, test_canvas_events),             //
     CASE_FIXTURE(APP, test_canvas_gui),                //
     CASE_FIXTURE(APP, test_canvas_screencast),         //
     CASE_FIXTURE(APP, test_canvas_video),              //
     CASE_FIXTURE(APP, test_canvas_triangle_1),         //
     CASE_FIXTURE(APP, test_canvas_triangle_resize),    //
+    CASE_FIXTURE(APP, test_canvas_triangle_latency),   //
     CASE_FIXTURE(APP, test_canvas_triangle_offscreen), //
     CASE_FIXTURE(APP, test_canvas_triangle_push),      //
     CASE_FIXTURE(APP, test_canvas_triangle_upload),    //
@@ -278,39 +314,45 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE(CANVAS, test_graphics_mesh),           //
 
     // Visuals.
-    CASE_FIXTURE(CANVAS, test_visuals_sources),      //
-    CASE_FIXTURE(CANVAS, test_visuals_props),        //
-    CASE_FIXTURE(CANVAS, test_visuals_update_color), //
-    CASE_FIXTURE(CANVAS, test_visuals_update_pos),   //
-    CASE_FIXTURE(CANVAS, test_visuals_partial),      //
-    CASE_FIXTURE(CANVAS, test_visuals_append),       //
-    CASE_FIXTURE(CANVAS, test_visuals_shared),       //
+    CASE_FIXTURE(CANVAS, test_visuals_sources),        //
+    CASE_FIXTURE(CANVAS, test_visuals_props),          //
+    CASE_FIXTURE(CANVAS, test_visuals_update_color),   //
+    CASE_FIXTURE(CANVAS, test_visuals_update_pos),     //
+    CASE_FIXTURE(CANVAS, test_visuals_partial),        //
+    CASE_FIXTURE(CANVAS, test_visuals_partial_ranges), //
+    CASE_FIXTURE(CANVAS, test_visuals_wrap),           //
+    CASE_FIXTURE(CANVAS, test_visuals_append),         //
+    CASE_FIXTURE(CANVAS, test_visuals_shared),         //
 
     // Builtin visuals.
-    CASE_FIXTURE(CANVAS, test_vislib_point),          //
-    CASE_FIXTURE(CANVAS, test_vislib_line_list),      //
-    CASE_FIXTURE(CANVAS, test_vislib_line_strip),     //
-    CASE_FIXTURE(CANVAS, test_vislib_triangle_list),  //
-    CASE_FIXTURE(CANVAS, test_vislib_triangle_strip), //
-    CASE_FIXTURE(CANVAS, test_vislib_triangle_fan),   //
-    CASE_FIXTURE(CANVAS, test_vislib_rectangle),      //
-    CASE_FIXTURE(CANVAS, test_vislib_marker),         //
-    CASE_FIXTURE(CANVAS, test_vislib_polygon),        //
-    CASE_FIXTURE(CANVAS, test_vislib_path),           //
-    CASE_FIXTURE(CANVAS, test_vislib_text),           //
-    CASE_FIXTURE(CANVAS, test_vislib_image_1),        //
-    CASE_FIXTURE(CANVAS, test_vislib_image_cmap),     //
-    CASE_FIXTURE(CANVAS, test_vislib_axes_2D_x),      //
-    CASE_FIXTURE(CANVAS, test_vislib_axes_2D_y),      //
-    CASE_FIXTURE(CANVAS, test_vislib_mesh),           //
-    CASE_FIXTURE(CANVAS, test_vislib_volume),         //
-    CASE_FIXTURE(CANVAS, test_vislib_volume_slice),   //
+    CASE_FIXTURE(CANVAS, test_vislib_point),             //
+    CASE_FIXTURE(CANVAS, test_vislib_line_list),         //
+    CASE_FIXTURE(CANVAS, test_vislib_line_strip),        //
+    CASE_FIXTURE(CANVAS, test_vislib_line_strip_stream), //
+    CASE_FIXTURE(CANVAS, test_vislib_triangle_list),     //
+    CASE_FIXTURE(CANVAS, test_vislib_triangle_strip),    //
+    CASE_FIXTURE(CANVAS, test_vislib_triangle_fan),      //
+    CASE_FIXTURE(CANVAS, test_vislib_rectangle),         //
+    CASE_FIXTURE(CANVAS, test_vislib_marker),            //
+    CASE_FIXTURE(CANVAS, test_vislib_polygon),           //
+    CASE_FIXTURE(CANVAS, test_vislib_path),              //
+    CASE_FIXTURE(CANVAS, test_vislib_text),              //
+    CASE_FIXTURE(CANVAS, test_vislib_image_1),           //
+    CASE_FIXTURE(CANVAS, test_vislib_image_cmap),        //
+    CASE_FIXTURE(CANVAS, test_vislib_axes_2D_x),         //
+    CASE_FIXTURE(CANVAS, test_vislib_axes_2D_y),         //
+    CASE_FIXTURE(CANVAS, test_vislib_mesh),              //
+    CASE_FIXTURE(CANVAS, test_vislib_volume),            //
+    CASE_FIXTURE(CANVAS, test_vislib_volume_slice),      //
 
     // Scene.
     CASE_FIXTURE(CANVAS, test_scene_empty),                 //
     CASE_FIXTURE(CANVAS, test_scene_empty_visuals),         //
     CASE_FIXTURE(CANVAS, test_scene_single),                //
     CASE_FIXTURE(CANVAS, test_scene_double),                //
+    CASE_FIXTURE(CANVAS, test_scene_async),                 //
+    CASE_FIXTURE(CANVAS, test_scene_dirty),                 //
+    CASE_FIXTURE(CANVAS, test_scene_partial_refill),        //
     CASE_FIXTURE(CANVAS, test_scene_multiple),              //
     CASE_FIXTURE(CANVAS, test_scene_link),                  //
     CASE_FIXTURE(CANVAS, test_scene_different_size),        //